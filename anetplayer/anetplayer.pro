@@ -4,6 +4,9 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++17
 
+# Trace events of the hot paths, saved as Chrome trace JSON: qmake CONFIG+=trace
+trace: DEFINES += ANET_TRACE
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
@@ -11,25 +14,80 @@ CONFIG += c++17
 SOURCES += \
     about.cpp \
     artnetsender.cpp \
+    cli.cpp \
+    clock.cpp \
+    clocksync.cpp \
     cuebutton.cpp \
+    displayserver.cpp \
+    driftanalyzer.cpp \
+    eventtrack.cpp \
     filemanager.cpp \
+    frameclock.cpp \
+    framerate.cpp \
+    gobench.cpp \
+    interfacemonitor.cpp \
+    loopplayer.cpp \
+    ltc.cpp \
+    ltcexporter.cpp \
+    ltcoutput.cpp \
     main.cpp \
     mainwindow.cpp \
+    mediacache.cpp \
+    mediaprober.cpp \
+    mediawatcher.cpp \
+    oscserver.cpp \
+    playlistjournal.cpp \
+    redundancylink.cpp \
+    scrubengine.cpp \
     settings.cpp \
+    showrecorder.cpp \
+    soaktest.cpp \
+    startup.cpp \
     tcconverter.cpp \
-    tcwindow.cpp
+    tcgenerator.cpp \
+    tcrenderer.cpp \
+    tcwindow.cpp \
+    trace.cpp
 
 HEADERS += \
     about.h \
     artnetsender.h \
+    cli.h \
+    clock.h \
+    clocksync.h \
     cuebutton.h \
+    displayserver.h \
+    driftanalyzer.h \
+    eventtrack.h \
     filemanager.h \
+    frameclock.h \
+    framerate.h \
+    gobench.h \
+    interfacemonitor.h \
+    loopplayer.h \
+    ltc.h \
+    ltcexporter.h \
+    ltcoutput.h \
     mainwindow.h \
+    mediacache.h \
+    mediaprober.h \
+    mediawatcher.h \
+    oscserver.h \
+    playlistjournal.h \
+    redundancylink.h \
+    ringbuffer.h \
+    scrubengine.h \
     settings.h \
+    showrecorder.h \
+    soaktest.h \
+    startup.h \
     stretcher.h \
     struct.h \
     tcconverter.h \
-    tcwindow.h
+    tcgenerator.h \
+    tcrenderer.h \
+    tcwindow.h \
+    trace.h
 
 FORMS += \
     about.ui \
@@ -1,26 +1,122 @@
 #include "artnetsender.h"
+#include "framerate.h"
 
+#define ARTTIMECODE_STREAM_ID 13
+#define ARTTIMECODE_HEADER_SIZE 14
 
 ArtNetSender::ArtNetSender(QObject *parent)
     : QObject(parent)
-{}
+{
+    setDecks(QVector<deck_t>(1)); // Single deck with StreamId 0 until the decks are configured
+}
 
-bool ArtNetSender::sendTime(const QString &time)
+bool ArtNetSender::sendTime(const QString &time, int deck)
 {
+    TRACE_SCOPE("net", "ArtNetSender::sendTime");
+    if (!hasDestination(deck)) {
+        return false;
+    }
+    stream_t &stream = streams[deck];
+    const qint64 calledNs = clock->nowNs();
+
     QByteArray dmxData = convertTimeToByteArray(time);
-    if (prepareArtNetPacket(dmxData))
+    stream.packet.replace(ARTTIMECODE_HEADER_SIZE, dmxData.size(), dmxData);
+
+    // Sent at once, the frame edge is now
+    int sent = 0;
+    int destinations = 0;
+    if (stream.destinations.isEmpty()) {
+        ++destinations;
+        sent += udpSocket.writeDatagram(stream.packet, targetAddress, targetPort) == stream.packet.size();
+    } else {
+        for (const auto &destination : stream.destinations)
+        {
+            ++destinations;
+            sent += udpSocket.writeDatagram(stream.packet, destination.first, destination.second) == stream.packet.size();
+        }
+    }
+    // One message for a run of failures, not one per frame
+    if (sent < destinations && !stream.failing)
+        emit sendMsg(QString("WARNING! Art-Net timecode not sent to %1 of %2 destinations: %3")
+                         .arg(destinations - sent).arg(destinations).arg(udpSocket.errorString()));
+    else if (sent == destinations && stream.failing)
+        emit sendMsg("Art-Net timecode sent again");
+    stream.failing = sent < destinations;
+    if (sent == 0) return false;
+
+    const qint64 sentNs = clock->nowNs();
+    const char *data = stream.packet.constData();
+    if (recorder)
+        recorder->recordTimecode(static_cast<quint8>(data[ARTTIMECODE_STREAM_ID]), data + ARTTIMECODE_HEADER_SIZE);
+
+    // Timing stats of the stream
+    stream_stats_t &stats = stream.stats;
+    stats.maxLatencyMs = qMax(stats.maxLatencyMs, (sentNs - calledNs) / 1e6);
+    if (stats.packets > 0)
     {
-        return true;
+        const qint64 interval = sentNs - stream.lastSentNs;
+        stream.intervalSumNs += interval;
+        stats.meanIntervalMs = stream.intervalSumNs / 1e6 / stats.packets;
+        stats.maxIntervalMs = qMax(stats.maxIntervalMs, interval / 1e6);
+        const double period = framePeriodMs(static_cast<quint8>(data[ARTTIMECODE_HEADER_SIZE + 4]));
+        // Seeks and pauses aren't jitter
+        if (interval / 1e6 < 2 * period)
+            stats.maxJitterMs = qMax(stats.maxJitterMs, qAbs(interval / 1e6 - period));
     }
-    return false;
+    stream.lastSentNs = sentNs;
+    ++stats.packets;
+    return sent == destinations;
 }
 
-bool ArtNetSender::prepareArtNetPacket(const QByteArray &data)
+bool ArtNetSender::hasDestination(int deck) const
 {
-    if (targetAddress.isNull() && !(targetPort > 0)) {
+    if (deck < 0 || deck >= streams.size()) {
         return false;
     }
+    return !streams[deck].destinations.isEmpty() || (!targetAddress.isNull() && targetPort != 0);
+}
+
+void ArtNetSender::setDecks(const QVector<deck_t> &decks)
+{
+    streams.clear();
+    for (const deck_t &deck : decks)
+    {
+        stream_t stream;
+        stream.packet = prepareArtNetPacket(deck.streamId);
+        for (const destination_t &destination : deck.destinations)
+            stream.destinations.append(qMakePair(QHostAddress(destination.ip), destination.port));
+        streams.append(stream);
+    }
+}
+
+stream_stats_t ArtNetSender::getStreamStats(int deck) const
+{
+    if (deck < 0 || deck >= streams.size())
+        return stream_stats_t();
+    return streams[deck].stats;
+}
+
+void ArtNetSender::resetStreamStats()
+{
+    for (stream_t &stream : streams)
+    {
+        stream.stats = stream_stats_t();
+        stream.intervalSumNs = 0;
+    }
+}
 
+double ArtNetSender::framePeriodMs(quint8 type)
+{
+    switch (type) {
+    case 0: return 1000.0 / 24;
+    case 1: return 1000.0 / 25;
+    case 2: return 1001.0 / 30;
+    default: return 1000.0 / 30;
+    }
+}
+
+QByteArray ArtNetSender::prepareArtNetPacket(quint8 streamId)
+{
     QByteArray packet;
     packet.append("Art-Net\0", 8);               // Prefix "Art-Net"
     packet.append(static_cast<char>(0x00));      // OpCode for ArtNet Timecode (0x9700, little-endian)
@@ -28,20 +124,35 @@ bool ArtNetSender::prepareArtNetPacket(const QByteArray &data)
     packet.append(static_cast<char>(0x00));      // Protocol version
     packet.append(static_cast<char>(0x0E));      // Protocol version
     packet.append(static_cast<char>(0x00));      // Filler (ignored by receiver)
-    packet.append(static_cast<char>(0x00));      // StreamId
-    packet.append(data); // Add the actual data
+    packet.append(static_cast<char>(streamId));  // StreamId
+    packet.append(QByteArray(5, 0));             // Frames, seconds, minutes, hours, type
+    return packet;
+}
 
-    udpSocket.writeDatagram(packet, targetAddress, targetPort); // Send
-    return true;
+QByteArray ArtNetSender::timecodePacket(quint8 streamId, const QString &time, QString *error)
+{
+    QByteArray packet = prepareArtNetPacket(streamId);
+    const QByteArray dmxData = timeToByteArray(time, error);
+    packet.replace(ARTTIMECODE_HEADER_SIZE, dmxData.size(), dmxData);
+    return packet;
 }
 
 QByteArray ArtNetSender::convertTimeToByteArray(const QString &time)
+{
+    QString error;
+    QByteArray dmxData = timeToByteArray(time, &error);
+    if (!error.isEmpty())
+        emit sendMsg(error);
+    return dmxData;
+}
+
+QByteArray ArtNetSender::timeToByteArray(const QString &time, QString *error)
 {
     QByteArray dmxData(5, 0);
 
     QStringList timeParts = time.split(':');
     if (timeParts.size() != 5) {
-        emit sendMsg("Invalid time format. Expected format hh:mm:ss:ff:fps.");
+        if (error) *error = "Invalid time format. Expected format hh:mm:ss:ff:fps.";
         return dmxData;
     }
 
@@ -51,31 +162,13 @@ QByteArray ArtNetSender::convertTimeToByteArray(const QString &time)
     uint8_t seconds = timeParts[2].toInt(&ok);
     uint8_t frames = timeParts[3].toInt(&ok);
     uint8_t fps = timeParts[4].toInt(&ok);
-    uint8_t type = 0x00;
-        // 0 = Film (24fps)
-        // 1 = EBU (25fps)
-        // 2 = DF (29.97fps)
-        // 3 = SMPTE (30fps)
-    switch (fps) {
-    case 24:
-        type = 0x00;
-        break;
-    case 25:
-        type = 0x01;
-        break;
-    case 29:
-        type = 0x02;
-        break;
-    case 30:
-        type = 0x03;
-        break;
-    default:
-        break;
-    }
+    // Type of the rate in the frame: 0 = Film (24fps), 1 = EBU (25fps), 2 = DF (29.97fps), 3 = SMPTE (30fps)
+    const framerate_t *rate = frameRateOfTimebase(fps);
+    uint8_t type = rate ? rate->artnetType : 0x00;
 
     if (!ok)
     {
-        emit sendMsg("Invalid time values.");
+        if (error) *error = "Invalid time values.";
         return dmxData;
     }
 
@@ -89,42 +182,114 @@ QByteArray ArtNetSender::convertTimeToByteArray(const QString &time)
     return dmxData;
 }
 
-bool ArtNetSender::setNetworkInterface(const QString &interfaceName)
+bool ArtNetSender::setNetworkInterface(const QString &newInterfaceName)
 {
-    foreach (const QNetworkInterface &interface, QNetworkInterface::allInterfaces())
+    interfaceName = newInterfaceName;
+    QHostAddress address;
+    if (monitor)
+        address = monitor->ipv4Address(interfaceName);
+    else
     {
-        if (interface.humanReadableName() == interfaceName && interface.flags().testFlag(QNetworkInterface::IsUp))
+        foreach (const QNetworkInterface &interface, QNetworkInterface::allInterfaces())
         {
+            if (interface.humanReadableName() != interfaceName || !interface.flags().testFlag(QNetworkInterface::IsUp)) continue;
             foreach (const QNetworkAddressEntry &entry, interface.addressEntries())
             {
-                if (entry.ip().protocol() == QAbstractSocket::IPv4Protocol)
-                {
-                    if (udpSocket.state() != QAbstractSocket::UnconnectedState) {
-                        udpSocket.close();
-                    }
-                    udpSocket.bind(entry.ip(), targetPort, QUdpSocket::ShareAddress);
-                    emit sendMsg("Bound to interface: " + interfaceName + "  with IP: " + entry.ip().toString());
-                    return true;
-                }
+                if (entry.ip().protocol() == QAbstractSocket::IPv4Protocol && address.isNull())
+                    address = entry.ip();
             }
         }
     }
-    emit sendMsg("Failed to bind to interface:" + interfaceName);
-    return false;
+    if (address.isNull())
+    {
+        emit sendMsg("Failed to bind to interface:" + interfaceName);
+        return false;
+    }
+
+    if (udpSocket.state() != QAbstractSocket::UnconnectedState) {
+        udpSocket.close();
+    }
+    udpSocket.bind(address, targetPort, QUdpSocket::ShareAddress);
+    boundAddress = address;
+    emit sendMsg("Bound to interface: " + interfaceName + "  with IP: " + address.toString());
+    return true;
+}
+
+void ArtNetSender::setInterfaceMonitor(InterfaceMonitor *interfaceMonitor)
+{
+    if (monitor)
+        disconnect(monitor, nullptr, this, nullptr);
+    monitor = interfaceMonitor;
+    if (monitor)
+        connect(monitor, &InterfaceMonitor::interfacesChanged, this, &ArtNetSender::onInterfacesChanged);
+}
+
+// A replugged cable or a new lease, the socket follows the address of the selected interface
+void ArtNetSender::onInterfacesChanged()
+{
+    if (!monitor || interfaceName.isEmpty()) return;
+    const QHostAddress address = monitor->ipv4Address(interfaceName);
+    if (address == boundAddress) return;
+    if (address.isNull())
+    {
+        emit sendMsg("WARNING! Interface " + interfaceName + " is down, timecode goes out when it's back");
+        boundAddress = QHostAddress();
+        return; // The old socket is kept, a dead address only fails the sends
+    }
+    const qint64 changedNs = monitor->changedNs();
+    if (udpSocket.state() != QAbstractSocket::UnconnectedState) {
+        udpSocket.close();
+    }
+    if (!udpSocket.bind(address, targetPort, QUdpSocket::ShareAddress))
+    {
+        emit sendMsg("Failed to bind to interface:" + interfaceName);
+        return;
+    }
+    boundAddress = address;
+    emit sendMsg(QString("Rebound to interface %1 with IP %2, %3 ms after the change")
+                     .arg(interfaceName, address.toString())
+                     .arg((Clock::system()->nowNs() - changedNs) / 1e6, 0, 'f', 1));
 }
 
-QStringList ArtNetSender::getAvailableInterfaces()
+QStringList ArtNetSender::getAvailableInterfaces(bool rescan)
 {
-    QStringList interfaces;
+    // The scan asks the system for every address of every interface, GUI thread only
+    static QStringList interfaces;
+    static bool scanned = false;
+    if (scanned && !rescan) return interfaces;
+
+    TRACE_SCOPE("net", "ArtNetSender::getAvailableInterfaces");
+    interfaces.clear();
     foreach (const QNetworkInterface &interface, QNetworkInterface::allInterfaces())
     {
         if (interface.flags().testFlag(QNetworkInterface::IsUp) && !interface.addressEntries().isEmpty()) {
             interfaces.append(interface.humanReadableName());
         }
     }
+    scanned = true;
     return interfaces;
 }
 
+bool ArtNetSender::sendPacket(const QByteArray &packet, const QHostAddress &address, quint16 port)
+{
+    const QHostAddress &destination = address.isNull() ? targetAddress : address;
+    if (destination.isNull() || port == 0) {
+        return false;
+    }
+    return udpSocket.writeDatagram(packet, destination, port) == packet.size();
+}
+
+void ArtNetSender::setRecorder(ShowRecorder *showRecorder)
+{
+    recorder = showRecorder;
+}
+
+void ArtNetSender::setClock(Clock *newClock)
+{
+    clock = newClock;
+    resetStreamStats();
+}
+
 void ArtNetSender::setTargetIP(const QString &ipAddress)
 {
     targetAddress = QHostAddress(ipAddress);
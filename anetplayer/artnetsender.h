@@ -6,26 +6,78 @@
 #include <QString>
 #include <QHostAddress>
 #include <QNetworkInterface>
+#include <QVector>
+#include "struct.h"
+#include "showrecorder.h"
+#include "trace.h"
+#include "clock.h"
+#include "interfacemonitor.h"
 
+// Timing of one timecode stream
+typedef struct
+{
+    quint64 packets = 0;
+    double meanIntervalMs = 0;
+    double maxIntervalMs = 0;
+    double maxJitterMs = 0;   // Largest deviation of a packet interval from the frame period
+    double maxLatencyMs = 0;  // Largest time from the frame edge to the sent packet
+} stream_stats_t;
+
+// Sends the ArtTimeCode streams of all decks. Every frame edge is sent at
+// once with the StreamId of its deck to the deck's own destinations, the
+// decks share one socket.
 class ArtNetSender : public QObject
 {
     Q_OBJECT
 
 public:
     explicit ArtNetSender(QObject *parent = nullptr);
-    bool sendTime(const QString &time);
+    bool sendTime(const QString &time, int deck = 0); // Send the frame "hh:mm:ss:ff:fps" of the deck, false if any send failed
+    bool hasDestination(int deck) const; // The deck's own destinations or the Art-Net target
+    void setDecks(const QVector<deck_t> &decks);
+    stream_stats_t getStreamStats(int deck) const;
+    void resetStreamStats();
     bool setNetworkInterface(const QString &interfaceName);
-    static QStringList getAvailableInterfaces();
+    void setInterfaceMonitor(InterfaceMonitor *interfaceMonitor); // Rebinds when the interface changes
+    static QStringList getAvailableInterfaces(bool rescan = false); // Scanned once, again on rescan
     void setTargetIP(const QString &ipAddress);
     void setTargetPort(quint16 port = 6454);
+    bool sendPacket(const QByteArray &packet, const QHostAddress &address, quint16 port); // Null address: Art-Net target
+    void setRecorder(ShowRecorder *showRecorder); // Every sent timecode goes to the show log
+    void setClock(Clock *newClock); // Time base of the stream stats
+
+    // Complete ArtTimeCode packet of "hh:mm:ss:ff:fps", as the stream sends it
+    static QByteArray timecodePacket(quint8 streamId, const QString &time, QString *error = nullptr);
+
+private slots:
+    void onInterfacesChanged();
 
 private:
-    bool prepareArtNetPacket(const QByteArray &data);
+    typedef struct
+    {
+        QByteArray packet; // Prepared ArtTimeCode packet, the time is written in place
+        QVector<QPair<QHostAddress, quint16>> destinations;
+        bool failing = false; // The last frame wasn't sent everywhere
+        qint64 lastSentNs = 0;
+        qint64 intervalSumNs = 0;
+        stream_stats_t stats;
+    } stream_t;
+
+    static QByteArray prepareArtNetPacket(quint8 streamId);
     QByteArray convertTimeToByteArray(const QString &time);
+    static QByteArray timeToByteArray(const QString &time, QString *error);
+    static double framePeriodMs(quint8 type);
+
+    QVector<stream_t> streams; // One per deck
 
     QUdpSocket udpSocket;
+    InterfaceMonitor *monitor = nullptr;
+    QString interfaceName; // Selected in the settings
+    QHostAddress boundAddress; // Null: not bound to the interface
     QHostAddress targetAddress;
     quint16 targetPort = 0;
+    ShowRecorder *recorder = nullptr;
+    Clock *clock = Clock::system();
 
 signals:
     void sendMsg(const QString &msg);
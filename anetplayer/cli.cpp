@@ -0,0 +1,2131 @@
+#include "cli.h"
+#include <QTextStream>
+#include <QDateTime>
+#include <QTime>
+#include <QStringList>
+#include <QHash>
+#include <QCoreApplication>
+#include <QApplication>
+#include <QUdpSocket>
+#include <QThread>
+#include <QtEndian>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QDir>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QFile>
+#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include "showrecorder.h"
+#include "eventtrack.h"
+#include "gobench.h"
+#include "trace.h"
+#include "tcconverter.h"
+#include "driftanalyzer.h"
+#include "tcrenderer.h"
+#include "soaktest.h"
+#include "frameclock.h"
+#include "redundancylink.h"
+#include "clocksync.h"
+#include "tcgenerator.h"
+#include "artnetsender.h"
+#include "filemanager.h"
+#include "mediaprober.h"
+#include "loopplayer.h"
+#include "scrubengine.h"
+#include "ltcexporter.h"
+#include "ltcoutput.h"
+#include "framerate.h"
+
+#define CLI_ERROR 2
+#define CLI_DIFF_TOLERANCE_MS 2.0 // Default allowed timing difference of a frame
+#define CLI_DIFF_MAX_LINES 20     // Reported differences of each kind
+#define CLI_GOLDEN_MS 10000       // Length of every golden capture
+#define CLI_BENCH_RUNS 20
+#define CLI_BENCH_TIMEOUT_MS 3000  // Wait for the audio start of one run
+#define CLI_BENCH_PAUSE_MS 300     // Between stop and the next GO
+#define CLI_EVENT_COUNT 100000     // Events of the largest track
+#define CLI_EVENT_CUE_MS 3600000LL // The events are spread over a one hour cue
+#define CLI_EVENT_FPS 30
+#define CLI_EVENT_SEEKS 10000
+#define CLI_EVENT_MAX_MARKER_MS 10000
+#define CLI_PLAYLIST_CUES 10000
+#define CLI_PLAYLIST_COLUMNS 10
+#define CLI_PLAYLIST_RUNS 5
+#define CLI_WS_SECONDS 10
+#define CLI_TRACE_EVENTS 10000000
+#define CLI_SIM_REPORT_MS 10     // Position report interval of the simulated player
+#define CLI_SIM_PRINT_S 60       // Simulated seconds between the printed lines
+#define CLI_SIM_TIMER_JITTER_NS 500000
+#define CLI_STANDBY_SECONDS 30
+#define CLI_STANDBY_FPS 25
+#define CLI_SYNC_SECONDS 10
+#define CLI_SYNC_LEAD_MS 1000    // Shared GO time ahead of the request
+#define CLI_SYNC_MAX_SPREAD_US 1000.0
+#define CLI_GENERATOR_SECONDS 10
+#define CLI_GENERATOR_HOURS 24.0     // Simulated run of the exactness check
+#define CLI_GENERATOR_MAX_LATE_MS 2.0 // p95 of the loopback arrival after the frame edge
+#define CLI_LOOP_RATE 48000
+#define CLI_LOOP_COUNT 20
+#define CLI_LOOP_MAX_READ 8192       // Largest sink read of the loop check, in bytes
+#define CLI_SCRUB_SECONDS 10
+#define CLI_SCRUB_MOVES 500          // Slider moves per second, a fast mouse
+#define CLI_LTC_SECONDS 10
+#define CLI_LTC_CUES 4               // Cues of the round trip, every second one interleaved
+#define CLI_LTC_LOOPBACK_SECONDS 60
+#define CLI_LTC_LOOPBACK_PPM 200.0   // LTC sink clock against the playhead
+#define CLI_LTC_LOOPBACK_PERIOD_MS 10 // Sink read of the simulated audio thread
+#define CLI_LTC_LOOPBACK_START_MS 3590000 // Cue timecode at the GO, runs across the hour
+#define CLI_LTC_LOOPBACK_JUMP_MS 90000    // Locate in the middle of the run
+#define CLI_LTC_SETTLE_MS 200        // After the start and the locate, the LTC catches up
+#define CLI_LTC_MAX_FRAMES 0.25      // Allowed LTC to Art-Net difference
+
+static QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+static QTextStream &err()
+{
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+static QString tcLabel(const quint8 *tc)
+{
+    return QString("%1:%2:%3:%4")
+        .arg(tc[3], 2, 10, QChar('0'))
+        .arg(tc[2], 2, 10, QChar('0'))
+        .arg(tc[1], 2, 10, QChar('0'))
+        .arg(tc[0], 2, 10, QChar('0'));
+}
+
+static QString rateName(quint8 rateType)
+{
+    switch (rateType) {
+    case 0: return "24fps";
+    case 1: return "25fps";
+    case 2: return "29.97df";
+    case 3: return "30fps";
+    default: return "?fps";
+    }
+}
+
+static QString actionName(quint8 action)
+{
+    switch (action) {
+    case TRANSPORT_GO: return "GO";
+    case TRANSPORT_PLAY: return "PLAY";
+    case TRANSPORT_PAUSE: return "PAUSE";
+    case TRANSPORT_STOP: return "STOP";
+    case TRANSPORT_LOCATE: return "LOCATE";
+    case TRANSPORT_END: return "END";
+    default: return "?";
+    }
+}
+
+static QString positionText(qint64 ms)
+{
+    return QTime(0, 0).addMSecs(ms).toString("hh:mm:ss.zzz");
+}
+
+static QString secondsText(qint64 ns)
+{
+    return QString::number(ns / 1e9, 'f', 6);
+}
+
+// Stream, rate and label of a timecode record, the same frame sent by two shows has the same key
+static quint64 frameKey(const show_record_t &record)
+{
+    const int fps = (record.tc[4] == 0) ? 24 : (record.tc[4] == 1) ? 25 : 30;
+    const quint64 frame = ((quint64(record.tc[3]) * 60 + record.tc[2]) * 60 + record.tc[1]) * fps + record.tc[0];
+    return (quint64(record.streamId) << 40) | (quint64(record.tc[4]) << 32) | frame;
+}
+
+static bool readLog(const QString &fileName, show_log_t &log)
+{
+    QString error;
+    if (!ShowRecorder::readLog(fileName, log, &error))
+    {
+        err() << error << Qt::endl;
+        return false;
+    }
+    return true;
+}
+
+static int dumpLog(const QString &fileName)
+{
+    show_log_t log;
+    if (!readLog(fileName, log)) return CLI_ERROR;
+
+    out() << "Show log: " << fileName << Qt::endl;
+    out() << "Started:  " << QDateTime::fromMSecsSinceEpoch(log.startEpochMs).toString(Qt::ISODateWithMs) << Qt::endl;
+    out() << Qt::endl;
+
+    QHash<int, qint64> lastFrameTime; // Stream -> time of the previous packet
+    QHash<int, qint64> intervalSum;
+    QHash<int, qint64> intervalMax;
+    QHash<int, int> packets;
+    int transport = 0;
+    qint64 dropped = 0;
+
+    for (int i = 0; i < log.records.size(); ++i)
+    {
+        const show_record_t &r = log.records[i];
+        const qint64 t = r.timeNs - log.startNs;
+        out() << QString("%1  %2  ").arg(i, 8).arg(secondsText(t), 14);
+
+        switch (r.type) {
+        case SHOW_REC_TIMECODE:
+        {
+            out() << QString("TC      s%1  %2  %3").arg(r.streamId).arg(tcLabel(r.tc), rateName(r.tc[4]));
+            auto it = lastFrameTime.constFind(r.streamId);
+            if (it != lastFrameTime.constEnd())
+            {
+                const qint64 interval = r.timeNs - it.value();
+                out() << QString("  +%1ms").arg(interval / 1e6, 0, 'f', 3);
+                intervalSum[r.streamId] += interval;
+                intervalMax[r.streamId] = qMax(intervalMax.value(r.streamId), interval);
+            }
+            lastFrameTime[r.streamId] = r.timeNs;
+            ++packets[r.streamId];
+            break;
+        }
+        case SHOW_REC_TRANSPORT:
+            out() << QString("%1  cue %2  %3").arg(actionName(r.action), -6).arg(r.cue + 1).arg(positionText(r.value));
+            ++transport;
+            break;
+        case SHOW_REC_DROPPED:
+            out() << QString("DROPPED %1 records").arg(r.value);
+            dropped += r.value;
+            break;
+        case SHOW_REC_DRIFT:
+            out() << QString("DRIFT   cue %1  offset %2 ms  drift %3 ppm")
+                         .arg(r.cue + 1).arg(r.value / 1000.0, 0, 'f', 3).arg(r.value2 / 1000.0, 0, 'f', 3);
+            break;
+        }
+        out() << Qt::endl;
+    }
+
+    out() << Qt::endl << QString("%1 records, %2 transport actions, %3 dropped")
+                             .arg(log.records.size()).arg(transport).arg(dropped) << Qt::endl;
+    for (auto it = packets.constBegin(); it != packets.constEnd(); ++it)
+    {
+        const int intervals = it.value() - 1;
+        out() << QString("Stream %1: %2 timecode packets").arg(it.key()).arg(it.value());
+        if (intervals > 0)
+            out() << QString(", mean interval %1ms, max %2ms")
+                         .arg(intervalSum.value(it.key()) / 1e6 / intervals, 0, 'f', 3)
+                         .arg(intervalMax.value(it.key()) / 1e6, 0, 'f', 3);
+        out() << Qt::endl;
+    }
+    return 0;
+}
+
+// Timecode frames are matched by stream and label, timing is compared after
+// removing the constant offset of the first common frame.
+// Transport actions are compared in order.
+static int diffLogs(const QString &fileA, const QString &fileB, double toleranceMs)
+{
+    show_log_t a, b;
+    if (!readLog(fileA, a) || !readLog(fileB, b)) return CLI_ERROR;
+
+    // First time every frame was sent
+    auto frameTimes = [](const show_log_t &log, QVector<quint64> &order) {
+        QHash<quint64, qint64> times;
+        for (const show_record_t &r : log.records)
+        {
+            if (r.type != SHOW_REC_TIMECODE) continue;
+            const quint64 key = frameKey(r);
+            if (!times.contains(key))
+            {
+                times.insert(key, r.timeNs);
+                order.append(key);
+            }
+        }
+        return times;
+    };
+    QVector<quint64> orderA, orderB;
+    const QHash<quint64, qint64> timesA = frameTimes(a, orderA);
+    const QHash<quint64, qint64> timesB = frameTimes(b, orderB);
+
+    auto keyLabel = [](quint64 key) {
+        const quint8 stream = static_cast<quint8>(key >> 40);
+        const quint8 rateType = static_cast<quint8>(key >> 32);
+        const int fps = (rateType == 0) ? 24 : (rateType == 1) ? 25 : 30;
+        qint64 frame = static_cast<qint64>(key & 0xFFFFFFFF);
+        quint8 tc[5];
+        tc[0] = frame % fps; frame /= fps;
+        tc[1] = frame % 60; frame /= 60;
+        tc[2] = frame % 60;
+        tc[3] = static_cast<quint8>(frame / 60);
+        return QString("s%1 %2 %3").arg(stream).arg(tcLabel(tc), rateName(rateType));
+    };
+
+    int differences = 0;
+
+    int onlyA = 0;
+    for (quint64 key : orderA)
+    {
+        if (timesB.contains(key)) continue;
+        if (onlyA++ < CLI_DIFF_MAX_LINES)
+            out() << "Only in A: " << keyLabel(key) << Qt::endl;
+    }
+    int onlyB = 0;
+    for (quint64 key : orderB)
+    {
+        if (timesA.contains(key)) continue;
+        if (onlyB++ < CLI_DIFF_MAX_LINES)
+            out() << "Only in B: " << keyLabel(key) << Qt::endl;
+    }
+    differences += onlyA + onlyB;
+
+    bool haveOffset = false;
+    qint64 offset = 0;
+    int common = 0;
+    int late = 0;
+    double sumAbs = 0;
+    double maxAbs = 0;
+    for (quint64 key : orderA)
+    {
+        auto it = timesB.constFind(key);
+        if (it == timesB.constEnd()) continue;
+        const qint64 delta = it.value() - timesA.value(key);
+        if (!haveOffset)
+        {
+            offset = delta;
+            haveOffset = true;
+        }
+        const double deviationMs = (delta - offset) / 1e6;
+        sumAbs += qAbs(deviationMs);
+        maxAbs = qMax(maxAbs, qAbs(deviationMs));
+        ++common;
+        if (qAbs(deviationMs) > toleranceMs)
+        {
+            if (late++ < CLI_DIFF_MAX_LINES)
+                out() << QString("Timing: %1 differs by %2ms").arg(keyLabel(key)).arg(deviationMs, 0, 'f', 3) << Qt::endl;
+        }
+    }
+    differences += late;
+
+    QVector<show_record_t> transportA, transportB;
+    for (const show_record_t &r : a.records)
+        if (r.type == SHOW_REC_TRANSPORT) transportA.append(r);
+    for (const show_record_t &r : b.records)
+        if (r.type == SHOW_REC_TRANSPORT) transportB.append(r);
+    const int transportCount = qMin(transportA.size(), transportB.size());
+    int transportDiffs = static_cast<int>(qAbs(transportA.size() - transportB.size()));
+    for (int i = 0; i < transportCount; ++i)
+    {
+        const show_record_t &ra = transportA[i];
+        const show_record_t &rb = transportB[i];
+        if (ra.action == rb.action && ra.cue == rb.cue) continue;
+        if (transportDiffs++ < CLI_DIFF_MAX_LINES)
+            out() << QString("Transport #%1: A %2 cue %3, B %4 cue %5")
+                         .arg(i).arg(actionName(ra.action)).arg(ra.cue + 1)
+                         .arg(actionName(rb.action)).arg(rb.cue + 1) << Qt::endl;
+    }
+    differences += transportDiffs;
+
+    out() << Qt::endl
+          << QString("Frames: %1 common, %2 only in A, %3 only in B").arg(common).arg(onlyA).arg(onlyB) << Qt::endl
+          << QString("Timing: offset %1ms, mean deviation %2ms, max %3ms, %4 over %5ms")
+                 .arg(offset / 1e6, 0, 'f', 3)
+                 .arg(common ? sumAbs / common : 0.0, 0, 'f', 3)
+                 .arg(maxAbs, 0, 'f', 3)
+                 .arg(late)
+                 .arg(toleranceMs) << Qt::endl
+          << QString("Transport: %1 in A, %2 in B, %3 differ")
+                 .arg(transportA.size()).arg(transportB.size()).arg(transportDiffs) << Qt::endl;
+
+    return differences > 0 ? 1 : 0;
+}
+
+static QString percentiles(QVector<double> values)
+{
+    if (values.isEmpty()) return "no data";
+    std::sort(values.begin(), values.end());
+    auto at = [&values](double p) { return values[qMin<int>(values.size() - 1, static_cast<int>(p * values.size()))]; };
+    return QString("min %1  median %2  p95 %3  max %4 ms")
+        .arg(values.first(), 0, 'f', 3)
+        .arg(at(0.5), 0, 'f', 3)
+        .arg(at(0.95), 0, 'f', 3)
+        .arg(values.last(), 0, 'f', 3);
+}
+
+// Loopback benchmark against a running player: /cue/N/go is sent, the player
+// replies /cue/N/started with its own datagram-to-audio latency in microseconds
+static int oscBench(const QString &host, quint16 port, int cue, int runs)
+{
+    QUdpSocket socket;
+    if (!socket.bind(QHostAddress::AnyIPv4, 0))
+    {
+        err() << "Can't open a UDP socket" << Qt::endl;
+        return CLI_ERROR;
+    }
+    const QHostAddress target(host);
+    const QByteArray go = EventTrack::encodeOsc(QString("/cue/%1/go").arg(cue), 1);
+    const QByteArray stop = EventTrack::encodeOsc(QString("/cue/%1/stop").arg(cue), 1);
+    const QByteArray started = QString("/cue/%1/started").arg(cue).toUtf8();
+
+    QVector<double> roundTrip;
+    QVector<double> playerLatency;
+    out() << QString("%1  %2  %3").arg("run", 4).arg("round trip ms", 14).arg("player ms", 10) << Qt::endl;
+    for (int run = 0; run < runs; ++run)
+    {
+        const qint64 sentNs = ShowRecorder::now();
+        socket.writeDatagram(go, target, port);
+
+        bool replied = false;
+        while (!replied && socket.waitForReadyRead(CLI_BENCH_TIMEOUT_MS))
+        {
+            while (socket.hasPendingDatagrams())
+            {
+                char buffer[512];
+                const qint64 size = socket.readDatagram(buffer, sizeof(buffer));
+                const qint64 receivedNs = ShowRecorder::now();
+                // Address, ",i", big-endian int
+                const int addressSize = (started.size() + 4) & ~3;
+                if (size < addressSize + 8 || memcmp(buffer, started.constData(), started.size() + 1) != 0)
+                    continue;
+                const double player = qFromBigEndian<qint32>(buffer + addressSize + 4) / 1000.0;
+                const double total = (receivedNs - sentNs) / 1e6;
+                roundTrip.append(total);
+                playerLatency.append(player);
+                out() << QString("%1  %2  %3").arg(run + 1, 4).arg(total, 14, 'f', 3).arg(player, 10, 'f', 3) << Qt::endl;
+                replied = true;
+            }
+        }
+        if (!replied)
+            out() << QString("%1  timeout").arg(run + 1, 4) << Qt::endl;
+
+        socket.writeDatagram(stop, target, port);
+        QThread::msleep(CLI_BENCH_PAUSE_MS);
+    }
+
+    out() << Qt::endl
+          << "Round trip:        " << percentiles(roundTrip) << Qt::endl
+          << "Message to audio:  " << percentiles(playerLatency) << Qt::endl;
+    return roundTrip.size() == runs ? 0 : 1;
+}
+
+// Load test of the display server: N WebSocket clients count the frames and
+// the delay from publish to receive. Run on the player host, the frames
+// carry the monotonic send time of the player.
+static int wsLoad(const QString &host, quint16 port, int clients, int seconds)
+{
+    typedef struct
+    {
+        QTcpSocket *socket;
+        QByteArray buffer;
+        bool upgraded = false;
+        qint64 frames = 0;
+    } ws_client_t;
+
+    QVector<ws_client_t> list(clients);
+    QVector<double> latency;
+    latency.reserve(clients * seconds * 30);
+
+    for (int i = 0; i < clients; ++i)
+    {
+        QTcpSocket *socket = new QTcpSocket(qApp);
+        list[i].socket = socket;
+        QObject::connect(socket, &QTcpSocket::connected, socket, [socket, &host, port]() {
+            quint32 key[4];
+            QRandomGenerator::global()->fillRange(key);
+            socket->write("GET /ws HTTP/1.1\r\n"
+                          "Host: " + host.toUtf8() + ":" + QByteArray::number(port) + "\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: " + QByteArray(reinterpret_cast<const char*>(key), sizeof(key)).toBase64() + "\r\n"
+                          "Sec-WebSocket-Version: 13\r\n\r\n");
+        });
+        QObject::connect(socket, &QTcpSocket::readyRead, socket, [&list, &latency, i]() {
+            ws_client_t &client = list[i];
+            client.buffer.append(client.socket->readAll());
+            if (!client.upgraded)
+            {
+                const int headerEnd = client.buffer.indexOf("\r\n\r\n");
+                if (headerEnd < 0) return;
+                if (!client.buffer.startsWith("HTTP/1.1 101"))
+                {
+                    client.socket->abort();
+                    return;
+                }
+                client.upgraded = true;
+                client.buffer.remove(0, headerEnd + 4);
+            }
+
+            // Server frames are not masked
+            while (client.buffer.size() >= 2)
+            {
+                const uchar *d = reinterpret_cast<const uchar*>(client.buffer.constData());
+                qint64 length = d[1] & 0x7F;
+                int pos = 2;
+                if (length == 126)
+                {
+                    if (client.buffer.size() < 4) return;
+                    length = qFromBigEndian<quint16>(d + 2);
+                    pos = 4;
+                }
+                else if (length == 127)
+                {
+                    if (client.buffer.size() < 10) return;
+                    length = qFromBigEndian<quint64>(d + 2);
+                    pos = 10;
+                }
+                if (client.buffer.size() < pos + length) return;
+
+                if ((d[0] & 0x0F) == 0x1)
+                {
+                    const qint64 receivedUs = ShowRecorder::now() / 1000;
+                    const QJsonObject frame = QJsonDocument::fromJson(client.buffer.mid(pos, length)).object();
+                    if (frame.contains("us"))
+                        latency.append((receivedUs - frame.value("us").toInteger()) / 1000.0);
+                    ++client.frames;
+                }
+                client.buffer.remove(0, pos + length);
+            }
+        });
+        socket->connectToHost(host, port);
+    }
+
+    QTimer::singleShot(seconds * 1000, qApp, &QCoreApplication::quit);
+    QCoreApplication::exec();
+
+    int upgraded = 0;
+    qint64 total = 0;
+    qint64 fewest = std::numeric_limits<qint64>::max();
+    qint64 most = 0;
+    for (const ws_client_t &client : list)
+    {
+        if (client.upgraded) ++upgraded;
+        total += client.frames;
+        fewest = qMin(fewest, client.frames);
+        most = qMax(most, client.frames);
+    }
+
+    out() << QString("Clients:  %1 of %2 connected").arg(upgraded).arg(clients) << Qt::endl
+          << QString("Frames:   %1 total, %2 per client per second, fewest %3, most %4")
+                 .arg(total).arg(total / double(clients) / seconds, 0, 'f', 1).arg(fewest).arg(most) << Qt::endl
+          << "Delay:    " << percentiles(latency) << Qt::endl;
+    return (upgraded == clients && fewest > 0) ? 0 : 1;
+}
+
+// Offline run of the timecode path on a virtual clock. The player reports a
+// position every few ms from an audio clock with the given error, the 1 ms
+// timer interpolates from the last report exactly like CueButton::updateTime
+// and the frame edges go to the analyzer. The true offset is known here, so
+// the analyzer estimate is checked against it.
+static int driftSim(double seconds, double fps, double audioPpm, int reportMs)
+{
+    TCconverter converter;
+    DriftAnalyzer analyzer;
+    analyzer.reset(fps);
+    QRandomGenerator random(1); // Same timer jitter on every run
+
+    const qint64 endNs = static_cast<qint64>(seconds * 1e9);
+    const double audioRate = 1.0 + audioPpm * 1e-6;
+    qint64 nextReportNs = 0;
+    qint64 lastKnownPosition = 0;
+    qint64 restartNs = 0;
+    quint8 prevff = 255;
+    double trueSum = 0;
+    qint64 trueCount = 0;
+    double trueLast = 0;
+    qint64 nextPrintNs = qint64(CLI_SIM_PRINT_S) * 1000000000;
+
+    QElapsedTimer wall;
+    wall.start();
+    out() << QString("%1  %2  %3  %4  %5  %6")
+                 .arg("time s", 8).arg("offset ms", 10).arg("jitter ms", 10).arg("drift ppm", 10)
+                 .arg("audio ppm", 10).arg("true ms", 10) << Qt::endl;
+    for (qint64 tick = 1; ; ++tick)
+    {
+        const qint64 timerNs = tick * 1000000 + random.bounded(CLI_SIM_TIMER_JITTER_NS);
+        if (timerNs > endNs) break;
+
+        // Position reports due before this timer tick
+        while (nextReportNs <= timerNs)
+        {
+            lastKnownPosition = static_cast<qint64>(nextReportNs / 1e6 * audioRate);
+            restartNs = nextReportNs;
+            analyzer.addAudioPosition(lastKnownPosition, nextReportNs);
+            nextReportNs += qint64(reportMs) * 1000000;
+        }
+
+        // CueButton::updateTime, QElapsedTimer::elapsed() counts whole ms
+        const qint64 currentPosition = lastKnownPosition + (timerNs - restartNs) / 1000000;
+        const timecode_t tc = converter.milliseconds2tc(currentPosition, fps);
+        if (tc.ff != prevff)
+        {
+            prevff = tc.ff;
+            const qint64 frame = static_cast<qint64>(currentPosition * fps / 1000);
+            analyzer.addFrameEdge(frame, timerNs);
+            trueLast = timerNs / 1e6 * audioRate - frame * 1000.0 / fps;
+            trueSum += trueLast;
+            ++trueCount;
+        }
+
+        if (timerNs >= nextPrintNs)
+        {
+            nextPrintNs += qint64(CLI_SIM_PRINT_S) * 1000000000;
+            const drift_stats_t stats = analyzer.stats();
+            out() << QString("%1  %2  %3  %4  %5  %6")
+                         .arg(timerNs / 1e9, 8, 'f', 0)
+                         .arg(stats.offsetMs, 10, 'f', 3)
+                         .arg(stats.jitterMs, 10, 'f', 3)
+                         .arg(stats.driftPpm, 10, 'f', 2)
+                         .arg(stats.audioClockPpm, 10, 'f', 1)
+                         .arg(trueLast, 10, 'f', 3) << Qt::endl;
+        }
+    }
+
+    const drift_stats_t stats = analyzer.stats();
+    const double wallS = qMax<qint64>(1, wall.elapsed()) / 1000.0;
+    out() << Qt::endl
+          << QString("%1 frame edges over %2 s, simulated in %3 s (%4x real time)")
+                 .arg(stats.edges).arg(seconds, 0, 'f', 0).arg(wallS, 0, 'f', 2).arg(seconds / wallS, 0, 'f', 0) << Qt::endl
+          << QString("Offset %1 .. %2 ms, mean true offset %3 ms")
+                 .arg(stats.minOffsetMs, 0, 'f', 3).arg(stats.maxOffsetMs, 0, 'f', 3)
+                 .arg(trueCount ? trueSum / trueCount : 0, 0, 'f', 3) << Qt::endl
+          << QString("Drift %1 ppm, audio clock %2 ppm (simulated %3 ppm)")
+                 .arg(stats.driftPpm, 0, 'f', 2).arg(stats.audioClockPpm, 0, 'f', 1).arg(audioPpm, 0, 'f', 1) << Qt::endl;
+    return 0;
+}
+
+// The second argument is a playlist and a cue number, or a duration in ms and a framerate
+static int renderPcap(const QStringList &args)
+{
+    render_options_t options;
+    bool isDuration = false;
+    options.durationMs = args[2].toLongLong(&isDuration);
+    if (isDuration)
+    {
+        options.fps = TimecodeRenderer::frameRateValue(args[3]);
+        options.adjustmentMs = (args.size() >= 5) ? args[4].toLongLong() : 0;
+    }
+    else
+    {
+        FileManager fileManager;
+        QObject::connect(&fileManager, &FileManager::sendMsg, [](const QString &msg) { err() << msg << Qt::endl; });
+        playlist_t playlist;
+        if (!fileManager.readPlaylist(args[2], playlist)) return CLI_ERROR;
+        const int index = args[3].toInt() - 1;
+        if (index < 0 || index >= playlist.cues.size() || playlist.cues[index].filePath.isEmpty())
+        {
+            err() << "No cue " << args[3] << " in " << args[2] << Qt::endl;
+            return CLI_ERROR;
+        }
+        const cue_t &cue = playlist.cues[index];
+        const media_info_t info = MediaProber::probeFile(cue.filePath);
+        if (info.durationMs <= 0)
+        {
+            err() << "Can't get the duration of " << cue.filePath << Qt::endl;
+            return CLI_ERROR;
+        }
+        options.durationMs = info.durationMs;
+        options.fps = TimecodeRenderer::frameRateValue((args.size() >= 5) ? args[4] : cue.frameRate);
+        options.adjustmentMs = cue.adjustmentTime;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<render_packet_t> packets = TimecodeRenderer::render(options);
+    if (!TimecodeRenderer::writePcap(args[1], packets))
+    {
+        err() << "Can't write " << args[1] << Qt::endl;
+        return CLI_ERROR;
+    }
+    out() << QString("%1 packets, %2 at %3 fps, offset %4 ms, rendered in %5 ms")
+                 .arg(packets.size()).arg(positionText(options.durationMs)).arg(options.fps)
+                 .arg(options.adjustmentMs).arg(timer.elapsed()) << Qt::endl;
+    return 0;
+}
+
+// Golden file check: timestamps and payloads must match exactly
+static int comparePcap(const QString &fileA, const QString &fileB)
+{
+    QVector<render_packet_t> a;
+    QVector<render_packet_t> b;
+    QString error;
+    if (!TimecodeRenderer::readPcap(fileA, a, &error) || !TimecodeRenderer::readPcap(fileB, b, &error))
+    {
+        err() << error << Qt::endl;
+        return CLI_ERROR;
+    }
+
+    int differences = 0;
+    const int count = qMin(a.size(), b.size());
+    for (int i = 0; i < count && differences < CLI_DIFF_MAX_LINES; ++i)
+    {
+        if (a[i].timeUs == b[i].timeUs && a[i].data == b[i].data) continue;
+        ++differences;
+        const quint8 *tcA = reinterpret_cast<const quint8*>(a[i].data.constData()) + 14;
+        const quint8 *tcB = reinterpret_cast<const quint8*>(b[i].data.constData()) + 14;
+        out() << QString("Packet %1: %2 us %3  |  %4 us %5").arg(i + 1)
+                     .arg(a[i].timeUs).arg(a[i].data.size() >= 19 ? tcLabel(tcA) : "?")
+                     .arg(b[i].timeUs).arg(b[i].data.size() >= 19 ? tcLabel(tcB) : "?") << Qt::endl;
+    }
+    if (a.size() != b.size())
+    {
+        out() << QString("Packet count differs: %1 and %2").arg(a.size()).arg(b.size()) << Qt::endl;
+        ++differences;
+    }
+    if (differences == 0)
+        out() << QString("Identical, %1 packets").arg(a.size()) << Qt::endl;
+    return differences > 0 ? 1 : 0;
+}
+
+typedef struct
+{
+    const char *file;
+    const char *frameRate;
+    qint64 adjustmentMs;
+} golden_case_t;
+
+// The captures in golden/, every rate, an offset across the first dropped
+// frames of 29.97 and a negative one across the 24 hour wrap
+static const golden_case_t goldenCases[] = {
+    {"tc24.pcap", "24", 0},
+    {"tc25.pcap", "25", 0},
+    {"tc2997.pcap", "29.97", 0},
+    {"tc30.pcap", "30", 0},
+    {"tc2997_offset.pcap", "29.97", 55000},
+    {"tc25_negative.pcap", "25", -3000},
+};
+
+// Renders every golden case and compares the written capture byte by byte.
+// "write" renders the golden files instead, after a change of the output
+// that is meant. The files in golden/ come from "write", never from
+// another tool, so a failure is always a change of this renderer.
+static int renderCheck(const QString &dirPath, bool write)
+{
+    QTemporaryDir tempDir;
+    if (!write && !tempDir.isValid())
+    {
+        err() << "Can't create a temporary directory" << Qt::endl;
+        return CLI_ERROR;
+    }
+
+    int failed = 0;
+    for (const golden_case_t &golden : goldenCases)
+    {
+        render_options_t options;
+        options.durationMs = CLI_GOLDEN_MS;
+        options.fps = TimecodeRenderer::frameRateValue(golden.frameRate);
+        options.adjustmentMs = golden.adjustmentMs;
+        const QVector<render_packet_t> packets = TimecodeRenderer::render(options);
+
+        const QString goldenPath = QDir(dirPath).filePath(golden.file);
+        const QString path = write ? goldenPath : tempDir.filePath(golden.file);
+        if (!TimecodeRenderer::writePcap(path, packets))
+        {
+            err() << "Can't write " << path << Qt::endl;
+            return CLI_ERROR;
+        }
+        if (write)
+        {
+            out() << QString("%1: %2 packets written").arg(golden.file).arg(packets.size()) << Qt::endl;
+            continue;
+        }
+
+        QFile rendered(path);
+        QFile expected(goldenPath);
+        if (!expected.open(QIODevice::ReadOnly))
+        {
+            err() << "Can't open " << goldenPath << Qt::endl;
+            return CLI_ERROR;
+        }
+        if (!rendered.open(QIODevice::ReadOnly))
+        {
+            err() << "Can't open " << path << Qt::endl;
+            return CLI_ERROR;
+        }
+        const QByteArray a = rendered.readAll();
+        const QByteArray b = expected.readAll();
+        if (a == b)
+        {
+            out() << QString("%1: identical, %2 packets").arg(golden.file).arg(packets.size()) << Qt::endl;
+            continue;
+        }
+
+        ++failed;
+        int offset = 0;
+        while (offset < a.size() && offset < b.size() && a[offset] == b[offset]) ++offset;
+        out() << QString("%1: FAILED, first difference at byte %2 (%3 and %4 bytes)")
+                     .arg(golden.file).arg(offset).arg(a.size()).arg(b.size()) << Qt::endl;
+        comparePcap(path, goldenPath);
+    }
+    if (!write)
+        out() << (failed ? QString("%1 golden captures differ").arg(failed) : QString("All golden captures match")) << Qt::endl;
+    return failed > 0 ? 1 : 0;
+}
+
+// Hot standby on loopback with two processes: start the backup, then the
+// primary. The primary plays a simulated cue and exits after the given time
+// without a goodbye, as a crashed machine. The backup follows it on its own
+// clock and reports how fast and how cleanly it took over.
+static int standbyTest(const QString &role, quint16 port, int seconds)
+{
+    TCconverter converter;
+    RedundancyLink link;
+    QObject::connect(&link, &RedundancyLink::sendMsg, [](const QString &msg) { err() << msg << Qt::endl; });
+    Clock *clock = Clock::system();
+    FrameClock frameClock(clock);
+    frameClock.setFramerate(CLI_STANDBY_FPS);
+    ClockTimer *timer = clock->createTimer(qApp);
+
+    if (role == "primary")
+    {
+        if (!link.start(REDUNDANCY_PRIMARY, "127.0.0.1", port)) return CLI_ERROR;
+        const qint64 startNs = clock->nowNs();
+        qint64 reportNs = 0;
+        timecode_t lastTc = {};
+        QObject::connect(timer, &ClockTimer::timeout, [&]() {
+            // The simulated player reports its position every few ms
+            const qint64 nowNs = clock->nowNs();
+            if (nowNs - reportNs >= CLI_SIM_REPORT_MS * 1000000LL)
+            {
+                reportNs = nowNs;
+                frameClock.setAudioPosition((nowNs - startNs) / 1000000);
+            }
+            timecode_t tc;
+            if (!frameClock.nextFrame(frameClock.position(), tc)) return;
+            heartbeat_t heartbeat;
+            heartbeat.state = HEARTBEAT_PLAYING;
+            heartbeat.cue = 0;
+            heartbeat.samplePosition = frameClock.reportedPosition();
+            heartbeat.positionNs = frameClock.reportTimeNs();
+            heartbeat.frame = tc;
+            heartbeat.frame.fps = 1; // ArtTimeCode type of 25 fps
+            link.publish(heartbeat);
+            lastTc = tc;
+        });
+        timer->start(1);
+        QTimer::singleShot(seconds * 1000, qApp, &QCoreApplication::quit);
+        QCoreApplication::exec();
+        link.stop();
+        out() << "Primary stopped after " << converter.tc2string(lastTc) << Qt::endl;
+        return 0;
+    }
+
+    if (!link.start(REDUNDANCY_BACKUP, "127.0.0.1", port)) return CLI_ERROR;
+    heartbeat_t last;
+    qint64 heardNs = 0;
+    bool following = false;
+    int seeks = 0;
+    QVector<double> lockErrors;
+    QObject::connect(&link, &RedundancyLink::heartbeatsPending, [&]() {
+        heartbeat_t heartbeat;
+        while (link.takeHeartbeat(heartbeat))
+        {
+            if (!link.isStandby()) continue;
+            last = heartbeat;
+            heardNs = clock->nowNs();
+            if (heartbeat.state != HEARTBEAT_PLAYING) continue;
+            // The muted cue of the backup runs on the local clock, seeks only when it's off
+            const double target = RedundancyLink::playheadMs(heartbeat, heardNs);
+            if (!following)
+            {
+                following = true;
+                frameClock.setAudioPosition(qRound64(target));
+                out() << "Following the primary at " << positionText(qRound64(target)) << Qt::endl;
+                continue;
+            }
+            const double error = target - frameClock.position();
+            lockErrors.append(qAbs(error));
+            if (qAbs(error) > 40)
+            {
+                frameClock.setAudioPosition(qRound64(target));
+                ++seeks;
+            }
+        }
+    });
+
+    bool continuous = false;
+    bool tookOver = false;
+    double detectMs = 0;
+    QObject::connect(&link, &RedundancyLink::primaryLost, [&]() {
+        tookOver = true;
+        detectMs = (clock->nowNs() - heardNs) / 1e6;
+        timecode_t tc = converter.milliseconds2tc(frameClock.position(), CLI_STANDBY_FPS);
+        timecode_t primaryTc = last.frame;
+        primaryTc.fps = CLI_STANDBY_FPS;
+        // The backup ran on through the silence, it continues where the primary would be now
+        const qint64 step = converter.ndftc2frames(tc) - converter.ndftc2frames(primaryTc);
+        const qint64 silentFrames = static_cast<qint64>(detectMs * CLI_STANDBY_FPS / 1000);
+        continuous = (step >= silentFrames && step <= silentFrames + 1);
+        out() << QString("Took over %1 ms after the last heartbeat").arg(detectMs, 0, 'f', 1) << Qt::endl
+              << QString("Primary's last frame %1, first backup frame %2, step %3 frames")
+                     .arg(converter.tc2string(primaryTc), converter.tc2string(tc)).arg(step) << Qt::endl
+              << "Lock error: " << percentiles(lockErrors) << QString(", %1 seeks").arg(seeks) << Qt::endl;
+        QCoreApplication::quit();
+    });
+    QTimer::singleShot(2 * seconds * 1000, qApp, &QCoreApplication::quit); // Started before the primary
+    QCoreApplication::exec();
+    if (!tookOver)
+    {
+        err() << (following ? "The primary didn't stop" : "No heartbeats from the primary") << Qt::endl;
+        return 1;
+    }
+    // Within a frame of the limit, the backup's next frame edge
+    return (continuous && detectMs < RedundancyLink::silenceLimitMs(1) + 1000.0 / CLI_STANDBY_FPS) ? 0 : 1;
+}
+
+// System clock with a known offset and rate error, the client of the sync
+// test runs on it so the estimate can be checked against the truth
+class SkewedClock : public Clock
+{
+public:
+    SkewedClock(double offsetMs, double ppm)
+        : originNs(Clock::system()->nowNs()), offsetNs(offsetMs * 1e6), rate(1 + ppm / 1e6) {}
+    qint64 nowNs() const override
+    {
+        return originNs + static_cast<qint64>((Clock::system()->nowNs() - originNs) * rate + offsetNs);
+    }
+    ClockTimer *createTimer(QObject *parent = nullptr) override { return Clock::system()->createTimer(parent); }
+
+private:
+    qint64 originNs;
+    double offsetNs;
+    double rate;
+};
+
+// Start of a synced GO: a timer to a few ms before, then a spin on the clock of the sync
+static void fireAt(ClockSync &sync, Clock *clock, const sync_go_t &go, std::function<void()> fire)
+{
+    const int timerMs = static_cast<int>((sync.toLocal(go.sharedNs) - clock->nowNs()) / 1000000) - SYNC_SPIN_MS;
+    QTimer::singleShot(qMax(0, timerMs), Qt::PreciseTimer, qApp, [&sync, clock, go, fire]() {
+        while (clock->nowNs() < sync.toLocal(go.sharedNs)) {}
+        fire();
+    });
+}
+
+// Synced GO of several processes on one machine: start the master, then
+// clients with different clock offsets and rates. Halfway through the run
+// the master schedules a GO, every client reports the true system time it
+// started at, and the master prints the spread.
+static int syncTest(const QStringList &args)
+{
+    const bool master = (args[1] == "master");
+    const QString host = master ? QString("127.0.0.1") : args[2];
+    const quint16 port = args[master ? 2 : 3].toUShort();
+    const int first = master ? 3 : 4;
+    const int seconds = qMax(1, (args.size() > first) ? args[first].toInt() : CLI_SYNC_SECONDS * (master ? 1 : 2));
+    const double offsetMs = (!master && args.size() > first + 1) ? args[first + 1].toDouble() : 0;
+    const double ppm = (!master && args.size() > first + 2) ? args[first + 2].toDouble() : 0;
+
+    SkewedClock skewed(offsetMs, ppm);
+    Clock *clock = master ? Clock::system() : &skewed;
+    ClockSync sync;
+    QObject::connect(&sync, &ClockSync::sendMsg, [](const QString &msg) { err() << msg << Qt::endl; });
+    // Any interface, the clients of the test can be on other hosts
+    if (!sync.start(master ? SYNC_MASTER : SYNC_CLIENT, host, port, QHostAddress(QHostAddress::AnyIPv4), clock)) return CLI_ERROR;
+
+    // The clients report on the next port
+    QUdpSocket reports;
+    if (master && !reports.bind(QHostAddress::AnyIPv4, port + 1))
+    {
+        err() << "Can't open the report port " << port + 1 << Qt::endl;
+        return CLI_ERROR;
+    }
+    QVector<qint64> firedNs;
+    QObject::connect(&reports, &QUdpSocket::readyRead, [&]() {
+        while (reports.hasPendingDatagrams())
+        {
+            const QStringList fields = QString::fromLatin1(reports.receiveDatagram().data()).split(' ');
+            if (fields.size() != 6 || fields[0] != "fired") continue;
+            firedNs.append(fields[1].toLongLong());
+            out() << QString("Client: offset error %1 us, jitter %2 us, path delay %3 us, drift %4 ppm")
+                         .arg(fields[2], fields[3], fields[4], fields[5]) << Qt::endl;
+        }
+    });
+
+    bool fired = false;
+    QObject::connect(&sync, &ClockSync::goPending, [&]() {
+        sync_go_t go;
+        while (sync.takeGo(go))
+        {
+            fireAt(sync, clock, go, [&]() {
+                const qint64 trueNs = Clock::system()->nowNs();
+                fired = true;
+                if (master)
+                {
+                    firedNs.append(trueNs);
+                    out() << QString("GO of cue %1").arg(go.cue + 1) << Qt::endl;
+                    return;
+                }
+                const sync_stats_t stats = sync.getStats();
+                const double trueOffsetUs = (trueNs - clock->nowNs()) / 1000.0;
+                const QString report = QString("fired %1 %2 %3 %4 %5").arg(trueNs)
+                                           .arg(stats.offsetUs - trueOffsetUs, 0, 'f', 1)
+                                           .arg(stats.jitterUs, 0, 'f', 1)
+                                           .arg(stats.pathDelayUs, 0, 'f', 1)
+                                           .arg(stats.driftPpm, 0, 'f', 2);
+                QUdpSocket socket;
+                socket.writeDatagram(report.toLatin1(), QHostAddress(host), port + 1);
+                out() << report << Qt::endl;
+                QCoreApplication::quit();
+            });
+        }
+    });
+
+    if (master)
+        QTimer::singleShot(seconds * 500, qApp, [&]() {
+            sync.scheduleGo(0, sync.sharedNow() + CLI_SYNC_LEAD_MS * 1000000LL);
+        });
+    QTimer::singleShot(seconds * 1000, qApp, &QCoreApplication::quit);
+    QCoreApplication::exec();
+    sync.stop();
+    if (!fired)
+    {
+        err() << (master ? "The GO didn't come back" : "No GO from the master") << Qt::endl;
+        return 1;
+    }
+    if (!master) return 0;
+    if (firedNs.size() < 2)
+    {
+        err() << "No client reported" << Qt::endl;
+        return 1;
+    }
+    const auto range = std::minmax_element(firedNs.begin(), firedNs.end());
+    const double spreadUs = (*range.second - *range.first) / 1000.0;
+    out() << QString("%1 players, GO spread %2 us").arg(firedNs.size()).arg(spreadUs, 0, 'f', 1) << Qt::endl;
+    return spreadUs < CLI_SYNC_MAX_SPREAD_US ? 0 : 1;
+}
+
+// Frame number of an ArtTimeCode packet, -1 if it isn't one
+static qint64 packetFrame(const char *data, qint64 size, TCconverter &converter)
+{
+    if (size < 19 || memcmp(data, "Art-Net", 8) != 0 || data[8] != 0x00 || data[9] != char(0x97)) return -1;
+    const quint8 *d = reinterpret_cast<const quint8*>(data);
+    timecode_t tc = {d[17], d[16], d[15], d[14], 0};
+    static const quint8 rates[] = {24, 25, 29, 30};
+    tc.fps = rates[qMin<int>(d[18], 3)];
+    return (tc.fps == 29) ? converter.dftc2frames(tc) : converter.ndftc2frames(tc);
+}
+
+// Generator accuracy. A simulated day checks the frame count and that every
+// frame is sent after its exact rational edge and within 1 ms. Then the
+// generator runs on the monotonic clock through an ArtNetSender to a
+// loopback socket, the arrival of every packet is compared with its edge.
+static int generatorBench(const QString &framerate, int seconds, double hours)
+{
+    TCconverter converter;
+    const double fps = (framerate == "29.97") ? 30000.0 / 1001 : framerate.toDouble();
+    const qint64 framesPerDay = (framerate == "29.97") ? 2589408 : qRound64(fps) * 86400;
+    int failures = 0;
+
+    // Exactness on the simulated clock
+    {
+        SimulatedClock clock;
+        TimecodeGenerator generator(nullptr, &clock);
+        generator.setFrameRate(framerate);
+        qint64 frames = 0;
+        qint64 expected = 0;
+        qint64 errors = 0;
+        double maxLateMs = 0;
+        QObject::connect(&generator, &TimecodeGenerator::frameChanged, [&](const QString &time) {
+            const QByteArray packet = ArtNetSender::timecodePacket(0, time);
+            const qint64 frame = packetFrame(packet.constData(), packet.size(), converter);
+            const double lateMs = (clock.nowNs() - generator.frameEdgeNs(generator.frame())) / 1e6;
+            maxLateMs = qMax(maxLateMs, lateMs);
+            if (frame != expected % framesPerDay || lateMs < 0 || lateMs >= 1.0)
+            {
+                if (errors < CLI_DIFF_MAX_LINES)
+                    err() << QString("Frame %1: sent %2 at %3 ms after the edge").arg(expected).arg(time).arg(lateMs, 0, 'f', 3) << Qt::endl;
+                ++errors;
+            }
+            ++frames;
+            expected = generator.frame() + 1;
+        });
+        generator.start();
+        const qint64 durationNs = static_cast<qint64>(hours * 3600e9);
+        clock.advanceTo(durationNs);
+        const qint64 exact = static_cast<qint64>(std::floor(durationNs / 1e9 * fps + 1e-9)) + 1; // The frame at 0 too
+        out() << QString("Simulated %1 h at %2 fps: %3 frames, expected %4, %5 errors, max %6 ms after the edge")
+                     .arg(hours).arg(framerate).arg(frames).arg(exact).arg(errors).arg(maxLateMs, 0, 'f', 3) << Qt::endl;
+        if (frames != exact || errors > 0) ++failures;
+    }
+
+    // Loopback on the monotonic clock, the receiver has its own thread
+    std::atomic<bool> stopRequested{false};
+    std::promise<quint16> bound;
+    std::future<quint16> port = bound.get_future();
+    QVector<QPair<qint64, qint64>> arrivals; // Frame, receive time
+    QThread *receiver = QThread::create([&]() {
+        QUdpSocket socket;
+        bound.set_value(socket.bind(QHostAddress::LocalHost, 0) ? socket.localPort() : 0);
+        TCconverter receiverConverter;
+        char buffer[64];
+        while (!stopRequested.load(std::memory_order_relaxed))
+        {
+            if (!socket.waitForReadyRead(20)) continue;
+            while (socket.hasPendingDatagrams())
+            {
+                const qint64 size = socket.readDatagram(buffer, sizeof(buffer));
+                const qint64 receivedNs = Clock::system()->nowNs();
+                const qint64 frame = packetFrame(buffer, size, receiverConverter);
+                if (frame >= 0) arrivals.append(qMakePair(frame, receivedNs));
+            }
+        }
+    });
+    receiver->start();
+    const quint16 receiverPort = port.get();
+    if (receiverPort == 0)
+    {
+        stopRequested = true;
+        receiver->wait();
+        delete receiver;
+        err() << "Can't open the loopback socket" << Qt::endl;
+        return CLI_ERROR;
+    }
+
+    ArtNetSender sender;
+    sender.setTargetIP("127.0.0.1");
+    sender.setTargetPort(receiverPort);
+    TimecodeGenerator generator;
+    generator.setFrameRate(framerate);
+    QObject::connect(&generator, &TimecodeGenerator::frameChanged, [&sender](const QString &time) { sender.sendTime(time); });
+    QObject::connect(&generator, &TimecodeGenerator::finished, qApp, &QCoreApplication::quit);
+    generator.runFor(seconds * 1000LL);
+    QCoreApplication::exec();
+    stopRequested = true;
+    receiver->wait();
+    delete receiver;
+
+    QVector<double> lateMs;
+    int gaps = 0;
+    for (int i = 0; i < arrivals.size(); ++i)
+    {
+        lateMs.append((arrivals[i].second - generator.frameEdgeNs(arrivals[i].first)) / 1e6);
+        if (i > 0 && (arrivals[i].first - arrivals[i - 1].first + framesPerDay) % framesPerDay != 1) ++gaps;
+    }
+    std::sort(lateMs.begin(), lateMs.end());
+    const double p95 = lateMs.isEmpty() ? 0 : lateMs[qMin<int>(lateMs.size() - 1, static_cast<int>(0.95 * lateMs.size()))];
+    const qint64 expectedPackets = static_cast<qint64>(seconds * fps);
+    out() << QString("Loopback %1 s: %2 packets, expected %3, %4 gaps").arg(seconds).arg(arrivals.size()).arg(expectedPackets).arg(gaps) << Qt::endl
+          << "Arrival after the frame edge: " << percentiles(lateMs) << Qt::endl;
+    if (arrivals.size() != expectedPackets || gaps > 0 || p95 > CLI_GENERATOR_MAX_LATE_MS) ++failures;
+    return failures > 0 ? 1 : 0;
+}
+
+static bool parseTimecode(const QString &text, double fps, timecode_t &tc)
+{
+    static const QRegularExpression format("^(\\d{2}):(\\d{2}):(\\d{2}):(\\d{2})$");
+    const QRegularExpressionMatch match = format.match(text);
+    if (!match.hasMatch()) return false;
+    tc = {static_cast<uint8_t>(match.captured(1).toInt()), static_cast<uint8_t>(match.captured(2).toInt()),
+          static_cast<uint8_t>(match.captured(3).toInt()), static_cast<uint8_t>(match.captured(4).toInt()),
+          static_cast<uint8_t>(fps)};
+    return true;
+}
+
+// Frame of a cue position, the conversion of a playing cue
+static qint64 positionFrame(qint64 ms, double fps, TCconverter &converter)
+{
+    const timecode_t tc = converter.milliseconds2tc(ms, fps);
+    return (static_cast<int>(fps) == 29) ? converter.dftc2frames(tc) : converter.ndftc2frames(tc);
+}
+
+// Loop accuracy without an audio device. A ramp, where every sample holds
+// its own index, is cut into the region from random decoder blocks and read
+// in random sizes as a sink does, through the loop count. Every sample must
+// follow the previous one or wrap from out - 1 to in. Then the timecode of
+// every heard sample is checked: jump back returns to the in frame at each
+// wrap, continue counts on without a repeated or skipped frame. Last the
+// frames the cue timer sends with each policy, on the simulated clock.
+static int loopCheck(const QString &inText, const QString &outText, double fps, int sampleRate, int loops)
+{
+    TCconverter converter;
+    timecode_t inTc, outTc;
+    if (!parseTimecode(inText, fps, inTc) || !parseTimecode(outText, fps, outTc))
+    {
+        err() << "Timecodes must be hh:mm:ss:ff" << Qt::endl;
+        return CLI_ERROR;
+    }
+    const bool dropFrame = static_cast<int>(fps) == 29;
+    const qint64 inFrame = dropFrame ? converter.dftc2frames(inTc) : converter.ndftc2frames(inTc);
+    const qint64 outFrame = dropFrame ? converter.dftc2frames(outTc) : converter.ndftc2frames(outTc);
+    if (outFrame <= inFrame)
+    {
+        err() << "The out point must be after the in point" << Qt::endl;
+        return CLI_ERROR;
+    }
+
+    const qint64 inSample = LoopBuffer::frameSample(inFrame, fps, sampleRate);
+    const qint64 outSample = LoopBuffer::frameSample(outFrame, fps, sampleRate);
+    const double exactLength = (outFrame - inFrame) * sampleRate / fps;
+    int failures = 0;
+    out() << QString("Loop %1-%2 at %3 fps, %4 Hz: samples %5-%6, %7 per loop, %8 from the frame count")
+                 .arg(inText, outText).arg(fps).arg(sampleRate).arg(inSample).arg(outSample).arg(outSample - inSample).arg(exactLength, 0, 'f', 1) << Qt::endl;
+    if (std::fabs((outSample - inSample) - exactLength) > sampleRate / 1000.0 + 1) ++failures; // Edges snap to whole ms
+
+    // Region cut from decoder blocks of random size
+    LoopBuffer buffer;
+    buffer.setFormat(sizeof(qint32), sampleRate);
+    buffer.setRegion(inSample - static_cast<qint64>(LOOP_PREROLL_MS) * sampleRate / 1000, inSample, outSample);
+    QRandomGenerator random(1);
+    QVector<qint32> block;
+    for (qint64 decoded = 0; !buffer.isComplete(); )
+    {
+        block.resize(random.bounded(1, 4096));
+        for (int i = 0; i < block.size(); ++i)
+            block[i] = static_cast<qint32>(decoded + i);
+        buffer.append(reinterpret_cast<const char*>(block.constData()), block.size() * sizeof(qint32), decoded);
+        decoded += block.size();
+    }
+
+    // Sink reads from the hand-over point
+    const qint64 start = qMax(buffer.getFirstSample(), inSample - static_cast<qint64>(LOOP_HANDOFF_MS) * sampleRate / 1000);
+    buffer.seek(start);
+    const qint64 total = (inSample - start) + loops * (outSample - inSample);
+    QByteArray chunk(CLI_LOOP_MAX_READ, '\0');
+    qint64 played = 0;
+    qint64 expected = start;
+    qint64 audioErrors = 0;
+    qint64 shortReads = 0;
+    while (played < total)
+    {
+        const qint64 maxBytes = random.bounded(1, CLI_LOOP_MAX_READ + 1);
+        const qint64 bytes = buffer.read(chunk.data(), maxBytes);
+        if (bytes != maxBytes / qint64(sizeof(qint32)) * qint64(sizeof(qint32))) ++shortReads;
+        const qint32 *samples = reinterpret_cast<const qint32*>(chunk.constData());
+        for (qint64 i = 0; i < bytes / qint64(sizeof(qint32)); ++i, ++played)
+        {
+            if (expected >= outSample) expected = inSample;
+            if (samples[i] != expected || buffer.audioSample(played) != expected)
+            {
+                if (audioErrors < CLI_DIFF_MAX_LINES)
+                    err() << QString("Sample %1: %2, expected %3").arg(played).arg(samples[i]).arg(expected) << Qt::endl;
+                ++audioErrors;
+            }
+            ++expected;
+        }
+    }
+    out() << QString("Audio: %1 samples from %2 through %3 wraps, %4 wrong, %5 short reads")
+                 .arg(played).arg(start).arg(buffer.wrapsAfter(played)).arg(audioErrors).arg(shortReads) << Qt::endl;
+    if (audioErrors > 0 || shortReads > 0 || buffer.wrapsAfter(played) != loops) ++failures;
+
+    // Timecode of every heard sample with both policies
+    const loop_tc_mode_t modes[] = {LOOP_TC_JUMP, LOOP_TC_CONTINUE};
+    for (loop_tc_mode_t mode : modes)
+    {
+        qint64 errors = 0;
+        qint64 jumps = 0;
+        qint64 previous = positionFrame(LoopBuffer::sampleMs(buffer.timecodeSample(0, mode), sampleRate), fps, converter);
+        for (qint64 p = 1; p < total; ++p)
+        {
+            const qint64 frame = positionFrame(LoopBuffer::sampleMs(buffer.timecodeSample(p, mode), sampleRate), fps, converter);
+            if (frame == previous || frame == previous + 1)
+            {
+                previous = frame;
+                continue;
+            }
+            // Only the jump back from the last frame of the loop to its first frame is allowed
+            const bool wrap = (mode == LOOP_TC_JUMP && previous == outFrame - 1 && frame == inFrame
+                               && buffer.audioSample(p) == inSample);
+            if (wrap)
+                ++jumps;
+            else
+            {
+                if (errors < CLI_DIFF_MAX_LINES)
+                    err() << QString("Sample %1: frame %2 after %3").arg(p).arg(frame).arg(previous) << Qt::endl;
+                ++errors;
+            }
+            previous = frame;
+        }
+        const qint64 expectedJumps = (mode == LOOP_TC_JUMP) ? buffer.wrapsAfter(total - 1) : 0;
+        out() << QString("Timecode %1: %2 jumps back to %3, %4 errors")
+                     .arg(mode == LOOP_TC_JUMP ? "jump back" : "continue").arg(jumps).arg(inText).arg(errors) << Qt::endl;
+        if (errors > 0 || jumps != expectedJumps) ++failures;
+    }
+
+    // The same through the cue: the 1 ms timer interpolates the playhead from
+    // the last report of the sink, which reads every few ms, and maps it with
+    // the timecode policy. Every sent frame must follow the previous one, jump
+    // back returns from the last frame to the in frame and never sends out.
+    const qint64 outMs = LoopBuffer::sampleMs(outSample, sampleRate);
+    const qint64 totalNs = total * 1000000000LL / sampleRate;
+    for (loop_tc_mode_t mode : modes)
+    {
+        SimulatedClock clock;
+        FrameClock frameClock(&clock);
+        frameClock.setFramerate(fps);
+        frameClock.setAudioPosition(LoopBuffer::sampleMs(buffer.timecodeSample(0, mode), sampleRate));
+        qint64 played = 0;
+        qint64 nextReadNs = 0;
+        qint64 previous = -1;
+        qint64 sent = 0;
+        qint64 jumps = 0;
+        qint64 errors = 0;
+        ClockTimer *timer = clock.createTimer();
+        QObject::connect(timer, &ClockTimer::timeout, [&]() {
+            const qint64 nowNs = clock.nowNs();
+            if (nowNs >= nextReadNs)
+            {
+                played = nowNs * sampleRate / 1000000000LL;
+                nextReadNs = nowNs + random.bounded(CLI_SIM_REPORT_MS / 2, CLI_SIM_REPORT_MS * 2 + 1) * 1000000LL;
+                const qint64 position = LoopBuffer::sampleMs(buffer.timecodeSample(played, mode), sampleRate);
+                if (position != frameClock.reportedPosition())
+                    frameClock.setAudioPosition(position);
+            }
+            const qint64 position = LoopBuffer::timecodePlayheadMs(frameClock.position(), outMs, mode);
+            timecode_t tc;
+            if (!frameClock.nextFrame(position, tc)) return;
+            const qint64 frame = positionFrame(position, fps, converter);
+            ++sent;
+            const bool next = (previous < 0 || frame == previous + 1) && (mode != LOOP_TC_JUMP || frame < outFrame);
+            if (mode == LOOP_TC_JUMP && previous == outFrame - 1 && frame == inFrame)
+                ++jumps;
+            else if (!next)
+            {
+                if (errors < CLI_DIFF_MAX_LINES)
+                    err() << QString("%1 ms: sent frame %2 after %3").arg(nowNs / 1000000).arg(frame).arg(previous) << Qt::endl;
+                ++errors;
+            }
+            previous = frame;
+        });
+        timer->start(1);
+        clock.advanceTo(totalNs);
+        delete timer;
+
+        const qint64 expectedJumps = (mode == LOOP_TC_JUMP) ? buffer.wrapsAfter(played) : 0;
+        out() << QString("Cue timer %1: %2 frames sent, %3 jumps back, %4 errors")
+                     .arg(mode == LOOP_TC_JUMP ? "jump back" : "continue").arg(sent).arg(jumps).arg(errors) << Qt::endl;
+        if (errors > 0 || jumps != expectedJumps || sent == 0) ++failures;
+    }
+    return failures > 0 ? 1 : 0;
+}
+
+// Slider drag on the simulated clock: a sweep back and forth with the move
+// rate of a fast mouse. Seeks and locates must stay within their rates, every
+// seek must go to the grid step of the target of that moment and the release
+// must seek exactly to the last position. A click without a move must seek
+// nothing, a slow drag within one step only once.
+static int scrubSim(int seconds, int movesPerSecond)
+{
+    SimulatedClock clock;
+    int failures = 0;
+    {
+        ScrubEngine scrub(nullptr, &clock);
+        qint64 target = 0;
+        qint64 staleSeeks = 0;
+        qint64 lastSeekNs = -1;
+        qint64 minSeekGapNs = std::numeric_limits<qint64>::max();
+        qint64 exactSeek = -1;
+        QObject::connect(&scrub, &ScrubEngine::seekRequested, [&](qint64 positionMs, bool exact) {
+            if (exact)
+            {
+                exactSeek = positionMs;
+                return;
+            }
+            if (positionMs != ScrubEngine::coarsePosition(target)) ++staleSeeks;
+            if (lastSeekNs >= 0) minSeekGapNs = qMin(minSeekGapNs, clock.nowNs() - lastSeekNs);
+            lastSeekNs = clock.nowNs();
+        });
+
+        const qint64 durationMs = 300000; // Five minute cue, swept every two seconds
+        const qint64 stepNs = 1000000000LL / movesPerSecond;
+        scrub.press(0);
+        for (qint64 i = 0; i < static_cast<qint64>(seconds) * movesPerSecond; ++i)
+        {
+            clock.advanceTo(i * stepNs);
+            const double phase = std::fmod(i * stepNs / 2e9, 1.0);
+            target = static_cast<qint64>(durationMs * (phase < 0.5 ? 2 * phase : 2 - 2 * phase));
+            scrub.move(target);
+        }
+        clock.advanceTo(static_cast<qint64>(seconds) * 1000000000LL);
+        scrub.release(target);
+
+        const qint64 maxSeeks = static_cast<qint64>(seconds) * 1000 / SCRUB_SEEK_INTERVAL_MS + 2;
+        const qint64 maxLocates = static_cast<qint64>(seconds) * 1000 / SCRUB_LOCATE_INTERVAL_MS + 2;
+        out() << QString("%1 moves in %2 s: %3 seeks (at most %4), %5 locates (at most %6)")
+                     .arg(scrub.moveCount()).arg(seconds).arg(scrub.seekCount()).arg(maxSeeks)
+                     .arg(scrub.locateCount()).arg(maxLocates) << Qt::endl
+              << QString("Shortest gap between seeks %1 ms, %2 stale seeks, release sought %3 ms of %4 ms")
+                     .arg(minSeekGapNs / 1e6, 0, 'f', 1).arg(staleSeeks).arg(exactSeek).arg(target) << Qt::endl;
+        if (scrub.seekCount() > maxSeeks || scrub.locateCount() > maxLocates || staleSeeks > 0
+            || minSeekGapNs < SCRUB_SEEK_INTERVAL_MS * 1000000LL || exactSeek != target)
+            ++failures;
+
+        // A click on the slider without a drag
+        exactSeek = -1;
+        scrub.press(target);
+        clock.advance(100000000LL);
+        scrub.release(target);
+        out() << QString("Click without a move: %1").arg(exactSeek < 0 ? "no seek" : "sought " + QString::number(exactSeek) + " ms") << Qt::endl;
+        if (exactSeek >= 0 || scrub.seekCount() > 0 || scrub.locateCount() > 0) ++failures;
+
+        // A slow drag inside one step of the grid, a move every 50 ms
+        const qint64 stepStart = ScrubEngine::coarsePosition(target);
+        scrub.press(stepStart);
+        for (qint64 offset = 1; offset < SCRUB_COARSE_STEP_MS; offset += 10)
+        {
+            clock.advance(50000000LL);
+            scrub.move(stepStart + offset);
+        }
+        const qint64 dragSeeks = scrub.seekCount();
+        scrub.cancel();
+        out() << QString("Slow drag within %1 ms: %2 seeks, %3 locates")
+                     .arg(SCRUB_COARSE_STEP_MS).arg(dragSeeks).arg(scrub.locateCount()) << Qt::endl;
+        if (dragSeeks != 1) ++failures;
+    }
+    return failures > 0 ? 1 : 0;
+}
+
+// LTC tracks of all cues of a playlist, rendered in parallel
+static int ltcExport(const QString &playlistFile, const QString &outputDir, bool interleave)
+{
+    FileManager fileManager;
+    QObject::connect(&fileManager, &FileManager::sendMsg, [](const QString &msg) { err() << msg << Qt::endl; });
+    playlist_t playlist;
+    if (!fileManager.readPlaylist(playlistFile, playlist)) return CLI_ERROR;
+    const QVector<ltc_export_job_t> jobs = LtcExporter::jobsFor(playlist.cues, outputDir, interleave);
+    if (jobs.isEmpty())
+    {
+        err() << "No cues with files in " << playlistFile << Qt::endl;
+        return CLI_ERROR;
+    }
+    if (!QDir().mkpath(outputDir))
+    {
+        err() << "Can't create " << outputDir << Qt::endl;
+        return CLI_ERROR;
+    }
+
+    LtcExporter exporter;
+    int result = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QObject::connect(&exporter, &LtcExporter::cueExported, [](const QString &outputPath, bool ok, const QString &error) {
+        if (ok) out() << outputPath << Qt::endl;
+        else err() << error << Qt::endl;
+    });
+    QObject::connect(&exporter, &LtcExporter::exportFinished, [&](int total, int failed) {
+        out() << QString("%1 cues, %2 failed, %3 ms on %4 threads")
+                     .arg(total).arg(failed).arg(timer.elapsed()).arg(QThread::idealThreadCount()) << Qt::endl;
+        result = (failed > 0) ? 1 : 0;
+        QCoreApplication::quit();
+    });
+    exporter.exportCues(jobs);
+    QCoreApplication::exec();
+    return result;
+}
+
+static QString tcText(const timecode_t &tc)
+{
+    return QString::asprintf("%02d:%02d:%02d:%02d", tc.hh, tc.mm, tc.ss, tc.ff);
+}
+
+// Programme sample of the round trip, every value differs from its neighbours
+static qint16 ltcProgrammeSample(qint64 frame, int channel)
+{
+    return static_cast<qint16>((frame * 7 + channel * 1000) % 30000 - 15000);
+}
+
+// Exports cues of known timecode through the thread pool and reads them back:
+// every decoded frame must follow the previous one, carry the drop frame flag
+// and the user bits of its cue and start on the sample the exact rate puts
+// it. The programme channels of the interleaved files must come out unchanged.
+static int ltcRoundtrip(const QString &frameRate, int sampleRate, int seconds)
+{
+    QTemporaryDir dir;
+    if (!dir.isValid())
+    {
+        err() << "Can't create a temporary folder" << Qt::endl;
+        return CLI_ERROR;
+    }
+    const framerate_t &rate = frameRateOf(frameRate);
+    const qint64 frames = static_cast<qint64>(seconds) * sampleRate;
+
+    // Stereo 16 bit programme
+    const QString programmePath = dir.filePath("programme.wav");
+    {
+        QFile file(programmePath);
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            err() << "Can't write " << programmePath << Qt::endl;
+            return CLI_ERROR;
+        }
+        file.write(LtcExporter::wavHeader(1, 2, sampleRate, 16, frames));
+        QByteArray data(frames * 4, '\0');
+        uchar *p = reinterpret_cast<uchar*>(data.data());
+        for (qint64 i = 0; i < frames; ++i, p += 4)
+        {
+            qToLittleEndian<qint16>(ltcProgrammeSample(i, 0), p);
+            qToLittleEndian<qint16>(ltcProgrammeSample(i, 1), p + 2);
+        }
+        file.write(data);
+    }
+
+    // Starts off the frame edges, across a minute, ten minutes and the hour
+    const qint64 adjustments[CLI_LTC_CUES] = {0, 59000 + 17, 599000 + 250, 3599000 + 123};
+    QVector<ltc_export_job_t> jobs;
+    for (int c = 0; c < CLI_LTC_CUES; ++c)
+    {
+        ltc_export_job_t job;
+        job.mediaPath = programmePath;
+        job.outputPath = dir.filePath(LtcExporter::outputName(c + 1, programmePath));
+        job.frameRate = rate.name;
+        job.adjustmentMs = adjustments[c];
+        job.durationMs = seconds * 1000LL;
+        job.sampleRate = sampleRate;
+        job.userBits = LtcExporter::cueUserBits(c + 1) | 0xABC00000;
+        job.interleave = (c % 2 == 0);
+        jobs.append(job);
+    }
+
+    int failures = 0;
+    QElapsedTimer timer;
+    timer.start();
+    {
+        LtcExporter exporter;
+        QObject::connect(&exporter, &LtcExporter::cueExported, [&failures](const QString &, bool ok, const QString &error) {
+            if (ok) return;
+            err() << error << Qt::endl;
+            ++failures;
+        });
+        QObject::connect(&exporter, &LtcExporter::exportFinished, qApp, &QCoreApplication::quit);
+        exporter.exportCues(jobs);
+        QCoreApplication::exec();
+    }
+    out() << QString("%1 cues of %2 s at %3 fps, %4 Hz exported in %5 ms")
+                 .arg(CLI_LTC_CUES).arg(seconds).arg(rate.name).arg(sampleRate).arg(timer.elapsed()) << Qt::endl;
+    if (failures > 0) return 1;
+
+    TCconverter converter;
+    for (const ltc_export_job_t &job : jobs)
+    {
+        QVector<ltc_frame_t> decoded;
+        QString error;
+        if (!LtcExporter::decodeFile(job.outputPath, rate.fps, decoded, &error))
+        {
+            err() << error << Qt::endl;
+            ++failures;
+            continue;
+        }
+
+        // First whole frame of the cue and the sample every frame starts on
+        const qint64 scale = 1000 * rate.rateNum;
+        const qint64 firstFrame = (job.adjustmentMs * rate.rateNum + 1000 * rate.rateDen - 1) / (1000 * rate.rateDen);
+        int errors = 0;
+        qint64 maxOffset = 0;
+        for (int i = 0; i < decoded.size(); ++i)
+        {
+            timecode_t tc = decoded[i].tc;
+            tc.fps = static_cast<uint8_t>(rate.timebase);
+            const qint64 frame = rate.dropFrame ? converter.dftc2frames(tc) : converter.ndftc2frames(tc);
+            const qint64 exact = (frame * rate.rateDen * 1000 - job.adjustmentMs * rate.rateNum) * sampleRate;
+            const qint64 sample = (exact + scale - 1) / scale;
+            maxOffset = qMax(maxOffset, qAbs(decoded[i].sample - sample));
+            if (frame != firstFrame + i || decoded[i].dropFrame != rate.dropFrame
+                || decoded[i].userBits != job.userBits || qAbs(decoded[i].sample - sample) > 1)
+            {
+                if (errors < CLI_DIFF_MAX_LINES)
+                    err() << QString("Frame %1: %2 at sample %3, expected frame %4 at sample %5")
+                                 .arg(i).arg(tcText(tc)).arg(decoded[i].sample).arg(firstFrame + i).arg(sample) << Qt::endl;
+                ++errors;
+            }
+        }
+        // Only the partial frames at the two ends are lost
+        const qint64 expectedFrames = frames * rate.rateNum / (sampleRate * rate.rateDen) - 2;
+
+        // Programme channels as they were
+        qint64 programmeErrors = 0;
+        if (job.interleave)
+        {
+            QFile file(job.outputPath);
+            ltc_wav_t wav;
+            if (!file.open(QIODevice::ReadOnly) || !LtcExporter::readWav(file, wav) || wav.channels != 3 || wav.frames != frames)
+                programmeErrors = frames;
+            else
+            {
+                file.seek(wav.dataPos);
+                const QByteArray data = file.read(frames * wav.blockAlign);
+                const uchar *p = reinterpret_cast<const uchar*>(data.constData());
+                for (qint64 s = 0; s < data.size() / wav.blockAlign; ++s, p += wav.blockAlign)
+                {
+                    if (qFromLittleEndian<qint16>(p) != ltcProgrammeSample(s, 0)
+                        || qFromLittleEndian<qint16>(p + 2) != ltcProgrammeSample(s, 1))
+                        ++programmeErrors;
+                }
+            }
+        }
+
+        out() << QString("%1: %2 frames from %3, %4 errors, max %5 samples off%6")
+                     .arg(QFileInfo(job.outputPath).fileName()).arg(decoded.size())
+                     .arg(decoded.isEmpty() ? QString("-") : tcText(decoded.first().tc))
+                     .arg(errors).arg(maxOffset)
+                     .arg(job.interleave ? QString(", %1 programme samples changed").arg(programmeErrors) : QString()) << Qt::endl;
+        if (errors > 0 || decoded.size() < expectedFrames || programmeErrors > 0) ++failures;
+    }
+    return failures > 0 ? 1 : 0;
+}
+
+// Live LTC against the Art-Net timecode without audio hardware. The cue
+// playhead runs on the simulated clock and sends Art-Net whenever its frame
+// changes, the LTC sink reads blocks on its own clock that runs ppm off,
+// behind the modelled buffer. Every decoded LTC frame must be heard within
+// a fraction of a frame of the Art-Net packet of the same timecode, also
+// after a locate in the middle of the run.
+static int ltcLoopback(const QString &frameRate, int seconds, double ppm)
+{
+    const framerate_t &rate = frameRateOf(frameRate);
+    const int sampleRate = LTC_EXPORT_SAMPLE_RATE;
+    const qint64 period = sampleRate * CLI_LTC_LOOPBACK_PERIOD_MS / 1000;
+    const qint64 bufferFrames = sampleRate * LTC_OUTPUT_BUFFER_MS / 1000;
+    const double sinkRate = sampleRate * (1 + ppm * 1e-6); // Samples per second of the simulated clock
+    const double frameNs = 1e9 * rate.rateDen / rate.rateNum;
+    const qint64 locateMs = seconds * 1000LL / 2;
+    QAudioFormat format;
+    format.setSampleRate(sampleRate);
+    format.setChannelCount(2);
+    format.setSampleFormat(QAudioFormat::Float);
+    const int ltcChannel = 1;
+
+    TCconverter converter;
+    QHash<qint64, qint64> artnetNs; // Frame -> clock time of its packet
+    QVector<ltc_frame_t> decoded;
+    int relocations = 0;
+    int finalPpm = 0;
+    SimulatedClock clock;
+    {
+        LtcOutput output(nullptr, &clock);
+        LtcDecoder decoder;
+        decoder.setFormat(sampleRate, rate.fps);
+        QByteArray block(period * format.bytesPerFrame(), '\0');
+        const float *samples = reinterpret_cast<const float*>(block.constData());
+        qint64 reads = 0;
+        qint64 nextReadNs = 0;
+        qint64 lastFrame = -1;
+        output.startDevice(format, ltcChannel, rate, 0, CLI_LTC_LOOPBACK_START_MS, bufferFrames);
+        for (qint64 ms = 0; ms <= seconds * 1000LL; ++ms)
+        {
+            // Audio thread of the LTC sink
+            while (nextReadNs <= ms * 1000000LL)
+            {
+                clock.advanceTo(nextReadNs);
+                output.device()->read(block.data(), block.size());
+                decoder.process(samples + ltcChannel, period, format.channelCount(), decoded);
+                ++reads;
+                nextReadNs = static_cast<qint64>(reads * period * 1e9 / sinkRate);
+            }
+            // Playhead of the cue, a frame goes out when it changes
+            clock.advanceTo(ms * 1000000LL);
+            const qint64 timecodeMs = CLI_LTC_LOOPBACK_START_MS + ms + (ms >= locateMs ? CLI_LTC_LOOPBACK_JUMP_MS : 0);
+            const qint64 frame = positionFrame(timecodeMs, rate.fps, converter);
+            if (frame == lastFrame) continue;
+            lastFrame = frame;
+            artnetNs.insert(frame, clock.nowNs());
+            output.follow(timecodeMs);
+        }
+        relocations = output.relocations();
+        finalPpm = output.speedPpm();
+    }
+
+    // Sample n of the LTC is heard when the sink has played the buffer before it
+    QVector<double> differences;
+    double worst = 0;
+    int unmatched = 0;
+    for (const ltc_frame_t &frame : decoded)
+    {
+        timecode_t tc = frame.tc;
+        tc.fps = static_cast<uint8_t>(rate.timebase);
+        const qint64 number = rate.dropFrame ? converter.dftc2frames(tc) : converter.ndftc2frames(tc);
+        const double heardNs = (frame.sample + bufferFrames - period) * 1e9 / sinkRate;
+        const bool settling = heardNs < CLI_LTC_SETTLE_MS * 1e6
+                              || (heardNs >= locateMs * 1e6 && heardNs < (locateMs + CLI_LTC_SETTLE_MS) * 1e6);
+        if (settling || heardNs > seconds * 1e9) continue; // The last frames are heard after the run
+        if (!artnetNs.contains(number))
+        {
+            ++unmatched;
+            continue;
+        }
+        const double difference = (heardNs - artnetNs.value(number)) / frameNs;
+        differences.append(difference * frameNs / 1e6);
+        worst = qMax(worst, std::fabs(difference));
+    }
+
+    out() << QString("%1 fps, %2 s, LTC clock %3 ppm off: %4 LTC frames, %5 Art-Net frames, %6 unmatched, %7 relocations, trim %8 ppm")
+                 .arg(rate.name).arg(seconds).arg(ppm).arg(decoded.size()).arg(artnetNs.size())
+                 .arg(unmatched).arg(relocations).arg(finalPpm) << Qt::endl
+          << "LTC heard after the Art-Net frame: " << percentiles(differences)
+          << QString(", worst %1 frame").arg(worst, 0, 'f', 3) << Qt::endl;
+    const bool ok = worst < CLI_LTC_MAX_FRAMES && unmatched == 0 && relocations == 2
+                    && differences.size() >= static_cast<int>((seconds - 1) * rate.fps);
+    return ok ? 0 : 1;
+}
+
+// Event track cost as the event count grows. Every track plays the hour
+// frame by frame with advance() and activeMarker() as a playing cue does,
+// then seeks to random positions. The frame cost stays flat with the count,
+// it only grows with the events that fire in the frame.
+static int eventBench(int maxCount)
+{
+    QRandomGenerator random(1); // The same tracks every run
+    const qint64 frames = CLI_EVENT_CUE_MS * CLI_EVENT_FPS / 1000;
+    out() << "Events   fired/frame   advance ns (mean p99 max)   marker ns (mean p99)   seek ns (mean max)" << Qt::endl;
+    for (int count = qMin(1000, maxCount);; count = qMin(count * 10, maxCount))
+    {
+        QVector<cue_event_t> events(count);
+        for (int i = 0; i < count; ++i)
+        {
+            cue_event_t &ev = events[i];
+            ev.timeMs = random.bounded(CLI_EVENT_CUE_MS);
+            ev.type = static_cast<cue_event_type_t>(CUE_EVENT_MARKER + i % 3);
+            ev.value = i;
+            if (ev.type == CUE_EVENT_MARKER)
+            {
+                ev.durationMs = random.bounded(CLI_EVENT_MAX_MARKER_MS);
+                ev.text = QString("Marker %1").arg(i);
+            }
+            else if (ev.type == CUE_EVENT_OSC)
+                ev.text = "/bench/event";
+        }
+        EventTrack track;
+        track.setEvents(events);
+        track.seek(0);
+
+        QVector<qint64> advanceNs(frames);
+        QVector<qint64> markerNs(frames);
+        qint64 fired = 0;
+        const qint64 lastPosition = (frames - 1) * 1000 / CLI_EVENT_FPS;
+        const qint64 due = std::count_if(events.begin(), events.end(),
+                                         [lastPosition](const cue_event_t &ev) { return ev.timeMs <= lastPosition; });
+        qint64 markers = 0; // Keeps the lookups from being optimised away
+        QElapsedTimer timer;
+        timer.start();
+        for (qint64 f = 0; f < frames; ++f)
+        {
+            const qint64 position = f * 1000 / CLI_EVENT_FPS;
+            const qint64 startNs = timer.nsecsElapsed();
+            track.advance(position, [&fired](int) { ++fired; });
+            const qint64 advancedNs = timer.nsecsElapsed();
+            markers += track.activeMarker(position);
+            advanceNs[f] = advancedNs - startNs;
+            markerNs[f] = timer.nsecsElapsed() - advancedNs;
+        }
+        if (fired != due)
+        {
+            err() << QString("%1 of %2 events fired in the playback").arg(fired).arg(due) << Qt::endl;
+            return 1;
+        }
+        qint64 seekSum = 0;
+        qint64 seekMax = 0;
+        for (int s = 0; s < CLI_EVENT_SEEKS; ++s)
+        {
+            const qint64 position = random.bounded(CLI_EVENT_CUE_MS);
+            const qint64 startNs = timer.nsecsElapsed();
+            track.seek(position);
+            track.advance(position, [&fired](int) { ++fired; });
+            markers += track.activeMarker(position);
+            const qint64 ns = timer.nsecsElapsed() - startNs;
+            seekSum += ns;
+            seekMax = qMax(seekMax, ns);
+        }
+
+        auto mean = [](const QVector<qint64> &values) {
+            return std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+        };
+        const double advanceMean = mean(advanceNs);
+        const double markerMean = mean(markerNs);
+        std::sort(advanceNs.begin(), advanceNs.end());
+        std::sort(markerNs.begin(), markerNs.end());
+        const int p99 = static_cast<int>(frames * 99 / 100);
+        out() << QString("%1   %2   %3 %4 %5   %6 %7   %8 %9")
+                     .arg(count, 6).arg(static_cast<double>(count) / frames, 11, 'f', 3)
+                     .arg(advanceMean, 9, 'f', 0).arg(advanceNs[p99], 6).arg(advanceNs.last(), 8)
+                     .arg(markerMean, 10, 'f', 0).arg(markerNs[p99], 6)
+                     .arg(static_cast<double>(seekSum) / CLI_EVENT_SEEKS, 10, 'f', 0).arg(seekMax, 7)
+              << Qt::endl;
+        if (markers == static_cast<qint64>(-frames - CLI_EVENT_SEEKS))
+            err() << "No marker was active" << Qt::endl;
+        if (count >= maxCount) break;
+    }
+    return 0;
+}
+
+// Save and load time of a large show in the compact format and in INI, both
+// through FileManager as the player does. Every cue has a file, a colour and
+// two events, every tenth one a loop. The INI file doesn't store the events.
+static int playlistBench(int cueCount, int runs)
+{
+    QTemporaryDir tempDir;
+    if (!tempDir.isValid())
+    {
+        err() << "Can't create a temporary directory" << Qt::endl;
+        return CLI_ERROR;
+    }
+
+    playlist_t playlist;
+    playlist.columns = CLI_PLAYLIST_COLUMNS;
+    playlist.rows = (cueCount + CLI_PLAYLIST_COLUMNS - 1) / CLI_PLAYLIST_COLUMNS;
+    playlist.cues.resize(playlist.rows * playlist.columns);
+    const QVector<framerate_t> &rates = frameRates();
+    for (int i = 0; i < playlist.cues.size(); ++i)
+    {
+        cue_t &cue = playlist.cues[i];
+        cue.filePath = QString("/show/audio/scene%1/cue%2.wav").arg(i / 100).arg(i);
+        cue.adjustmentTime = (i % 7 - 3) * 1000;
+        cue.frameRate = rates[i % rates.size()].name;
+        cue.cueColor = QColor::fromHsv(i % 360, 200, 255);
+        cue.deck = i % 4;
+        if (i % 10 == 0)
+        {
+            cue.loopIn = "00:01:00:00";
+            cue.loopOut = "00:01:30:00";
+        }
+        cue_event_t marker;
+        marker.timeMs = 1000;
+        marker.text = QString("Scene %1").arg(i);
+        cue_event_t osc;
+        osc.timeMs = 2000;
+        osc.type = CUE_EVENT_OSC;
+        osc.text = "/lights/go";
+        osc.value = i;
+        cue.events = {marker, osc};
+    }
+
+    FileManager fileManager;
+    QObject::connect(&fileManager, &FileManager::sendMsg, [](const QString &msg) {
+        if (!msg.startsWith("Playlist saved") && !msg.startsWith("Playlist loaded")) err() << msg << Qt::endl;
+    });
+
+    out() << QString("%1 cues, %2 runs of every format").arg(playlist.cues.size()).arg(runs) << Qt::endl;
+    const QStringList suffixes = {"anpl", "plist"};
+    double medianLoad[2] = {};
+    bool failed = false;
+    for (int f = 0; f < suffixes.size(); ++f)
+    {
+        QVector<double> saveMs;
+        QVector<double> loadMs;
+        qint64 size = 0;
+        for (int run = 0; run < runs; ++run)
+        {
+            const QString saved = tempDir.filePath(QString("save%1.%2").arg(run).arg(suffixes[f]));
+            const QString loaded = tempDir.filePath(QString("load%1.%2").arg(run).arg(suffixes[f]));
+            QElapsedTimer timer;
+            timer.start();
+            if (!fileManager.writePlaylist(saved, playlist))
+            {
+                err() << "Can't save " << saved << Qt::endl;
+                return 1;
+            }
+            saveMs.append(timer.nsecsElapsed() / 1e6);
+            size = QFileInfo(saved).size();
+
+            // A copy under a new name: QSettings keeps the files it wrote parsed
+            QFile::copy(saved, loaded);
+            playlist_t result;
+            timer.restart();
+            if (!fileManager.readPlaylist(loaded, result))
+            {
+                err() << "Can't load " << loaded << Qt::endl;
+                return 1;
+            }
+            loadMs.append(timer.nsecsElapsed() / 1e6);
+
+            int differences = 0;
+            for (int i = 0; i < playlist.cues.size() && i < result.cues.size(); ++i)
+            {
+                const cue_t &a = playlist.cues[i];
+                const cue_t &b = result.cues[i];
+                if (a.filePath != b.filePath || a.adjustmentTime != b.adjustmentTime || a.frameRate != b.frameRate
+                    || a.cueColor.name() != b.cueColor.name() || a.deck != b.deck || a.loopOut != b.loopOut)
+                    ++differences;
+            }
+            if (result.cues.size() != playlist.cues.size() || differences > 0)
+            {
+                err() << QString("%1: %2 of %3 cues loaded, %4 differ")
+                             .arg(suffixes[f]).arg(result.cues.size()).arg(playlist.cues.size()).arg(differences) << Qt::endl;
+                failed = true;
+            }
+        }
+        std::sort(loadMs.begin(), loadMs.end());
+        medianLoad[f] = loadMs[loadMs.size() / 2];
+        out() << QString(".%1, %2 KB").arg(suffixes[f]).arg(size / 1024) << Qt::endl
+              << "  Save: " << percentiles(saveMs) << Qt::endl
+              << "  Load: " << percentiles(loadMs) << Qt::endl;
+    }
+    if (medianLoad[0] > 0)
+        out() << QString("Median load of .anpl is %1 times faster than .plist").arg(medianLoad[1] / medianLoad[0], 0, 'f', 1) << Qt::endl;
+    return failed ? 1 : 0;
+}
+
+#ifdef ANET_TRACE
+// Cost of one scoped event, the loop without tracing is subtracted
+static int traceBench()
+{
+    volatile int sink = 0;
+    qint64 startNs = ShowRecorder::now();
+    for (int i = 0; i < CLI_TRACE_EVENTS; ++i)
+        sink = sink + i;
+    const qint64 emptyNs = ShowRecorder::now() - startNs;
+
+    startNs = ShowRecorder::now();
+    for (int i = 0; i < CLI_TRACE_EVENTS; ++i)
+    {
+        TRACE_SCOPE("bench", "traceBench");
+        sink = sink + i;
+    }
+    const qint64 tracedNs = ShowRecorder::now() - startNs;
+
+    const double perEvent = double(tracedNs - emptyNs) / CLI_TRACE_EVENTS;
+    out() << QString("%1 events, %2 ns per event").arg(CLI_TRACE_EVENTS).arg(perEvent, 0, 'f', 1) << Qt::endl;
+    return perEvent < 50.0 ? 0 : 1;
+}
+#endif
+
+int runCli(int &argc, char *argv[])
+{
+    QStringList args;
+    for (int i = 1; i < argc; ++i)
+        args.append(QString::fromLocal8Bit(argv[i]));
+    if (args.isEmpty()) return -1;
+
+    const QString command = args.first();
+    if (command == "--dump-log")
+    {
+        if (args.size() != 2)
+        {
+            err() << "Usage: --dump-log <show.ansr>" << Qt::endl;
+            return CLI_ERROR;
+        }
+        return dumpLog(args[1]);
+    }
+    if (command == "--diff-log")
+    {
+        if (args.size() < 3 || args.size() > 4)
+        {
+            err() << "Usage: --diff-log <a.ansr> <b.ansr> [toleranceMs]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        const double tolerance = (args.size() == 4) ? args[3].toDouble() : CLI_DIFF_TOLERANCE_MS;
+        return diffLogs(args[1], args[2], tolerance);
+    }
+    if (command == "--osc-bench")
+    {
+        if (args.size() < 4 || args.size() > 5)
+        {
+            err() << "Usage: --osc-bench <host> <port> <cue> [runs]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        QCoreApplication app(argc, argv);
+        const int runs = (args.size() == 5) ? args[4].toInt() : CLI_BENCH_RUNS;
+        return oscBench(args[1], args[2].toUShort(), args[3].toInt(), qMax(1, runs));
+    }
+    if (command == "--ws-load")
+    {
+        if (args.size() < 4 || args.size() > 5)
+        {
+            err() << "Usage: --ws-load <host> <port> <clients> [seconds]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        QCoreApplication app(argc, argv);
+        const int seconds = (args.size() == 5) ? args[4].toInt() : CLI_WS_SECONDS;
+        return wsLoad(args[1], args[2].toUShort(), qMax(1, args[3].toInt()), qMax(1, seconds));
+    }
+    if (command == "--standby-test")
+    {
+        if (args.size() < 3 || args.size() > 4 || (args[1] != "primary" && args[1] != "backup"))
+        {
+            err() << "Usage: --standby-test <primary|backup> <port> [seconds]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        QCoreApplication app(argc, argv);
+        const int seconds = (args.size() == 4) ? args[3].toInt() : CLI_STANDBY_SECONDS;
+        return standbyTest(args[1], args[2].toUShort(), qMax(1, seconds));
+    }
+    if (command == "--sync-test")
+    {
+        const bool master = (args.size() >= 3 && args.size() <= 4 && args.value(1) == "master");
+        const bool client = (args.size() >= 4 && args.size() <= 7 && args.value(1) == "client");
+        if (!master && !client)
+        {
+            err() << "Usage: --sync-test master <port> [seconds]" << Qt::endl
+                  << "       --sync-test client <host> <port> [seconds] [offsetMs] [ppm]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        QCoreApplication app(argc, argv);
+        return syncTest(args);
+    }
+    if (command == "--generator-bench")
+    {
+        if (args.size() < 2 || args.size() > 4 || !QStringList({"24", "25", "29.97", "30"}).contains(args[1]))
+        {
+            err() << "Usage: --generator-bench <24|25|29.97|30> [seconds] [simulated hours]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        QCoreApplication app(argc, argv);
+        const int seconds = (args.size() >= 3) ? args[2].toInt() : CLI_GENERATOR_SECONDS;
+        const double hours = (args.size() == 4) ? args[3].toDouble() : CLI_GENERATOR_HOURS;
+        return generatorBench(args[1], qMax(1, seconds), qMax(0.0, hours));
+    }
+    if (command == "--loop-check")
+    {
+        if (args.size() < 3 || args.size() > 6 || (args.size() >= 4 && !QStringList({"24", "25", "29.97", "30"}).contains(args[3])))
+        {
+            err() << "Usage: --loop-check <in hh:mm:ss:ff> <out hh:mm:ss:ff> [24|25|29.97|30] [sample rate] [loops]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        const double fps = (args.size() >= 4) ? args[3].toDouble() : 30.0;
+        const int rate = (args.size() >= 5) ? args[4].toInt() : CLI_LOOP_RATE;
+        const int loops = (args.size() == 6) ? args[5].toInt() : CLI_LOOP_COUNT;
+        return loopCheck(args[1], args[2], fps, qMax(8000, rate), qMax(1, loops));
+    }
+    if (command == "--scrub-sim")
+    {
+        if (args.size() > 3)
+        {
+            err() << "Usage: --scrub-sim [seconds] [moves per second]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        const int seconds = (args.size() >= 2) ? args[1].toInt() : CLI_SCRUB_SECONDS;
+        const int moves = (args.size() == 3) ? args[2].toInt() : CLI_SCRUB_MOVES;
+        return scrubSim(qMax(1, seconds), qBound(1, moves, 10000));
+    }
+    if (command == "--ltc-export")
+    {
+        if (args.size() < 3 || args.size() > 4 || (args.size() == 4 && args[3] != "interleave"))
+        {
+            err() << "Usage: --ltc-export <playlist> <out dir> [interleave]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        QCoreApplication app(argc, argv);
+        return ltcExport(args[1], args[2], args.size() == 4);
+    }
+    if (command == "--ltc-roundtrip")
+    {
+        if (args.size() > 4 || (args.size() >= 2 && !QStringList({"24", "25", "29.97", "30"}).contains(args[1])))
+        {
+            err() << "Usage: --ltc-roundtrip [24|25|29.97|30] [sample rate] [seconds]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        QCoreApplication app(argc, argv);
+        const QStringList rates = (args.size() >= 2) ? QStringList(args[1]) : QStringList({"24", "25", "29.97", "30"});
+        const int sampleRate = (args.size() >= 3) ? args[2].toInt() : LTC_EXPORT_SAMPLE_RATE;
+        const int seconds = (args.size() == 4) ? args[3].toInt() : CLI_LTC_SECONDS;
+        int result = 0;
+        for (const QString &rate : rates)
+            result = qMax(result, ltcRoundtrip(rate, qMax(8000, sampleRate), qMax(1, seconds)));
+        return result;
+    }
+    if (command == "--ltc-loopback")
+    {
+        if (args.size() > 4 || (args.size() >= 2 && !QStringList({"24", "25", "29.97", "30"}).contains(args[1])))
+        {
+            err() << "Usage: --ltc-loopback [24|25|29.97|30] [seconds] [LTC clock ppm]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        const QStringList rates = (args.size() >= 2) ? QStringList(args[1]) : QStringList({"24", "25", "29.97", "30"});
+        const int seconds = (args.size() >= 3) ? args[2].toInt() : CLI_LTC_LOOPBACK_SECONDS;
+        const double ppm = (args.size() == 4) ? args[3].toDouble() : CLI_LTC_LOOPBACK_PPM;
+        int result = 0;
+        for (const QString &rate : rates)
+            result = qMax(result, ltcLoopback(rate, qMax(2, seconds), qBound(-1000.0, ppm, 1000.0)));
+        return result;
+    }
+    if (command == "--soak")
+    {
+        if (args.size() > 2)
+        {
+            err() << "Usage: --soak [hours]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        QCoreApplication app(argc, argv);
+        const double hours = (args.size() == 2) ? args[1].toDouble() : 24;
+        return runSoak(qMax(0.0, hours));
+    }
+    if (command == "--render-pcap")
+    {
+        if (args.size() < 4 || args.size() > 5)
+        {
+            err() << "Usage: --render-pcap <out.pcap> <playlist> <cue> [fps]" << Qt::endl
+                  << "       --render-pcap <out.pcap> <durationMs> <fps> [adjustmentMs]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        return renderPcap(args);
+    }
+    if (command == "--compare-pcap")
+    {
+        if (args.size() != 3)
+        {
+            err() << "Usage: --compare-pcap <a.pcap> <golden.pcap>" << Qt::endl;
+            return CLI_ERROR;
+        }
+        return comparePcap(args[1], args[2]);
+    }
+    if (command == "--render-check")
+    {
+        if (args.size() < 2 || args.size() > 3 || (args.size() == 3 && args[2] != "write"))
+        {
+            err() << "Usage: --render-check <golden dir> [write]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        return renderCheck(args[1], args.size() == 3);
+    }
+    if (command == "--drift-sim")
+    {
+        if (args.size() < 2 || args.size() > 5)
+        {
+            err() << "Usage: --drift-sim <seconds> [fps] [audio clock ppm] [report interval ms]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        const double fps = (args.size() >= 3) ? args[2].toDouble() : 30.0;
+        const double ppm = (args.size() >= 4) ? args[3].toDouble() : 0.0;
+        const int reportMs = (args.size() >= 5) ? args[4].toInt() : CLI_SIM_REPORT_MS;
+        return driftSim(qMax(1.0, args[1].toDouble()), fps > 0 ? fps : 30.0, ppm, qMax(1, reportMs));
+    }
+#ifdef ANET_TRACE
+    if (command == "--trace-bench")
+        return traceBench();
+#endif
+    if (command == "--event-bench")
+    {
+        if (args.size() > 2)
+        {
+            err() << "Usage: --event-bench [max events]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        const int count = (args.size() == 2) ? args[1].toInt() : CLI_EVENT_COUNT;
+        return eventBench(qMax(1, count));
+    }
+    if (command == "--playlist-bench")
+    {
+        if (args.size() > 3)
+        {
+            err() << "Usage: --playlist-bench [cues] [runs]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        const int cues = (args.size() >= 2) ? args[1].toInt() : CLI_PLAYLIST_CUES;
+        const int runs = (args.size() == 3) ? args[2].toInt() : CLI_PLAYLIST_RUNS;
+        return playlistBench(qMax(1, cues), qMax(1, runs));
+    }
+    if (command == "--go-bench")
+    {
+        if (args.size() < 2 || args.size() > 4)
+        {
+            err() << "Usage: --go-bench <audio file> [runs] [result.json]" << Qt::endl;
+            return CLI_ERROR;
+        }
+        QApplication app(argc, argv); // Cues are widgets
+        const int runs = (args.size() >= 3) ? args[2].toInt() : CLI_BENCH_RUNS;
+        return runGoBench(args[1], qMax(1, runs), (args.size() == 4) ? args[3] : QString());
+    }
+    return -1;
+}
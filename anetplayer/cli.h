@@ -0,0 +1,31 @@
+#ifndef CLI_H
+#define CLI_H
+
+// Command line tools, they run without the GUI:
+//   anetplayer --dump-log <show.ansr>
+//   anetplayer --diff-log <a.ansr> <b.ansr> [toleranceMs]
+//   anetplayer --osc-bench <host> <port> <cue> [runs]
+//   anetplayer --ws-load <host> <port> <clients> [seconds]
+//   anetplayer --event-bench [max events]
+//   anetplayer --go-bench <audio file> [runs] [result.json]
+//   anetplayer --playlist-bench [cues] [runs]
+//   anetplayer --trace-bench (built with CONFIG+=trace)
+//   anetplayer --render-pcap <out.pcap> <playlist> <cue> [fps]
+//   anetplayer --render-pcap <out.pcap> <durationMs> <fps> [adjustmentMs]
+//   anetplayer --compare-pcap <a.pcap> <golden.pcap>
+//   anetplayer --render-check <golden dir> [write]
+//   anetplayer --drift-sim <seconds> [fps] [audio clock ppm] [report interval ms]
+//   anetplayer --soak [hours]
+//   anetplayer --generator-bench <24|25|29.97|30> [seconds] [simulated hours]
+//   anetplayer --scrub-sim [seconds] [moves per second]
+//   anetplayer --ltc-export <playlist> <out dir> [interleave]
+//   anetplayer --ltc-roundtrip [24|25|29.97|30] [sample rate] [seconds]
+//   anetplayer --ltc-loopback [24|25|29.97|30] [seconds] [LTC clock ppm]
+//   anetplayer --loop-check <in hh:mm:ss:ff> <out hh:mm:ss:ff> [24|25|29.97|30] [sample rate] [loops]
+//   anetplayer --standby-test <primary|backup> <port> [seconds] (backup first, in another process)
+//   anetplayer --sync-test master <port> [seconds]
+//   anetplayer --sync-test client <host> <port> [seconds] [offsetMs] [ppm] (after the master, in other processes)
+// Returns the process exit code, or -1 if the arguments have no tool command
+int runCli(int &argc, char *argv[]);
+
+#endif // CLI_H
@@ -0,0 +1,110 @@
+#include "clock.h"
+#include <QTimer>
+#include <chrono>
+
+class SystemTimer : public ClockTimer
+{
+public:
+    explicit SystemTimer(QObject *parent) : ClockTimer(parent), timer(new QTimer(this))
+    {
+        timer->setTimerType(Qt::PreciseTimer); // A coarse timer may be 5 % off, more than a frame edge allows
+        connect(timer, &QTimer::timeout, this, &ClockTimer::timeout);
+    }
+    void start(int periodMs) override
+    {
+        timer->setSingleShot(singleShot);
+        timer->start(periodMs);
+    }
+    void stop() override { timer->stop(); }
+    bool isActive() const override { return timer->isActive(); }
+
+private:
+    QTimer *timer;
+};
+
+class SystemClock : public Clock
+{
+public:
+    qint64 nowNs() const override
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    ClockTimer *createTimer(QObject *parent) override { return new SystemTimer(parent); }
+};
+
+Clock *Clock::system()
+{
+    static SystemClock clock;
+    return &clock;
+}
+
+class SimulatedClock::SimulatedTimer : public ClockTimer
+{
+public:
+    SimulatedTimer(SimulatedClock *owner, QObject *parent) : ClockTimer(parent), clock(owner)
+    {
+        clock->timers.append(this);
+    }
+    ~SimulatedTimer()
+    {
+        if (clock) clock->timers.removeOne(this);
+    }
+    void start(int periodMs) override
+    {
+        periodNs = qMax(periodMs, 0) * qint64(1000000);
+        dueNs = clock->now + periodNs;
+        active = true;
+    }
+    void stop() override { active = false; }
+    bool isActive() const override { return active; }
+
+    SimulatedClock *clock;
+    qint64 periodNs = 0;
+    qint64 dueNs = 0;
+    bool active = false;
+};
+
+SimulatedClock::~SimulatedClock()
+{
+    for (SimulatedTimer *timer : timers)
+        timer->clock = nullptr;
+}
+
+qint64 SimulatedClock::nowNs() const
+{
+    return now;
+}
+
+ClockTimer *SimulatedClock::createTimer(QObject *parent)
+{
+    return new SimulatedTimer(this, parent);
+}
+
+void SimulatedClock::advance(qint64 ns)
+{
+    advanceTo(now + ns);
+}
+
+void SimulatedClock::advanceTo(qint64 timeNs)
+{
+    forever
+    {
+        // Earliest due timer, ties in creation order
+        SimulatedTimer *next = nullptr;
+        for (SimulatedTimer *timer : timers)
+        {
+            if (timer->active && timer->dueNs <= timeNs && (!next || timer->dueNs < next->dueNs))
+                next = timer;
+        }
+        if (!next) break;
+
+        now = next->dueNs;
+        if (next->isSingleShot())
+            next->active = false;
+        else
+            next->dueNs += qMax(next->periodNs, qint64(1000000)); // No idle loop to run a zero period timer
+        emit next->timeout();
+    }
+    now = qMax(now, timeNs);
+}
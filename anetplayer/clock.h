@@ -0,0 +1,57 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <QObject>
+#include <QVector>
+
+// Timer of a Clock, emits timeout() every period of that clock
+class ClockTimer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ClockTimer(QObject *parent = nullptr) : QObject(parent) {}
+    virtual void start(int periodMs) = 0;
+    virtual void stop() = 0;
+    virtual bool isActive() const = 0;
+    void setSingleShot(bool enable) { singleShot = enable; }
+    bool isSingleShot() const { return singleShot; }
+
+protected:
+    bool singleShot = false;
+
+signals:
+    void timeout();
+};
+
+// Time source and scheduler of the playback. The system clock is the
+// monotonic clock with QTimer, the simulated clock only moves when it's
+// advanced, so hours of playback run in seconds and always the same way.
+class Clock
+{
+public:
+    virtual ~Clock() {}
+    virtual qint64 nowNs() const = 0; // Monotonic
+    virtual ClockTimer *createTimer(QObject *parent = nullptr) = 0;
+
+    static Clock *system(); // Shared, lives as long as the process
+};
+
+// Timers must be deleted before the clock
+class SimulatedClock : public Clock
+{
+public:
+    ~SimulatedClock();
+    qint64 nowNs() const override;
+    ClockTimer *createTimer(QObject *parent = nullptr) override;
+
+    void advance(qint64 ns);   // Fire every timer due until now + ns, in time order
+    void advanceTo(qint64 timeNs);
+
+private:
+    class SimulatedTimer;
+    QVector<SimulatedTimer*> timers;
+    qint64 now = 0;
+};
+
+#endif // CLOCK_H
@@ -0,0 +1,506 @@
+#include "clocksync.h"
+#include <QUdpSocket>
+#include <QHash>
+#include <QSet>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+
+#define SYNC_MAGIC "ANSY"
+#define SYNC_VERSION 2               // 2: GOs are repeated
+#define SYNC_PACKET_SIZE 40
+#define SYNC_POLL_MS 125            // Client exchange period
+#define SYNC_IDLE_MS 5              // Thread wake-up, outgoing GOs wait at most this long
+#define SYNC_CLIENT_TIMEOUT_MS 10000 // The master forgets clients that stopped polling
+#define SYNC_MIN_OFFSET_SPREAD_NS 10000.0
+#define SYNC_MAX_SLOPE 500e-6
+#define SYNC_GO_SENDS 3              // Copies of every GO, a lost datagram doesn't lose the start
+#define SYNC_GO_RESEND_MS 10         // Between the copies, all are out well within SYNC_MIN_LEAD_MS
+#define SYNC_GO_MEMORY_MS 5000       // Received GOs are remembered this long to drop the copies
+
+typedef enum
+{
+    SYNC_REQUEST = 1,
+    SYNC_RESPONSE,
+    SYNC_GO
+} sync_packet_type_t;
+
+typedef struct
+{
+    quint8 type;
+    quint32 sequence;
+    qint32 cue;
+    qint64 t1;  // GO: shared time
+    qint64 t2;
+    qint64 t3;
+} sync_packet_t;
+
+static QByteArray encodePacket(const sync_packet_t &packet)
+{
+    QByteArray data(SYNC_PACKET_SIZE, '\0');
+    uchar *d = reinterpret_cast<uchar*>(data.data());
+    memcpy(d, SYNC_MAGIC, 4);
+    d[4] = SYNC_VERSION;
+    d[5] = packet.type;
+    qToLittleEndian<quint32>(packet.sequence, d + 8);
+    qToLittleEndian<qint32>(packet.cue, d + 12);
+    qToLittleEndian<qint64>(packet.t1, d + 16);
+    qToLittleEndian<qint64>(packet.t2, d + 24);
+    qToLittleEndian<qint64>(packet.t3, d + 32);
+    return data;
+}
+
+static bool decodePacket(const char *data, qint64 size, sync_packet_t &packet)
+{
+    const uchar *d = reinterpret_cast<const uchar*>(data);
+    if (size < SYNC_PACKET_SIZE || memcmp(d, SYNC_MAGIC, 4) != 0 || d[4] != SYNC_VERSION) return false;
+    packet.type = d[5];
+    packet.sequence = qFromLittleEndian<quint32>(d + 8);
+    packet.cue = qFromLittleEndian<qint32>(d + 12);
+    packet.t1 = qFromLittleEndian<qint64>(d + 16);
+    packet.t2 = qFromLittleEndian<qint64>(d + 24);
+    packet.t3 = qFromLittleEndian<qint64>(d + 32);
+    return packet.type >= SYNC_REQUEST && packet.type <= SYNC_GO;
+}
+
+// Copies of a GO still to be sent
+typedef struct
+{
+    QByteArray data;
+    int sendsLeft;
+    qint64 nextNs;
+} go_resend_t;
+
+// True for the first copy of a GO, the key holds its sender and its bytes
+static bool firstCopy(QHash<QByteArray, qint64> &seen, const QByteArray &key, qint64 nowNs)
+{
+    for (auto it = seen.begin(); it != seen.end();)
+    {
+        if (nowNs - it.value() > SYNC_GO_MEMORY_MS * 1000000LL)
+            it = seen.erase(it);
+        else
+            ++it;
+    }
+    if (seen.contains(key)) return false;
+    seen.insert(key, nowNs);
+    return true;
+}
+
+static double median(QVector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    const int n = values.size();
+    return (n % 2) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+void OffsetEstimator::reset()
+{
+    *this = OffsetEstimator();
+}
+
+void OffsetEstimator::addExchange(qint64 t1, qint64 t2, qint64 t3, qint64 t4)
+{
+    exchange_t &exchange = window[next];
+    exchange.localNs = t1 + (t4 - t1) / 2;
+    exchange.offsetNs = ((t2 - t1) + (t3 - t4)) / 2.0;
+    exchange.roundTripNs = static_cast<double>((t4 - t1) - (t3 - t2));
+    next = (next + 1) % SYNC_WINDOW;
+    if (count < SYNC_WINDOW) ++count;
+    ++exchanges;
+    refNs = exchange.localNs;
+    fit();
+}
+
+void OffsetEstimator::fit()
+{
+    QVector<double> roundTrips;
+    roundTrips.reserve(count);
+    for (int i = 0; i < count; ++i)
+        roundTrips.append(window[i].roundTripNs);
+    roundTripNs = *std::min_element(roundTrips.begin(), roundTrips.end());
+    const double delayLimit = median(roundTrips); // Faster half
+
+    QVector<double> fastOffsets;
+    for (int i = 0; i < count; ++i)
+        if (window[i].roundTripNs <= delayLimit) fastOffsets.append(window[i].offsetNs);
+    const double center = median(fastOffsets);
+    QVector<double> deviations;
+    for (double offset : fastOffsets)
+        deviations.append(std::abs(offset - center));
+    const double spread = qMax(3 * 1.4826 * median(deviations), SYNC_MIN_OFFSET_SPREAD_NS);
+
+    // Least squares of the kept exchanges
+    double n = 0, meanX = 0, meanY = 0, m2x = 0, cxy = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const exchange_t &exchange = window[i];
+        if (exchange.roundTripNs > delayLimit || std::abs(exchange.offsetNs - center) > spread) continue;
+        const double x = static_cast<double>(exchange.localNs - refNs);
+        ++n;
+        const double dx = x - meanX;
+        meanX += dx / n;
+        meanY += (exchange.offsetNs - meanY) / n;
+        m2x += dx * (x - meanX);
+        cxy += dx * (exchange.offsetNs - meanY);
+    }
+    outliers = count - static_cast<int>(n);
+    slope = (n >= 3 && m2x > 0) ? qBound(-SYNC_MAX_SLOPE, cxy / m2x, SYNC_MAX_SLOPE) : 0;
+    offsetNs = meanY - slope * meanX; // At refNs
+
+    double squares = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const exchange_t &exchange = window[i];
+        if (exchange.roundTripNs > delayLimit || std::abs(exchange.offsetNs - center) > spread) continue;
+        const double residual = exchange.offsetNs - (offsetNs + slope * (exchange.localNs - refNs));
+        squares += residual * residual;
+    }
+    jitterNs = (n > 0) ? std::sqrt(squares / n) : 0;
+}
+
+sync_stats_t OffsetEstimator::stats(qint64 localNs) const
+{
+    sync_stats_t result;
+    result.exchanges = exchanges;
+    if (count == 0) return result;
+    result.locked = exchanges >= SYNC_MIN_SAMPLES;
+    result.offsetUs = (toShared(localNs) - localNs) / 1000.0;
+    result.driftPpm = -slope * 1e6; // A growing offset is a slow local clock
+    result.jitterUs = jitterNs / 1000.0;
+    result.roundTripUs = roundTripNs / 1000.0;
+    result.pathDelayUs = roundTripNs / 2000.0;
+    result.outliers = outliers;
+    return result;
+}
+
+qint64 OffsetEstimator::toShared(qint64 localNs) const
+{
+    return localNs + static_cast<qint64>(std::llround(offsetNs + slope * (localNs - refNs)));
+}
+
+qint64 OffsetEstimator::toLocal(qint64 sharedNs) const
+{
+    // The offset changes by ppm, one step is exact to well below a ns
+    const qint64 guess = sharedNs - static_cast<qint64>(std::llround(offsetNs));
+    return sharedNs - (toShared(guess) - guess);
+}
+
+ClockSync::ClockSync(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ClockSync::~ClockSync()
+{
+    stop();
+}
+
+bool ClockSync::start(sync_role_t newRole, const QString &master, quint16 port, const QHostAddress &bindAddress,
+                      Clock *newClock)
+{
+    stop();
+    if (newRole == SYNC_OFF) return true;
+    if (port == 0 || (newRole == SYNC_CLIENT && QHostAddress(master).isNull()))
+    {
+        emit sendMsg("Clock sync needs the master address and port");
+        return false;
+    }
+    if (bindAddress.isNull())
+    {
+        emit sendMsg("Clock sync is off, the Art-Net interface has no address");
+        return false;
+    }
+
+    role = newRole;
+    clock = newClock;
+    masterAddress = QHostAddress(master);
+    listenAddress = bindAddress;
+    syncPort = port;
+    stopRequested = false;
+    wakePending = false;
+    {
+        QMutexLocker locker(&mutex);
+        estimator.reset();
+        outgoing.clear();
+    }
+
+    std::promise<bool> bound;
+    std::future<bool> result = bound.get_future();
+    thread = QThread::create([this, &bound]() {
+        QUdpSocket socket;
+        const bool ok = socket.bind(listenAddress, (role == SYNC_MASTER) ? syncPort : 0);
+        bound.set_value(ok);
+        if (!ok) return;
+        if (role == SYNC_MASTER)
+            masterLoop(socket);
+        else
+            clientLoop(socket);
+    });
+    thread->setObjectName("Clock sync");
+    thread->start();
+
+    if (!result.get())
+    {
+        thread->wait();
+        delete thread;
+        thread = nullptr;
+        role = SYNC_OFF;
+        emit sendMsg(QString("Can't open the clock sync port %1 on %2").arg(port).arg(bindAddress.toString()));
+        return false;
+    }
+    if (role == SYNC_MASTER)
+        emit sendMsg(QString("Clock sync master on %1:%2").arg(bindAddress.toString()).arg(port));
+    else
+        emit sendMsg(QString("Clock sync with %1:%2").arg(master).arg(port));
+    return true;
+}
+
+void ClockSync::stop()
+{
+    if (!thread) return;
+    stopRequested = true;
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+    role = SYNC_OFF;
+}
+
+sync_role_t ClockSync::getRole() const
+{
+    return role;
+}
+
+sync_stats_t ClockSync::getStats() const
+{
+    if (role == SYNC_MASTER)
+    {
+        sync_stats_t master;
+        master.locked = true;
+        return master;
+    }
+    QMutexLocker locker(&mutex);
+    return estimator.stats(clock->nowNs());
+}
+
+bool ClockSync::isLocked() const
+{
+    return getStats().locked;
+}
+
+qint64 ClockSync::sharedNow() const
+{
+    const qint64 now = clock->nowNs();
+    if (role != SYNC_CLIENT) return now;
+    QMutexLocker locker(&mutex);
+    return estimator.toShared(now);
+}
+
+qint64 ClockSync::toLocal(qint64 sharedNs) const
+{
+    if (role != SYNC_CLIENT) return sharedNs;
+    QMutexLocker locker(&mutex);
+    return estimator.toLocal(sharedNs);
+}
+
+void ClockSync::scheduleGo(int cue, qint64 sharedNs)
+{
+    if (role == SYNC_OFF) return;
+    QMutexLocker locker(&mutex);
+    outgoing.append({cue, sharedNs});
+}
+
+bool ClockSync::takeGo(sync_go_t &go)
+{
+    if (incoming.pop(go)) return true;
+
+    // Allow the next wake-up, a GO pushed meanwhile is taken now
+    wakePending.store(false, std::memory_order_release);
+    return incoming.pop(go);
+}
+
+void ClockSync::pushGo(const sync_go_t &go)
+{
+    if (!incoming.push(go))
+    {
+        emit sendMsg("Clock sync GO queue full");
+        return;
+    }
+    if (!wakePending.exchange(true, std::memory_order_acq_rel))
+        emit goPending();
+}
+
+void ClockSync::masterLoop(QUdpSocket &socket)
+{
+    QHash<QPair<quint32, quint16>, qint64> clients; // Address -> last request
+    QHash<QByteArray, qint64> seen; // GOs taken, for the copies
+    QVector<go_resend_t> resends;
+    QSet<quint32> untrusted; // Reported once each
+    quint32 goSequence = 0;
+    char buffer[SYNC_PACKET_SIZE * 2];
+    while (!stopRequested.load(std::memory_order_relaxed))
+    {
+        socket.waitForReadyRead(SYNC_IDLE_MS);
+        QVector<sync_go_t> goes;
+        while (socket.hasPendingDatagrams())
+        {
+            QHostAddress sender;
+            quint16 senderPort = 0;
+            const qint64 size = socket.readDatagram(buffer, sizeof(buffer), &sender, &senderPort);
+            const qint64 receivedNs = clock->nowNs();
+            sync_packet_t packet;
+            if (size <= 0 || !decodePacket(buffer, size, packet)) continue;
+
+            if (packet.type == SYNC_REQUEST)
+            {
+                clients.insert(qMakePair(sender.toIPv4Address(), senderPort), receivedNs);
+                packet.type = SYNC_RESPONSE;
+                packet.t2 = receivedNs;
+                packet.t3 = clock->nowNs();
+                socket.writeDatagram(encodePacket(packet), sender, senderPort);
+            }
+            else if (packet.type == SYNC_GO)
+            {
+                const QPair<quint32, quint16> client = qMakePair(sender.toIPv4Address(), senderPort);
+                if (!clients.contains(client))
+                {
+                    if (!untrusted.contains(client.first))
+                    {
+                        untrusted.insert(client.first);
+                        emit sendMsg("WARNING! Clock sync GO from " + sender.toString() + " ignored, it isn't a client");
+                    }
+                    continue;
+                }
+                QByteArray key = QByteArray::number(client.first) + ':' + QByteArray::number(client.second) + ' ';
+                key.append(buffer, SYNC_PACKET_SIZE);
+                if (firstCopy(seen, key, receivedNs))
+                    goes.append({packet.cue, packet.t1});
+            }
+        }
+        {
+            QMutexLocker locker(&mutex);
+            goes += outgoing;
+            outgoing.clear();
+        }
+
+        // Every GO goes to all clients, the one that asked for it too
+        const qint64 nowNs = clock->nowNs();
+        for (auto it = clients.begin(); it != clients.end();)
+        {
+            if (nowNs - it.value() > SYNC_CLIENT_TIMEOUT_MS * 1000000LL)
+                it = clients.erase(it);
+            else
+                ++it;
+        }
+        for (const sync_go_t &go : goes)
+        {
+            sync_packet_t packet = {SYNC_GO, ++goSequence, go.cue, go.sharedNs, 0, 0};
+            resends.append({encodePacket(packet), SYNC_GO_SENDS, nowNs});
+            pushGo(go);
+        }
+        for (int i = 0; i < resends.size();)
+        {
+            go_resend_t &resend = resends[i];
+            if (resend.nextNs > nowNs)
+            {
+                ++i;
+                continue;
+            }
+            for (auto it = clients.constBegin(); it != clients.constEnd(); ++it)
+                socket.writeDatagram(resend.data, QHostAddress(it.key().first), it.key().second);
+            resend.nextNs = nowNs + SYNC_GO_RESEND_MS * 1000000LL;
+            if (--resend.sendsLeft == 0)
+                resends.removeAt(i);
+            else
+                ++i;
+        }
+    }
+}
+
+void ClockSync::clientLoop(QUdpSocket &socket)
+{
+    char buffer[SYNC_PACKET_SIZE * 2];
+    quint32 sequence = 0;
+    qint64 nextPollNs = 0;
+    bool locked = false;
+    QHash<QByteArray, qint64> seen; // GOs taken, for the copies
+    QVector<go_resend_t> resends;
+    bool untrustedReported = false;
+    while (!stopRequested.load(std::memory_order_relaxed))
+    {
+        if (clock->nowNs() >= nextPollNs)
+        {
+            sync_packet_t request = {SYNC_REQUEST, ++sequence, -1, 0, 0, 0};
+            request.t1 = clock->nowNs();
+            socket.writeDatagram(encodePacket(request), masterAddress, syncPort);
+            nextPollNs = request.t1 + SYNC_POLL_MS * 1000000LL;
+        }
+
+        socket.waitForReadyRead(SYNC_IDLE_MS);
+        while (socket.hasPendingDatagrams())
+        {
+            QHostAddress sender;
+            quint16 senderPort = 0;
+            const qint64 size = socket.readDatagram(buffer, sizeof(buffer), &sender, &senderPort);
+            const qint64 receivedNs = clock->nowNs();
+            sync_packet_t packet;
+            if (size <= 0 || !decodePacket(buffer, size, packet)) continue;
+            // Only the master is trusted, with the time and with GOs
+            if (sender.toIPv4Address() != masterAddress.toIPv4Address() || senderPort != syncPort)
+            {
+                if (!untrustedReported)
+                {
+                    untrustedReported = true;
+                    emit sendMsg("WARNING! Clock sync packets from " + sender.toString() + " ignored, it isn't the master");
+                }
+                continue;
+            }
+
+            if (packet.type == SYNC_RESPONSE)
+            {
+                sync_stats_t stats;
+                {
+                    QMutexLocker locker(&mutex);
+                    estimator.addExchange(packet.t1, packet.t2, packet.t3, receivedNs);
+                    stats = estimator.stats(receivedNs);
+                }
+                if (stats.locked && !locked)
+                {
+                    locked = true;
+                    emit sendMsg(QString("Clock locked to the master, offset %1 us, path delay %2 us")
+                                     .arg(stats.offsetUs, 0, 'f', 1).arg(stats.pathDelayUs, 0, 'f', 1));
+                }
+            }
+            else if (packet.type == SYNC_GO && firstCopy(seen, QByteArray(buffer, SYNC_PACKET_SIZE), receivedNs))
+                pushGo({packet.cue, packet.t1});
+        }
+
+        QVector<sync_go_t> goes;
+        {
+            QMutexLocker locker(&mutex);
+            goes.swap(outgoing);
+        }
+        const qint64 nowNs = clock->nowNs();
+        for (const sync_go_t &go : goes)
+        {
+            sync_packet_t packet = {SYNC_GO, ++sequence, go.cue, go.sharedNs, 0, 0};
+            resends.append({encodePacket(packet), SYNC_GO_SENDS, nowNs});
+        }
+        for (int i = 0; i < resends.size();)
+        {
+            go_resend_t &resend = resends[i];
+            if (resend.nextNs > nowNs)
+            {
+                ++i;
+                continue;
+            }
+            socket.writeDatagram(resend.data, masterAddress, syncPort);
+            resend.nextNs = nowNs + SYNC_GO_RESEND_MS * 1000000LL;
+            if (--resend.sendsLeft == 0)
+                resends.removeAt(i);
+            else
+                ++i;
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QHostAddress>
+#include <atomic>
+#include "clock.h"
+#include "ringbuffer.h"
+
+class QUdpSocket;
+
+#define SYNC_DEFAULT_PORT 7020
+#define SYNC_WINDOW 64          // Exchanges of the estimate, 8 s at the poll rate
+#define SYNC_MIN_SAMPLES 8      // Exchanges before the estimate is used
+#define SYNC_GO_QUEUE_SIZE 64
+#define SYNC_DEFAULT_LEAD_MS 500 // Shared GO time ahead of the request
+#define SYNC_MIN_LEAD_MS 50      // Time for the GO to reach every client
+#define SYNC_SPIN_MS 2           // Timer wake-up before the GO, the rest is a spin
+
+typedef enum
+{
+    SYNC_OFF = 0,
+    SYNC_MASTER,   // Its clock is the shared time
+    SYNC_CLIENT
+} sync_role_t;
+
+typedef struct
+{
+    bool locked = false;       // Enough exchanges for the shared time
+    qint64 exchanges = 0;
+    double offsetUs = 0;       // Shared time minus local time, now
+    double driftPpm = 0;       // Local clock against the shared one
+    double jitterUs = 0;       // Offset residuals of the kept exchanges
+    double roundTripUs = 0;    // Least round trip of the window
+    double pathDelayUs = 0;    // One way, half of the least round trip
+    int outliers = 0;          // Exchanges of the window left out
+} sync_stats_t;
+
+typedef struct
+{
+    qint32 cue;
+    qint64 sharedNs;  // GO time on the shared clock
+} sync_go_t;
+
+// Offset and drift of the local clock against the master from two-way
+// exchanges. Each exchange gives an offset and a round trip, the estimate
+// keeps the faster half of the window (queueing only adds delay) and drops
+// offsets far from their median, then fits a line through the rest: the
+// value is the offset, the slope the drift.
+class OffsetEstimator
+{
+public:
+    void reset();
+    // t1 local send, t2 master receive, t3 master send, t4 local receive
+    void addExchange(qint64 t1, qint64 t2, qint64 t3, qint64 t4);
+    sync_stats_t stats(qint64 localNs) const;
+    qint64 toShared(qint64 localNs) const;
+    qint64 toLocal(qint64 sharedNs) const;
+
+private:
+    typedef struct
+    {
+        qint64 localNs;   // Middle of the exchange
+        double offsetNs;
+        double roundTripNs;
+    } exchange_t;
+
+    exchange_t window[SYNC_WINDOW];
+    int count = 0;
+    int next = 0;
+    qint64 exchanges = 0;
+
+    // Fit of the kept exchanges: offset = offsetNs + slope * (local - refNs)
+    qint64 refNs = 0;
+    double offsetNs = 0;
+    double slope = 0;
+    double jitterNs = 0;
+    double roundTripNs = 0;
+    int outliers = 0;
+
+    void fit();
+};
+
+// Shared time of several players. Clients poll the master with two-way
+// exchanges on their own thread. A GO for a shared time is sent to the
+// master, which passes it to every client and takes it itself, each
+// instance starts the cue when its estimate of the shared time gets there.
+// Every GO is sent a few times with its sequence, receivers drop repeats.
+// The master takes GOs only from clients that poll it, a client only from
+// its master.
+class ClockSync : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ClockSync(QObject *parent = nullptr);
+    ~ClockSync();
+
+    // Listens on bindAddress, the Art-Net interface
+    bool start(sync_role_t role, const QString &master, quint16 port, const QHostAddress &bindAddress,
+               Clock *clock = Clock::system());
+    void stop();
+    sync_role_t getRole() const;
+
+    sync_stats_t getStats() const;
+    bool isLocked() const; // The master always is
+    qint64 sharedNow() const;
+    qint64 toLocal(qint64 sharedNs) const;
+
+    void scheduleGo(int cue, qint64 sharedNs); // For every instance, this one included
+    bool takeGo(sync_go_t &go); // Playback thread only
+
+signals:
+    void goPending();
+    void sendMsg(const QString &msg);
+
+private:
+    sync_role_t role = SYNC_OFF;
+    Clock *clock = Clock::system();
+    QHostAddress masterAddress;
+    QHostAddress listenAddress;
+    quint16 syncPort = 0;
+    QThread *thread = nullptr;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> wakePending{false};
+
+    mutable QMutex mutex; // Guards the estimator and the outgoing GOs
+    OffsetEstimator estimator;
+    QVector<sync_go_t> outgoing; // Scheduled here, sent by the thread
+    RingBuffer<sync_go_t, SYNC_GO_QUEUE_SIZE> incoming;
+
+    void masterLoop(QUdpSocket &socket);
+    void clientLoop(QUdpSocket &socket);
+    void pushGo(const sync_go_t &go);
+};
+
+#endif // CLOCKSYNC_H
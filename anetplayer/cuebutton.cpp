@@ -1,7 +1,8 @@
 #include "cuebutton.h"
+#include "scrubengine.h"
 
-CueButton::CueButton(QWidget *parent)
-    : QPushButton(parent), player(new QMediaPlayer(this)), timer(new QTimer(this))
+CueButton::CueButton(QWidget *parent, Clock *clock)
+    : QPushButton(parent), clock(clock), timer(clock->createTimer(this)), frameClock(clock)
 {
     // Set the size policy to allow the button to expand
     setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
@@ -9,18 +10,40 @@ CueButton::CueButton(QWidget *parent)
     // Default system button color
     cueColor = palette().color(QPalette::Button);
 
+    // Connect timer to update the playback time
+    connect(timer, &ClockTimer::timeout, this, &CueButton::updateTime);
+    // Connect left mouse button click to start playback
+    connect(this, &QPushButton::clicked, this, &CueButton::playFile);
+}
+
+QMediaPlayer *CueButton::mediaPlayer()
+{
+    if (player) return player;
+
+    TRACE_SCOPE("media", "CueButton::mediaPlayer");
+    player = new QMediaPlayer(this);
     // Create and bind an audio output device
     QAudioOutput *audioOutput = new QAudioOutput(this);
+    audioOutput->setMuted(standby);
     player->setAudioOutput(audioOutput);
     player->setPlaybackRate(1.0); // Standard playback speed (1x)
     // Track the current playback position of the file
     connect(player, &QMediaPlayer::positionChanged, this, &CueButton::onPositionChanged);
-    // Connect timer to update the playback time
-    connect(timer, &QTimer::timeout, this, &CueButton::updateTime);
-    // Connect left mouse button click to start playback
-    connect(this, &QPushButton::clicked, this, &CueButton::playFile);
     // Track when playback reaches the end
     connect(player, &QMediaPlayer::mediaStatusChanged, this, &CueButton::onMediaStatusChanged);
+    return player;
+}
+
+bool CueButton::isPlaying() const
+{
+    if (looping) return !loop->isPaused(); // The player is paused under the loop
+    return player && player->isPlaying();
+}
+
+QMediaPlayer::PlaybackState CueButton::playbackState() const
+{
+    if (looping) return loop->isPaused() ? QMediaPlayer::PausedState : QMediaPlayer::PlayingState;
+    return player ? player->playbackState() : QMediaPlayer::StoppedState;
 }
 
 CueButton::~CueButton()
@@ -57,6 +80,7 @@ void CueButton::adjustTimeDialog(bool addTime)
         timeAdjustmentDisplay = QString("%1%2").arg(sign, input);
 
         setFileNameText(fileName); // Update the button text
+        emit cueEdited(this, CUE_FIELD_OFFSET);
     }
     else if (ok)
     {
@@ -64,27 +88,84 @@ void CueButton::adjustTimeDialog(bool addTime)
     }
 }
 
+void CueButton::addMarkerDialog()
+{
+    bool ok;
+    QString input = QInputDialog::getText(this,
+                                          "Add Marker",
+                                          "Marker position in the cue (hh:mm:ss:ff):",
+                                          QLineEdit::Normal,
+                                          "00:00:00:00",
+                                          &ok);
+    if (!ok) return;
+    if (!validateTimeFormat(input))
+    {
+        QMessageBox::warning(this, "Invalid Input", "Please enter a valid time format (hh:mm:ss:ff).");
+        return;
+    }
+
+    QString text = QInputDialog::getText(this, "Add Marker", "Marker text:", QLineEdit::Normal, input, &ok);
+    if (!ok) return;
+
+    cue_event_t marker;
+    marker.type = CUE_EVENT_MARKER;
+    marker.timeMs = timeStringToMilliseconds(input);
+    marker.text = text;
+
+    QVector<cue_event_t> events = eventTrack.getEvents();
+    events.append(marker);
+    eventTrack.setEvents(events);
+    emit cueEdited(this, CUE_FIELD_EVENTS);
+}
+
+void CueButton::clearEvents()
+{
+    eventTrack.setEvents(QVector<cue_event_t>());
+    emit cueEdited(this, CUE_FIELD_EVENTS);
+}
+
+void CueButton::setLoopDialog()
+{
+    bool ok;
+    const QString in = QInputDialog::getText(this, "Set Loop", "Loop in (hh:mm:ss:ff):", QLineEdit::Normal,
+                                             loopIn.isEmpty() ? "00:00:00:00" : loopIn, &ok);
+    if (!ok) return;
+    const QString out = QInputDialog::getText(this, "Set Loop", "Loop out (hh:mm:ss:ff):", QLineEdit::Normal,
+                                              loopOut.isEmpty() ? in : loopOut, &ok);
+    if (!ok) return;
+
+    if (!setLoop(in, out))
+    {
+        QMessageBox::warning(this, "Invalid Input", "Please enter valid times (hh:mm:ss:ff), the out point after the in point.");
+        return;
+    }
+    emit cueEdited(this, CUE_FIELD_LOOP);
+}
+
 bool CueButton::validateTimeFormat(const QString &timeString)
 {
     static QRegularExpression regex("^\\d{2}:\\d{2}:\\d{2}:\\d{2}$");
     return regex.match(timeString).hasMatch();
 }
 
-qint64 CueButton::timeStringToMilliseconds(const QString &timeString)
+timecode_t CueButton::timeStringToTimecode(const QString &timeString)
 {
+    timecode_t tc = {0, 0, 0, 0, static_cast<uint8_t>(fps)};
     QStringList parts = timeString.split(':');
     if (parts.size() != 4) {
-        return 0; // Invalid time format, return 0
+        return tc; // Invalid time format, return 0
     }
 
-    timecode_t tc;
     tc.hh = parts[0].toInt();
     tc.mm = parts[1].toInt();
     tc.ss = parts[2].toInt();
     tc.ff = parts[3].toInt();
-    tc.fps = fps;
+    return tc;
+}
 
-    return tcconverter.tc2milliseconds(tc);
+qint64 CueButton::timeStringToMilliseconds(const QString &timeString)
+{
+    return tcconverter.tc2milliseconds(timeStringToTimecode(timeString));
 }
 
 void CueButton::contextMenuEvent(QContextMenuEvent *event)
@@ -98,6 +179,66 @@ void CueButton::contextMenuEvent(QContextMenuEvent *event)
     QAction *addTimeAction = menu.addAction("Add Time");
     QAction *subtractTimeAction = menu.addAction("Subtract Time");
     QAction *setCueColorAction = menu.addAction("Set Cue Color");
+    QAction *addMarkerAction = menu.addAction("Add Marker");
+    QAction *clearEventsAction = menu.addAction("Clear Events");
+    clearEventsAction->setEnabled(!eventTrack.isEmpty());
+    // Timecode rate of this cue
+    QMenu *rateMenu = menu.addMenu("Framerate");
+    for (const framerate_t &entry : frameRates())
+    {
+        QAction *rateAction = rateMenu->addAction(entry.label);
+        rateAction->setCheckable(true);
+        rateAction->setChecked(&entry == rate);
+        const QString name = entry.name;
+        connect(rateAction, &QAction::triggered, this, [this, name]() {
+            if (name == rate->name) return;
+            setFrameRate(name);
+            emit cueEdited(this, CUE_FIELD_FRAMERATE);
+        });
+    }
+    QAction *setLoopAction = menu.addAction("Set Loop");
+    QAction *clearLoopAction = menu.addAction("Clear Loop");
+    clearLoopAction->setEnabled(hasLoop());
+
+    // Timecode at the loop point
+    QMenu *loopMenu = menu.addMenu("Loop Timecode");
+    const QStringList loopModes = {"Jump Back", "Continue"};
+    for (int i = 0; i < loopModes.size(); ++i)
+    {
+        QAction *modeAction = loopMenu->addAction(loopModes[i]);
+        modeAction->setCheckable(true);
+        modeAction->setChecked(i == loopTcMode);
+        connect(modeAction, &QAction::triggered, this, [this, i]() {
+            if (i == loopTcMode) return;
+            setLoopTcMode(static_cast<loop_tc_mode_t>(i));
+            emit cueEdited(this, CUE_FIELD_LOOP);
+        });
+    }
+
+    // Deck selection, only when there are several decks
+    if (deckNames.size() > 1)
+    {
+        QMenu *deckMenu = menu.addMenu("Deck");
+        for (int i = 0; i < deckNames.size(); ++i)
+        {
+            QAction *deckAction = deckMenu->addAction(deckNames[i]);
+            deckAction->setCheckable(true);
+            deckAction->setChecked(i == deck);
+            connect(deckAction, &QAction::triggered, this, [this, i]() {
+                if (i == deck) return;
+                setDeck(i);
+                emit cueEdited(this, CUE_FIELD_DECK);
+            });
+        }
+    }
+
+    QAction *ltcAction = menu.addAction("LTC Output");
+    ltcAction->setCheckable(true);
+    ltcAction->setChecked(ltcOutput);
+    connect(ltcAction, &QAction::triggered, this, [this](bool checked) {
+        setLtcOutput(checked);
+        emit cueEdited(this, CUE_FIELD_LTC);
+    });
 
     // Connect actions to slots
     connect(selectFileAction, &QAction::triggered, this, &CueButton::selectFile);
@@ -105,6 +246,13 @@ void CueButton::contextMenuEvent(QContextMenuEvent *event)
     connect(addTimeAction, &QAction::triggered, this, [this]() { adjustTimeDialog(true); });
     connect(subtractTimeAction, &QAction::triggered, this, [this]() { adjustTimeDialog(false); });
     connect(setCueColorAction, &QAction::triggered, this, &CueButton::chooseButtonColor);
+    connect(addMarkerAction, &QAction::triggered, this, &CueButton::addMarkerDialog);
+    connect(clearEventsAction, &QAction::triggered, this, &CueButton::clearEvents);
+    connect(setLoopAction, &QAction::triggered, this, &CueButton::setLoopDialog);
+    connect(clearLoopAction, &QAction::triggered, this, [this]() {
+        clearLoop();
+        emit cueEdited(this, CUE_FIELD_LOOP);
+    });
 
     // Display the menu at the cursor position
     menu.exec(event->globalPos());
@@ -124,6 +272,30 @@ void CueButton::setFileNameText(const QString &fileName)
     {
         displayText += "\n+00:00:00:00"; // Add default time adjustment string
     }
+    displayText += "  " + rate->label; // Every cue runs at its own rate
+    if (ltcOutput)
+        displayText += "  LTC";
+
+    // Deck of the cue, when there are several
+    if (deckNames.size() > 1)
+    {
+        displayText += "\n" + deckNames.value(deck, QString("Deck %1").arg(deck + 1));
+    }
+
+    if (hasLoop())
+    {
+        displayText += QString("\nLoop %1-%2").arg(loopIn, loopOut);
+    }
+
+    // Flag missing or broken media before the show starts
+    if (mediaInfo.status == MEDIA_MISSING)
+    {
+        displayText += "\nMISSING";
+    }
+    else if (mediaInfo.status == MEDIA_BROKEN)
+    {
+        displayText += "\nBROKEN";
+    }
 
     setText(displayText); // Set button text
 }
@@ -136,7 +308,10 @@ void CueButton::selectFile()
     // If a file is selected, set its name as the button's text
     if (!fileName.isEmpty())
     {
+        mediaInfo = media_info_t();
         setFileNameText(fileName);
+        emit fileSelected(this);
+        emit cueEdited(this, CUE_FIELD_FILE);
     }
 }
 
@@ -148,6 +323,7 @@ void CueButton::clear()
 
 void CueButton::playFile()
 {
+    TRACE_SCOPE("cue", "CueButton::playFile");
 
     if (filePath.isEmpty()) {
         return;
@@ -157,67 +333,252 @@ void CueButton::playFile()
         emit playingStatus("ERROR! Can't play file. File path doesn't exixsts.");
         return;
     }
+    else if (mediaInfo.status == MEDIA_BROKEN)
+    {
+        emit playingStatus("ERROR! File cannot be played: " + fileName);
+        return;
+    }
 
-    player->setSource(QUrl::fromLocalFile(filePath));
-    duration = player->duration();
+    {
+        TRACE_SCOPE("media", "QMediaPlayer::setSource");
+        mediaPlayer()->setSource(QUrl::fromLocalFile(filePath));
+    }
+    // The probed duration is exact and known before the player parses the file
+    duration = (mediaInfo.durationMs > 0) ? mediaInfo.durationMs : player->duration();
     if (duration == 0)
     {
         emit playingStatus("ERROR! File cannot be played: " + fileName);
         return;
     }
+    if (looping)
+    {
+        loop->stop();
+        looping = false;
+    }
     player->setPosition(0);
-    lastKnownPosition = 0; // Reset position
+    frameClock.stop(); // Reset position
+    eventTrack.seek(0);
+    drift.reset(fps);
+    waitingAudioStart = true;
     player->play();
+    prepareLoop(); // Decoded while the cue plays up to the loop
 
     timer->start(1);  // Update every 1 ms
-    elapsedTimer.invalidate(); // Stop timer
+    frameClock.invalidate(); // Wait for the first position report
 
     emit playbackStarted(this); // Notify that playback has started
+    emit transportChanged(this, TRANSPORT_GO, 0);
     emit playingStatus("Playing  " + fileName);
 }
 
 void CueButton::onMediaStatusChanged(QMediaPlayer::MediaStatus status)
 {
     if (status == QMediaPlayer::EndOfMedia){
+        emit transportChanged(this, TRANSPORT_END, duration);
         this->stopPlayback(); // Stop the timer and reset the state
         emit playingStatus("Stopped " + fileName);
     }
     else if (status == QMediaPlayer::InvalidMedia)
     {
         timer->stop();
-        elapsedTimer.invalidate();
+        frameClock.invalidate();
         emit playingStatus("ERROR! File cannot be played: " + fileName);
     }
 }
 
 void CueButton::updateTime()
 {
-    if (!elapsedTimer.isValid()) return;
-    qint64 currentPosition = lastKnownPosition + elapsedTimer.elapsed(); // Interpolate
+    TRACE_SCOPE("cue", "CueButton::updateTime");
+    if (!frameClock.isRunning() || scrubbing) return; // The scrub engine sends the timecode of a drag
+    if (looping)
+        updateLoopTime();
+    else if (loop && loop->isReady())
+    {
+        const qint64 position = frameClock.position();
+        if (position >= loop->handoffMs() && position < loop->outMs())
+            enterLoop(position);
+    }
+    qint64 currentPosition = frameClock.position(); // Interpolate
+    if (looping)
+        currentPosition = LoopBuffer::timecodePlayheadMs(currentPosition, loop->outMs(), loopTcMode);
+    const qint64 audioPosition = looping ? loop->audioPositionMs() : currentPosition;
+
+    // Cursor advance, only the events that became due are visited
+    if (!eventTrack.isEmpty())
+        eventTrack.advance(audioPosition, [this](int index) { emit eventDue(this, index); });
     // Get timecode format from millisecs
-    timecode_t tc = tcconverter.milliseconds2tc(currentPosition, fps);
+    timecode_t tc;
+    if (frameClock.nextFrame(currentPosition, tc))
+    {
+        QString audioTime = tcconverter.tc2string(looping ? tcconverter.milliseconds2tc(audioPosition, fps) : tc);
+        // Apply time correction for calculating Art-Net TC
+        QString anetTime = tcconverter.anetTime(currentPosition, timeAdjustmentSign * adjustmentTimeMs, fps);
 
-    static uint8_t prevff = 0;
-    if (tc.ff != prevff)
+        // Frame count as in milliseconds2tc, the edge is compared with the audio clock
+        drift.addFrameEdge(static_cast<qint64>(currentPosition * fps / 1000), clock->nowNs());
+
+        int sliderValue = static_cast<int>((audioPosition * 1000) / duration);
+        emit updatePlayTime(this, audioTime, anetTime, sliderValue);
+    }
+}
+
+// Decoding starts at GO, the loop takes over once it's ready and the playhead is near the in point
+void CueButton::prepareLoop()
+{
+    if (!hasLoop()) return;
+    if (!loop)
     {
-        prevff = tc.ff;
+        loop = new LoopPlayer(this);
+        loop->setMuted(standby);
+        connect(loop, &LoopPlayer::failed, this, [this](const QString &msg) {
+            if (looping) leaveLoop(frameClock.position());
+            emit playingStatus("ERROR! " + msg + ": " + fileName);
+        });
+    }
+    if (!loop->isReady())
+        loop->prepare(filePath, timeStringToTimecode(loopIn), timeStringToTimecode(loopOut), fps);
+}
 
-        QString audioTime = tcconverter.tc2string(tc);
-        // Apply time correction for calculating Art-Net TC
-        qint64 adjustedTimeMs = currentPosition + timeAdjustmentSign * adjustmentTimeMs;
+// Not gapless, see LoopPlayer. It happens LOOP_HANDOFF_MS before the in point
+// so the loop itself starts clean.
+void CueButton::enterLoop(qint64 positionMs)
+{
+    if (!loop->start(positionMs)) return;
+    looping = true;
+    loopWraps = 0;
+    if (player) player->pause();
+    frameClock.setAudioPosition(loop->timecodePositionMs(loopTcMode));
+    emit playingStatus("Looping  " + fileName);
+}
+
+void CueButton::leaveLoop(qint64 positionMs)
+{
+    const bool paused = loop->isPaused();
+    loop->stop();
+    looping = false;
+    if (!player) return;
+    player->setPosition(positionMs);
+    frameClock.setAudioPosition(positionMs);
+    if (paused)
+        frameClock.invalidate();
+    else
+        player->play();
+    eventTrack.seek(positionMs);
+    drift.reset(fps);
+}
+
+// Playhead from the audio the sink took, the loop restarts the events of the region
+void CueButton::updateLoopTime()
+{
+    const qint64 wraps = loop->wraps();
+    if (wraps != loopWraps)
+    {
+        loopWraps = wraps;
+        eventTrack.seek(loop->inMs());
+        if (loopTcMode == LOOP_TC_JUMP)
+            drift.reset(fps); // The timecode jumped with the audio
+    }
+    const qint64 position = loop->timecodePositionMs(loopTcMode);
+    if (position != frameClock.reportedPosition())
+    {
+        frameClock.setAudioPosition(position);
+        drift.addAudioPosition(position, clock->nowNs());
+    }
+}
 
-        timecode_t anettc = tcconverter.milliseconds2tc(adjustedTimeMs, fps);
-        QString anetTime = tcconverter.tc2string(anettc) + QString(":%1").arg(static_cast<int>(fps));
+void CueButton::emitCurrentFrame()
+{
+    if (!frameClock.isRunning()) return;
+    const qint64 currentPosition = frameClock.position();
+    timecode_t tc;
+    frameClock.nextFrame(currentPosition, tc); // The timer continues from this frame
+    const QString anetTime = tcconverter.anetTime(currentPosition, timeAdjustmentSign * adjustmentTimeMs, fps);
+    emit updatePlayTime(this, tcconverter.tc2string(tc), anetTime, static_cast<int>((currentPosition * 1000) / duration));
+}
 
-        int sliderValue = static_cast<int>((currentPosition * 1000) / duration);
-        emit updatePlayTime(audioTime, anetTime, sliderValue);
+// Only the player moves, the show log, the markers and the drift follow the exact seek of the release
+void CueButton::scrubTo(qint64 positionMs, bool grain)
+{
+    if (!player || looping) return; // The loop is located on release
+    player->setPosition(positionMs);
+    if (!grain || player->playbackState() != QMediaPlayer::PausedState) return;
+
+    if (!grainTimer)
+    {
+        grainTimer = clock->createTimer(this);
+        grainTimer->setSingleShot(true);
+        connect(grainTimer, &ClockTimer::timeout, this, [this]() {
+            if (timer->isActive() || !player || player->playbackState() != QMediaPlayer::PlayingState)
+                return; // Played or stopped meanwhile
+            player->pause();
+            frameClock.invalidate();
+        });
     }
+    player->play();
+    grainTimer->start(SCRUB_GRAIN_MS);
+}
+
+void CueButton::setScrubbing(bool enable)
+{
+    scrubbing = enable;
+}
+
+QString CueButton::timecodeAt(qint64 positionMs)
+{
+    return tcconverter.anetTime(positionMs, timeAdjustmentSign * adjustmentTimeMs, fps);
+}
+
+QString CueButton::audioTimeAt(qint64 positionMs)
+{
+    return tcconverter.tc2string(tcconverter.milliseconds2tc(positionMs, fps));
+}
+
+void CueButton::setStandby(bool enable)
+{
+    standby = enable;
+    if (loop) loop->setMuted(enable);
+    if (!player) return; // Muted when it's created
+    player->audioOutput()->setMuted(enable);
+    if (!enable)
+        player->setPlaybackRate(1.0);
+}
+
+bool CueButton::isStandby() const
+{
+    return standby;
+}
+
+void CueButton::setRateTrim(double rate)
+{
+    if (standby && player && !qFuzzyCompare(player->playbackRate(), rate))
+        player->setPlaybackRate(rate); // Muted, the pitch change isn't heard
+}
+
+qint64 CueButton::getPlayhead() const
+{
+    if (frameClock.isRunning()) return frameClock.position();
+    return player ? player->position() : 0;
+}
+
+bool CueButton::getPositionReport(qint64 &positionMs, qint64 &timeNs) const
+{
+    if (!frameClock.isRunning()) return false;
+    positionMs = frameClock.reportedPosition();
+    timeNs = frameClock.reportTimeNs();
+    return true;
 }
 
 void CueButton::onPositionChanged(qint64 position)
 {
-    lastKnownPosition = position;
-    elapsedTimer.restart();
+    if (looping) return; // Paused under the loop
+    frameClock.setAudioPosition(position);
+    if (waitingAudioStart && position > 0)
+    {
+        waitingAudioStart = false;
+        emit audioStarted(this);
+    }
+    if (!waitingAudioStart && player->playbackState() == QMediaPlayer::PlayingState)
+        drift.addAudioPosition(position, clock->nowNs());
 }
 
 
@@ -231,8 +592,10 @@ void CueButton::chooseButtonColor()
         // Apply the color only to the selected button, so assign a unique identifier to the button
         this->setObjectName(QString("cueButton_%1").arg(reinterpret_cast<quintptr>(this)));
         // Apply the style only to this button
+        TRACE_SCOPE("ui", "CueButton::setStyleSheet");
         this->setStyleSheet(QStringLiteral("#%1 { background-color: %2; }")
                                 .arg(this->objectName(), cueColor.name()));
+        emit cueEdited(this, CUE_FIELD_COLOR);
     }
 }
 
@@ -245,53 +608,105 @@ void CueButton::resizeEvent(QResizeEvent *event)
 
 void CueButton::stopPlayback()
 {
+    if (looping)
+    {
+        emit transportChanged(this, TRANSPORT_STOP, loop->audioPositionMs());
+        loop->stop();
+        looping = false;
+    }
+    else if (player && player->playbackState() != QMediaPlayer::StoppedState)
+        emit transportChanged(this, TRANSPORT_STOP, player->position());
     if (player)
         player->stop();
     if (timer)
         timer->stop();
-    elapsedTimer.invalidate(); // Timer stop
-    lastKnownPosition = 0;
+    frameClock.stop();
+    waitingAudioStart = false;
     emit playingStatus("Stopped  " + fileName);
 }
 
 void CueButton::startPlayback()
 {
-    if (!player->isPlaying())
+    if (looping && loop->isPaused())
+    {
+        loop->resume();
+        timer->start(1);
+        drift.reset(fps);
+        emit playingStatus("Looping  " + fileName);
+        emit transportChanged(this, TRANSPORT_PLAY, loop->audioPositionMs());
+    }
+    else if (!looping && player && !player->isPlaying())
     {
         player->play();
         timer->start(1);
+        drift.reset(fps);
         emit playingStatus("Playing  " + fileName);
+        emit transportChanged(this, TRANSPORT_PLAY, player->position());
     }
 }
 
 void CueButton::pausePlayback()
 {
-    if (player->isPlaying())
+    if (isPlaying())
     {
-        player->pause();
+        const qint64 position = looping ? loop->audioPositionMs() : player->position();
+        if (looping)
+            loop->pause();
+        else
+            player->pause();
         timer->stop();
-        elapsedTimer.invalidate(); // Timer reset
+        frameClock.invalidate(); // Timer reset
+        emit transportChanged(this, TRANSPORT_PAUSE, position);
     }
     emit playingStatus("Paused  " + fileName);
 }
 
 void CueButton::setFrameRate(const QString &framerate)
 {
-    if (framerate == "24") fps = 24;
-    else if (framerate == "25") fps = 25;
-    else if (framerate == "29.97") fps = 29.97;
-    else if (framerate == "30") fps = 30;
-    else fps = 30;
+    rate = &frameRateOf(framerate);
+    fps = rate->fps;
+    frameClock.setFramerate(fps);
+    if (frameClock.isRunning())
+        drift.reset(fps); // Frame edges are counted at the new rate
+    if (!fileName.isEmpty())
+        setFileNameText(fileName);
+    if (loop && !looping)
+        loop->release(); // The loop points moved, decoded again at the next GO
 }
 
 void CueButton::setPlaybackPosition(qint64 position)
 {
-    player->setPosition(position);
+    if (looping)
+    {
+        // Inside the decoded audio the loop restarts there, elsewhere the player takes over
+        const bool inLoop = position >= loop->handoffMs() && position < loop->outMs();
+        if (!inLoop || loop->isPaused() || !loop->start(position))
+            leaveLoop(position);
+        loopWraps = 0;
+    }
+    else if (player)
+        player->setPosition(position);
+    drift.reset(fps);
+    emit transportChanged(this, TRANSPORT_LOCATE, position);
+
+    // Binary search for the next event, the marker covering the new position is shown again
+    eventTrack.seek(position);
+    int marker = eventTrack.activeMarker(position);
+    if (marker != -1)
+        emit eventDue(this, marker);
+}
+
+void CueButton::locate(timecode_t tc)
+{
+    tc.fps = fps;
+    setPlaybackPosition(tcconverter.tc2milliseconds(tc));
 }
 
 qint64 CueButton::getDuration() const
 {
-    return player->duration();
+    if (mediaInfo.durationMs > 0)
+        return mediaInfo.durationMs;
+    return player ? player->duration() : 0;
 }
 
 QString CueButton::getFilePath() const
@@ -309,11 +724,16 @@ qint64 CueButton::getAdjustmentTime() const
 
 QString CueButton::getFrameRate() const
 {
-    return QString::number(fps);
+    return rate->name;
 }
 
 void CueButton::setFilePath(const QString &path)
 {
+    if (path != filePath)
+    {
+        mediaInfo = media_info_t();
+        if (loop && !looping) loop->release();
+    }
     filePath = path;
     fileName = QUrl::fromLocalFile(filePath).fileName();
     setFileNameText(fileName);
@@ -348,6 +768,7 @@ void CueButton::setCueColor(QColor color)
         // Set a unique name for the button
         this->setObjectName(QString("cueButton_%1").arg(reinterpret_cast<quintptr>(this)));
         // Apply the style only to this button
+        TRACE_SCOPE("ui", "CueButton::setStyleSheet");
         this->setStyleSheet(QStringLiteral("#%1 { background-color: %2; }")
                                 .arg(this->objectName(), color.name()));
         cueColor = color;
@@ -359,21 +780,208 @@ QColor CueButton::getCueColor()
     return cueColor;
 }
 
-QString CueButton::getUiFramerate()
+cue_t CueButton::getCue() const
+{
+    cue_t cue;
+    cue.filePath = filePath;
+    cue.adjustmentTime = getAdjustmentTime();
+    cue.frameRate = getFrameRate();
+    cue.cueColor = cueColor;
+    cue.events = eventTrack.getEvents();
+    cue.deck = deck;
+    cue.loopIn = loopIn;
+    cue.loopOut = loopOut;
+    cue.loopTcMode = static_cast<quint8>(loopTcMode);
+    cue.ltcOut = ltcOutput;
+    return cue;
+}
+
+void CueButton::setCue(const cue_t &cue)
+{
+    if (cue.filePath.isEmpty())
+    {
+        resetCue();
+        return;
+    }
+
+    setFrameRate(cue.frameRate);
+    setAdjustmentTime(cue.adjustmentTime);
+    setFilePath(cue.filePath);
+    setCueColor(cue.cueColor);
+    eventTrack.setEvents(cue.events);
+    setDeck(cue.deck);
+    setLtcOutput(cue.ltcOut);
+    setLoopTcMode(static_cast<loop_tc_mode_t>(qMin<int>(cue.loopTcMode, LOOP_TC_CONTINUE)));
+    if (!setLoop(cue.loopIn, cue.loopOut))
+        clearLoop();
+}
+
+void CueButton::resetCue()
+{
+    if (playbackState() != QMediaPlayer::StoppedState)
+        stopPlayback();
+    if (player)
+        player->setSource(QUrl());
+
+    filePath.clear();
+    fileName.clear();
+    mediaInfo = media_info_t();
+    setToolTip(QString());
+    adjustmentTimeMs = 0;
+    timeAdjustmentSign = 1;
+    timeAdjustmentDisplay.clear();
+    eventTrack.setEvents(QVector<cue_event_t>());
+    setDeck(0);
+    clearLoop();
+    loopTcMode = LOOP_TC_JUMP;
+    ltcOutput = false;
+
+    // Back to the default system button color
+    setStyleSheet(QString());
+    cueColor = palette().color(QPalette::Button);
+    setText(QString());
+}
+
+void CueButton::setMediaInfo(const media_info_t &info)
 {
-    int framerate = static_cast<int>(fps);
-    switch (framerate) {
-    case 24:
-        return QString("24ndf");
-    case 25:
-        return QString("25ndf");
-    case 30:
-        return QString("30ndf");
-    case 29:
-        return QString("29df");
+    mediaInfo = info;
 
+    switch (info.status) {
+    case MEDIA_OK:
+    {
+        duration = info.durationMs;
+        QString tip = QString("%1, %2 Hz, %3 ch, %4")
+                          .arg(info.format)
+                          .arg(info.sampleRate)
+                          .arg(info.channels)
+                          .arg(QTime(0, 0).addMSecs(info.durationMs).toString("hh:mm:ss.zzz"));
+        if (info.hasLevels)
+        {
+            tip += QString("\nRMS %1 dBFS, peak %2 dBFS")
+                       .arg(info.rmsDb, 0, 'f', 1)
+                       .arg(info.peakDb, 0, 'f', 1);
+        }
+        setToolTip(tip);
+        break;
+    }
+    case MEDIA_UNSUPPORTED:
+        setToolTip("Unknown format: " + filePath);
+        break;
+    case MEDIA_MISSING:
+        setToolTip("File not found: " + filePath);
+        break;
+    case MEDIA_BROKEN:
+        setToolTip("File is broken: " + filePath);
+        break;
     default:
-        return QString("00df");
+        setToolTip(QString());
+        break;
+    }
+
+    if (!fileName.isEmpty())
+        setFileNameText(fileName);
+}
+
+const EventTrack &CueButton::getEventTrack() const
+{
+    return eventTrack;
+}
+
+const DriftAnalyzer &CueButton::getDrift() const
+{
+    return drift;
+}
+
+void CueButton::setDeck(int deckIndex)
+{
+    if (playbackState() != QMediaPlayer::StoppedState && deckIndex != deck)
+        stopPlayback(); // The playing deck would lose track of the cue
+    deck = qMax(0, deckIndex);
+    if (!fileName.isEmpty())
+        setFileNameText(fileName);
+}
+
+int CueButton::getDeck() const
+{
+    return deck;
+}
+
+void CueButton::setLtcOutput(bool enable)
+{
+    ltcOutput = enable;
+    if (!fileName.isEmpty())
+        setFileNameText(fileName);
+}
+
+bool CueButton::getLtcOutput() const
+{
+    return ltcOutput;
+}
+
+bool CueButton::setLoop(const QString &in, const QString &out)
+{
+    if (in.isEmpty() && out.isEmpty())
+    {
+        clearLoop();
+        return true;
     }
-    return "";
+    if (!validateTimeFormat(in) || !validateTimeFormat(out)
+        || timeStringToMilliseconds(out) <= timeStringToMilliseconds(in))
+        return false;
+
+    if (looping) leaveLoop(loop->audioPositionMs());
+    if (loop) loop->release();
+    loopIn = in;
+    loopOut = out;
+    if (isPlaying()) prepareLoop(); // Takes effect in the running cue
+    if (!fileName.isEmpty())
+        setFileNameText(fileName);
+    return true;
+}
+
+void CueButton::clearLoop()
+{
+    if (looping) leaveLoop(loop->audioPositionMs());
+    if (loop) loop->release();
+    loopIn.clear();
+    loopOut.clear();
+    if (!fileName.isEmpty())
+        setFileNameText(fileName);
+}
+
+bool CueButton::hasLoop() const
+{
+    return !loopIn.isEmpty() && !loopOut.isEmpty();
+}
+
+void CueButton::setLoopTcMode(loop_tc_mode_t mode)
+{
+    loopTcMode = mode;
+}
+
+loop_tc_mode_t CueButton::getLoopTcMode() const
+{
+    return loopTcMode;
+}
+
+bool CueButton::isLooping() const
+{
+    return looping;
+}
+
+void CueButton::setDeckNames(const QStringList &names)
+{
+    deckNames = names;
+    if (!fileName.isEmpty())
+        setFileNameText(fileName);
+}
+
+media_info_t CueButton::getMediaInfo() const
+{
+    return mediaInfo;
+}
+
+QString CueButton::getUiFramerate()
+{
+    return rate->label;
 }
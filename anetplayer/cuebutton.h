@@ -11,27 +11,37 @@
 #include <QTime>
 #include <QTimer>
 #include <QAudioOutput>
-#include <QElapsedTimer>
 #include <QInputDialog>
 #include <QRegularExpression>
 #include <QMessageBox>
 #include <QColorDialog>
 #include "tcconverter.h"
+#include "eventtrack.h"
+#include "trace.h"
+#include "driftanalyzer.h"
+#include "clock.h"
+#include "frameclock.h"
+#include "loopplayer.h"
+#include "framerate.h"
 
 class CueButton : public QPushButton
 {
     Q_OBJECT
 
 public:
-    explicit CueButton(QWidget *parent = nullptr);
+    explicit CueButton(QWidget *parent = nullptr, Clock *clock = Clock::system()); // Timers and playhead run on the clock
     ~CueButton();
-    QMediaPlayer *player;
+    QMediaPlayer *player = nullptr; // Created at the first GO, cues that never play open no audio output
+    bool isPlaying() const;
+    QMediaPlayer::PlaybackState playbackState() const;
+    QMediaPlayer *mediaPlayer(); // The player, created on the first call
 
     void stopPlayback();
     void startPlayback();
     void pausePlayback();
     void setFrameRate(const QString &framerate);
     void setPlaybackPosition(qint64 position);
+    void locate(timecode_t tc); // Move the playhead to hh:mm:ss:ff at the cue framerate
     qint64 getDuration() const;
 
     // Methods for loading the configuration
@@ -44,6 +54,49 @@ public:
     QColor getCueColor();
     QString getUiFramerate();
 
+    // Whole cue state, used by the playlist
+    cue_t getCue() const;
+    void setCue(const cue_t &cue);
+    void resetCue();
+
+    const EventTrack &getEventTrack() const;
+    const DriftAnalyzer &getDrift() const; // Timecode against the audio clock since the last start or locate
+
+    // Hot standby: the cue plays muted and follows the primary with a trimmed rate
+    void setStandby(bool standby);
+    bool isStandby() const;
+    void setRateTrim(double rate);
+    qint64 getPlayhead() const; // Interpolated position in ms
+    bool getPositionReport(qint64 &positionMs, qint64 &timeNs) const; // Last report of the player on the cue clock
+    void emitCurrentFrame(); // Timecode of the playhead now, also if it was sent already
+
+    // Slider drag: coarse seeks of the player, no timecode from the cue meanwhile
+    void scrubTo(qint64 positionMs, bool grain); // A paused cue plays a short grain
+    void setScrubbing(bool enable);
+    QString timecodeAt(qint64 positionMs); // "hh:mm:ss:ff:fps" as it's sent at that position
+    QString audioTimeAt(qint64 positionMs);
+
+    // Deck that plays the cue, the names are shown in the context menu
+    void setDeck(int deckIndex);
+    int getDeck() const;
+    void setDeckNames(const QStringList &names);
+
+    // Live LTC of the cue on the LTC output of the settings
+    void setLtcOutput(bool enable);
+    bool getLtcOutput() const;
+
+    // Loop region in timecode of the cue, played from decoded audio
+    bool setLoop(const QString &in, const QString &out); // Empty strings clear the loop
+    void clearLoop();
+    bool hasLoop() const;
+    void setLoopTcMode(loop_tc_mode_t mode);
+    loop_tc_mode_t getLoopTcMode() const;
+    bool isLooping() const; // The loop plays instead of the player
+
+    // Result of the background file check
+    void setMediaInfo(const media_info_t &info);
+    media_info_t getMediaInfo() const;
+
 protected:
     void contextMenuEvent(QContextMenuEvent *event) override; // Handle right-click for the context menu
 
@@ -57,32 +110,63 @@ private slots:
     void onPositionChanged(qint64 position);
     void onMediaStatusChanged(QMediaPlayer::MediaStatus status);
     void chooseButtonColor();
+    void setLoopDialog();
 
 private:
     TCconverter tcconverter;  // Instance of the TCconverter class
     void setFileNameText(const QString &fileName);
     QString filePath; // Full path to audio file
     QString fileName;
-    QTimer *timer;
-    QElapsedTimer elapsedTimer;
-    qint64 lastKnownPosition = 0;
+    Clock *clock;
+    ClockTimer *timer;
+    FrameClock frameClock; // Playhead between the position reports of the player
     qint64 duration = 10000; // Total duration in milliseconds
-    double fps = 30; // Art-Net frame rate
+    const framerate_t *rate = &frameRateOf("30"); // Rate of the cue, an entry of frameRates()
+    double fps = 30; // Art-Net frame rate, rate->fps
 
     void adjustTimeDialog(bool addTime);
+    void addMarkerDialog();
+    void clearEvents();
     bool validateTimeFormat(const QString &timeString);
     qint64 timeStringToMilliseconds(const QString &timeString);
+    timecode_t timeStringToTimecode(const QString &timeString);
     qint64 adjustmentTimeMs = 0;  // Time adjustment in milliseconds
     QString timeAdjustmentDisplay; // Stores the displayed adjustment time
     int timeAdjustmentSign = 1; // 1 for addition, -1 for subtraction
     QColor cueColor;
+    media_info_t mediaInfo;
+    EventTrack eventTrack; // Events fired at positions inside the cue
+    DriftAnalyzer drift;
+    int deck = 0;
+    QStringList deckNames;
+    bool ltcOutput = false;
+    bool waitingAudioStart = false; // Started, the player hasn't moved yet
+    bool standby = false;
+    QString loopIn;
+    QString loopOut;
+    loop_tc_mode_t loopTcMode = LOOP_TC_JUMP;
+    LoopPlayer *loop = nullptr; // Created when a cue with a loop plays
+    bool looping = false;
+    bool scrubbing = false;
+    ClockTimer *grainTimer = nullptr;
+    qint64 loopWraps = 0;
+
+    void prepareLoop();
+    void enterLoop(qint64 positionMs);
+    void leaveLoop(qint64 positionMs); // Back to the player at the position
+    void updateLoopTime();
     int counter = 0;
 
 signals:
-    void updatePlayTime(const QString &audioTime, const QString &tcTime, const int &sliderTime); // Signal to update the playback time
+    void updatePlayTime(CueButton *button, const QString &audioTime, const QString &tcTime, const int &sliderTime); // Signal to update the playback time
     void playbackStarted(CueButton *button);    // Signal indicating the start of playback
     void playingStatus(const QString &stat);
     void requestClear(CueButton *button);
+    void fileSelected(CueButton *button);
+    void cueEdited(CueButton *button, cue_field_t field); // Cue was changed by the user
+    void eventDue(CueButton *button, int index); // Event of the track reached, index in getEventTrack()
+    void transportChanged(CueButton *button, transport_action_t action, qint64 positionMs);
+    void audioStarted(CueButton *button); // First position update of the player after GO
 };
 
 #endif // CUEBUTTON_H
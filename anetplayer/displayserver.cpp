@@ -0,0 +1,340 @@
+#include "displayserver.h"
+#include <QFile>
+#include <QCryptographicHash>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QtEndian>
+#include "showrecorder.h"
+
+#define DISPLAY_PAGE ":/tcdisplay.html"
+#define DISPLAY_WS_PATH "/ws"
+#define DISPLAY_WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define DISPLAY_MAX_REQUEST 8192
+#define DISPLAY_MAX_BACKLOG (256 * 1024) // A client that can't keep up skips frames
+#define DISPLAY_MAX_PENDING 256
+
+DisplayServerWorker::DisplayServerWorker(QObject *parent)
+    : QObject(parent)
+{
+}
+
+bool DisplayServerWorker::listen(const QHostAddress &address, quint16 port)
+{
+    close();
+
+    QFile file(DISPLAY_PAGE);
+    if (file.open(QIODevice::ReadOnly))
+        page = file.readAll();
+
+    server = new QTcpServer(this);
+    server->setMaxPendingConnections(DISPLAY_MAX_PENDING);
+    connect(server, &QTcpServer::newConnection, this, &DisplayServerWorker::onNewConnection);
+    if (!server->listen(address, port))
+    {
+        delete server;
+        server = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void DisplayServerWorker::close()
+{
+    for (auto it = clients.begin(); it != clients.end(); ++it)
+    {
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+    }
+    clients.clear();
+    webSockets = 0;
+    delete server;
+    server = nullptr;
+}
+
+int DisplayServerWorker::clientCount() const
+{
+    return webSockets.load(std::memory_order_relaxed);
+}
+
+void DisplayServerWorker::post(const QByteArray &frame)
+{
+    QMutexLocker locker(&frameMutex);
+    latestFrame = frame;
+    if (framePending) return; // The queued broadcast takes the latest frame
+    framePending = true;
+    QMetaObject::invokeMethod(this, &DisplayServerWorker::broadcast, Qt::QueuedConnection);
+}
+
+void DisplayServerWorker::broadcast()
+{
+    QByteArray frame;
+    {
+        QMutexLocker locker(&frameMutex);
+        frame = latestFrame;
+        framePending = false;
+    }
+
+    // The frame is implicitly shared, every write references the same bytes
+    for (auto it = clients.cbegin(); it != clients.cend(); ++it)
+    {
+        QTcpSocket *socket = it.key();
+        if (it->websocket && socket->bytesToWrite() < DISPLAY_MAX_BACKLOG)
+            socket->write(frame);
+    }
+}
+
+void DisplayServerWorker::onNewConnection()
+{
+    while (QTcpSocket *socket = server->nextPendingConnection())
+    {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        clients.insert(socket, client_t());
+        connect(socket, &QTcpSocket::readyRead, this, &DisplayServerWorker::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, &DisplayServerWorker::onDisconnected);
+    }
+}
+
+void DisplayServerWorker::onDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    auto it = clients.find(socket);
+    if (it == clients.end()) return;
+    if (it->websocket)
+        --webSockets;
+    clients.erase(it);
+    socket->deleteLater();
+}
+
+void DisplayServerWorker::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    auto it = clients.find(socket);
+    if (it == clients.end()) return;
+
+    client_t &client = it.value();
+    client.buffer.append(socket->readAll());
+    if (client.websocket)
+        handleFrames(socket, client);
+    else
+        handleRequest(socket, client);
+}
+
+void DisplayServerWorker::handleRequest(QTcpSocket *socket, client_t &client)
+{
+    const int headerEnd = client.buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+    {
+        if (client.buffer.size() > DISPLAY_MAX_REQUEST)
+            socket->abort();
+        return;
+    }
+
+    const QList<QByteArray> lines = client.buffer.left(headerEnd).split('\n');
+    client.buffer.remove(0, headerEnd + 4);
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() < 2 || requestLine[0] != "GET")
+    {
+        sendResponse(socket, "405 Method Not Allowed", "text/plain", "Method not allowed\n");
+        return;
+    }
+
+    QByteArray key;
+    bool upgrade = false;
+    for (int i = 1; i < lines.size(); ++i)
+    {
+        const QByteArray line = lines[i].trimmed();
+        const int colon = line.indexOf(':');
+        if (colon < 0) continue;
+        const QByteArray name = line.left(colon).trimmed().toLower();
+        const QByteArray value = line.mid(colon + 1).trimmed();
+        if (name == "sec-websocket-key")
+            key = value;
+        else if (name == "upgrade")
+            upgrade = value.toLower() == "websocket";
+    }
+
+    const QByteArray path = requestLine[1];
+    if (path == DISPLAY_WS_PATH && upgrade && !key.isEmpty())
+    {
+        const QByteArray accept = QCryptographicHash::hash(key + DISPLAY_WS_GUID, QCryptographicHash::Sha1).toBase64();
+        socket->write("HTTP/1.1 101 Switching Protocols\r\n"
+                      "Upgrade: websocket\r\n"
+                      "Connection: Upgrade\r\n"
+                      "Sec-WebSocket-Accept: " + accept + "\r\n\r\n");
+        client.websocket = true;
+        ++webSockets;
+
+        // A new display shows the current state without waiting for the next frame
+        QMutexLocker locker(&frameMutex);
+        if (!latestFrame.isEmpty())
+            socket->write(latestFrame);
+        return;
+    }
+
+    if (path == "/" || path == "/index.html")
+        sendResponse(socket, "200 OK", "text/html; charset=utf-8", page);
+    else
+        sendResponse(socket, "404 Not Found", "text/plain", "Not found\n");
+}
+
+void DisplayServerWorker::sendResponse(QTcpSocket *socket, const QByteArray &status, const QByteArray &type, const QByteArray &body)
+{
+    socket->write("HTTP/1.1 " + status + "\r\n"
+                  "Content-Type: " + type + "\r\n"
+                  "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                  "Cache-Control: no-cache\r\n"
+                  "Connection: close\r\n\r\n");
+    socket->write(body);
+    socket->disconnectFromHost();
+}
+
+// Client frames: only close and ping are answered, the display sends nothing else
+void DisplayServerWorker::handleFrames(QTcpSocket *socket, client_t &client)
+{
+    while (client.buffer.size() >= 2)
+    {
+        const uchar *d = reinterpret_cast<const uchar*>(client.buffer.constData());
+        const int opcode = d[0] & 0x0F;
+        const bool masked = d[1] & 0x80;
+        qint64 length = d[1] & 0x7F;
+        int pos = 2;
+        if (length == 126)
+        {
+            if (client.buffer.size() < 4) return;
+            length = qFromBigEndian<quint16>(d + 2);
+            pos = 4;
+        }
+        else if (length == 127)
+        {
+            if (client.buffer.size() < 10) return;
+            length = qFromBigEndian<quint64>(d + 2);
+            pos = 10;
+        }
+        if (length > DISPLAY_MAX_REQUEST)
+        {
+            socket->abort();
+            return;
+        }
+        const int maskPos = pos;
+        if (masked) pos += 4;
+        if (client.buffer.size() < pos + length) return;
+
+        QByteArray payload = client.buffer.mid(pos, length);
+        if (masked)
+        {
+            for (int i = 0; i < payload.size(); ++i)
+                payload[i] = payload[i] ^ d[maskPos + (i & 3)];
+        }
+        client.buffer.remove(0, pos + length);
+
+        if (opcode == 0x8)
+        {
+            socket->write(QByteArray("\x88\x00", 2)); // Close
+            socket->disconnectFromHost();
+            return;
+        }
+        if (opcode == 0x9)
+        {
+            QByteArray pong = DisplayServer::textFrame(payload);
+            pong[0] = static_cast<char>(0x8A);
+            socket->write(pong);
+        }
+    }
+}
+
+DisplayServer::DisplayServer(QObject *parent)
+    : QObject(parent)
+    , worker(new DisplayServerWorker())
+{
+    worker->moveToThread(&thread);
+    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
+    thread.setObjectName("Display server");
+    thread.start();
+}
+
+DisplayServer::~DisplayServer()
+{
+    stop();
+    thread.quit();
+    thread.wait();
+}
+
+bool DisplayServer::start(quint16 port, const QHostAddress &address)
+{
+    if (listenPort == port && listenAddress == address) return true;
+    stop();
+    if (port == 0 || address.isNull()) return false;
+
+    bool ok = false;
+    QMetaObject::invokeMethod(worker, [this, port, address]() { return worker->listen(address, port); },
+                              Qt::BlockingQueuedConnection, &ok);
+    if (!ok)
+    {
+        emit sendMsg(QString("Can't open the display server on %1:%2").arg(address.toString()).arg(port));
+        return false;
+    }
+    listenPort = port;
+    listenAddress = address;
+    const QString host = (address == QHostAddress::AnyIPv4) ? "<this host>" : address.toString();
+    emit sendMsg(QString("Timecode display on http://%1:%2/").arg(host).arg(port));
+    return true;
+}
+
+void DisplayServer::stop()
+{
+    if (listenPort == 0) return;
+    QMetaObject::invokeMethod(worker, &DisplayServerWorker::close, Qt::BlockingQueuedConnection);
+    listenPort = 0;
+    listenAddress.clear();
+}
+
+bool DisplayServer::isRunning() const
+{
+    return listenPort != 0;
+}
+
+int DisplayServer::clientCount() const
+{
+    return worker->clientCount();
+}
+
+void DisplayServer::publish(const QString &timecode, const QString &fps, const QString &cue, const QString &state)
+{
+    if (listenPort == 0) return;
+
+    QJsonObject obj;
+    obj.insert("tc", timecode);
+    obj.insert("fps", fps);
+    obj.insert("cue", cue);
+    obj.insert("state", state);
+    obj.insert("us", ShowRecorder::now() / 1000); // Monotonic send time, used by the load test
+    worker->post(textFrame(QJsonDocument(obj).toJson(QJsonDocument::Compact)));
+}
+
+QByteArray DisplayServer::textFrame(const QByteArray &payload)
+{
+    QByteArray frame;
+    frame.reserve(payload.size() + 10);
+    frame.append(static_cast<char>(0x81)); // FIN, text
+    if (payload.size() < 126)
+    {
+        frame.append(static_cast<char>(payload.size()));
+    }
+    else if (payload.size() < 65536)
+    {
+        frame.append(static_cast<char>(126));
+        char length[2];
+        qToBigEndian<quint16>(payload.size(), length);
+        frame.append(length, 2);
+    }
+    else
+    {
+        frame.append(static_cast<char>(127));
+        char length[8];
+        qToBigEndian<quint64>(payload.size(), length);
+        frame.append(length, 8);
+    }
+    frame.append(payload);
+    return frame;
+}
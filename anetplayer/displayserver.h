@@ -0,0 +1,89 @@
+#ifndef DISPLAYSERVER_H
+#define DISPLAYSERVER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QHash>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <atomic>
+
+#define DISPLAY_DEFAULT_PORT 8080
+#define DISPLAY_DEFAULT_ADDRESS "127.0.0.1" // This computer only until another address is set
+
+// Connections of the display server, lives in the server thread
+class DisplayServerWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DisplayServerWorker(QObject *parent = nullptr);
+
+    void post(const QByteArray &frame); // Called from the GUI thread
+    int clientCount() const;
+
+public slots:
+    bool listen(const QHostAddress &address, quint16 port);
+    void close();
+
+private slots:
+    void broadcast();
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+    typedef struct
+    {
+        QByteArray buffer;  // Unparsed input
+        bool websocket = false;
+    } client_t;
+
+    QTcpServer *server = nullptr;
+    QHash<QTcpSocket*, client_t> clients;
+    QByteArray page;        // Display page, read once from the resources
+    std::atomic<int> webSockets{0};
+
+    QMutex frameMutex;
+    QByteArray latestFrame; // Pre-serialized WebSocket frame, shared by all connections
+    bool framePending = false;
+
+    void handleRequest(QTcpSocket *socket, client_t &client);
+    void handleFrames(QTcpSocket *socket, client_t &client);
+    void sendResponse(QTcpSocket *socket, const QByteArray &status, const QByteArray &type, const QByteArray &body);
+};
+
+// Embedded HTTP and WebSocket server for remote timecode displays.
+// The page is served at http://host:port/, the page connects to /ws and
+// gets the timecode, cue and transport state. Every publish() serializes
+// one frame, the server thread writes the same bytes to all clients.
+class DisplayServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DisplayServer(QObject *parent = nullptr);
+    ~DisplayServer();
+
+    bool start(quint16 port, const QHostAddress &address); // Restarts when either changed
+    void stop();
+    bool isRunning() const;
+    int clientCount() const;
+
+    void publish(const QString &timecode, const QString &fps, const QString &cue, const QString &state);
+
+    static QByteArray textFrame(const QByteArray &payload); // Unmasked WebSocket text frame
+
+signals:
+    void sendMsg(const QString &msg);
+
+private:
+    QThread thread;
+    DisplayServerWorker *worker;
+    quint16 listenPort = 0;
+    QHostAddress listenAddress;
+};
+
+#endif // DISPLAYSERVER_H
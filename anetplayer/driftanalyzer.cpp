@@ -0,0 +1,79 @@
+#include "driftanalyzer.h"
+#include <cmath>
+
+void DriftAnalyzer::reset(double framerate)
+{
+    *this = DriftAnalyzer();
+    fps = framerate > 0 ? framerate : 30;
+}
+
+void DriftAnalyzer::addAudioPosition(qint64 positionMs, qint64 timeNs)
+{
+    if (originNs < 0) originNs = timeNs;
+    const double x = (timeNs - originNs) / 1e9;
+    audioX[audioNext] = x;
+    audioY[audioNext] = static_cast<double>(positionMs);
+    audioNext = (audioNext + 1) % DRIFT_AUDIO_WINDOW;
+    if (audioCount < DRIFT_AUDIO_WINDOW) ++audioCount;
+    audioClock.add(x, static_cast<double>(positionMs));
+}
+
+// Playhead in ms at x. Over the short window the audio clock runs at the
+// nominal rate, so only the phase is fitted, it averages the report jitter.
+double DriftAnalyzer::playheadAt(double x) const
+{
+    double phase = 0;
+    for (int i = 0; i < audioCount; ++i)
+        phase += audioY[i] - audioX[i] * 1000.0;
+    return phase / audioCount + x * 1000.0;
+}
+
+void DriftAnalyzer::addFrameEdge(qint64 frame, qint64 timeNs)
+{
+    if (audioCount == 0) return; // No audio clock yet
+    const double x = (timeNs - originNs) / 1e9;
+    const double frameMs = frame * 1000.0 / fps;
+    const double offset = playheadAt(x) - frameMs;
+
+    offsets[offsetNext] = offset;
+    offsetNext = (offsetNext + 1) % DRIFT_OFFSET_WINDOW;
+    if (offsetCount < DRIFT_OFFSET_WINDOW) ++offsetCount;
+
+    const double audioS = frameMs / 1000.0;
+    drift.add(audioS, offset);
+    if (edges == 0)
+    {
+        firstAudioS = audioS;
+        minOffset = offset;
+        maxOffset = offset;
+    }
+    lastAudioS = audioS;
+    minOffset = qMin(minOffset, offset);
+    maxOffset = qMax(maxOffset, offset);
+    ++edges;
+}
+
+drift_stats_t DriftAnalyzer::stats() const
+{
+    drift_stats_t result;
+    result.edges = edges;
+    if (edges == 0) return result;
+
+    double sum = 0;
+    for (int i = 0; i < offsetCount; ++i)
+        sum += offsets[i];
+    const double mean = sum / offsetCount;
+    double squares = 0;
+    for (int i = 0; i < offsetCount; ++i)
+        squares += (offsets[i] - mean) * (offsets[i] - mean);
+
+    result.elapsedS = lastAudioS - firstAudioS;
+    result.offsetMs = mean;
+    result.jitterMs = std::sqrt(squares / offsetCount);
+    result.minOffsetMs = minOffset;
+    result.maxOffsetMs = maxOffset;
+    result.driftPpm = drift.slope() * 1000.0; // ms per s
+    if (audioClock.n > 1)
+        result.audioClockPpm = audioClock.slope() * 1000.0 - 1e6;
+    return result;
+}
@@ -0,0 +1,80 @@
+#ifndef DRIFTANALYZER_H
+#define DRIFTANALYZER_H
+
+#include <QtGlobal>
+
+#define DRIFT_AUDIO_WINDOW 64   // Audio clock samples of the local clock fit
+#define DRIFT_OFFSET_WINDOW 256 // Frame edges of the live offset, about 8 s
+
+typedef struct
+{
+    qint64 edges = 0;          // Frame edges analysed
+    double elapsedS = 0;       // Audio time covered
+    double offsetMs = 0;       // Mean over the last window, positive = timecode behind the audio
+    double jitterMs = 0;       // Standard deviation over the last window
+    double minOffsetMs = 0;
+    double maxOffsetMs = 0;
+    double driftPpm = 0;       // Trend of the offset over the whole run
+    double audioClockPpm = 0;  // Audio clock against the system clock
+} drift_stats_t;
+
+// Compares the emitted timecode frame edges with the audio clock. The
+// audio clock is the position reported by the player, a line is fitted
+// through the last reports to get the playhead at the moment a frame is
+// sent. The offset is that playhead minus the nominal start of the frame,
+// the drift is the slope of the offset over the run. Running sums are kept,
+// so a long show costs no memory.
+class DriftAnalyzer
+{
+public:
+    void reset(double framerate);
+    void addAudioPosition(qint64 positionMs, qint64 timeNs);
+    void addFrameEdge(qint64 frame, qint64 timeNs); // Frame count at the framerate
+    drift_stats_t stats() const;
+
+private:
+    typedef struct
+    {
+        qint64 n = 0;
+        double meanX = 0;
+        double meanY = 0;
+        double m2x = 0; // Sum of squared x deviations
+        double cxy = 0; // Sum of the x*y co-deviations
+
+        void add(double x, double y)
+        {
+            ++n;
+            const double dx = x - meanX;
+            meanX += dx / n;
+            meanY += (y - meanY) / n;
+            m2x += dx * (x - meanX);
+            cxy += dx * (y - meanY);
+        }
+        double slope() const { return m2x > 0 ? cxy / m2x : 0; }
+    } regression_t; // Welford's running least squares
+
+    double fps = 30;
+    qint64 originNs = -1;
+
+    // Last audio reports, x = s since the origin, y = position in ms
+    double audioX[DRIFT_AUDIO_WINDOW];
+    double audioY[DRIFT_AUDIO_WINDOW];
+    int audioCount = 0;
+    int audioNext = 0;
+
+    double offsets[DRIFT_OFFSET_WINDOW];
+    int offsetCount = 0;
+    int offsetNext = 0;
+
+    regression_t audioClock; // Position over system time
+    regression_t drift;      // Offset over audio time
+    qint64 edges = 0;
+    double firstAudioS = -1;
+    double lastAudioS = 0;
+    double minOffset = 0;
+    double maxOffset = 0;
+
+    double playheadAt(double x) const;
+};
+
+#endif // DRIFTANALYZER_H
@@ -0,0 +1,187 @@
+#include "eventtrack.h"
+#include <QJsonObject>
+#include <QtEndian>
+
+#define ARTNET_DEFAULT_PORT 6454
+#define ARTTRIGGER_DATA_SIZE 512
+
+EventTrack::EventTrack() {}
+
+void EventTrack::setEvents(const QVector<cue_event_t> &trackEvents)
+{
+    events = trackEvents;
+    std::stable_sort(events.begin(), events.end(), [](const cue_event_t &a, const cue_event_t &b) {
+        return a.timeMs < b.timeMs;
+    });
+
+    const int count = events.size();
+    times.resize(count);
+    maxEnd.resize(count);
+    lastMarker.resize(count);
+    packets.resize(count);
+
+    qint64 end = -1;
+    int marker = -1;
+    for (int i = 0; i < count; ++i)
+    {
+        const cue_event_t &ev = events[i];
+        times[i] = ev.timeMs;
+        end = qMax(end, ev.timeMs + ev.durationMs);
+        maxEnd[i] = end;
+        if (ev.type == CUE_EVENT_MARKER) marker = i;
+        lastMarker[i] = marker;
+
+        event_packet_t &packet = packets[i];
+        packet.host = ev.host.isEmpty() ? QHostAddress() : QHostAddress(ev.host);
+        switch (ev.type) {
+        case CUE_EVENT_OSC:
+            packet.data = encodeOsc(ev.text, ev.value);
+            packet.port = ev.port ? ev.port : OSC_DEFAULT_PORT;
+            break;
+        case CUE_EVENT_TRIGGER:
+            packet.data = encodeTrigger(ev.value, ev.subValue);
+            packet.port = ev.port ? ev.port : ARTNET_DEFAULT_PORT;
+            break;
+        default:
+            packet.data.clear();
+            packet.port = 0;
+            break;
+        }
+    }
+
+    cursor = 0;
+    lastPositionMs = 0;
+}
+
+const QVector<cue_event_t> &EventTrack::getEvents() const
+{
+    return events;
+}
+
+bool EventTrack::isEmpty() const
+{
+    return events.isEmpty();
+}
+
+const cue_event_t &EventTrack::event(int index) const
+{
+    return events[index];
+}
+
+const event_packet_t &EventTrack::packet(int index) const
+{
+    return packets[index];
+}
+
+void EventTrack::seek(qint64 positionMs)
+{
+    cursor = static_cast<int>(std::lower_bound(times.constBegin(), times.constEnd(), positionMs) - times.constBegin());
+    lastPositionMs = positionMs;
+}
+
+int EventTrack::activeMarker(qint64 positionMs) const
+{
+    // Walk back from the last event started before the position while an earlier region may still cover it
+    int i = static_cast<int>(std::upper_bound(times.constBegin(), times.constEnd(), positionMs) - times.constBegin()) - 1;
+    if (i < 0) return -1;
+    // A marker without a length is active until the next marker starts, also after a seek
+    const int latest = lastMarker[i];
+    if (latest >= 0 && events[latest].durationMs == 0) return latest;
+    for (; i >= 0 && maxEnd[i] > positionMs; --i)
+    {
+        const cue_event_t &ev = events[i];
+        if (ev.type == CUE_EVENT_MARKER && ev.timeMs + ev.durationMs > positionMs)
+            return i;
+    }
+    return -1;
+}
+
+// {"t":ms,"d":ms,"k":"marker|osc|trigger","x":text,"v":value,"s":subValue,"h":host,"p":port}
+QJsonArray EventTrack::toJson(const QVector<cue_event_t> &events)
+{
+    QJsonArray array;
+    for (const cue_event_t &ev : events)
+    {
+        QJsonObject obj;
+        obj.insert("t", ev.timeMs);
+        if (ev.durationMs > 0) obj.insert("d", ev.durationMs);
+        switch (ev.type) {
+        case CUE_EVENT_OSC:
+            obj.insert("k", "osc");
+            break;
+        case CUE_EVENT_TRIGGER:
+            obj.insert("k", "trigger");
+            break;
+        default:
+            obj.insert("k", "marker");
+            break;
+        }
+        if (!ev.text.isEmpty()) obj.insert("x", ev.text);
+        if (ev.value != 0) obj.insert("v", ev.value);
+        if (ev.subValue != 0) obj.insert("s", ev.subValue);
+        if (!ev.host.isEmpty()) obj.insert("h", ev.host);
+        if (ev.port != 0) obj.insert("p", ev.port);
+        array.append(obj);
+    }
+    return array;
+}
+
+QVector<cue_event_t> EventTrack::fromJson(const QJsonArray &array)
+{
+    QVector<cue_event_t> events;
+    events.reserve(array.size());
+    for (const QJsonValue &value : array)
+    {
+        QJsonObject obj = value.toObject();
+        cue_event_t ev;
+        ev.timeMs = obj.value("t").toInteger();
+        ev.durationMs = obj.value("d").toInteger();
+        QString kind = obj.value("k").toString();
+        if (kind == "osc")
+            ev.type = CUE_EVENT_OSC;
+        else if (kind == "trigger")
+            ev.type = CUE_EVENT_TRIGGER;
+        else
+            ev.type = CUE_EVENT_MARKER;
+        ev.text = obj.value("x").toString();
+        ev.value = obj.value("v").toInt();
+        ev.subValue = obj.value("s").toInt();
+        ev.host = obj.value("h").toString();
+        ev.port = static_cast<quint16>(obj.value("p").toInt());
+        events.append(ev);
+    }
+    return events;
+}
+
+// OSC message: padded address, ",i" type tag, big-endian int32
+QByteArray EventTrack::encodeOsc(const QString &address, qint32 value)
+{
+    QByteArray data = address.toUtf8();
+    data.append('\0');
+    while (data.size() % 4) data.append('\0');
+    data.append(",i\0\0", 4);
+    char arg[4];
+    qToBigEndian<qint32>(value, arg);
+    data.append(arg, 4);
+    return data;
+}
+
+// ArtTrigger: OemCode 0xFFFF addresses all devices, Key/SubKey select the action
+QByteArray EventTrack::encodeTrigger(qint32 key, qint32 subKey)
+{
+    QByteArray data;
+    data.reserve(18 + ARTTRIGGER_DATA_SIZE);
+    data.append("Art-Net\0", 8);
+    data.append(static_cast<char>(0x00));  // OpCode ArtTrigger 0x9900, little-endian
+    data.append(static_cast<char>(0x99));
+    data.append(static_cast<char>(0x00));  // Protocol version
+    data.append(static_cast<char>(0x0E));
+    data.append(static_cast<char>(0x00));  // Filler
+    data.append(static_cast<char>(0x00));  // Filler
+    data.append(static_cast<char>(0xFF));  // OemCodeHi
+    data.append(static_cast<char>(0xFF));  // OemCodeLo
+    data.append(static_cast<char>(key));
+    data.append(static_cast<char>(subKey));
+    data.append(QByteArray(ARTTRIGGER_DATA_SIZE, 0));
+    return data;
+}
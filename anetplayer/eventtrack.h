@@ -0,0 +1,76 @@
+#ifndef EVENTTRACK_H
+#define EVENTTRACK_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <algorithm>
+#include "struct.h"
+
+#define OSC_DEFAULT_PORT 8000
+
+// Network packet of an event, encoded when the track is set
+typedef struct
+{
+    QByteArray data;
+    QHostAddress host; // Null: send to the Art-Net target
+    quint16 port;
+} event_packet_t;
+
+// Timecode-indexed events of a cue. Start times are kept in a separate sorted
+// array, so normal playback only moves a cursor forward and a seek is a binary
+// search. The prefix maximum of the event end times is an interval index for
+// the markers that cover a position, a marker without a length covers the
+// time until the next marker. Firing doesn't allocate: packets are
+// encoded in advance and events are passed by index.
+class EventTrack
+{
+
+public:
+    EventTrack();
+
+    void setEvents(const QVector<cue_event_t> &trackEvents);
+    const QVector<cue_event_t> &getEvents() const;
+    bool isEmpty() const;
+
+    const cue_event_t &event(int index) const;
+    const event_packet_t &packet(int index) const;
+
+    void seek(qint64 positionMs); // Events from this position on are pending
+
+    // Call fire(index) for every pending event up to the position
+    template<typename F>
+    void advance(qint64 positionMs, F &&fire)
+    {
+        if (positionMs < lastPositionMs)
+        {
+            seek(positionMs);
+        }
+        lastPositionMs = positionMs;
+        const int count = static_cast<int>(times.size());
+        while (cursor < count && times[cursor] <= positionMs)
+        {
+            fire(cursor++);
+        }
+    }
+
+    int activeMarker(qint64 positionMs) const; // Latest marker region covering the position, -1 if none
+
+    static QJsonArray toJson(const QVector<cue_event_t> &events);
+    static QVector<cue_event_t> fromJson(const QJsonArray &array);
+    static QByteArray encodeOsc(const QString &address, qint32 value); // OSC message with one int argument
+
+private:
+    QVector<cue_event_t> events;
+    QVector<qint64> times;    // Sorted start times
+    QVector<qint64> maxEnd;   // Prefix maximum of the end times
+    QVector<int> lastMarker;  // Latest marker up to each event, -1 if none
+    QVector<event_packet_t> packets;
+    int cursor = 0;
+    qint64 lastPositionMs = 0;
+
+    static QByteArray encodeTrigger(qint32 key, qint32 subKey);
+};
+
+#endif // EVENTTRACK_H
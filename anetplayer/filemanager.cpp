@@ -1,18 +1,43 @@
 #include "filemanager.h"
 #include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 #include "artnetsender.h"
+#include "oscserver.h"
+#include "trace.h"
+#include "displayserver.h"
+#include "redundancylink.h"
+#include "clocksync.h"
+
+#define PLAYLIST_JSON_SUFFIX "anpl"
+#define PLAYLIST_INI_SUFFIX "plist"
+#define PLAYLIST_JSON_FORMAT "anetplaylist"
+#define PLAYLIST_JSON_VERSION 1
+#define PLAYLIST_FILTER "ANet Playlist Files (*.anpl);;ANet INI Playlist Files (*.plist)"
 
 FileManager::FileManager(QObject *parent) : QObject(parent)
 {
 }
 
-bool FileManager::savePlaylist(const QVector<CueButton*>& buttons, QGridLayout *gridLayout)
+bool FileManager::savePlaylist(const QVector<CueButton*>& buttons, QGridLayout *gridLayout, QString *savedFileName)
 {
     if (!gridLayout) return false;
 
-    QString fileName = QFileDialog::getSaveFileName(nullptr, "Save playlist", "", "ANet Playlist Files (*.plist)");
+    QString selectedFilter;
+    QString fileName = QFileDialog::getSaveFileName(nullptr, "Save playlist", "", PLAYLIST_FILTER, &selectedFilter);
     if (fileName.isEmpty()) return false;
 
+    // Append the extension of the selected filter if the user didn't type it
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix != PLAYLIST_JSON_SUFFIX && suffix != PLAYLIST_INI_SUFFIX)
+    {
+        fileName += selectedFilter.contains(PLAYLIST_INI_SUFFIX) ? "." PLAYLIST_INI_SUFFIX : "." PLAYLIST_JSON_SUFFIX;
+    }
+
     int maxRow = 0;
     int maxCol = 0;
 
@@ -26,69 +51,240 @@ bool FileManager::savePlaylist(const QVector<CueButton*>& buttons, QGridLayout *
         }
     }
 
+    playlist_t playlist;
     // Добавляем +1, потому что строки и столбцы начинаются с 0
-    int realRows = ++maxRow;
-    int realCols = ++maxCol;
+    playlist.rows = ++maxRow;
+    playlist.columns = ++maxCol;
+    playlist.cues.reserve(buttons.size());
+    for (CueButton *button : buttons)
+    {
+        playlist.cues.append(button->getCue());
+    }
 
-    QSettings settings(fileName, QSettings::IniFormat);
+    if (savedFileName) *savedFileName = fileName;
+    return writePlaylist(fileName, playlist);
+}
 
-    settings.beginGroup("CueConfig");
 
-    settings.setValue("rows", realRows);
-    settings.setValue("columns", realCols);
+bool FileManager::loadPlaylist(playlist_t &playlist, QString *loadedFileName)
+{
+    QString fileName = QFileDialog::getOpenFileName(nullptr, "Load playlist", "", PLAYLIST_FILTER);
+    if (fileName.isEmpty()) return false;
 
-    for (int i = 0; i < buttons.size(); ++i)
+    if (loadedFileName) *loadedFileName = fileName;
+    return readPlaylist(fileName, playlist);
+}
+
+bool FileManager::writePlaylist(const QString &fileName, const playlist_t &playlist)
+{
+    TRACE_SCOPE("io", "FileManager::writePlaylist");
+    QElapsedTimer timer;
+    timer.start();
+
+    bool ok = false;
+    if (QFileInfo(fileName).suffix().toLower() == PLAYLIST_INI_SUFFIX)
+        ok = writeIniPlaylist(fileName, playlist);
+    else
+        ok = writeJsonPlaylist(fileName, playlist);
+
+    if (ok)
     {
-        QString key = QString("cue%1").arg(i);
-        settings.beginGroup(key);
-        saveButtonSettings(settings, buttons[i]);
-        settings.endGroup();
+        emit sendMsg(QString("Playlist saved: %1 cues in %2 ms").arg(playlist.cues.size()).arg(timer.elapsed()));
     }
+    return ok;
+}
 
-    settings.endGroup();
+bool FileManager::readPlaylist(const QString &fileName, playlist_t &playlist)
+{
+    TRACE_SCOPE("io", "FileManager::readPlaylist");
+    QElapsedTimer timer;
+    timer.start();
+
+    playlist.rows = 0;
+    playlist.columns = 0;
+    playlist.cues.clear();
+
+    bool ok = false;
+    if (QFileInfo(fileName).suffix().toLower() == PLAYLIST_INI_SUFFIX)
+        ok = readIniPlaylist(fileName, playlist);
+    else
+        ok = readJsonPlaylist(fileName, playlist);
+
+    if (!ok || playlist.rows <= 0 || playlist.columns <= 0)
+    {
+        emit sendMsg("Invalid playlist file: " + fileName);
+        return false;
+    }
+
+    // Pad or cut the cue array so that it matches the grid
+    playlist.cues.resize(playlist.rows * playlist.columns);
+
+    emit sendMsg(QString("Playlist loaded: %1 cues in %2 ms").arg(playlist.cues.size()).arg(timer.elapsed()));
     return true;
 }
 
+// JSON playlist layout:
+// {"format":"anetplaylist","version":1,"rows":3,"columns":3,
+//  "cues":[{"f":"/path/file.wav","o":-1000,"r":"25","c":"#ff0000","e":[events],"d":1,
+//           "li":"00:01:00:00","lo":"00:01:30:00","lm":0,"lt":true},{},...]}
+// Empty cues are stored as {} to keep the cue index equal to the array index
+// The INI format doesn't store the cue events
+bool FileManager::writeJsonPlaylist(const QString &fileName, const playlist_t &playlist)
+{
+    QJsonArray cues;
+    for (const cue_t &cue : playlist.cues)
+    {
+        QJsonObject obj;
+        if (!cue.filePath.isEmpty())
+        {
+            obj.insert("f", cue.filePath);
+            if (cue.adjustmentTime != 0)
+                obj.insert("o", cue.adjustmentTime);
+            obj.insert("r", cue.frameRate);
+            if (cue.cueColor.isValid())
+                obj.insert("c", cue.cueColor.name());
+            if (!cue.events.isEmpty())
+                obj.insert("e", EventTrack::toJson(cue.events));
+            if (cue.deck != 0)
+                obj.insert("d", cue.deck);
+            if (!cue.loopIn.isEmpty())
+            {
+                obj.insert("li", cue.loopIn);
+                obj.insert("lo", cue.loopOut);
+                obj.insert("lm", cue.loopTcMode);
+            }
+            if (cue.ltcOut)
+                obj.insert("lt", true);
+        }
+        cues.append(obj);
+    }
+
+    QJsonObject root;
+    root.insert("format", PLAYLIST_JSON_FORMAT);
+    root.insert("version", PLAYLIST_JSON_VERSION);
+    root.insert("rows", playlist.rows);
+    root.insert("columns", playlist.columns);
+    root.insert("cues", cues);
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        emit sendMsg("Can't open playlist for writing: " + fileName);
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
 
-QPair<int, int> FileManager::loadPlaylist(QVector<CueButton*>& buttons, QGridLayout* gridLayout, QWidget* parent)
+bool FileManager::readJsonPlaylist(const QString &fileName, playlist_t &playlist)
 {
-    if (!gridLayout) return QPair<int, int>(-1, -1);
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return false;
 
-    QString fileName = QFileDialog::getOpenFileName(nullptr, "Load playlist", "", "ANet Playlist Files (*.plist)");
-    if (fileName.isEmpty()) return QPair<int, int>(-1, -1);
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject())
+    {
+        emit sendMsg("Playlist parse error: " + error.errorString());
+        return false;
+    }
 
-    // Clear the layout and remove the buttons
-    QLayoutItem *item;
-    while ((item = gridLayout->takeAt(0)) != nullptr) {
-        gridLayout->removeItem(item);
+    QJsonObject root = doc.object();
+    if (root.value("format").toString() != PLAYLIST_JSON_FORMAT) return false;
+    if (root.value("version").toInt() > PLAYLIST_JSON_VERSION)
+    {
+        emit sendMsg("Playlist was saved by a newer version of the player");
+        return false;
     }
-    foreach (CueButton *but, buttons) {
-        but->stopPlayback(); // Just in case, stop the playback
-        delete but;
+
+    playlist.rows = root.value("rows").toInt();
+    playlist.columns = root.value("columns").toInt();
+
+    // Single pass over the cue array
+    const QJsonArray cues = root.value("cues").toArray();
+    playlist.cues.reserve(cues.size());
+    for (const QJsonValue &value : cues)
+    {
+        QJsonObject obj = value.toObject();
+        cue_t cue;
+        cue.filePath = obj.value("f").toString();
+        cue.adjustmentTime = obj.value("o").toInteger();
+        cue.frameRate = obj.value("r").toString();
+        cue.cueColor = QColor(obj.value("c").toString());
+        cue.events = EventTrack::fromJson(obj.value("e").toArray());
+        cue.deck = obj.value("d").toInt();
+        cue.loopIn = obj.value("li").toString();
+        cue.loopOut = obj.value("lo").toString();
+        cue.loopTcMode = static_cast<quint8>(obj.value("lm").toInt());
+        cue.ltcOut = obj.value("lt").toBool();
+        playlist.cues.append(cue);
     }
-    buttons.clear();
+    return true;
+}
 
+bool FileManager::writeIniPlaylist(const QString &fileName, const playlist_t &playlist)
+{
     QSettings settings(fileName, QSettings::IniFormat);
+    settings.clear();
+
     settings.beginGroup("CueConfig");
 
-    int rows = settings.value("rows", 0).toInt();
-    int columns = settings.value("columns", 0).toInt();
+    settings.setValue("rows", playlist.rows);
+    settings.setValue("columns", playlist.columns);
 
-    int totalButtons = rows * columns;
-    while (buttons.size() < totalButtons) {
-        CueButton *button = new CueButton(parent);
-        buttons.append(button);
+    for (int i = 0; i < playlist.cues.size(); ++i)
+    {
+        const cue_t &cue = playlist.cues[i];
+        QString key = QString("cue%1").arg(i);
+        settings.beginGroup(key);
+        settings.setValue("fileName", cue.filePath);
+        settings.setValue("adjustmentTime", cue.adjustmentTime);
+        settings.setValue("frameRate", cue.frameRate);
+        settings.setValue("cueColor", cue.cueColor.name());
+        settings.setValue("deck", cue.deck);
+        settings.setValue("loopIn", cue.loopIn);
+        settings.setValue("loopOut", cue.loopOut);
+        settings.setValue("loopTcMode", cue.loopTcMode);
+        settings.setValue("ltcOut", cue.ltcOut);
+        settings.endGroup();
     }
 
-    for (int i = 0; i < buttons.size(); ++i) {
+    settings.endGroup();
+    settings.sync();
+    return settings.status() == QSettings::NoError;
+}
+
+bool FileManager::readIniPlaylist(const QString &fileName, playlist_t &playlist)
+{
+    if (!QFile::exists(fileName)) return false;
+
+    QSettings settings(fileName, QSettings::IniFormat);
+    settings.beginGroup("CueConfig");
+
+    playlist.rows = settings.value("rows", 0).toInt();
+    playlist.columns = settings.value("columns", 0).toInt();
+
+    int totalButtons = playlist.rows * playlist.columns;
+    playlist.cues.reserve(totalButtons);
+    for (int i = 0; i < totalButtons; ++i) {
         QString key = QString("cue%1").arg(i);
         settings.beginGroup(key);
-        loadButtonSettings(settings, buttons[i]);
+        cue_t cue;
+        cue.filePath = settings.value("fileName").toString();
+        cue.adjustmentTime = settings.value("adjustmentTime").toLongLong();
+        cue.frameRate = settings.value("frameRate").toString();
+        cue.cueColor = QColor(settings.value("cueColor").toString());
+        cue.deck = settings.value("deck", 0).toInt();
+        cue.loopIn = settings.value("loopIn").toString();
+        cue.loopOut = settings.value("loopOut").toString();
+        cue.loopTcMode = static_cast<quint8>(settings.value("loopTcMode", LOOP_TC_JUMP).toUInt());
+        cue.ltcOut = settings.value("ltcOut", false).toBool();
+        playlist.cues.append(cue);
         settings.endGroup();
     }
 
     settings.endGroup();
-    return QPair<int, int>(rows, columns);
+    return true;
 }
 
 bool FileManager::saveSettings(const QString &settingsFileName, const settings_t &settings)
@@ -103,6 +299,18 @@ bool FileManager::saveSettings(const QString &settingsFileName, const settings_t
     settingsFile.setValue("ip", settings.ip);
     settingsFile.setValue("port", settings.port);
     settingsFile.setValue("tcOut", settings.tcOut);
+    settingsFile.setValue("oscPort", settings.oscPort);
+    settingsFile.setValue("oscSenders", settings.oscSenders);
+    settingsFile.setValue("displayPort", settings.displayPort);
+    settingsFile.setValue("displayAddress", settings.displayAddress);
+    settingsFile.setValue("redundancyRole", settings.redundancyRole);
+    settingsFile.setValue("redundancyPeer", settings.redundancyPeer);
+    settingsFile.setValue("redundancyPort", settings.redundancyPort);
+    settingsFile.setValue("syncRole", settings.syncRole);
+    settingsFile.setValue("syncMaster", settings.syncMaster);
+    settingsFile.setValue("syncPort", settings.syncPort);
+    settingsFile.setValue("ltcDevice", settings.ltcDevice);
+    settingsFile.setValue("ltcChannel", settings.ltcChannel);
 
     settingsFile.endGroup();
     return true;
@@ -111,9 +319,26 @@ bool FileManager::saveSettings(const QString &settingsFileName, const settings_t
 bool FileManager::loadSettings(const QString &settingsFileName, settings_t &settings)
 {
     QSettings settingsFile(settingsFileName, QSettings::IniFormat);
+    return readSettings(settingsFile, settings);
+}
+
+bool FileManager::loadDecks(const QString &settingsFileName, QVector<deck_t> &decks)
+{
+    QSettings settingsFile(settingsFileName, QSettings::IniFormat);
+    return readDecks(settingsFile, decks);
+}
+
+// Settings and decks from one read of the file
+bool FileManager::loadConfig(const QString &settingsFileName, settings_t &settings, QVector<deck_t> &decks)
+{
+    QSettings settingsFile(settingsFileName, QSettings::IniFormat);
+    return readDecks(settingsFile, decks) && readSettings(settingsFile, settings);
+}
 
+bool FileManager::readSettings(QSettings &settingsFile, settings_t &settings)
+{
     // Check if the file exists
-    if (!QFile::exists(settingsFileName))
+    if (!QFile::exists(settingsFile.fileName()))
     {
         // If the file doesn't exist, create it with default settings
         settingsFile.beginGroup("settings");
@@ -125,6 +350,9 @@ bool FileManager::loadSettings(const QString &settingsFileName, settings_t &sett
         settingsFile.setValue("ip", "127.0.0.1");
         settingsFile.setValue("port", 6454);
         settingsFile.setValue("tcOut", 1);
+        settingsFile.setValue("oscPort", OSC_DEFAULT_SERVER_PORT);
+        settingsFile.setValue("displayPort", DISPLAY_DEFAULT_PORT);
+        settingsFile.setValue("displayAddress", DISPLAY_DEFAULT_ADDRESS);
         settingsFile.endGroup();
     }
 
@@ -137,31 +365,64 @@ bool FileManager::loadSettings(const QString &settingsFileName, settings_t &sett
     settings.ip = settingsFile.value("ip", "127.0.0.1").toString();
     settings.port = settingsFile.value("port", 6454).toInt();
     settings.tcOut = settingsFile.value("tcOut", 1).toBool();
+    settings.oscPort = settingsFile.value("oscPort", OSC_DEFAULT_SERVER_PORT).toUInt();
+    settings.oscSenders = settingsFile.value("oscSenders", "").toString();
+    settings.displayPort = settingsFile.value("displayPort", DISPLAY_DEFAULT_PORT).toUInt();
+    settings.displayAddress = settingsFile.value("displayAddress", DISPLAY_DEFAULT_ADDRESS).toString();
+    settings.redundancyRole = qBound(0, settingsFile.value("redundancyRole", REDUNDANCY_OFF).toInt(), static_cast<int>(REDUNDANCY_BACKUP));
+    settings.redundancyPeer = settingsFile.value("redundancyPeer", "").toString();
+    settings.redundancyPort = settingsFile.value("redundancyPort", REDUNDANCY_DEFAULT_PORT).toUInt();
+    settings.syncRole = qBound(0, settingsFile.value("syncRole", SYNC_OFF).toInt(), static_cast<int>(SYNC_CLIENT));
+    settings.syncMaster = settingsFile.value("syncMaster", "").toString();
+    settings.syncPort = settingsFile.value("syncPort", SYNC_DEFAULT_PORT).toUInt();
+    settings.ltcDevice = settingsFile.value("ltcDevice", "").toString();
+    settings.ltcChannel = settingsFile.value("ltcChannel", 0).toUInt();
 
     settingsFile.endGroup();
 
     return true;
 }
 
-void FileManager::saveButtonSettings(QSettings& settings, CueButton* button)
+// [Decks] group of config.ini, without it there is one deck on StreamId 0:
+// size=2
+// 1\name=Stage Left
+// 1\streamId=0
+// 1\destinations=192.168.1.10:6454 192.168.1.11:6454
+bool FileManager::readDecks(QSettings &settingsFile, QVector<deck_t> &decks)
 {
-    settings.setValue("fileName", button->getFilePath());
-    settings.setValue("adjustmentTime", button->getAdjustmentTime());
-    settings.setValue("frameRate", button->getFrameRate());
-    settings.setValue("cueColor", button->getCueColor().name());
-}
+    decks.clear();
 
-void FileManager::loadButtonSettings(QSettings& settings, CueButton* button)
-{
-    QString filePath = settings.value("fileName").toString();
-    qint64 adjustmentTime = settings.value("adjustmentTime").toLongLong();
-    QString frameRate = settings.value("frameRate").toString();
-    QColor color(settings.value("cueColor").toString());
-
-    if (!filePath.isEmpty()) {
-        button->setAdjustmentTime(adjustmentTime);
-        button->setFilePath(filePath);
-        button->setFrameRate(frameRate);
-        button->setCueColor(color);
+    int count = settingsFile.beginReadArray("Decks");
+    count = qMin(count, MAX_DECKS);
+    for (int i = 0; i < count; ++i)
+    {
+        settingsFile.setArrayIndex(i);
+        deck_t deck;
+        deck.name = settingsFile.value("name", QString("Deck %1").arg(i + 1)).toString();
+        deck.streamId = static_cast<quint8>(settingsFile.value("streamId", i).toUInt());
+        const QStringList destinations = settingsFile.value("destinations").toString().split(' ', Qt::SkipEmptyParts);
+        for (const QString &entry : destinations)
+        {
+            destination_t destination;
+            destination.ip = entry.section(':', 0, 0);
+            destination.port = static_cast<quint16>(entry.section(':', 1, 1).toUInt());
+            if (destination.port == 0) destination.port = 6454;
+            if (QHostAddress(destination.ip).isNull())
+            {
+                emit sendMsg("Invalid deck destination: " + entry);
+                continue;
+            }
+            deck.destinations.append(destination);
+        }
+        decks.append(deck);
     }
+    settingsFile.endArray();
+
+    if (decks.isEmpty())
+    {
+        deck_t deck;
+        deck.name = "Main";
+        decks.append(deck);
+    }
+    return true;
 }
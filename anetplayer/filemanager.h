@@ -17,16 +17,31 @@ public:
     explicit FileManager(QObject *parent = nullptr);
 
     // Save load playlist
-    bool savePlaylist(const QVector<CueButton*>& buttons, QGridLayout* layout);
-    QPair<int, int> loadPlaylist(QVector<CueButton*>& buttons, QGridLayout* gridLayout, QWidget* parent);
+    bool savePlaylist(const QVector<CueButton*>& buttons, QGridLayout* layout, QString *savedFileName = nullptr);
+    bool loadPlaylist(playlist_t &playlist, QString *loadedFileName = nullptr);
+
+    // Read write playlist file, the format is selected by the file extension
+    bool writePlaylist(const QString &fileName, const playlist_t &playlist);
+    bool readPlaylist(const QString &fileName, playlist_t &playlist);
 
     // Save load common settings
     bool saveSettings(const QString &settingsFileName, const settings_t &settings);
     bool loadSettings(const QString &settingsFileName, settings_t &settings);
+    bool loadDecks(const QString &settingsFileName, QVector<deck_t> &decks);
+    bool loadConfig(const QString &settingsFileName, settings_t &settings, QVector<deck_t> &decks);
 
 private:
-    void saveButtonSettings(QSettings& settings, CueButton* button);
-    void loadButtonSettings(QSettings& settings, CueButton* button);
+    // Compact JSON playlist (*.anpl)
+    bool writeJsonPlaylist(const QString &fileName, const playlist_t &playlist);
+    bool readJsonPlaylist(const QString &fileName, playlist_t &playlist);
+    // Legacy INI playlist (*.plist), kept for import/export
+    bool writeIniPlaylist(const QString &fileName, const playlist_t &playlist);
+    bool readIniPlaylist(const QString &fileName, playlist_t &playlist);
+    bool readSettings(QSettings &settingsFile, settings_t &settings);
+    bool readDecks(QSettings &settingsFile, QVector<deck_t> &decks);
+
+signals:
+    void sendMsg(const QString &msg);
 };
 
 #endif // FILEMANAGER_H
@@ -0,0 +1,57 @@
+#include "frameclock.h"
+
+FrameClock::FrameClock(Clock *clock)
+    : clock(clock)
+{
+}
+
+void FrameClock::setFramerate(double framerate)
+{
+    fps = framerate;
+}
+
+void FrameClock::setAudioPosition(qint64 positionMs)
+{
+    lastKnownPosition = positionMs;
+    positionTimeNs = clock->nowNs();
+}
+
+void FrameClock::stop()
+{
+    lastKnownPosition = 0;
+    positionTimeNs = -1;
+}
+
+void FrameClock::invalidate()
+{
+    positionTimeNs = -1;
+}
+
+bool FrameClock::isRunning() const
+{
+    return positionTimeNs >= 0;
+}
+
+qint64 FrameClock::position() const
+{
+    if (positionTimeNs < 0) return lastKnownPosition;
+    return lastKnownPosition + (clock->nowNs() - positionTimeNs) / 1000000; // Whole ms, as QElapsedTimer
+}
+
+qint64 FrameClock::reportedPosition() const
+{
+    return lastKnownPosition;
+}
+
+qint64 FrameClock::reportTimeNs() const
+{
+    return positionTimeNs;
+}
+
+bool FrameClock::nextFrame(qint64 positionMs, timecode_t &tc)
+{
+    tc = converter.milliseconds2tc(positionMs, fps);
+    if (tc.ff == prevTc.ff && tc.ss == prevTc.ss && tc.mm == prevTc.mm && tc.hh == prevTc.hh) return false;
+    prevTc = tc;
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef FRAMECLOCK_H
+#define FRAMECLOCK_H
+
+#include "clock.h"
+#include "tcconverter.h"
+
+// Playhead of a cue between the position reports of the player. The last
+// report is extrapolated on the clock, every timer tick checks it for a
+// new timecode frame. CueButton and the offline tools share this code, so a
+// simulated clock runs the same conversion as a live show.
+class FrameClock
+{
+public:
+    explicit FrameClock(Clock *clock = Clock::system());
+    void setFramerate(double framerate);
+
+    void setAudioPosition(qint64 positionMs); // Report of the player
+    void stop(); // Back to 0, no playhead until the next report
+    void invalidate(); // Keep the position, no playhead until the next report
+    bool isRunning() const;
+    qint64 position() const; // Interpolated playhead in ms
+    qint64 reportedPosition() const; // Last report and its clock time, -1 = stopped
+    qint64 reportTimeNs() const;
+
+    // True when the position is in another frame than the last one, tc is set
+    bool nextFrame(qint64 positionMs, timecode_t &tc);
+
+private:
+    TCconverter converter;
+    Clock *clock;
+    double fps = 30;
+    qint64 lastKnownPosition = 0;
+    qint64 positionTimeNs = -1; // Clock time of the last report, -1 = stopped
+    timecode_t prevTc = {}; // Last timecode update, the whole of it: a loop can jump back to the same ff
+};
+
+#endif // FRAMECLOCK_H
@@ -0,0 +1,31 @@
+#include "framerate.h"
+
+const QVector<framerate_t> &frameRates()
+{
+    static const QVector<framerate_t> rates = {
+        {"24", 24, 24, false, 0, 24, 1, "24ndf"},
+        {"25", 25, 25, false, 1, 25, 1, "25ndf"},
+        {"29.97", 29.97, 29, true, 2, 30000, 1001, "29.97df"},
+        {"30", 30, 30, false, 3, 30, 1, "30ndf"}
+    };
+    return rates;
+}
+
+const framerate_t &frameRateOf(const QString &name)
+{
+    const QVector<framerate_t> &rates = frameRates();
+    for (const framerate_t &rate : rates)
+    {
+        if (rate.name == name) return rate;
+    }
+    return rates.last();
+}
+
+const framerate_t *frameRateOfTimebase(int timebase)
+{
+    for (const framerate_t &rate : frameRates())
+    {
+        if (rate.timebase == timebase) return &rate;
+    }
+    return nullptr;
+}
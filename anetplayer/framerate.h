@@ -0,0 +1,26 @@
+#ifndef FRAMERATE_H
+#define FRAMERATE_H
+
+#include <QString>
+#include <QVector>
+
+// Everything that depends on a timecode rate, computed once for every rate.
+// A cue keeps a pointer into the table, so switching cues or rates never
+// parses a name or rebuilds a converter.
+typedef struct
+{
+    QString name;        // "24", "25", "29.97", "30", as stored in the playlist
+    double fps;          // Rate of TCconverter
+    int timebase;        // Last field of "hh:mm:ss:ff:fps", 29 for 29.97
+    bool dropFrame;
+    quint8 artnetType;   // ArtTimeCode Type: 0 Film, 1 EBU, 2 DF, 3 SMPTE
+    qint64 rateNum;      // Exact rate, rateNum frames per rateDen seconds
+    qint64 rateDen;
+    QString label;       // Grid and transport label, "25ndf" or "29.97df"
+} framerate_t;
+
+const QVector<framerate_t> &frameRates();
+const framerate_t &frameRateOf(const QString &name); // Unknown names are 30
+const framerate_t *frameRateOfTimebase(int timebase); // nullptr when unknown
+
+#endif // FRAMERATE_H
@@ -0,0 +1,291 @@
+#include "gobench.h"
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QThread>
+#include <QFile>
+#include <QTextStream>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QAudioOutput>
+#include <atomic>
+#include <future>
+#include <algorithm>
+#include <cstring>
+#include "cuebutton.h"
+#include "artnetsender.h"
+#include "mediaprober.h"
+#include "showrecorder.h"
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
+#include <QAudioBufferOutput>
+#define GO_BENCH_BUFFER_OUTPUT // The decoded PCM buffers are delivered to the benchmark
+#endif
+
+#define GO_BENCH_TIMEOUT_MS 5000 // Wait for the audio and the timecode of one run
+#define GO_BENCH_PAUSE_MS 200    // Between stop and the next GO
+#define GO_BENCH_POLL_MS 1
+
+// Receives ArtTimeCode on 127.0.0.1 in its own thread, so the arrival is
+// timestamped when the datagram is read and not when the GUI loop gets to it
+class TimecodeProbe
+{
+public:
+    ~TimecodeProbe() { stop(); }
+
+    bool start()
+    {
+        std::promise<quint16> bound;
+        std::future<quint16> result = bound.get_future();
+        thread = QThread::create([this, &bound]() {
+            QUdpSocket socket;
+            bound.set_value(socket.bind(QHostAddress::LocalHost, 0) ? socket.localPort() : 0);
+            char buffer[64];
+            while (!stopRequested.load(std::memory_order_relaxed))
+            {
+                if (!socket.waitForReadyRead(20)) continue;
+                while (socket.hasPendingDatagrams())
+                {
+                    const qint64 size = socket.readDatagram(buffer, sizeof(buffer));
+                    const qint64 receivedNs = ShowRecorder::now();
+                    // "Art-Net", OpTimeCode 0x9700 little-endian
+                    if (size < 19 || memcmp(buffer, "Art-Net", 8) != 0 || buffer[8] != 0x00 || buffer[9] != char(0x97))
+                        continue;
+                    if (armed.exchange(false, std::memory_order_acq_rel))
+                        firstNs.store(receivedNs, std::memory_order_release);
+                }
+            }
+        });
+        thread->start();
+        port = result.get();
+        return port != 0;
+    }
+
+    void stop()
+    {
+        if (!thread) return;
+        stopRequested = true;
+        thread->wait();
+        delete thread;
+        thread = nullptr;
+    }
+
+    void arm()
+    {
+        firstNs.store(0, std::memory_order_relaxed);
+        armed.store(true, std::memory_order_release);
+    }
+
+    quint16 port = 0;
+    std::atomic<qint64> firstNs{0};
+
+private:
+    QThread *thread = nullptr;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> armed{false};
+};
+
+typedef struct
+{
+    QString name;
+    QVector<double> audioMs;
+    QVector<double> timecodeMs;
+    int timeouts = 0;
+} go_bench_scenario_t;
+
+static QJsonObject summary(QVector<double> values)
+{
+    QJsonObject obj;
+    obj.insert("n", values.size());
+    if (values.isEmpty()) return obj;
+    std::sort(values.begin(), values.end());
+    auto at = [&values](double p) { return values[qMin<int>(values.size() - 1, static_cast<int>(p * values.size()))]; };
+    double sum = 0;
+    for (double value : values) sum += value;
+    obj.insert("min", values.first());
+    obj.insert("mean", sum / values.size());
+    obj.insert("median", at(0.5));
+    obj.insert("p90", at(0.9));
+    obj.insert("p99", at(0.99));
+    obj.insert("max", values.last());
+    return obj;
+}
+
+static QJsonArray toArray(const QVector<double> &values)
+{
+    QJsonArray array;
+    for (double value : values)
+        array.append(value);
+    return array;
+}
+
+static void wait(int ms)
+{
+    QEventLoop loop;
+    QTimer::singleShot(ms, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+static CueButton *createCue(const QString &filePath, const media_info_t &info, ArtNetSender &anet)
+{
+    CueButton *button = new CueButton();
+    button->setFilePath(filePath);
+    button->setMediaInfo(info);
+    button->mediaPlayer()->audioOutput()->setMuted(true); // The buffers are measured, nothing has to be heard
+    QObject::connect(button, &CueButton::updatePlayTime, &anet,
+                     [&anet](CueButton *, const QString &, const QString &tcTime, const int &) {
+        anet.sendTime(tcTime);
+    });
+    return button;
+}
+
+// One GO: click, then wait until the first audio buffer and the first timecode packet
+static void runOnce(CueButton *button, TimecodeProbe &probe, go_bench_scenario_t &scenario)
+{
+    std::atomic<qint64> audioNs{0};
+#ifdef GO_BENCH_BUFFER_OUTPUT
+    QAudioBufferOutput bufferOutput;
+    QObject::connect(&bufferOutput, &QAudioBufferOutput::audioBufferReceived, &bufferOutput, [&audioNs]() {
+        qint64 expected = 0;
+        audioNs.compare_exchange_strong(expected, ShowRecorder::now());
+    }, Qt::DirectConnection);
+    button->mediaPlayer()->setAudioBufferOutput(&bufferOutput);
+#else
+    // Older Qt doesn't give the PCM buffers, the first position update is the audio start
+    QMetaObject::Connection started = QObject::connect(button, &CueButton::audioStarted, button, [&audioNs]() {
+        audioNs.store(ShowRecorder::now());
+    });
+#endif
+
+    probe.arm();
+    QEventLoop loop;
+    QTimer poll;
+    QObject::connect(&poll, &QTimer::timeout, &loop, [&]() {
+        if (audioNs.load() != 0 && probe.firstNs.load() != 0)
+            loop.quit();
+    });
+    QTimer::singleShot(GO_BENCH_TIMEOUT_MS, &loop, &QEventLoop::quit);
+
+    const qint64 goNs = ShowRecorder::now();
+    button->click(); // Same path as the mouse: clicked -> playFile
+    poll.start(GO_BENCH_POLL_MS);
+    loop.exec();
+
+    const qint64 audio = audioNs.load();
+    const qint64 timecode = probe.firstNs.load();
+    if (audio == 0 || timecode == 0)
+        ++scenario.timeouts;
+    if (audio != 0)
+        scenario.audioMs.append((audio - goNs) / 1e6);
+    if (timecode != 0)
+        scenario.timecodeMs.append((timecode - goNs) / 1e6);
+
+    button->stopPlayback();
+#ifdef GO_BENCH_BUFFER_OUTPUT
+    button->player->setAudioBufferOutput(nullptr);
+#else
+    QObject::disconnect(started);
+#endif
+}
+
+int runGoBench(const QString &filePath, int runs, const QString &jsonFile)
+{
+    QTextStream err(stderr);
+
+    const media_info_t info = MediaProber::probeFile(filePath);
+    if (info.status != MEDIA_OK && info.status != MEDIA_UNSUPPORTED)
+    {
+        err << "Can't use the file: " << filePath << Qt::endl;
+        return 2;
+    }
+
+    TimecodeProbe probe;
+    if (!probe.start())
+    {
+        err << "Can't open the loopback timecode socket" << Qt::endl;
+        return 2;
+    }
+    ArtNetSender anet;
+    anet.setTargetIP("127.0.0.1");
+    anet.setTargetPort(probe.port);
+
+    // Cold: a new cue, player and decoder for every GO
+    go_bench_scenario_t cold;
+    cold.name = "cold";
+    for (int run = 0; run < runs; ++run)
+    {
+        CueButton *button = createCue(filePath, info, anet);
+        runOnce(button, probe, cold);
+        delete button;
+        wait(GO_BENCH_PAUSE_MS);
+    }
+
+    // Warm: the same cue again and again
+    go_bench_scenario_t warm;
+    warm.name = "warm";
+    CueButton *button = createCue(filePath, info, anet);
+    runOnce(button, probe, warm); // Loads the file, not counted
+    warm = go_bench_scenario_t();
+    warm.name = "warm";
+    wait(GO_BENCH_PAUSE_MS);
+    for (int run = 0; run < runs; ++run)
+    {
+        runOnce(button, probe, warm);
+        wait(GO_BENCH_PAUSE_MS);
+    }
+    delete button;
+    probe.stop();
+
+    QJsonArray scenarios;
+    for (const go_bench_scenario_t *scenario : {&cold, &warm})
+    {
+        QJsonObject obj;
+        obj.insert("name", scenario->name);
+        obj.insert("timeouts", scenario->timeouts);
+        obj.insert("audio_ms", toArray(scenario->audioMs));
+        obj.insert("timecode_ms", toArray(scenario->timecodeMs));
+        obj.insert("audio", summary(scenario->audioMs));
+        obj.insert("timecode", summary(scenario->timecodeMs));
+        scenarios.append(obj);
+
+        const QJsonObject audio = summary(scenario->audioMs);
+        const QJsonObject timecode = summary(scenario->timecodeMs);
+        err << QString("%1: audio median %2 p99 %3 ms, timecode median %4 p99 %5 ms, %6 timeouts")
+                   .arg(scenario->name, -4)
+                   .arg(audio.value("median").toDouble(), 0, 'f', 3)
+                   .arg(audio.value("p99").toDouble(), 0, 'f', 3)
+                   .arg(timecode.value("median").toDouble(), 0, 'f', 3)
+                   .arg(timecode.value("p99").toDouble(), 0, 'f', 3)
+                   .arg(scenario->timeouts) << Qt::endl;
+    }
+
+    QJsonObject root;
+    root.insert("benchmark", "go-latency");
+    root.insert("file", filePath);
+    root.insert("runs", runs);
+    root.insert("qt", qVersion());
+#ifdef GO_BENCH_BUFFER_OUTPUT
+    root.insert("audio_point", "first-buffer");
+#else
+    root.insert("audio_point", "first-position");
+#endif
+    root.insert("scenarios", scenarios);
+    const QByteArray json = QJsonDocument(root).toJson();
+
+    if (jsonFile.isEmpty() || jsonFile == "-")
+    {
+        QTextStream(stdout) << json;
+    }
+    else
+    {
+        QFile file(jsonFile);
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size())
+        {
+            err << "Can't write " << jsonFile << Qt::endl;
+            return 2;
+        }
+    }
+    return (cold.timeouts + warm.timeouts) == 0 ? 0 : 1;
+}
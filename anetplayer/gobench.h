@@ -0,0 +1,13 @@
+#ifndef GOBENCH_H
+#define GOBENCH_H
+
+#include <QString>
+
+// GO latency benchmark. A cue is started with a programmatic click, the
+// delay to the first audio buffer of the player and to the first ArtTimeCode
+// packet received on loopback is measured. Cold runs use a new cue (new
+// player and decoder) every time, warm runs reuse one cue. The results are
+// written as JSON, a summary goes to stderr. Needs a QApplication.
+int runGoBench(const QString &filePath, int runs, const QString &jsonFile);
+
+#endif // GOBENCH_H
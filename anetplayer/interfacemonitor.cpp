@@ -0,0 +1,322 @@
+#include "interfacemonitor.h"
+#include <QNetworkInterface>
+#include <QHash>
+#include <QtEndian>
+#include <algorithm>
+#include "clock.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+
+#define NETLINK_BUFFER_SIZE 32768
+#endif
+
+static bool sameEntry(const interface_entry_t &a, const interface_entry_t &b)
+{
+    return a.index == b.index && a.name == b.name && a.up == b.up && a.addresses == b.addresses;
+}
+
+// Table of QNetworkInterface, used where rtnetlink isn't available
+static QVector<interface_entry_t> scanInterfaces()
+{
+    QVector<interface_entry_t> entries;
+    foreach (const QNetworkInterface &interface, QNetworkInterface::allInterfaces())
+    {
+        interface_entry_t entry;
+        entry.index = interface.index();
+        entry.name = interface.humanReadableName();
+        entry.up = interface.flags().testFlag(QNetworkInterface::IsUp) && interface.flags().testFlag(QNetworkInterface::IsRunning);
+        foreach (const QNetworkAddressEntry &address, interface.addressEntries())
+        {
+            if (address.ip().protocol() == QAbstractSocket::IPv4Protocol)
+                entry.addresses.append(address.ip());
+        }
+        entries.append(entry);
+    }
+    return entries;
+}
+
+InterfaceMonitor::InterfaceMonitor(QObject *parent)
+    : QObject(parent)
+{
+}
+
+InterfaceMonitor::~InterfaceMonitor()
+{
+    stop();
+}
+
+bool InterfaceMonitor::start()
+{
+    stop();
+    stopRequested = false;
+
+    std::promise<bool> ready;
+    std::future<bool> result = ready.get_future();
+    thread = QThread::create([this, &ready]() {
+#ifdef Q_OS_LINUX
+        const int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        sockaddr_nl local = {};
+        local.nl_family = AF_NETLINK;
+        local.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR;
+        if (fd >= 0 && bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == 0)
+        {
+            netlinkLoop(fd, ready);
+            close(fd);
+            return;
+        }
+        if (fd >= 0) close(fd);
+        emit sendMsg("No rtnetlink, the network interfaces are rescanned every second");
+#endif
+        publish(scanInterfaces());
+        ready.set_value(true);
+        scanLoop();
+    });
+    thread->setObjectName("Interface monitor");
+    thread->start();
+    return result.get();
+}
+
+void InterfaceMonitor::stop()
+{
+    if (!thread) return;
+    stopRequested = true;
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+}
+
+QVector<interface_entry_t> InterfaceMonitor::interfaces() const
+{
+    QMutexLocker locker(&mutex);
+    return table;
+}
+
+QStringList InterfaceMonitor::interfaceNames() const
+{
+    QStringList names;
+    QMutexLocker locker(&mutex);
+    for (const interface_entry_t &entry : table)
+    {
+        if (entry.up && !entry.addresses.isEmpty())
+            names.append(entry.name);
+    }
+    return names;
+}
+
+QHostAddress InterfaceMonitor::ipv4Address(const QString &name) const
+{
+    QMutexLocker locker(&mutex);
+    for (const interface_entry_t &entry : table)
+    {
+        if (entry.name == name)
+            return (entry.up && !entry.addresses.isEmpty()) ? entry.addresses.first() : QHostAddress();
+    }
+    return QHostAddress();
+}
+
+qint64 InterfaceMonitor::changedNs() const
+{
+    QMutexLocker locker(&mutex);
+    return lastChangeNs;
+}
+
+// New table from the thread, signalled only when something changed
+void InterfaceMonitor::publish(const QVector<interface_entry_t> &entries)
+{
+    {
+        QMutexLocker locker(&mutex);
+        if (entries.size() == table.size()
+            && std::equal(entries.begin(), entries.end(), table.begin(), sameEntry))
+            return;
+        table = entries;
+        lastChangeNs = Clock::system()->nowNs();
+    }
+    emit interfacesChanged();
+}
+
+void InterfaceMonitor::scanLoop()
+{
+    int elapsedMs = 0;
+    while (!stopRequested.load(std::memory_order_relaxed))
+    {
+        QThread::msleep(MONITOR_POLL_MS);
+        elapsedMs += MONITOR_POLL_MS;
+        if (elapsedMs < MONITOR_SCAN_MS) continue;
+        elapsedMs = 0;
+        publish(scanInterfaces());
+    }
+}
+
+#ifdef Q_OS_LINUX
+// Links and addresses by interface index, updated by every message
+typedef QHash<int, interface_entry_t> link_table_t;
+
+static void applyMessage(const nlmsghdr *message, link_table_t &links)
+{
+    switch (message->nlmsg_type) {
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+    {
+        const ifinfomsg *info = static_cast<const ifinfomsg*>(NLMSG_DATA(message));
+        if (message->nlmsg_type == RTM_DELLINK)
+        {
+            links.remove(info->ifi_index);
+            break;
+        }
+        interface_entry_t &entry = links[info->ifi_index];
+        entry.index = info->ifi_index;
+        entry.up = (info->ifi_flags & IFF_UP) && (info->ifi_flags & IFF_RUNNING); // Running: carrier
+        int length = IFLA_PAYLOAD(message);
+        for (const rtattr *attribute = IFLA_RTA(info); RTA_OK(attribute, length); attribute = RTA_NEXT(attribute, length))
+        {
+            if (attribute->rta_type == IFLA_IFNAME)
+                entry.name = QString::fromLocal8Bit(static_cast<const char*>(RTA_DATA(attribute)));
+        }
+        break;
+    }
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+    {
+        const ifaddrmsg *info = static_cast<const ifaddrmsg*>(NLMSG_DATA(message));
+        if (info->ifa_family != AF_INET) break;
+        QHostAddress address;
+        int length = IFA_PAYLOAD(message);
+        for (const rtattr *attribute = IFA_RTA(info); RTA_OK(attribute, length); attribute = RTA_NEXT(attribute, length))
+        {
+            // Local is the address of the interface, on point to point links address is the peer
+            if (attribute->rta_type == IFA_LOCAL || (attribute->rta_type == IFA_ADDRESS && address.isNull()))
+                address = QHostAddress(qFromBigEndian<quint32>(RTA_DATA(attribute)));
+        }
+        if (address.isNull()) break;
+        interface_entry_t &entry = links[static_cast<int>(info->ifa_index)];
+        entry.index = static_cast<int>(info->ifa_index);
+        entry.addresses.removeAll(address);
+        if (message->nlmsg_type == RTM_NEWADDR)
+            entry.addresses.append(address);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static QVector<interface_entry_t> sortedTable(const link_table_t &links)
+{
+    QVector<interface_entry_t> entries;
+    for (const interface_entry_t &entry : links)
+    {
+        if (!entry.name.isEmpty()) entries.append(entry); // Address of a link not dumped yet
+    }
+    std::sort(entries.begin(), entries.end(), [](const interface_entry_t &a, const interface_entry_t &b) {
+        return a.index < b.index;
+    });
+    return entries;
+}
+
+typedef enum
+{
+    NETLINK_READ_OK = 0,
+    NETLINK_READ_OVERRUN,   // The kernel dropped events, the table must be read again
+    NETLINK_READ_FAILED
+} netlink_read_t;
+
+// Applies every pending message, done is set by the end of a dump
+static netlink_read_t readMessages(int fd, char *buffer, link_table_t &links, bool &done)
+{
+    while (true)
+    {
+        const ssize_t size = recv(fd, buffer, NETLINK_BUFFER_SIZE, MSG_DONTWAIT);
+        if (size < 0)
+        {
+            if (errno == ENOBUFS) return NETLINK_READ_OVERRUN;
+            return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? NETLINK_READ_OK : NETLINK_READ_FAILED;
+        }
+        int length = static_cast<int>(size);
+        for (const nlmsghdr *message = reinterpret_cast<const nlmsghdr*>(buffer); NLMSG_OK(message, length);
+             message = NLMSG_NEXT(message, length))
+        {
+            if (message->nlmsg_type == NLMSG_DONE || message->nlmsg_type == NLMSG_ERROR)
+                done = true;
+            else
+                applyMessage(message, links);
+        }
+    }
+}
+
+static bool requestDump(int fd, quint16 type, quint32 sequence)
+{
+    struct
+    {
+        nlmsghdr header;
+        rtgenmsg body;
+    } request = {};
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(rtgenmsg));
+    request.header.nlmsg_type = type;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = sequence;
+    request.body.rtgen_family = AF_UNSPEC;
+    return send(fd, &request, request.header.nlmsg_len, 0) == static_cast<ssize_t>(request.header.nlmsg_len);
+}
+
+// Whole table: links first, then their addresses, one dump at a time. Events
+// that arrive meanwhile are applied on the way.
+static bool dumpTable(int fd, char *buffer, link_table_t &links)
+{
+    links.clear();
+    const quint16 dumps[] = {RTM_GETLINK, RTM_GETADDR};
+    for (quint32 i = 0; i < 2; ++i)
+    {
+        if (!requestDump(fd, dumps[i], i + 1)) return false;
+        bool done = false;
+        while (!done)
+        {
+            pollfd descriptor = {fd, POLLIN, 0};
+            if (poll(&descriptor, 1, MONITOR_SCAN_MS) <= 0) return false;
+            if (readMessages(fd, buffer, links, done) != NETLINK_READ_OK) return false;
+        }
+    }
+    return true;
+}
+
+void InterfaceMonitor::netlinkLoop(int fd, std::promise<bool> &ready)
+{
+    QByteArray storage(NETLINK_BUFFER_SIZE, '\0');
+    char *buffer = storage.data();
+    link_table_t links;
+
+    if (!dumpTable(fd, buffer, links))
+    {
+        emit sendMsg("Can't read the network interfaces from rtnetlink, they are rescanned every second");
+        publish(scanInterfaces());
+        ready.set_value(true);
+        scanLoop();
+        return;
+    }
+    publish(sortedTable(links));
+    ready.set_value(true);
+
+    while (!stopRequested.load(std::memory_order_relaxed))
+    {
+        pollfd descriptor = {fd, POLLIN, 0};
+        if (poll(&descriptor, 1, MONITOR_POLL_MS) <= 0) continue;
+        bool done = false;
+        netlink_read_t result = readMessages(fd, buffer, links, done);
+        if (result == NETLINK_READ_OVERRUN && !dumpTable(fd, buffer, links))
+            result = NETLINK_READ_FAILED;
+        if (result == NETLINK_READ_FAILED)
+        {
+            emit sendMsg("rtnetlink failed, the network interfaces are rescanned every second");
+            scanLoop();
+            return;
+        }
+        publish(sortedTable(links)); // One signal for the whole batch
+    }
+}
+#endif
@@ -0,0 +1,63 @@
+#ifndef INTERFACEMONITOR_H
+#define INTERFACEMONITOR_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QHostAddress>
+#include <QStringList>
+#include <atomic>
+#include <future>
+
+#define MONITOR_POLL_MS 50    // Thread wake-up to check for stop
+#define MONITOR_SCAN_MS 1000  // Rescan period without rtnetlink
+
+typedef struct
+{
+    int index = 0;
+    QString name;
+    bool up = false;                 // Administratively up with a carrier
+    QList<QHostAddress> addresses;   // IPv4
+} interface_entry_t;
+
+// Table of the network interfaces and their IPv4 addresses, kept up to date
+// by a thread. On Linux the thread listens to the rtnetlink link and address
+// groups, a replugged cable or a new DHCP lease is seen as it happens. Other
+// systems rescan periodically. A batch of changes is signalled once with
+// interfacesChanged(), queued to the thread of the monitor.
+class InterfaceMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InterfaceMonitor(QObject *parent = nullptr);
+    ~InterfaceMonitor();
+
+    bool start(); // The table is filled when it returns
+    void stop();
+
+    QVector<interface_entry_t> interfaces() const;
+    QStringList interfaceNames() const; // Up with an address, as getAvailableInterfaces()
+    QHostAddress ipv4Address(const QString &name) const; // Null when down or without an address
+    qint64 changedNs() const; // Monotonic time of the last change
+
+signals:
+    void interfacesChanged();
+    void sendMsg(const QString &msg);
+
+private:
+    QThread *thread = nullptr;
+    std::atomic<bool> stopRequested{false};
+
+    mutable QMutex mutex; // Guards the table
+    QVector<interface_entry_t> table;
+    qint64 lastChangeNs = 0;
+
+    void publish(const QVector<interface_entry_t> &entries);
+    void scanLoop();
+#ifdef Q_OS_LINUX
+    void netlinkLoop(int fd, std::promise<bool> &ready);
+#endif
+};
+
+#endif // INTERFACEMONITOR_H
@@ -0,0 +1,390 @@
+#include "loopplayer.h"
+#include <QAudioDecoder>
+#include <QAudioSink>
+#include <QAudioBuffer>
+#include <QMediaDevices>
+#include <QAudioDevice>
+#include <QUrl>
+#include <cmath>
+#include <cstring>
+#include "tcconverter.h"
+
+static qint64 ceilDiv(qint64 a, qint64 b)
+{
+    return (a >= 0) ? (a + b - 1) / b : -(-a / b);
+}
+
+// Frame of a position as TCconverter::milliseconds2tc counts it
+static qint64 msFrame(qint64 ms, double fps)
+{
+    return static_cast<qint64>(std::floor(ms * fps / 1000));
+}
+
+// First whole ms of the frame, the sample at that ms is the loop point
+static qint64 frameMs(qint64 frame, double fps)
+{
+    qint64 ms = static_cast<qint64>(std::ceil(frame * 1000.0 / fps));
+    while (msFrame(ms, fps) < frame) ++ms;
+    while (ms > 0 && msFrame(ms - 1, fps) >= frame) --ms;
+    return ms;
+}
+
+static qint64 tcFrames(timecode_t tc, double fps)
+{
+    TCconverter converter;
+    tc.fps = static_cast<uint8_t>(fps);
+    return (tc.fps == 29) ? converter.dftc2frames(tc) : converter.ndftc2frames(tc);
+}
+
+void LoopBuffer::setFormat(int frameBytes, int rate)
+{
+    bytesPerFrame = frameBytes;
+    sampleRate = rate;
+}
+
+void LoopBuffer::setRegion(qint64 first, qint64 in, qint64 out)
+{
+    pcm.clear();
+    firstSample = qMax<qint64>(0, qMin(first, in));
+    inSample = in;
+    outSample = out;
+    seekSample = firstSample;
+    cursor = firstSample;
+    if (bytesPerFrame > 0)
+        pcm.reserve((outSample - firstSample) * bytesPerFrame);
+}
+
+void LoopBuffer::clear()
+{
+    pcm = QByteArray(); // Frees the memory
+    firstSample = inSample = outSample = seekSample = 0;
+    cursor = 0;
+}
+
+bool LoopBuffer::append(const char *data, qint64 bytes, qint64 startSample)
+{
+    if (bytesPerFrame <= 0 || isComplete()) return isComplete();
+    const qint64 next = firstSample + pcm.size() / bytesPerFrame; // First sample still missing
+    const qint64 from = qMax(startSample, next);
+    const qint64 to = qMin(startSample + bytes / bytesPerFrame, outSample);
+    if (to > from && from == next)
+        pcm.append(data + (from - startSample) * bytesPerFrame, (to - from) * bytesPerFrame);
+    return isComplete();
+}
+
+bool LoopBuffer::isComplete() const
+{
+    return bytesPerFrame > 0 && outSample > inSample && firstSample + pcm.size() / bytesPerFrame >= outSample;
+}
+
+bool LoopBuffer::seek(qint64 sample)
+{
+    if (sample < firstSample || sample >= outSample) return false;
+    seekSample = sample;
+    cursor = sample;
+    return true;
+}
+
+qint64 LoopBuffer::read(char *data, qint64 maxBytes)
+{
+    if (!isComplete()) return 0;
+    const qint64 frames = maxBytes / bytesPerFrame;
+    const char *source = pcm.constData();
+    qint64 position = cursor.load(std::memory_order_relaxed);
+    qint64 done = 0;
+    while (done < frames)
+    {
+        if (position >= outSample) position = inSample; // The loop point, inside the copy
+        const qint64 count = qMin(frames - done, outSample - position);
+        memcpy(data + done * bytesPerFrame, source + (position - firstSample) * bytesPerFrame, count * bytesPerFrame);
+        done += count;
+        position += count;
+    }
+    cursor.store(position, std::memory_order_relaxed);
+    return done * bytesPerFrame;
+}
+
+qint64 LoopBuffer::startSample() const
+{
+    return seekSample;
+}
+
+qint64 LoopBuffer::audioSample(qint64 playedSamples) const
+{
+    const qint64 sample = seekSample + playedSamples;
+    if (sample < outSample || outSample <= inSample) return sample;
+    return inSample + (sample - inSample) % (outSample - inSample);
+}
+
+qint64 LoopBuffer::timecodeSample(qint64 playedSamples, loop_tc_mode_t mode) const
+{
+    return (mode == LOOP_TC_CONTINUE) ? seekSample + playedSamples : audioSample(playedSamples);
+}
+
+qint64 LoopBuffer::wrapsAfter(qint64 playedSamples) const
+{
+    const qint64 sample = seekSample + playedSamples;
+    if (sample < outSample || outSample <= inSample) return 0;
+    return 1 + (sample - outSample) / (outSample - inSample);
+}
+
+int LoopBuffer::getBytesPerFrame() const
+{
+    return bytesPerFrame;
+}
+
+int LoopBuffer::getSampleRate() const
+{
+    return sampleRate;
+}
+
+qint64 LoopBuffer::getFirstSample() const
+{
+    return firstSample;
+}
+
+qint64 LoopBuffer::getInSample() const
+{
+    return inSample;
+}
+
+qint64 LoopBuffer::getOutSample() const
+{
+    return outSample;
+}
+
+qint64 LoopBuffer::frameSample(qint64 frame, double fps, int sampleRate)
+{
+    return ceilDiv(frameMs(frame, fps) * sampleRate, 1000);
+}
+
+qint64 LoopBuffer::sampleMs(qint64 sample, int sampleRate)
+{
+    return (sampleRate > 0) ? sample * 1000 / sampleRate : 0;
+}
+
+qint64 LoopBuffer::timecodePlayheadMs(qint64 interpolatedMs, qint64 outMs, loop_tc_mode_t mode)
+{
+    return (mode == LOOP_TC_JUMP) ? qMin(interpolatedMs, outMs - 1) : interpolatedMs;
+}
+
+LoopDevice::LoopDevice(LoopBuffer *buffer, QObject *parent)
+    : QIODevice(parent), buffer(buffer)
+{
+}
+
+bool LoopDevice::isSequential() const
+{
+    return true;
+}
+
+qint64 LoopDevice::readData(char *data, qint64 maxSize)
+{
+    return buffer->read(data, maxSize);
+}
+
+qint64 LoopDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+LoopPlayer::LoopPlayer(QObject *parent)
+    : QObject(parent), device(new LoopDevice(&buffer, this))
+{
+}
+
+LoopPlayer::~LoopPlayer()
+{
+    release();
+}
+
+void LoopPlayer::prepare(const QString &filePath, const timecode_t &in, const timecode_t &out, double framerate)
+{
+    release();
+    inTc = in;
+    outTc = out;
+    fps = framerate;
+    if (tcFrames(out, fps) <= tcFrames(in, fps))
+    {
+        emit failed("Loop out point must be after the in point");
+        return;
+    }
+
+    // Decoded to the format of the output device, the sink plays it as it is
+    decoder = new QAudioDecoder(this);
+    decoder->setAudioFormat(QMediaDevices::defaultAudioOutput().preferredFormat());
+    decoder->setSource(QUrl::fromLocalFile(filePath));
+    connect(decoder, &QAudioDecoder::bufferReady, this, &LoopPlayer::onBufferReady);
+    connect(decoder, &QAudioDecoder::finished, this, &LoopPlayer::onDecoderFinished);
+    connect(decoder, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error), this, [this]() {
+        const QString msg = "Can't decode the loop: " + decoder->errorString();
+        release();
+        emit failed(msg);
+    });
+    decoder->start();
+}
+
+void LoopPlayer::release()
+{
+    stop();
+    if (decoder)
+    {
+        decoder->disconnect(this);
+        decoder->stop();
+        decoder->deleteLater();
+        decoder = nullptr;
+    }
+    buffer.clear();
+    format = QAudioFormat();
+    complete = false;
+}
+
+bool LoopPlayer::isReady() const
+{
+    return complete;
+}
+
+qint64 LoopPlayer::inMs() const
+{
+    return frameMs(tcFrames(inTc, fps), fps);
+}
+
+qint64 LoopPlayer::outMs() const
+{
+    return frameMs(tcFrames(outTc, fps), fps);
+}
+
+qint64 LoopPlayer::handoffMs() const
+{
+    return qMax(LoopBuffer::sampleMs(buffer.getFirstSample(), buffer.getSampleRate()), inMs() - LOOP_HANDOFF_MS);
+}
+
+void LoopPlayer::onBufferReady()
+{
+    while (decoder && decoder->bufferAvailable())
+    {
+        const QAudioBuffer block = decoder->read();
+        if (!block.isValid()) continue;
+
+        if (!format.isValid())
+        {
+            // Region in samples of the decoded rate
+            format = block.format();
+            const int rate = format.sampleRate();
+            const qint64 in = LoopBuffer::frameSample(tcFrames(inTc, fps), fps, rate);
+            const qint64 out = LoopBuffer::frameSample(tcFrames(outTc, fps), fps, rate);
+            if (out - in > static_cast<qint64>(LOOP_MAX_SECONDS) * rate)
+            {
+                release();
+                emit failed(QString("Loop is longer than %1 s").arg(LOOP_MAX_SECONDS));
+                return;
+            }
+            buffer.setFormat(format.bytesPerFrame(), rate);
+            buffer.setRegion(in - static_cast<qint64>(LOOP_PREROLL_MS) * rate / 1000, in, out);
+            decodedSamples = 0;
+        }
+
+        // Decoder time stamps are in µs, the sample count is exact
+        const bool done = buffer.append(block.constData<char>(), block.byteCount(), decodedSamples);
+        decodedSamples += block.frameCount();
+        if (done)
+        {
+            complete = true;
+            decoder->disconnect(this);
+            decoder->stop(); // The rest of the file isn't needed
+            emit ready();
+            return;
+        }
+    }
+}
+
+void LoopPlayer::onDecoderFinished()
+{
+    if (complete) return;
+    release();
+    emit failed("Loop out point is after the end of the file");
+}
+
+bool LoopPlayer::start(qint64 positionMs)
+{
+    if (!complete) return false;
+    stop();
+    const qint64 sample = qBound(buffer.getFirstSample(), ceilDiv(positionMs * buffer.getSampleRate(), 1000),
+                                 buffer.getOutSample() - 1);
+    buffer.seek(sample);
+
+    // A new sink counts the processed audio from 0
+    sink = new QAudioSink(QMediaDevices::defaultAudioOutput(), format, this);
+    sink->setVolume(muted ? 0.0 : 1.0);
+    device->open(QIODevice::ReadOnly);
+    sink->start(device);
+    if (sink->error() != QAudio::NoError)
+    {
+        stop();
+        emit failed("Can't open the audio output for the loop");
+        return false;
+    }
+    return true;
+}
+
+void LoopPlayer::stop()
+{
+    if (!sink) return;
+    sink->stop();
+    delete sink;
+    sink = nullptr;
+    device->close();
+}
+
+void LoopPlayer::pause()
+{
+    if (sink) sink->suspend();
+}
+
+void LoopPlayer::resume()
+{
+    if (sink) sink->resume();
+}
+
+bool LoopPlayer::isActive() const
+{
+    return sink != nullptr;
+}
+
+bool LoopPlayer::isPaused() const
+{
+    return sink && sink->state() == QAudio::SuspendedState;
+}
+
+void LoopPlayer::setMuted(bool mute)
+{
+    muted = mute;
+    if (sink) sink->setVolume(muted ? 0.0 : 1.0);
+}
+
+qint64 LoopPlayer::playedSamples() const
+{
+    if (!sink || format.bytesPerFrame() <= 0) return 0;
+    // Processed is what the sink took from the device, the part still queued
+    // in its buffer isn't heard yet
+    const qint64 processed = sink->processedUSecs() * buffer.getSampleRate() / 1000000;
+    const qint64 queued = (sink->bufferSize() - sink->bytesFree()) / format.bytesPerFrame();
+    return qMax<qint64>(0, processed - queued);
+}
+
+qint64 LoopPlayer::audioPositionMs() const
+{
+    return LoopBuffer::sampleMs(buffer.audioSample(playedSamples()), buffer.getSampleRate());
+}
+
+qint64 LoopPlayer::timecodePositionMs(loop_tc_mode_t mode) const
+{
+    return LoopBuffer::sampleMs(buffer.timecodeSample(playedSamples(), mode), buffer.getSampleRate());
+}
+
+qint64 LoopPlayer::wraps() const
+{
+    return buffer.wrapsAfter(playedSamples());
+}
@@ -0,0 +1,145 @@
+#ifndef LOOPPLAYER_H
+#define LOOPPLAYER_H
+
+#include <QObject>
+#include <QIODevice>
+#include <QAudioFormat>
+#include <atomic>
+#include "struct.h"
+
+#define LOOP_PREROLL_MS 500      // Decoded before the in point, the hand-over happens in it
+#define LOOP_HANDOFF_MS 250      // The loop takes over this long before the in point
+#define LOOP_MAX_SECONDS 600     // Longest region kept in memory
+
+// Decoded PCM of a loop region and the read cursor over it. Samples from
+// the start of the pre-roll to the out point are kept, reading wraps from
+// the last sample before out to the in point inside one copy, so the loop
+// has no gap and no seek. Positions are sample frames of the whole file.
+class LoopBuffer
+{
+public:
+    void setFormat(int bytesPerFrame, int sampleRate);
+    void setRegion(qint64 firstSample, qint64 inSample, qint64 outSample); // Keeps first..out, loops in..out
+    void clear();
+
+    // Decoded block that starts at startSample, the part outside the region is dropped.
+    // Returns true when the region is complete.
+    bool append(const char *data, qint64 bytes, qint64 startSample);
+    bool isComplete() const;
+
+    bool seek(qint64 sample); // Next read starts there, inside first..out
+    qint64 read(char *data, qint64 maxBytes); // Whole frames, never short once complete
+    qint64 startSample() const; // Sample of the last seek
+
+    // Sample heard after playedSamples since the seek: the audio wraps, the
+    // continuing timecode counts on from the seek
+    qint64 audioSample(qint64 playedSamples) const;
+    qint64 timecodeSample(qint64 playedSamples, loop_tc_mode_t mode) const;
+    qint64 wrapsAfter(qint64 playedSamples) const;
+
+    int getBytesPerFrame() const;
+    int getSampleRate() const;
+    qint64 getFirstSample() const;
+    qint64 getInSample() const;
+    qint64 getOutSample() const;
+
+    // Edge of a timecode frame and back, as TCconverter counts frames from milliseconds
+    static qint64 frameSample(qint64 frame, double fps, int sampleRate);
+    static qint64 sampleMs(qint64 sample, int sampleRate); // Whole ms the sample falls in
+    // Timecode playhead of the cue timer from the one interpolated since the
+    // last report: jump back holds the last frame before out until the wrap
+    // is reported, the out frame is never sent
+    static qint64 timecodePlayheadMs(qint64 interpolatedMs, qint64 outMs, loop_tc_mode_t mode);
+
+private:
+    QByteArray pcm;
+    int bytesPerFrame = 0;
+    int sampleRate = 0;
+    qint64 firstSample = 0;
+    qint64 inSample = 0;
+    qint64 outSample = 0;
+    qint64 seekSample = 0;
+    std::atomic<qint64> cursor{0}; // Sample of the next read
+};
+
+// Pull device of the audio sink over the loop buffer
+class LoopDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit LoopDevice(LoopBuffer *buffer, QObject *parent = nullptr);
+    bool isSequential() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    LoopBuffer *buffer;
+};
+
+class QAudioDecoder;
+class QAudioSink;
+
+// Loop region of a cue. prepare() decodes the pre-roll and the region in
+// the background, the cue keeps playing through QMediaPlayer meanwhile.
+// Near the in point the cue calls start() and pauses its player, from
+// then on the sink plays the buffer and the loop is sample accurate.
+// The hand-over itself is not: the audio still queued in the player's
+// output is dropped and the new sink has its own start latency, so there
+// is a short gap or skip of a few tens of ms inside the pre-roll, before
+// the in point. The wraps and the timecode after the hand-over are exact.
+class LoopPlayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoopPlayer(QObject *parent = nullptr);
+    ~LoopPlayer();
+
+    void prepare(const QString &filePath, const timecode_t &in, const timecode_t &out, double fps);
+    void release(); // Stops and frees the buffer
+    bool isReady() const;
+    qint64 inMs() const;
+    qint64 outMs() const;
+    qint64 handoffMs() const; // Playhead that hands the cue over to the loop
+
+    bool start(qint64 positionMs); // Play from the position, inside the decoded part
+    void stop();
+    void pause();
+    void resume();
+    bool isActive() const; // Started and not stopped
+    bool isPaused() const;
+    void setMuted(bool muted);
+
+    // Heard position of the audio and of the timecode, in ms of the cue
+    qint64 audioPositionMs() const;
+    qint64 timecodePositionMs(loop_tc_mode_t mode) const;
+    qint64 wraps() const;
+
+signals:
+    void ready();
+    void failed(const QString &msg);
+
+private slots:
+    void onBufferReady();
+    void onDecoderFinished();
+
+private:
+    LoopBuffer buffer;
+    LoopDevice *device;
+    QAudioDecoder *decoder = nullptr;
+    QAudioSink *sink = nullptr;
+    QAudioFormat format;
+    timecode_t inTc = {};
+    timecode_t outTc = {};
+    double fps = 30;
+    qint64 decodedSamples = 0; // Samples of the file before the next decoded block
+    bool complete = false;
+    bool muted = false;
+
+    qint64 playedSamples() const;
+};
+
+#endif // LOOPPLAYER_H
@@ -0,0 +1,227 @@
+#include "ltc.h"
+#include <algorithm>
+#include <cstring>
+
+#define LTC_HALF_BITS (2 * LTC_FRAME_BITS)
+#define LTC_SYNC_BIT 64
+#define LTC_PHASE_SCALE 1000 // Finer phase units, one ppm of speed trim is several of them
+
+// Bits 64..79 in the order they are sent
+static const quint8 ltcSync[16] = {0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1};
+
+static qint64 floorDiv(qint64 a, qint64 b)
+{
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+// BCD fields and user bit nibbles, least significant bit first
+static void putBits(quint8 *bits, int first, int count, int value)
+{
+    for (int i = 0; i < count; ++i)
+        bits[first + i] = static_cast<quint8>((value >> i) & 1);
+}
+
+static int getBits(const quint8 *bits, int first, int count)
+{
+    int value = 0;
+    for (int i = 0; i < count; ++i)
+        value |= bits[first + i] << i;
+    return value;
+}
+
+void LtcEncoder::setFormat(int rateHz, const framerate_t &frameRate)
+{
+    sampleRate = rateHz;
+    rate = &frameRate;
+    halfLength = rate->rateDen * sampleRate * LTC_PHASE_SCALE;
+    nominalStep = LTC_HALF_BITS * rate->rateNum * LTC_PHASE_SCALE;
+    step = nominalStep;
+    locate(0);
+}
+
+void LtcEncoder::setUserBits(quint32 value)
+{
+    userBits = value;
+}
+
+void LtcEncoder::setAmplitude(float value)
+{
+    amplitude = value;
+    level = (level < 0) ? -amplitude : amplitude;
+}
+
+void LtcEncoder::setSpeed(int ppm)
+{
+    step = nominalStep + nominalStep * ppm / 1000000;
+}
+
+void LtcEncoder::locate(qint64 timecodeMs)
+{
+    if (!rate) return;
+    // Frame and the time into it, exact: rem / (1000 * rateNum) seconds
+    currentFrame = floorDiv(timecodeMs * rate->rateNum, 1000 * rate->rateDen);
+    const qint64 rem = timecodeMs * rate->rateNum - currentFrame * 1000 * rate->rateDen;
+    const qint64 units = rem * sampleRate * LTC_HALF_BITS * LTC_PHASE_SCALE / 1000;
+    half = static_cast<int>(qMin<qint64>(units / halfLength, LTC_HALF_BITS - 1));
+    phase = units - half * halfLength;
+    buildFrame();
+
+    // Every frame has an even number of transitions, so it starts at the same level
+    level = -amplitude;
+    for (int h = 0; h <= half; ++h)
+    {
+        if (h % 2 == 0 || bits[h / 2])
+            level = -level;
+    }
+}
+
+void LtcEncoder::render(float *out, qint64 count, int stride)
+{
+    while (count > 0)
+    {
+        // Samples left in this half bit, they all have the same level
+        const qint64 run = qMin(count, (halfLength - phase + step - 1) / step);
+        if (stride == 1)
+            std::fill(out, out + run, level);
+        else
+        {
+            for (qint64 i = 0; i < run; ++i)
+                out[i * stride] = level;
+        }
+        out += run * stride;
+        count -= run;
+        phase += run * step;
+        while (phase >= halfLength)
+        {
+            phase -= halfLength;
+            nextHalf();
+        }
+    }
+}
+
+qint64 LtcEncoder::frame() const
+{
+    return currentFrame;
+}
+
+double LtcEncoder::position() const
+{
+    if (!rate) return 0;
+    const double frames = currentFrame + (half + static_cast<double>(phase) / halfLength) / LTC_HALF_BITS;
+    return frames * 1000 * rate->rateDen / rate->rateNum;
+}
+
+int LtcEncoder::getSampleRate() const
+{
+    return sampleRate;
+}
+
+void LtcEncoder::nextHalf()
+{
+    if (++half == LTC_HALF_BITS)
+    {
+        half = 0;
+        ++currentFrame;
+        buildFrame();
+    }
+    // Transition at the start of every bit and in the middle of a 1
+    if (half % 2 == 0 || bits[half / 2])
+        level = -level;
+}
+
+void LtcEncoder::buildFrame()
+{
+    const timecode_t tc = rate->dropFrame ? converter.frames2dftc(currentFrame)
+                                          : converter.frames2ndftc(currentFrame, rate->timebase);
+    memset(bits, 0, sizeof(bits));
+    putBits(bits, 0, 4, tc.ff % 10);
+    putBits(bits, 8, 2, tc.ff / 10);
+    bits[10] = rate->dropFrame ? 1 : 0;
+    putBits(bits, 16, 4, tc.ss % 10);
+    putBits(bits, 24, 3, tc.ss / 10);
+    putBits(bits, 32, 4, tc.mm % 10);
+    putBits(bits, 40, 3, tc.mm / 10);
+    putBits(bits, 48, 4, tc.hh % 10);
+    putBits(bits, 56, 2, tc.hh / 10);
+    for (int i = 0; i < 8; ++i)
+        putBits(bits, 4 + 8 * i, 4, (userBits >> (4 * i)) & 0x0F);
+    memcpy(bits + LTC_SYNC_BIT, ltcSync, sizeof(ltcSync));
+
+    // Polarity correction: an even number of ones, bit 59 at 25 fps and bit 27 otherwise
+    const int ones = static_cast<int>(std::count(bits, bits + LTC_FRAME_BITS, 1));
+    bits[rate->timebase == 25 ? 59 : 27] = static_cast<quint8>(ones % 2);
+}
+
+void LtcDecoder::setFormat(int sampleRate, double fps)
+{
+    frameRate = fps;
+    bitLength = sampleRate / (fps * LTC_FRAME_BITS);
+    reset();
+}
+
+void LtcDecoder::reset()
+{
+    position = 0;
+    lastEdge = -1;
+    high = false;
+    pendingHalf = false;
+    received = 0;
+}
+
+void LtcDecoder::process(const float *samples, qint64 count, int stride, QVector<ltc_frame_t> &frames)
+{
+    for (qint64 i = 0; i < count; ++i, ++position)
+    {
+        const bool isHigh = samples[i * stride] > 0;
+        if (isHigh == high) continue;
+        high = isHigh;
+        if (lastEdge >= 0)
+        {
+            const double interval = position - lastEdge;
+            if (interval < 0.75 * bitLength)
+            {
+                // Half bit: the second one completes a 1
+                if (pendingHalf)
+                    pushBit(1, bitStart, frames);
+                else
+                    bitStart = lastEdge;
+                pendingHalf = !pendingHalf;
+            }
+            else if (interval < 1.5 * bitLength)
+            {
+                if (!pendingHalf)
+                    pushBit(0, lastEdge, frames);
+                pendingHalf = false; // A whole bit after a lone half: out of step, the next sync word aligns again
+            }
+            else
+            {
+                pendingHalf = false; // Signal lost
+                received = 0;
+            }
+        }
+        lastEdge = position;
+    }
+}
+
+void LtcDecoder::pushBit(quint8 bit, qint64 startSample, QVector<ltc_frame_t> &frames)
+{
+    memmove(bits, bits + 1, LTC_FRAME_BITS - 1);
+    memmove(starts, starts + 1, (LTC_FRAME_BITS - 1) * sizeof(qint64));
+    bits[LTC_FRAME_BITS - 1] = bit;
+    starts[LTC_FRAME_BITS - 1] = startSample;
+    if (++received < LTC_FRAME_BITS || memcmp(bits + LTC_SYNC_BIT, ltcSync, sizeof(ltcSync)) != 0)
+        return;
+
+    ltc_frame_t frame;
+    frame.tc.ff = static_cast<uint8_t>(getBits(bits, 0, 4) + 10 * getBits(bits, 8, 2));
+    frame.tc.ss = static_cast<uint8_t>(getBits(bits, 16, 4) + 10 * getBits(bits, 24, 3));
+    frame.tc.mm = static_cast<uint8_t>(getBits(bits, 32, 4) + 10 * getBits(bits, 40, 3));
+    frame.tc.hh = static_cast<uint8_t>(getBits(bits, 48, 4) + 10 * getBits(bits, 56, 2));
+    frame.dropFrame = bits[10] != 0;
+    frame.tc.fps = static_cast<uint8_t>(frame.dropFrame ? 29 : qRound(frameRate));
+    frame.userBits = 0;
+    for (int i = 0; i < 8; ++i)
+        frame.userBits |= static_cast<quint32>(getBits(bits, 4 + 8 * i, 4)) << (4 * i);
+    frame.sample = starts[0];
+    frames.append(frame);
+}
@@ -0,0 +1,89 @@
+#ifndef LTC_H
+#define LTC_H
+
+#include <QVector>
+#include "struct.h"
+#include "framerate.h"
+#include "tcconverter.h"
+
+#define LTC_FRAME_BITS 80
+#define LTC_DEFAULT_AMPLITUDE 0.5f  // -6 dBFS, the usual line level of LTC
+
+// SMPTE 12M linear timecode, biphase mark coded: every bit starts with a
+// transition, a 1 has a second one in the middle. The 80 bit frame holds
+// the BCD time with a user bit nibble after every field, the drop frame
+// and polarity correction bits and the sync word 0011 1111 1111 1101.
+//
+// The encoder keeps its phase in integer fractions of a half bit, so frames
+// stay on the exact rational rate over any length. The speed may be trimmed
+// by ppm to follow the playhead of a cue.
+// render() fills the runs between two transitions at once and neither
+// allocates nor locks, it may be called from an audio callback.
+class LtcEncoder
+{
+public:
+    void setFormat(int sampleRate, const framerate_t &rate);
+    void setUserBits(quint32 bits); // UB1 is the low nibble
+    void setAmplitude(float amplitude);
+    void setSpeed(int ppm); // Trim of the rate to follow another clock, 0 = exact
+
+    void locate(qint64 timecodeMs); // Timecode at the next sample, frames before 0 wrap from 24 h
+    void render(float *out, qint64 count, int stride = 1); // Every stride-th float is written
+
+    qint64 frame() const; // Frame being sent
+    double position() const; // Timecode of the next sample in ms, fractions of a ms included
+    int getSampleRate() const;
+
+private:
+    TCconverter converter;
+    const framerate_t *rate = nullptr;
+    int sampleRate = 48000;
+    quint32 userBits = 0;
+    float amplitude = LTC_DEFAULT_AMPLITUDE;
+
+    qint64 halfLength = 1;  // One half bit in phase units
+    qint64 nominalStep = 0; // Phase of one sample at the exact rate
+    qint64 step = 0;
+    qint64 phase = 0;       // Inside the current half bit
+    int half = 0;           // Half bit of the frame, 0..159
+    qint64 currentFrame = 0;
+    float level = LTC_DEFAULT_AMPLITUDE;
+    quint8 bits[LTC_FRAME_BITS] = {};
+
+    void buildFrame();
+    void nextHalf();
+};
+
+typedef struct
+{
+    timecode_t tc;
+    bool dropFrame;
+    quint32 userBits;
+    qint64 sample;      // First sample of the frame
+} ltc_frame_t;
+
+// Reads frames back from samples: intervals between zero crossings are
+// half or whole bits, a frame is complete when the sync word arrives.
+class LtcDecoder
+{
+public:
+    void setFormat(int sampleRate, double fps);
+    void reset();
+    void process(const float *samples, qint64 count, int stride, QVector<ltc_frame_t> &frames);
+
+private:
+    double frameRate = 30;
+    double bitLength = 20; // Samples of one bit at the nominal rate
+    qint64 position = 0;   // Sample index of the next input
+    qint64 lastEdge = -1;
+    bool high = false;
+    bool pendingHalf = false;
+    qint64 bitStart = 0;
+    quint8 bits[LTC_FRAME_BITS] = {};     // Last bits, oldest first
+    qint64 starts[LTC_FRAME_BITS] = {};   // Sample each of them started
+    int received = 0;
+
+    void pushBit(quint8 bit, qint64 startSample, QVector<ltc_frame_t> &frames);
+};
+
+#endif // LTC_H
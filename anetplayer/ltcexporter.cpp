@@ -0,0 +1,340 @@
+#include "ltcexporter.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+#include "framerate.h"
+#include "mediaprober.h"
+#include "trace.h"
+
+#define WAV_HEADER_SIZE 44
+#define WAV_MAX_DATA_BYTES 0xFFFFFFD0LL // RIFF sizes are 32 bit
+
+static bool fail(QString *error, const QString &msg)
+{
+    if (error) *error = msg;
+    return false;
+}
+
+// Normalized value of one little-endian PCM sample, as MediaProber reads them
+static inline float loadSample(const uchar *p, int bytesPerSample, bool isFloat)
+{
+    switch (bytesPerSample) {
+    case 1:
+        return (static_cast<int>(p[0]) - 128) / 128.0f;
+    case 2:
+        return qFromLittleEndian<qint16>(p) / 32768.0f;
+    case 3:
+        return (static_cast<qint32>(quint32(p[2]) << 24 | quint32(p[1]) << 16 | quint32(p[0]) << 8) >> 8) / 8388608.0f;
+    default:
+        if (isFloat)
+            return qFromLittleEndian<float>(p);
+        return qFromLittleEndian<qint32>(p) / 2147483648.0f;
+    }
+}
+
+static inline void storeSample(uchar *p, float value, int bytesPerSample, bool isFloat)
+{
+    switch (bytesPerSample) {
+    case 1:
+        p[0] = static_cast<uchar>(128 + std::lrint(value * 127.0f));
+        break;
+    case 2:
+        qToLittleEndian<qint16>(static_cast<qint16>(std::lrint(value * 32767.0f)), p);
+        break;
+    case 3:
+    {
+        const qint32 v = static_cast<qint32>(std::lrint(value * 8388607.0f));
+        p[0] = static_cast<uchar>(v);
+        p[1] = static_cast<uchar>(v >> 8);
+        p[2] = static_cast<uchar>(v >> 16);
+        break;
+    }
+    default:
+        if (isFloat)
+            qToLittleEndian<float>(value, p);
+        else
+            qToLittleEndian<qint32>(static_cast<qint32>(std::lrint(value * 2147483647.0)), p);
+    }
+}
+
+QByteArray LtcExporter::wavHeader(quint16 formatTag, int channels, int sampleRate, int bits, qint64 frames)
+{
+    const int blockAlign = channels * bits / 8;
+    const quint32 dataBytes = static_cast<quint32>(frames * blockAlign);
+    QByteArray header(WAV_HEADER_SIZE, '\0');
+    uchar *h = reinterpret_cast<uchar*>(header.data());
+    memcpy(h, "RIFF", 4);
+    qToLittleEndian<quint32>(dataBytes + WAV_HEADER_SIZE - 8, h + 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, h + 16);
+    qToLittleEndian<quint16>(formatTag, h + 20);
+    qToLittleEndian<quint16>(static_cast<quint16>(channels), h + 22);
+    qToLittleEndian<quint32>(static_cast<quint32>(sampleRate), h + 24);
+    qToLittleEndian<quint32>(static_cast<quint32>(sampleRate * blockAlign), h + 28);
+    qToLittleEndian<quint16>(static_cast<quint16>(blockAlign), h + 32);
+    qToLittleEndian<quint16>(static_cast<quint16>(bits), h + 34);
+    memcpy(h + 36, "data", 4);
+    qToLittleEndian<quint32>(dataBytes, h + 40);
+    return header;
+}
+
+LtcExporter::LtcExporter(QObject *parent)
+    : QObject(parent)
+{
+}
+
+LtcExporter::~LtcExporter()
+{
+    abort = true;
+    pool.clear();
+    pool.waitForDone();
+}
+
+void LtcExporter::exportCues(const QVector<ltc_export_job_t> &jobs)
+{
+    const int gen = generation;
+    for (const ltc_export_job_t &job : jobs)
+    {
+        ++total;
+        ++pending;
+        pool.start([this, gen, job]() {
+            QString error;
+            const bool ok = exportFile(job, &error, &abort);
+            // Deliver the result in the thread of the exporter
+            QMetaObject::invokeMethod(this, [this, gen, job, ok, error]() {
+                if (gen != generation) return;
+                if (!ok) ++failed;
+                emit cueExported(job.outputPath, ok, error);
+                if (--pending == 0)
+                {
+                    emit exportFinished(total, failed);
+                    total = 0;
+                    failed = 0;
+                }
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void LtcExporter::cancel()
+{
+    ++generation;
+    pool.clear(); // Remove the exports that haven't started yet
+    abort = true;
+    pool.waitForDone(); // The running ones stop within a block
+    abort = false;
+    total = 0;
+    pending = 0;
+    failed = 0;
+}
+
+bool LtcExporter::isBusy() const
+{
+    return pending > 0;
+}
+
+bool LtcExporter::exportFile(const ltc_export_job_t &job, QString *error, const std::atomic<bool> *abort)
+{
+    TRACE_SCOPE("ltc", "LtcExporter::exportFile");
+    const framerate_t &rate = frameRateOf(job.frameRate);
+
+    // Programme channels copied as they are, the LTC is written in their sample format
+    QFile source(job.mediaPath);
+    ltc_wav_t programme;
+    int sampleRate = job.sampleRate;
+    qint64 frames = 0;
+    if (job.interleave)
+    {
+        if (!source.open(QIODevice::ReadOnly) || !readWav(source, programme))
+            return fail(error, "Only PCM WAV programme audio can be interleaved: " + QFileInfo(job.mediaPath).fileName());
+        sampleRate = programme.sampleRate;
+        frames = programme.frames;
+        source.seek(programme.dataPos);
+    }
+    else
+    {
+        qint64 durationMs = job.durationMs;
+        if (durationMs <= 0)
+            durationMs = MediaProber::probeFile(job.mediaPath).durationMs;
+        if (durationMs <= 0)
+            return fail(error, "Can't get the duration of " + QFileInfo(job.mediaPath).fileName());
+        frames = (durationMs * sampleRate + 999) / 1000;
+    }
+    if (sampleRate <= 0 || frames <= 0)
+        return fail(error, "Nothing to export for " + QFileInfo(job.mediaPath).fileName());
+
+    const quint16 formatTag = job.interleave ? programme.formatTag : 1;
+    const int bits = job.interleave ? programme.bits : 16;
+    const int bytesPerSample = bits / 8;
+    const int channels = job.interleave ? programme.channels + 1 : 1;
+    const int programmeAlign = job.interleave ? programme.blockAlign : 0;
+    const int outputAlign = programmeAlign + bytesPerSample;
+    if (frames * outputAlign > WAV_MAX_DATA_BYTES)
+        return fail(error, "LTC track is too long for a WAV file: " + QFileInfo(job.outputPath).fileName());
+
+    // The file appears complete or not at all
+    QSaveFile file(job.outputPath);
+    if (!file.open(QIODevice::WriteOnly))
+        return fail(error, "Can't write " + job.outputPath);
+    file.write(wavHeader(formatTag, channels, sampleRate, bits, frames));
+
+    LtcEncoder encoder;
+    encoder.setFormat(sampleRate, rate);
+    encoder.setUserBits(job.userBits);
+    encoder.locate(job.adjustmentMs); // Timecode of the first sample of the cue
+    QVector<float> ltc(LTC_EXPORT_BLOCK_FRAMES);
+    QByteArray input;
+    QByteArray block(LTC_EXPORT_BLOCK_FRAMES * outputAlign, '\0');
+    const bool isFloat = (formatTag == 3);
+
+    for (qint64 done = 0; done < frames;)
+    {
+        if (abort && abort->load(std::memory_order_relaxed))
+        {
+            file.cancelWriting();
+            return fail(error, "Export cancelled");
+        }
+        const int count = static_cast<int>(qMin<qint64>(LTC_EXPORT_BLOCK_FRAMES, frames - done));
+        encoder.render(ltc.data(), count);
+
+        uchar *d = reinterpret_cast<uchar*>(block.data());
+        if (job.interleave)
+        {
+            input = source.read(static_cast<qint64>(count) * programmeAlign);
+            if (input.size() < count * programmeAlign)
+            {
+                file.cancelWriting();
+                return fail(error, "Can't read " + job.mediaPath);
+            }
+            const uchar *s = reinterpret_cast<const uchar*>(input.constData());
+            for (int i = 0; i < count; ++i, d += outputAlign, s += programmeAlign)
+            {
+                memcpy(d, s, programmeAlign);
+                storeSample(d + programmeAlign, ltc[i], bytesPerSample, isFloat);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < count; ++i, d += outputAlign)
+                storeSample(d, ltc[i], bytesPerSample, isFloat);
+        }
+
+        if (file.write(block.constData(), static_cast<qint64>(count) * outputAlign) != static_cast<qint64>(count) * outputAlign)
+        {
+            file.cancelWriting();
+            return fail(error, "Can't write " + job.outputPath);
+        }
+        done += count;
+    }
+    if (!file.commit())
+        return fail(error, "Can't write " + job.outputPath);
+    return true;
+}
+
+bool LtcExporter::decodeFile(const QString &path, double fps, QVector<ltc_frame_t> &frames, QString *error)
+{
+    QFile file(path);
+    ltc_wav_t wav;
+    if (!file.open(QIODevice::ReadOnly) || !readWav(file, wav))
+        return fail(error, "Can't read the WAV file " + path);
+    file.seek(wav.dataPos);
+
+    LtcDecoder decoder;
+    decoder.setFormat(wav.sampleRate, fps);
+    const int bytesPerSample = wav.bits / 8;
+    const int ltcOffset = wav.blockAlign - bytesPerSample; // Last channel
+    QVector<float> samples(LTC_EXPORT_BLOCK_FRAMES);
+    for (qint64 done = 0; done < wav.frames;)
+    {
+        const int count = static_cast<int>(qMin<qint64>(LTC_EXPORT_BLOCK_FRAMES, wav.frames - done));
+        const QByteArray data = file.read(static_cast<qint64>(count) * wav.blockAlign);
+        if (data.size() < count * wav.blockAlign)
+            return fail(error, "Can't read " + path);
+        const uchar *p = reinterpret_cast<const uchar*>(data.constData()) + ltcOffset;
+        for (int i = 0; i < count; ++i, p += wav.blockAlign)
+            samples[i] = loadSample(p, bytesPerSample, wav.formatTag == 3);
+        decoder.process(samples.constData(), count, 1, frames);
+        done += count;
+    }
+    return true;
+}
+
+bool LtcExporter::readWav(QFile &file, ltc_wav_t &wav)
+{
+    const QByteArray riff = file.read(12);
+    if (riff.size() < 12 || !riff.startsWith("RIFF") || riff.mid(8, 4) != "WAVE") return false;
+
+    bool hasFmt = false;
+    while (!file.atEnd())
+    {
+        const QByteArray chunk = file.read(8);
+        if (chunk.size() < 8) break;
+        const quint32 size = qFromLittleEndian<quint32>(chunk.constData() + 4);
+        const qint64 dataPos = file.pos();
+
+        if (chunk.startsWith("fmt "))
+        {
+            const QByteArray fmt = file.read(qMin<quint32>(size, 40));
+            if (fmt.size() < 16) return false;
+            wav.formatTag = qFromLittleEndian<quint16>(fmt.constData());
+            wav.channels = qFromLittleEndian<quint16>(fmt.constData() + 2);
+            wav.sampleRate = static_cast<int>(qFromLittleEndian<quint32>(fmt.constData() + 4));
+            wav.blockAlign = qFromLittleEndian<quint16>(fmt.constData() + 12);
+            wav.bits = qFromLittleEndian<quint16>(fmt.constData() + 14);
+            // WAVE_FORMAT_EXTENSIBLE: the real format is in the sub format GUID
+            if (wav.formatTag == 0xFFFE && fmt.size() >= 26)
+                wav.formatTag = qFromLittleEndian<quint16>(fmt.constData() + 24);
+            hasFmt = true;
+        }
+        else if (chunk.startsWith("data"))
+        {
+            // Whole bytes per sample, 1 = PCM, 3 = IEEE float
+            const bool isPcm = (wav.formatTag == 1 && wav.bits % 8 == 0 && wav.bits >= 8 && wav.bits <= 32);
+            const bool isFloat = (wav.formatTag == 3 && wav.bits == 32);
+            if (!hasFmt || (!isPcm && !isFloat) || wav.channels <= 0 || wav.blockAlign != wav.channels * wav.bits / 8)
+                return false;
+            wav.dataPos = dataPos;
+            wav.frames = qMin<qint64>(size, file.size() - dataPos) / wav.blockAlign;
+            return true;
+        }
+
+        if (!file.seek(dataPos + size + (size & 1))) break;
+    }
+    return false;
+}
+
+QVector<ltc_export_job_t> LtcExporter::jobsFor(const QVector<cue_t> &cues, const QString &outputDir, bool interleave)
+{
+    QVector<ltc_export_job_t> jobs;
+    const QDir dir(outputDir);
+    for (int i = 0; i < cues.size(); ++i)
+    {
+        const cue_t &cue = cues[i];
+        if (cue.filePath.isEmpty()) continue;
+        ltc_export_job_t job;
+        job.mediaPath = cue.filePath;
+        job.outputPath = dir.filePath(outputName(i + 1, cue.filePath));
+        job.frameRate = cue.frameRate;
+        job.adjustmentMs = cue.adjustmentTime;
+        job.userBits = cueUserBits(i + 1);
+        job.interleave = interleave && QFileInfo(cue.filePath).suffix().compare("wav", Qt::CaseInsensitive) == 0;
+        jobs.append(job);
+    }
+    return jobs;
+}
+
+QString LtcExporter::outputName(int cue, const QString &mediaPath)
+{
+    return QString("%1 %2.ltc.wav").arg(cue, 2, 10, QChar('0')).arg(QFileInfo(mediaPath).completeBaseName());
+}
+
+quint32 LtcExporter::cueUserBits(int cue)
+{
+    quint32 bits = 0;
+    for (int shift = 0; cue > 0 && shift < 32; shift += 4, cue /= 10)
+        bits |= static_cast<quint32>(cue % 10) << shift;
+    return bits;
+}
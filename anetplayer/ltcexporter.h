@@ -0,0 +1,79 @@
+#ifndef LTCEXPORTER_H
+#define LTCEXPORTER_H
+
+#include <QObject>
+#include <QFile>
+#include <QThreadPool>
+#include <atomic>
+#include "ltc.h"
+
+#define LTC_EXPORT_SAMPLE_RATE 48000
+#define LTC_EXPORT_BLOCK_FRAMES 8192  // Sample frames rendered and written at a time
+
+typedef struct
+{
+    QString mediaPath;       // Audio of the cue, sets the length
+    QString outputPath;      // WAV file written
+    QString frameRate = "30"; // cue_t::frameRate
+    qint64 adjustmentMs = 0;  // Signed, as cue_t::adjustmentTime
+    qint64 durationMs = 0;    // 0 = probed from the media file
+    int sampleRate = LTC_EXPORT_SAMPLE_RATE; // Of a track without the programme
+    quint32 userBits = 0;
+    bool interleave = false;  // LTC as an extra channel after the programme channels
+} ltc_export_job_t;
+
+typedef struct
+{
+    quint16 formatTag = 0;   // 1 = PCM, 3 = IEEE float
+    int channels = 0;
+    int sampleRate = 0;
+    int bits = 0;
+    int blockAlign = 0;
+    qint64 dataPos = 0;
+    qint64 frames = 0;       // Sample frames that really exist
+} ltc_wav_t;
+
+// LTC tracks of the cues for playback from a DAW or a multitrack player,
+// the timecode follows the cue from its first sample exactly as the
+// Art-Net output does. Every cue is rendered on the thread pool and
+// streamed to disk in blocks, a cue of any length needs little memory.
+// A WAV programme may be copied into the file with the LTC as its last
+// channel, other formats give an LTC only track.
+class LtcExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LtcExporter(QObject *parent = nullptr);
+    ~LtcExporter();
+
+    void exportCues(const QVector<ltc_export_job_t> &jobs); // Results arrive with cueExported()
+    void cancel(); // Running exports stop after their current block
+    bool isBusy() const;
+
+    // Synchronous export, called on the pool threads
+    static bool exportFile(const ltc_export_job_t &job, QString *error = nullptr, const std::atomic<bool> *abort = nullptr);
+    // Frames of the LTC in the last channel of a WAV file
+    static bool decodeFile(const QString &path, double fps, QVector<ltc_frame_t> &frames, QString *error = nullptr);
+
+    // A job for every cue with a file, WAV cues interleaved if asked
+    static QVector<ltc_export_job_t> jobsFor(const QVector<cue_t> &cues, const QString &outputDir, bool interleave);
+    static bool readWav(QFile &file, ltc_wav_t &wav);
+    static QByteArray wavHeader(quint16 formatTag, int channels, int sampleRate, int bits, qint64 frames);
+    static QString outputName(int cue, const QString &mediaPath); // "03 name.ltc.wav"
+    static quint32 cueUserBits(int cue); // Cue number in BCD, UB1 holds the units
+
+signals:
+    void cueExported(const QString &outputPath, bool ok, const QString &error);
+    void exportFinished(int total, int failed);
+
+private:
+    QThreadPool pool;
+    std::atomic<bool> abort{false};
+    int generation = 0; // Results of the cancelled exports are ignored
+    int total = 0;
+    int pending = 0;
+    int failed = 0;
+};
+
+#endif // LTCEXPORTER_H
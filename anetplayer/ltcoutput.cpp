@@ -0,0 +1,300 @@
+#include "ltcoutput.h"
+#include <QAudioSink>
+#include <QAudioDevice>
+#include <QMediaDevices>
+#include <cmath>
+#include <cstring>
+
+#define NS_PER_MS 1000000LL
+
+LtcDevice::LtcDevice(Clock *clock, QObject *parent)
+    : QIODevice(parent), clock(clock)
+{
+}
+
+void LtcDevice::configure(const QAudioFormat &audioFormat, int ltcChannel, const framerate_t &rate, quint32 userBits)
+{
+    format = audioFormat;
+    channel = ltcChannel;
+    bytesPerSample = format.bytesPerSample();
+    bytesPerFrame = format.bytesPerFrame();
+    encoder.setFormat(format.sampleRate(), rate);
+    encoder.setUserBits(userBits);
+    encoder.setSpeed(0);
+    appliedPpm = 0;
+    speedPpm = 0;
+}
+
+void LtcDevice::setBufferFrames(qint64 frames)
+{
+    bufferFrames = frames;
+}
+
+void LtcDevice::requestLocate(qint64 timecodeMs, qint64 timeNs)
+{
+    const quint32 seq = requestSeq.load();
+    requestSeq = seq + 1;
+    requestMs = timecodeMs;
+    requestNs = timeNs;
+    requestSeq = seq + 2;
+}
+
+void LtcDevice::setSpeedPpm(int ppm)
+{
+    speedPpm = ppm;
+}
+
+bool LtcDevice::snapshot(double &timecodeMs, qint64 &heardNs) const
+{
+    const quint32 seq = stateSeq.load();
+    if (seq == 0 || (seq & 1)) return false;
+    const quint32 applied = appliedRequest.load();
+    const qint64 timecodeNs = stateTimecodeNs.load();
+    const qint64 heard = stateHeardNs.load();
+    if (stateSeq.load() != seq || applied != requestSeq.load()) return false;
+    timecodeMs = timecodeNs / 1e6;
+    heardNs = heard;
+    return true;
+}
+
+bool LtcDevice::isSequential() const
+{
+    return true;
+}
+
+qint64 LtcDevice::readData(char *data, qint64 maxSize)
+{
+    const qint64 frames = maxSize / bytesPerFrame;
+    if (frames <= 0) return 0;
+    const qint64 nowNs = clock->nowNs();
+    const qint64 buffered = qMax(bufferFrames.load(std::memory_order_relaxed), frames);
+    applyRequest(nowNs, buffered - frames);
+    const int ppm = speedPpm.load(std::memory_order_relaxed);
+    if (ppm != appliedPpm)
+    {
+        encoder.setSpeed(ppm);
+        appliedPpm = ppm;
+    }
+
+    // Silence on the other channels, the LTC is written into its own
+    uchar *out = reinterpret_cast<uchar*>(data);
+    memset(out, format.sampleFormat() == QAudioFormat::UInt8 ? 0x80 : 0, frames * bytesPerFrame);
+    uchar *p = out + channel * bytesPerSample;
+    for (qint64 done = 0; done < frames;)
+    {
+        const int count = static_cast<int>(qMin<qint64>(LTC_OUTPUT_BLOCK_FRAMES, frames - done));
+        encoder.render(block, count);
+        switch (format.sampleFormat()) {
+        case QAudioFormat::UInt8:
+            for (int i = 0; i < count; ++i, p += bytesPerFrame)
+                *p = static_cast<uchar>(128 + std::lrint(block[i] * 127.0f));
+            break;
+        case QAudioFormat::Int16:
+            for (int i = 0; i < count; ++i, p += bytesPerFrame)
+            {
+                const qint16 v = static_cast<qint16>(std::lrint(block[i] * 32767.0f));
+                memcpy(p, &v, sizeof(v));
+            }
+            break;
+        case QAudioFormat::Int32:
+            for (int i = 0; i < count; ++i, p += bytesPerFrame)
+            {
+                const qint32 v = static_cast<qint32>(std::lrint(block[i] * 2147483647.0));
+                memcpy(p, &v, sizeof(v));
+            }
+            break;
+        default:
+            for (int i = 0; i < count; ++i, p += bytesPerFrame)
+                memcpy(p, &block[i], sizeof(float));
+            break;
+        }
+        done += count;
+    }
+
+    // The next sample is heard after everything queued in the sink
+    const quint32 seq = stateSeq.load(std::memory_order_relaxed);
+    stateSeq = seq + 1;
+    stateTimecodeNs = static_cast<qint64>(encoder.position() * NS_PER_MS);
+    stateHeardNs = nowNs + buffered * 1000000000LL / format.sampleRate();
+    stateSeq = seq + 2;
+    return frames * bytesPerFrame;
+}
+
+qint64 LtcDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+// The first sample of this read is heard after the queued ones, it gets the playhead of that moment
+void LtcDevice::applyRequest(qint64 nowNs, qint64 queuedFrames)
+{
+    const quint32 seq = requestSeq.load();
+    if ((seq & 1) || seq == appliedRequest.load(std::memory_order_relaxed)) return;
+    const qint64 timecodeMs = requestMs.load();
+    const qint64 timeNs = requestNs.load();
+    if (requestSeq.load() != seq) return; // Written again meanwhile, taken at the next read
+
+    const qint64 heardNs = nowNs + queuedFrames * 1000000000LL / format.sampleRate();
+    encoder.locate(timecodeMs + (heardNs - timeNs + NS_PER_MS / 2) / NS_PER_MS);
+    // Published with the state of this read
+    const quint32 state = stateSeq.load(std::memory_order_relaxed);
+    stateSeq = state + 1;
+    appliedRequest = seq;
+    stateSeq = state + 2;
+}
+
+LtcOutput::LtcOutput(QObject *parent, Clock *clock)
+    : QObject(parent), clock(clock), ltcDevice(new LtcDevice(clock, this))
+{
+}
+
+LtcOutput::~LtcOutput()
+{
+    stop();
+}
+
+void LtcOutput::setDevice(const QString &id, int ltcChannel)
+{
+    if (id == deviceId && ltcChannel == channel) return;
+    stop(); // The cue starts it again on the new device with its next frame
+    deviceId = id;
+    channel = qMax(0, ltcChannel);
+}
+
+bool LtcOutput::isEnabled() const
+{
+    return !deviceId.isEmpty();
+}
+
+bool LtcOutput::start(const framerate_t &rate, quint32 userBits, qint64 timecodeMs)
+{
+    stop();
+    if (deviceId.isEmpty()) return false;
+    QAudioDevice device;
+    for (const QAudioDevice &output : QMediaDevices::audioOutputs())
+    {
+        if (QString::fromUtf8(output.id()) == deviceId)
+            device = output;
+    }
+    if (device.isNull())
+    {
+        emit failed("LTC output device not found");
+        return false;
+    }
+    const QAudioFormat format = device.preferredFormat();
+    if (channel >= format.channelCount())
+    {
+        emit failed(QString("LTC output has no channel %1").arg(channel + 1));
+        return false;
+    }
+
+    ltcDevice->configure(format, channel, rate, userBits);
+    ltcDevice->setBufferFrames(format.framesForDuration(LTC_OUTPUT_BUFFER_MS * 1000));
+    setRate(rate);
+    integralPpm = 0;
+    relocate(timecodeMs); // Taken by the first read
+    sink = new QAudioSink(device, format, this);
+    sink->setBufferSize(format.bytesForDuration(LTC_OUTPUT_BUFFER_MS * 1000));
+    ltcDevice->open(QIODevice::ReadOnly);
+    sink->start(ltcDevice);
+    if (sink->error() != QAudio::NoError)
+    {
+        stop();
+        emit failed("Can't open the LTC output");
+        return false;
+    }
+    // The backend may have chosen another size
+    ltcDevice->setBufferFrames(sink->bufferSize() / format.bytesPerFrame());
+    active = true;
+    return true;
+}
+
+void LtcOutput::stop()
+{
+    active = false;
+    if (sink)
+    {
+        sink->stop();
+        delete sink;
+        sink = nullptr;
+    }
+    ltcDevice->close();
+}
+
+bool LtcOutput::isActive() const
+{
+    return active;
+}
+
+void LtcOutput::follow(qint64 timecodeMs)
+{
+    if (!active) return;
+    double ltcMs;
+    qint64 heardNs;
+    if (!ltcDevice->snapshot(ltcMs, heardNs)) return; // A locate is on its way to the device
+
+    // LTC heard now, extrapolated from the last read with the trimmed speed
+    lastErrorMs = ltcMs + (clock->nowNs() - heardNs) / 1e6 * (1 + ppm / 1e6) - timecodeMs * timecodeScale;
+    if (std::fabs(lastErrorMs) > LTC_LOCK_RELOCATE_FRAMES * frameMs)
+    {
+        relocate(timecodeMs);
+        return;
+    }
+    integralPpm = qBound<double>(-LTC_LOCK_MAX_PPM, integralPpm - lastErrorMs * LTC_LOCK_GAIN_I, LTC_LOCK_MAX_PPM);
+    ppm = qRound(qBound<double>(-LTC_LOCK_MAX_PPM, integralPpm - lastErrorMs * LTC_LOCK_GAIN_P, LTC_LOCK_MAX_PPM));
+    ltcDevice->setSpeedPpm(ppm);
+}
+
+void LtcOutput::startDevice(const QAudioFormat &format, int ltcChannel, const framerate_t &rate, quint32 userBits,
+                            qint64 timecodeMs, qint64 bufferFrames)
+{
+    stop();
+    channel = ltcChannel;
+    ltcDevice->configure(format, channel, rate, userBits);
+    ltcDevice->setBufferFrames(bufferFrames);
+    setRate(rate);
+    integralPpm = 0;
+    relocate(timecodeMs);
+    ltcDevice->open(QIODevice::ReadOnly);
+    active = true;
+}
+
+LtcDevice *LtcOutput::device()
+{
+    return ltcDevice;
+}
+
+double LtcOutput::errorMs() const
+{
+    return lastErrorMs;
+}
+
+int LtcOutput::speedPpm() const
+{
+    return ppm;
+}
+
+int LtcOutput::relocations() const
+{
+    return relocates;
+}
+
+// Art-Net counts frames of the playhead at framerate_t::fps, the encoder at
+// the exact rate: 29.97 against 30000/1001 would drift a frame in ten hours
+void LtcOutput::setRate(const framerate_t &rate)
+{
+    frameMs = 1000.0 * rate.rateDen / rate.rateNum;
+    timecodeScale = rate.fps * rate.rateDen / rate.rateNum;
+}
+
+// A jump, the drift of the two clocks learned so far stays in the integral
+void LtcOutput::relocate(qint64 timecodeMs)
+{
+    ltcDevice->requestLocate(qRound64(timecodeMs * timecodeScale), clock->nowNs());
+    ppm = qRound(integralPpm);
+    ltcDevice->setSpeedPpm(ppm);
+    lastErrorMs = 0;
+    ++relocates;
+}
@@ -0,0 +1,124 @@
+#ifndef LTCOUTPUT_H
+#define LTCOUTPUT_H
+
+#include <QObject>
+#include <QIODevice>
+#include <QAudioFormat>
+#include <atomic>
+#include "ltc.h"
+#include "clock.h"
+
+class QAudioSink;
+
+#define LTC_OUTPUT_BLOCK_FRAMES 512   // Frames rendered at a time in the audio callback
+#define LTC_OUTPUT_BUFFER_MS 40       // Sink buffer, the lock compensates its latency
+#define LTC_LOCK_RELOCATE_FRAMES 1.0  // Larger errors jump the LTC instead of slewing it
+#define LTC_LOCK_GAIN_P 300           // Speed trim in ppm per ms of error
+#define LTC_LOCK_GAIN_I 3             // Added to the integral per ms of error and playhead update
+#define LTC_LOCK_MAX_PPM 2000         // Far inside the speed range LTC readers accept
+
+// Pull device of the LTC sink. readData() runs in the audio thread: it
+// renders into a preallocated block, takes the locate requests and the
+// speed trim from atomics and publishes what it rendered the same way, so
+// it never allocates, locks or waits for the GUI thread.
+class LtcDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit LtcDevice(Clock *clock = Clock::system(), QObject *parent = nullptr);
+
+    // Before open(), the LTC goes to one channel, the others are silent
+    void configure(const QAudioFormat &format, int channel, const framerate_t &rate, quint32 userBits);
+    void setBufferFrames(qint64 frames); // Queued in the sink after a read, its latency
+
+    // Playhead timecode at a clock time, applied at the next read
+    void requestLocate(qint64 timecodeMs, qint64 timeNs);
+    void setSpeedPpm(int ppm);
+    // Timecode heard at heardNs, false until the last locate request is rendered
+    bool snapshot(double &timecodeMs, qint64 &heardNs) const;
+
+    bool isSequential() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    Clock *clock;
+    LtcEncoder encoder;
+    QAudioFormat format;
+    int channel = 0;
+    int bytesPerSample = 2;
+    int bytesPerFrame = 2;
+    float block[LTC_OUTPUT_BLOCK_FRAMES];
+    std::atomic<qint64> bufferFrames{0};
+
+    // Locate request of the GUI thread, the sequence is odd while it's written
+    std::atomic<quint32> requestSeq{0};
+    std::atomic<qint64> requestMs{0};
+    std::atomic<qint64> requestNs{0};
+    std::atomic<int> speedPpm{0};
+    int appliedPpm = 0;
+
+    // State of the audio thread, the same way
+    std::atomic<quint32> stateSeq{0};
+    std::atomic<quint32> appliedRequest{0};
+    std::atomic<qint64> stateTimecodeNs{0}; // Timecode of the next sample, in ns
+    std::atomic<qint64> stateHeardNs{0};    // Clock time it's heard
+
+    void applyRequest(qint64 nowNs, qint64 queuedFrames);
+};
+
+// Live LTC on a dedicated audio output. The cue playhead that drives the
+// Art-Net timecode is followed with every frame it sends: small errors,
+// the two audio clocks drifting apart, are slewed away with a speed trim
+// of the encoder, a locate or a start jumps the LTC to the playhead.
+class LtcOutput : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LtcOutput(QObject *parent = nullptr, Clock *clock = Clock::system());
+    ~LtcOutput();
+
+    void setDevice(const QString &deviceId, int channel); // Empty id = no LTC output
+    bool isEnabled() const;
+
+    bool start(const framerate_t &rate, quint32 userBits, qint64 timecodeMs); // Opens the sink at the playhead
+    void stop();
+    bool isActive() const;
+    void follow(qint64 timecodeMs); // Playhead of the cue, in ms of timecode
+
+    // Offline tools read device() themselves, bufferFrames models the sink
+    void startDevice(const QAudioFormat &format, int channel, const framerate_t &rate, quint32 userBits,
+                     qint64 timecodeMs, qint64 bufferFrames);
+    LtcDevice *device();
+
+    // State of the lock
+    double errorMs() const; // LTC heard minus the playhead at the last follow()
+    int speedPpm() const;
+    int relocations() const;
+
+signals:
+    void failed(const QString &msg);
+
+private:
+    Clock *clock;
+    LtcDevice *ltcDevice;
+    QAudioSink *sink = nullptr;
+    QString deviceId;
+    int channel = 0;
+    bool active = false;
+    double frameMs = 1000.0 / 30;
+    double timecodeScale = 1; // Playhead ms to ms of the LTC rate
+    double integralPpm = 0;
+    int ppm = 0;
+    double lastErrorMs = 0;
+    int relocates = 0;
+
+    void setRate(const framerate_t &rate);
+    void relocate(qint64 timecodeMs);
+};
+
+#endif // LTCOUTPUT_H
@@ -1,13 +1,18 @@
 #include "mainwindow.h"
+#include "cli.h"
+#include "trace.h"
+#include "startup.h"
 
 #include <QApplication>
 #include <QStyleFactory>
+#include <QTimer>
 
 // Function to load and apply QSS
 void applyStyleSheet(QApplication &app, const QString &path) {
     QFile file(path);
     if (file.open(QFile::ReadOnly)) {
         QString styleSheet = QLatin1String(file.readAll());
+        TRACE_SCOPE("ui", "QApplication::setStyleSheet");
         app.setStyleSheet(styleSheet);
         file.close();
     } else {
@@ -17,14 +22,23 @@ void applyStyleSheet(QApplication &app, const QString &path) {
 
 int main(int argc, char *argv[])
 {
+    startupBegin();
+    // Command line tools run without the GUI
+    int cliResult = runCli(argc, argv);
+    if (cliResult >= 0)
+        return cliResult;
+
     QApplication a(argc, argv);
+    // Style before the widgets, a later change polishes every widget again
+    qApp->setStyle(QStyleFactory::create("Fusion"));
+    startupMark("application");
 
     MainWindow w;
 
     w.setWindowTitle("Art-Net Timecode Player 2");
 
-    qApp->setStyle(QStyleFactory::create("Fusion"));
-
     w.show();
+    startupMark("show");
+    QTimer::singleShot(0, &w, &MainWindow::startupFinished);
     return a.exec();
 }
@@ -1,24 +1,108 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include <QDateTime>
+#include <cmath>
+#include "startup.h"
 
 #define TIMER_INTERVAL_MS 800
 #define STATUSBAR_MSG_TIMEOUT_MS 1500
 #define ICON_SIZE 36
+#define MEDIA_CACHE_FILE "media.cache"
+#define SHOW_LOG_DIR "showlogs"
+#define JOURNAL_COMPACT_RECORDS 1000 // Rewrite the playlist file when the journal grows longer
+#define TRACE_DIR "traces"
+#define DRIFT_LOG_INTERVAL_MS 10000
+#define REDUNDANCY_SEEK_MS 40         // Backup cue further off than this is moved to the primary playhead
+#define REDUNDANCY_SEEK_HOLD_MS 500   // Time for the player to report the new position after a seek
+#define REDUNDANCY_PULL_MS 2000.0     // Smaller errors are pulled in by the rate within about this time
+#define REDUNDANCY_MAX_TRIM 0.02
+#define REDUNDANCY_TRIM_STEP 0.0005
+
+#ifdef ANET_TRACE
+// Events of the last seconds of every thread, returns the file name or an empty string
+static QString saveTrace()
+{
+    const QString fileName = QString("%1/trace-%2.json").arg(TRACE_DIR, QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"));
+    return Trace::writeChromeJson(fileName) ? fileName : QString();
+}
+#endif
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
-    // Settings window
-    settingsForm = new Settings(this);
-    settingsForm->setWindowTitle("Art-Net Timecode Player 2 Settings");
-    // Send artnet tc to the network
+    startupMark("ui");
+    // Send artnet tc to the network, bound to the interface the monitor follows
+    interfaceMonitor = new InterfaceMonitor(this);
+    connect(interfaceMonitor, &InterfaceMonitor::sendMsg, this, &MainWindow::on_msgReceived);
+    interfaceMonitor->start();
     anet = new ArtNetSender(this);
-    // Show audio and anet tc window
-    tcwindow = new TCwindow(this);
+    anet->setInterfaceMonitor(interfaceMonitor);
     // Save/load playlists, common settings
     fileManager= new FileManager(this);
+    // Check the cue files in background, known files come from the cache beside config.ini
+    mediaCache = new MediaCache();
+    mediaCache->load(MEDIA_CACHE_FILE);
+    mediaProber = new MediaProber(this);
+    mediaProber->setCache(mediaCache);
+    mediaWatcher = new MediaWatcher(this);
+    ltcExporter = new LtcExporter(this);
+    ltcOutput = new LtcOutput(this);
+    // Every cue edit goes to the journal of the opened playlist
+    journal = new PlaylistJournal(this);
+    journal->setPlaylistWriter([this](const QString &fileName, const playlist_t &playlist) {
+        return fileManager->writePlaylist(fileName, playlist);
+    });
+    startupMark("media cache");
+
+    // Record the show from the start, one log file per run
+    recorder = new ShowRecorder(this);
+    connect(recorder, &ShowRecorder::sendMsg, this, &MainWindow::on_msgReceived);
+    recorder->start(SHOW_LOG_DIR);
+    anet->setRecorder(recorder);
+
+    // Remote control, the port comes with the settings
+    oscServer = new OscServer(this);
+    connect(oscServer, &OscServer::sendMsg, this, &MainWindow::on_msgReceived);
+    connect(oscServer, &OscServer::commandsPending, this, &MainWindow::onOscCommands);
+    // The control servers listen on the Art-Net interface, they follow its address
+    connect(interfaceMonitor, &InterfaceMonitor::interfacesChanged, this, &MainWindow::startOsc);
+    // Remote timecode displays, the server runs in its own thread
+    displayServer = new DisplayServer(this);
+    connect(displayServer, &DisplayServer::sendMsg, this, &MainWindow::on_msgReceived);
+    // Hot standby, the role comes with the settings
+    redundancy = new RedundancyLink(this);
+    connect(redundancy, &RedundancyLink::sendMsg, this, &MainWindow::on_msgReceived);
+    connect(redundancy, &RedundancyLink::heartbeatsPending, this, &MainWindow::onRedundancyHeartbeats);
+    connect(redundancy, &RedundancyLink::primaryLost, this, &MainWindow::onPrimaryLost);
+    connect(redundancy, &RedundancyLink::primaryBack, this, &MainWindow::onPrimaryBack);
+    // Synced GOs of several players, the role comes with the settings
+    clockSync = new ClockSync(this);
+    connect(clockSync, &ClockSync::sendMsg, this, &MainWindow::on_msgReceived);
+    connect(clockSync, &ClockSync::goPending, this, &MainWindow::onSyncGo);
+    connect(interfaceMonitor, &InterfaceMonitor::interfacesChanged, this, &MainWindow::startClockSync);
+    // Free-running timecode, started from the Generator menu
+    generator = new TimecodeGenerator(this);
+    connect(generator, &TimecodeGenerator::frameChanged, this, &MainWindow::onGeneratorFrame);
+    connect(generator, &TimecodeGenerator::finished, this, [this]() {
+        msgBuffer.append("Generator stopped at " + generator->frameText(generator->frame()));
+    });
+    // Slider drags go through the scrub engine
+    scrub = new ScrubEngine(this);
+    connect(scrub, &ScrubEngine::seekRequested, this, &MainWindow::onScrubSeek);
+    connect(scrub, &ScrubEngine::locateRequested, this, &MainWindow::onScrubLocate);
+    connect(scrub, &ScrubEngine::scrubbingChanged, this, [this](bool scrubbing) {
+        if (scrubButton) scrubButton->setScrubbing(scrubbing);
+    });
+#ifdef ANET_TRACE
+    // Trace of the hot paths, also saved on exit
+    ui->menuFile->addAction("Save Trace", this, [this]() {
+        const QString fileName = saveTrace();
+        msgBuffer.append(fileName.isEmpty() ? "Can't save the trace" : "Trace saved: " + fileName);
+    });
+#endif
+    startupMark("services");
 
     // Load icons on the buttons
     QPixmap pixmap;
@@ -42,22 +126,71 @@ MainWindow::MainWindow(QWidget *parent)
     // Poll the buffer and display messages in the StatusBar
     pollingTimer = new QTimer(this);
     connect(pollingTimer, &QTimer::timeout, this, &MainWindow::checkMsgBuffer);
+    connect(pollingTimer, &QTimer::timeout, this, &MainWindow::updateStreamStats);
+    connect(pollingTimer, &QTimer::timeout, this, &MainWindow::updateDrift);
+    driftLogTimer.start();
     pollingTimer->start(TIMER_INTERVAL_MS);
 
-    // Get data from the settings form
-    connect(settingsForm, &Settings::settingsData, this, &MainWindow::onSettingsData);
     // Track slider movement by the user
     connect(ui->horizontalSliderPlayTime, &QSlider::sliderMoved, this, &MainWindow::onSliderMoved);
+    connect(ui->horizontalSliderPlayTime, &QSlider::sliderPressed, this, &MainWindow::onSliderPressed);
+    connect(ui->horizontalSliderPlayTime, &QSlider::sliderReleased, this, &MainWindow::onSliderReleased);
     // Get text from the ArtNetSender class
     connect(anet, &ArtNetSender::sendMsg, this, &MainWindow::on_msgReceived);
-    // Send timecode to the tcWindow
-    connect(this, &MainWindow::tcSignal, tcwindow, &TCwindow::onTcReceived);
+    // Get text from the FileManager class
+    connect(fileManager, &FileManager::sendMsg, this, &MainWindow::on_msgReceived);
+    // Get text from the playlist journal
+    connect(journal, &PlaylistJournal::sendMsg, this, &MainWindow::on_msgReceived);
+    connect(journal, &PlaylistJournal::compacted, this, [this](bool ok) {
+        if (!ok)
+            msgBuffer.append("ERROR! Failed to write the playlist, edits are kept in the journal");
+    });
+    // Stream the file check results into the cue grid
+    connect(mediaProber, &MediaProber::mediaProbed, this, &MainWindow::onMediaProbed);
+    connect(mediaProber, &MediaProber::probeFinished, this, [this](int total, int failed) {
+        if (failed > 0)
+            msgBuffer.append(QString("WARNING! %1 of %2 media files are missing or broken").arg(failed).arg(total));
+        else
+            msgBuffer.append(QString("Media check: %1 files OK").arg(total));
+        mediaCache->save();
+    });
+    connect(ltcExporter, &LtcExporter::cueExported, this, [this](const QString &outputPath, bool ok, const QString &error) {
+        msgBuffer.append(ok ? "LTC exported: " + outputPath : "ERROR! " + error);
+    });
+    connect(ltcExporter, &LtcExporter::exportFinished, this, [this](int total, int failed) {
+        if (failed > 0)
+            msgBuffer.append(QString("WARNING! LTC export: %1 of %2 cues failed").arg(failed).arg(total));
+        else
+            msgBuffer.append(QString("LTC export: %1 cues written").arg(total));
+    });
+    connect(ltcOutput, &LtcOutput::failed, this, [this](const QString &msg) {
+        msgBuffer.append("ERROR! " + msg);
+    });
+    // Cue files changed on disk
+    connect(mediaWatcher, &MediaWatcher::fileChanged, this, &MainWindow::onMediaFileChanged);
+    // Transport bar follows the selected deck
+    connect(ui->comboBox_Deck, &QComboBox::currentIndexChanged, this, &MainWindow::onDeckSelected);
     // Load configuration file config.ini
     loadSettingsFromFile();
+    startupMark("config and cues");
 }
 
 MainWindow::~MainWindow()
 {
+    closePlaylist();
+    oscServer->stop();
+    displayServer->stop();
+    redundancy->stop();
+    clockSync->stop();
+    interfaceMonitor->stop();
+    anet->setRecorder(nullptr);
+    recorder->stop();
+    delete mediaProber; // Wait for the probe threads before the cache they use is deleted
+    mediaCache->save();
+    delete mediaCache;
+#ifdef ANET_TRACE
+    saveTrace();
+#endif
     delete ui;
 }
 
@@ -72,6 +205,9 @@ void MainWindow::createButtons(const uint8_t &rows, const uint8_t &columns, cons
         connectCues(button);
     }
 
+    gridRows = rows;
+    gridColumns = columns;
+
     // Clear the layout and add buttons to the new grid
     QLayoutItem *item;
     while ((item = gridLayout->takeAt(0)) != nullptr) {
@@ -84,47 +220,70 @@ void MainWindow::createButtons(const uint8_t &rows, const uint8_t &columns, cons
         int col = i % columns;
         gridLayout->addWidget(buttons[i], row, col);
         buttons[i]->show();
-        // In the future, each button might have its own framerate (this might not be necessary)
-        // Now, the framerate is the same for all buttons
-        buttons[i]->setFrameRate(framerate);
+        // The framerate is a property of the cue, the settings only give the rate of empty cues
+        if (buttons[i]->getFilePath().isEmpty())
+            buttons[i]->setFrameRate(framerate);
     }
 }
 
 void MainWindow::onPlaybackStarted(CueButton *button)
 {
-    if (currentPlayingButton != nullptr && currentPlayingButton != button) {
-        currentPlayingButton->stopPlayback(); // Stop the previous button
+    // Only the cue playing on the same deck is stopped, other decks keep playing
+    const int deck = deckOf(button);
+    CueButton *previous = playingButtons[deck];
+    if (previous != nullptr && previous != button) {
+        previous->stopPlayback(); // Stop the previous button
     }
-    currentPlayingButton = button; // Assign the new button before playback
+    releaseButton(button); // The cue could play on another deck before
+    playingButtons[deck] = button; // Assign the new button before playback
+    if (generator->isRunning() && generatorDeck == deck)
+        generator->stop(); // The cue takes the deck
 }
 
-void MainWindow::updatePlayingTime(const QString &audioTime, const QString &tcTime, const int &sliderTimeValue)
+void MainWindow::updatePlayingTime(CueButton *button, const QString &audioTime, const QString &tcTime, const int &sliderTimeValue)
 {
-    ui->labelAudioTime->setText(audioTime); // Update the playback time
+    const int deck = deckOf(button);
+    if ((anet)&&(isTC)&&(!redundancy->isStandby()))
+    {
+        // A failed send is reported by the sender, only a missing destination stops the cue
+        if (!anet->sendTime(tcTime, deck) && !anet->hasDestination(deck))
+        {
+            msgBuffer.append("Invalid ArtNet initialization parameters.");
+            button->stopPlayback();
+            return;
+        }
+    }
+    followLtc(button);
+    if (redundancy->getRole() == REDUNDANCY_PRIMARY)
+    {
+        const QStringList parts = tcTime.split(':');
+        if (parts.size() == 5)
+        {
+            const framerate_t *rate = frameRateOfTimebase(parts[4].toInt());
+            sentFrames[deck] = {static_cast<uint8_t>(parts[0].toInt()), static_cast<uint8_t>(parts[1].toInt()),
+                                static_cast<uint8_t>(parts[2].toInt()), static_cast<uint8_t>(parts[3].toInt()),
+                                static_cast<uint8_t>(rate ? rate->artnetType : 3)};
+        }
+        publishHeartbeat(button, HEARTBEAT_PLAYING);
+    }
+
+    if (deck != selectedDeck) return; // Other decks play without the transport bar
+
     ui->horizontalSliderPlayTime->setValue(sliderTimeValue); // Update the slider
+    showDeckTime(audioTime, tcTime);
+}
+
+void MainWindow::showDeckTime(const QString &audioTime, const QString &tcTime)
+{
+    ui->labelAudioTime->setText(audioTime); // Update the playback time
     QString nofpstc = "00:00:00:00"; // Set default timecode
     QString currentFPS = "00ndf";
 
     if (isTC){
         nofpstc = tcTime.left(tcTime.lastIndexOf(':')); // delete fps val from tc
-        int fpsVal = tcTime.mid(tcTime.lastIndexOf(':') + 1).toInt();
-        switch (fpsVal) {
-        case 24:
-            currentFPS = "24ndf";
-            break;
-        case 25:
-            currentFPS = "25ndf";
-            break;
-        case 30:
-            currentFPS = "30ndf";
-            break;
-        case 29:
-            currentFPS = "29.97df";
-            break;
-        default:
-            currentFPS = "00ndf";
-            break;
-        }
+        // Rate of the deck's cue, the cues of a show can run at different rates
+        const framerate_t *rate = frameRateOfTimebase(tcTime.mid(tcTime.lastIndexOf(':') + 1).toInt());
+        currentFPS = rate ? rate->label : "00ndf";
     }
 
     if (tcwindow && tcwindow->isVisible()) {
@@ -133,21 +292,71 @@ void MainWindow::updatePlayingTime(const QString &audioTime, const QString &tcTi
 
     ui->labelTcTime->setText(nofpstc);
     ui->label_fps->setText(currentFPS);
+    displayServer->publish(nofpstc, currentFPS, displayCue, displayState);
+}
 
-    //if (!isTC) return;  // If TC sending is off exit
+// The LTC goes with the Art-Net of the cue, the last started LTC cue takes the output
+void MainWindow::followLtc(CueButton *button)
+{
+    const bool wanted = button->getLtcOutput() && button->isPlaying() && ltcOutput->isEnabled() && !redundancy->isStandby();
+    if (!wanted)
+    {
+        if (button == ltcButton) stopLtc();
+        return;
+    }
+    const qint64 timecodeMs = button->getPlayhead() + button->getAdjustmentTime();
+    if (button != ltcButton)
+    {
+        // A failed start is tried again with the next GO
+        ltcButton = button;
+        ltcOutput->start(frameRateOf(button->getFrameRate()), LtcExporter::cueUserBits(buttons.indexOf(button) + 1), timecodeMs);
+        return;
+    }
+    ltcOutput->follow(timecodeMs);
+}
 
-    if ((anet)&&(isTC))
+void MainWindow::stopLtc()
+{
+    ltcOutput->stop();
+    ltcButton = nullptr;
+}
+
+void MainWindow::startOsc()
+{
+    if (currentSettings.oscPort == 0)
     {
-        if (!anet->sendTime(tcTime))
-        {
-            msgBuffer.append("Invalid ArtNet initialization parameters.");
-            currentPlayingButton->stopPlayback();
-        }
+        oscServer->stop();
+        return;
+    }
+    QList<QHostAddress> senders;
+    for (const QString &sender : currentSettings.oscSenders.split(',', Qt::SkipEmptyParts))
+    {
+        const QHostAddress address(sender.trimmed());
+        if (address.isNull())
+            msgBuffer.append("WARNING! Invalid OSC sender address: " + sender.trimmed());
+        else
+            senders.append(address);
     }
+    oscServer->start(currentSettings.oscPort, interfaceMonitor->ipv4Address(currentSettings.slectedInterfaceName), senders);
+}
+
+// Restarted only when the settings or the interface address changed, a running sync keeps its estimate
+void MainWindow::startClockSync()
+{
+    const QHostAddress address = interfaceMonitor->ipv4Address(currentSettings.slectedInterfaceName);
+    const QString syncConfig = QString("%1 %2 %3 %4").arg(currentSettings.syncRole).arg(currentSettings.syncMaster)
+                                   .arg(currentSettings.syncPort).arg(address.toString());
+    if (syncConfig == clockSyncConfig) return;
+    clockSyncConfig = syncConfig;
+    clockSync->start(static_cast<sync_role_t>(currentSettings.syncRole), currentSettings.syncMaster,
+                     currentSettings.syncPort, address);
 }
 
 void MainWindow::onSettingsData(const settings_t &sett)
 {
+    currentSettings = sett;
+    if (journal->isOpen() && (sett.rows != gridRows || sett.columns != gridColumns))
+        journal->appendGrid(sett.rows, sett.columns);
     adjustButtonCount(sett.rows, sett.columns);
     createButtons(sett.rows, sett.columns, sett.fps);
     if (anet)
@@ -158,11 +367,41 @@ void MainWindow::onSettingsData(const settings_t &sett)
         msgBuffer.append("Settings applyed");
     }
     isTC = sett.tcOut;
+    defaultFrameRate = sett.fps;
+    startOsc();
+    if (sett.displayPort > 0)
+    {
+        const QHostAddress displayAddress(sett.displayAddress);
+        if (displayAddress.isNull())
+            msgBuffer.append("WARNING! Invalid timecode display address: " + sett.displayAddress);
+        displayServer->start(sett.displayPort, displayAddress.isNull() ? QHostAddress(DISPLAY_DEFAULT_ADDRESS) : displayAddress);
+    }
+    else
+        displayServer->stop();
+    // Restarted only when changed, a backup that took over keeps the show
+    const QString config = QString("%1 %2 %3").arg(sett.redundancyRole).arg(sett.redundancyPeer).arg(sett.redundancyPort);
+    if (config != redundancyConfig)
+    {
+        redundancyConfig = config;
+        redundancy->start(static_cast<redundancy_role_t>(sett.redundancyRole), sett.redundancyPeer, sett.redundancyPort);
+    }
+    startClockSync();
+    ltcOutput->setDevice(sett.ltcDevice, sett.ltcChannel);
+    if (!ltcOutput->isActive())
+        ltcButton = nullptr; // The playing cue starts it on the new device
 }
 
 
 void MainWindow::on_actionSettings_triggered()
 {
+    if (!settingsForm) // Created when it's opened first, not at the start
+    {
+        settingsForm = new Settings(this);
+        // Get data from the settings form
+        connect(settingsForm, &Settings::settingsData, this, &MainWindow::onSettingsData);
+    }
+    settingsForm->setInterfaces(interfaceMonitor->interfaceNames());
+    settingsForm->setSettings(currentSettings);
     settingsForm->setWindowTitle("Settings Art-Net Timecode Player 2");
     settingsForm->show();
 }
@@ -173,64 +412,131 @@ void MainWindow::adjustButtonCount(const uint8_t &rows, const uint8_t &columns)
     int requiredButtons = rows * columns;
     while (buttons.size() > requiredButtons) {
         CueButton *button = buttons.takeLast();
+        releaseButton(button);
+        oscGoPending.remove(button);
+        if (button == scrubButton) cancelScrub();
+        if (button == ltcButton) stopLtc();
         delete button;
     }
 }
 
 void MainWindow::onSliderMoved(int position)
 {
-    if (currentPlayingButton) {
+    if (scrubButton) {
         // Convert the slider value from the range [0, 1000] to milliseconds
-        qint64 newPosition = (position * currentPlayingButton->getDuration()) / 1000;
-        currentPlayingButton->setPlaybackPosition(newPosition);
+        scrub->move((position * scrubButton->getDuration()) / 1000);
     }
 }
 
+// The drag stays on the cue it started with
+void MainWindow::onSliderPressed()
+{
+    scrubButton = selectedButton();
+    if (scrubButton)
+        scrub->press((ui->horizontalSliderPlayTime->value() * scrubButton->getDuration()) / 1000);
+}
+
+void MainWindow::onSliderReleased()
+{
+    if (scrubButton)
+        scrub->release((ui->horizontalSliderPlayTime->value() * scrubButton->getDuration()) / 1000);
+    scrubButton = nullptr;
+}
+
+// The dragged cue is deleted, the rest of the drag goes nowhere
+void MainWindow::cancelScrub()
+{
+    scrubButton = nullptr;
+    scrub->cancel();
+}
+
+void MainWindow::onScrubSeek(qint64 positionMs, bool exact)
+{
+    if (!scrubButton) return;
+    if (exact)
+        scrubButton->setPlaybackPosition(positionMs);
+    else
+        scrubButton->scrubTo(positionMs, ui->actionScrub_Audio->isChecked());
+}
+
+// Timecode of the slider, the cue itself sends none while it's dragged
+void MainWindow::onScrubLocate(qint64 positionMs)
+{
+    if (!scrubButton) return;
+    const int deck = deckOf(scrubButton);
+    const QString tcTime = scrubButton->timecodeAt(positionMs);
+    if (anet && isTC && !redundancy->isStandby())
+        anet->sendTime(tcTime, deck);
+    if (deck == selectedDeck)
+        showDeckTime(scrubButton->audioTimeAt(positionMs), tcTime);
+}
+
 void MainWindow::on_pushButton_Play_clicked()
 {
-    if (currentPlayingButton){
-        currentPlayingButton->startPlayback();
+    if (selectedButton()){
+        selectedButton()->startPlayback();
     }
 }
 
 void MainWindow::on_pushButton_Stop_clicked()
 {
-    if (currentPlayingButton){
-        currentPlayingButton->stopPlayback();
+    if (selectedButton()){
+        selectedButton()->stopPlayback();
         this->setUiDefaults();
     }
 }
 
 void MainWindow::on_pushButton_Pause_clicked()
 {
-    if (currentPlayingButton)
-        currentPlayingButton->pausePlayback();
+    if (selectedButton())
+        selectedButton()->pausePlayback();
 }
 
 // Load playlist with file selection
 void MainWindow::on_actionOpen_triggered()
 {
-    this->clearCues();
-    QPair<int, int> matrix = fileManager->loadPlaylist(buttons, gridLayout, this);
-    if (matrix.first != -1 && matrix.second != -1) {
-        for (int i = 0; i < buttons.size(); ++i)
-        {
-            connectCues(buttons[i]);
-            int row = i / matrix.first;
-            int col = i % matrix.second;
-            gridLayout->addWidget(buttons[i], row, col);
-        }
-        this->setUiDefaults();
+    playlist_t playlist;
+    QString fileName;
+    if (fileManager->loadPlaylist(playlist, &fileName)) {
+        closePlaylist();
+        // Edits that weren't compacted into the file before a crash
+        int recovered = PlaylistJournal::replay(fileName, playlist);
+        applyPlaylist(playlist);
+        journal->open(fileName);
         msgBuffer.append("Playlist loaded successfully");
+        if (recovered > 0)
+            msgBuffer.append(QString("Recovered %1 unsaved edits from the journal").arg(recovered));
     } else {
         msgBuffer.append("Failed to load playlist");
     }
 }
 
-// Save playlist with file selection
+// Edits are already in the journal, save only syncs it and compacts a long journal
 void MainWindow::on_actionSave_triggered()
 {
-    if (fileManager->savePlaylist(buttons, gridLayout)){
+    if (!journal->isOpen()) {
+        on_actionSave_As_triggered();
+        return;
+    }
+
+    if (!journal->flush()) {
+        msgBuffer.append("Failed to save playlist");
+        return;
+    }
+    if (journal->recordCount() >= JOURNAL_COMPACT_RECORDS)
+        journal->compact(currentPlaylist());
+    msgBuffer.append("Playlist saved successfully");
+}
+
+// Save playlist with file selection
+void MainWindow::on_actionSave_As_triggered()
+{
+    QString fileName;
+    if (fileManager->savePlaylist(buttons, gridLayout, &fileName)){
+        closePlaylist();
+        // The new file holds everything, journals of an older show with the same name are stale
+        PlaylistJournal::removeFiles(fileName);
+        journal->open(fileName);
         msgBuffer.append("Playlist saved successfully");
     } else {
        msgBuffer.append("Failed to save playlist");
@@ -240,14 +546,20 @@ void MainWindow::on_actionSave_triggered()
 void MainWindow::loadSettingsFromFile()
 {
     // Read parameters from the file if they exist, otherwise use default values
+    QVector<deck_t> loadedDecks;
     settings_t loadedSettings;
-    fileManager->loadSettings("config.ini", loadedSettings);
+    fileManager->loadConfig("config.ini", loadedSettings, loadedDecks);
+    // Decks first, the cues created by the settings need their names
+    applyDecks(loadedDecks);
     this->onSettingsData(loadedSettings);
 }
 
 void MainWindow::clearCues()
 {
-    currentPlayingButton = nullptr;
+    playingButtons.fill(nullptr);
+    oscGoPending.clear();
+    stopLtc();
+    cancelScrub();
     this->setUiDefaults();
     // Clear the layout and remove the buttons
     QLayoutItem *item;
@@ -261,6 +573,177 @@ void MainWindow::clearCues()
     buttons.clear();
 }
 
+void MainWindow::applyPlaylist(const playlist_t &playlist)
+{
+    for (CueButton *button : playingButtons) {
+        if (button)
+            button->stopPlayback();
+    }
+    playingButtons.fill(nullptr);
+    this->setUiDefaults();
+
+    // Existing cues are reused, only the difference in the grid size is created or deleted
+    adjustButtonCount(playlist.rows, playlist.columns);
+    createButtons(playlist.rows, playlist.columns, defaultFrameRate);
+
+    for (int i = 0; i < buttons.size(); ++i)
+    {
+        if (i < playlist.cues.size())
+            buttons[i]->setCue(playlist.cues[i]);
+        else
+            buttons[i]->resetCue();
+        if (buttons[i]->getFilePath().isEmpty())
+            buttons[i]->setFrameRate(defaultFrameRate); // Loaded cues keep their own rate
+    }
+
+    // The grid is shown already, the files are checked in background
+    probeCues();
+}
+
+void MainWindow::probeCues()
+{
+    mediaProber->cancel();
+    probeIndex.clear();
+    for (int i = 0; i < buttons.size(); ++i)
+    {
+        QString path = buttons[i]->getFilePath();
+        if (!path.isEmpty())
+            probeIndex[path].append(i);
+    }
+    mediaProber->probe(probeIndex.keys());
+    mediaWatcher->setFiles(probeIndex.keys());
+}
+
+void MainWindow::probeCue(CueButton *button)
+{
+    int index = buttons.indexOf(button);
+    QString path = button->getFilePath();
+    if (index == -1 || path.isEmpty()) return;
+
+    QVector<int> &indexes = probeIndex[path];
+    if (!indexes.contains(index))
+        indexes.append(index);
+    mediaProber->probe(QStringList() << path);
+    mediaWatcher->addFile(path);
+}
+
+void MainWindow::onMediaProbed(const QString &path, const media_info_t &info)
+{
+    // Cues could be cleared or changed while the file was probed
+    for (int index : probeIndex.value(path))
+    {
+        if (index < buttons.size() && buttons[index] && buttons[index]->getFilePath() == path)
+            buttons[index]->setMediaInfo(info);
+    }
+}
+
+playlist_t MainWindow::currentPlaylist() const
+{
+    playlist_t playlist;
+    playlist.rows = gridRows;
+    playlist.columns = gridColumns;
+    playlist.cues.reserve(buttons.size());
+    for (CueButton *button : buttons)
+    {
+        playlist.cues.append(button->getCue());
+    }
+    return playlist;
+}
+
+// Write the journaled edits into the playlist file and detach from it
+void MainWindow::closePlaylist()
+{
+    if (!journal->isOpen()) return;
+    if (journal->recordCount() > 0)
+        journal->compact(currentPlaylist());
+    journal->close();
+}
+
+// Only the changed file is dropped from the cache and checked again
+void MainWindow::onMediaFileChanged(const QString &path)
+{
+    mediaCache->invalidate(path);
+
+    QVector<int> &indexes = probeIndex[path];
+    indexes.clear();
+    for (int i = 0; i < buttons.size(); ++i)
+    {
+        if (buttons[i]->getFilePath() == path)
+        {
+            buttons[i]->setMediaInfo(media_info_t());
+            indexes.append(i);
+        }
+    }
+    if (indexes.isEmpty()) return;
+
+    mediaProber->probe(QStringList() << path);
+    msgBuffer.append("Media file changed: " + QFileInfo(path).fileName());
+}
+
+void MainWindow::onCueEventDue(CueButton *button, int index)
+{
+    const EventTrack &track = button->getEventTrack();
+    const cue_event_t &event = track.event(index);
+    if (event.type == CUE_EVENT_MARKER)
+    {
+        ui->label_PlayStatus->setText(event.text);
+        return;
+    }
+
+    if (redundancy->isStandby()) return; // The primary sends the events
+
+    // OSC and ArtTrigger packets are encoded when the track is set
+    const event_packet_t &packet = track.packet(index);
+    if (anet && !anet->sendPacket(packet.data, packet.host, packet.port))
+        msgBuffer.append("Failed to send cue event: " + event.text);
+}
+
+void MainWindow::onTransportChanged(CueButton *button, transport_action_t action, qint64 positionMs)
+{
+    recorder->recordTransport(action, buttons.indexOf(button), positionMs);
+    if (button == ltcButton && (action == TRANSPORT_PAUSE || action == TRANSPORT_STOP || action == TRANSPORT_END))
+        stopLtc();
+    if (action == TRANSPORT_STOP)
+        oscGoPending.remove(button); // Stopped before the audio started
+    if (redundancy->getRole() == REDUNDANCY_PRIMARY)
+    {
+        heartbeat_state_t state = HEARTBEAT_PLAYING;
+        if (action == TRANSPORT_PAUSE)
+            state = HEARTBEAT_PAUSED;
+        else if (action == TRANSPORT_STOP || action == TRANSPORT_END)
+            state = HEARTBEAT_STOPPED;
+        else if (action == TRANSPORT_LOCATE && !button->isPlaying())
+            state = HEARTBEAT_PAUSED;
+        publishHeartbeat(button, state);
+    }
+
+    if (deckOf(button) != selectedDeck) return;
+    switch (action) {
+    case TRANSPORT_GO:
+    case TRANSPORT_PLAY:
+        displayCue = QFileInfo(button->getFilePath()).completeBaseName();
+        displayState = "Playing";
+        break;
+    case TRANSPORT_PAUSE:
+        displayState = "Paused";
+        break;
+    case TRANSPORT_STOP:
+    case TRANSPORT_END:
+        displayState = "Stopped";
+        break;
+    default:
+        return;
+    }
+    displayServer->publish(ui->labelTcTime->text(), ui->label_fps->text(), displayCue, displayState);
+}
+
+void MainWindow::onCueEdited(CueButton *button, cue_field_t field)
+{
+    int index = buttons.indexOf(button);
+    if (index != -1 && journal->isOpen())
+        journal->append(field, index, button->getCue());
+}
+
 void MainWindow::connectCues(CueButton *cueBut)
 {
     // Connect signals
@@ -272,6 +755,16 @@ void MainWindow::connectCues(CueButton *cueBut)
     });
     // Delete selected cue
     connect(cueBut, &CueButton::requestClear, this, &MainWindow::onClearReceived);
+    // Check the newly selected file
+    connect(cueBut, &CueButton::fileSelected, this, &MainWindow::probeCue);
+    // Journal the user edits
+    connect(cueBut, &CueButton::cueEdited, this, &MainWindow::onCueEdited);
+    // Events of the cue track
+    connect(cueBut, &CueButton::eventDue, this, &MainWindow::onCueEventDue);
+    cueBut->setDeckNames(deckNames);
+    // Transport actions go to the show log
+    connect(cueBut, &CueButton::transportChanged, this, &MainWindow::onTransportChanged);
+    connect(cueBut, &CueButton::audioStarted, this, &MainWindow::onCueAudioStarted);
 }
 
 void MainWindow::setUiDefaults()
@@ -282,6 +775,309 @@ void MainWindow::setUiDefaults()
     ui->label_fps->setText("00ndf");
 }
 
+void MainWindow::applyDecks(const QVector<deck_t> &deckList)
+{
+    for (CueButton *button : playingButtons) {
+        if (button)
+            button->stopPlayback();
+    }
+
+    decks = deckList;
+    playingButtons.fill(nullptr, decks.size());
+    anet->setDecks(decks);
+
+    deckNames.clear();
+    for (const deck_t &deck : decks)
+        deckNames.append(deck.name);
+    for (CueButton *button : buttons)
+        button->setDeckNames(deckNames);
+
+    ui->comboBox_Deck->blockSignals(true);
+    ui->comboBox_Deck->clear();
+    ui->comboBox_Deck->addItems(deckNames);
+    ui->comboBox_Deck->blockSignals(false);
+    ui->comboBox_Deck->setVisible(decks.size() > 1);
+    selectedDeck = 0;
+}
+
+int MainWindow::deckOf(const CueButton *button) const
+{
+    // Cues of a playlist made with more decks play on the last one
+    return qBound(0, button->getDeck(), static_cast<int>(decks.size()) - 1);
+}
+
+CueButton *MainWindow::selectedButton() const
+{
+    return playingButtons.value(selectedDeck, nullptr);
+}
+
+void MainWindow::releaseButton(const CueButton *button)
+{
+    for (CueButton *&playing : playingButtons) {
+        if (playing == button)
+            playing = nullptr;
+    }
+}
+
+// Commands queued by the OSC thread, all of them are taken in one wake-up
+void MainWindow::onOscCommands()
+{
+    osc_command_t command;
+    while (oscServer->takeCommand(command))
+    {
+        CueButton *button = (command.cue >= 0 && command.cue < buttons.size()) ? buttons[command.cue] : nullptr;
+        switch (command.type) {
+        case OSC_CUE_GO:
+            if (!button || button->getFilePath().isEmpty()) break;
+            oscGoPending.insert(button, command);
+            button->click(); // Same path as the mouse
+            break;
+        case OSC_CUE_STOP:
+            if (button) button->stopPlayback();
+            break;
+        case OSC_CUE_SYNC_GO:
+            if (!button || button->getFilePath().isEmpty()) break;
+            if (clockSync->getRole() == SYNC_OFF || !clockSync->isLocked())
+            {
+                msgBuffer.append("Synced GO without a locked clock sync, the cue starts now");
+                button->click();
+                break;
+            }
+            clockSync->scheduleGo(command.cue, clockSync->sharedNow()
+                                                   + qMax<qint64>(command.value > 0 ? command.value : SYNC_DEFAULT_LEAD_MS, SYNC_MIN_LEAD_MS) * 1000000LL);
+            break;
+        case OSC_TRANSPORT_PLAY:
+            on_pushButton_Play_clicked();
+            break;
+        case OSC_TRANSPORT_PAUSE:
+            on_pushButton_Pause_clicked();
+            break;
+        case OSC_TRANSPORT_STOP:
+            on_pushButton_Stop_clicked();
+            break;
+        case OSC_TRANSPORT_LOCATE:
+            if (selectedButton()) selectedButton()->locate(command.tc);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// Latency from the OSC datagram to the moving playhead, replied as /cue/N/started <microseconds>
+void MainWindow::onCueAudioStarted(CueButton *button)
+{
+    auto it = oscGoPending.find(button);
+    if (it == oscGoPending.end()) return;
+    const osc_command_t command = it.value();
+    oscGoPending.erase(it);
+
+    const qint32 latencyUs = static_cast<qint32>((ShowRecorder::now() - command.receivedNs) / 1000);
+    const QByteArray reply = EventTrack::encodeOsc(QString("/cue/%1/started").arg(command.cue + 1), latencyUs);
+    oscReplySocket.writeDatagram(reply, QHostAddress(command.senderIp), command.senderPort);
+}
+
+// Playhead of the cue for the backup, the last position report of the player with its time
+void MainWindow::publishHeartbeat(CueButton *button, heartbeat_state_t state)
+{
+    heartbeat_t heartbeat;
+    heartbeat.deck = static_cast<quint8>(deckOf(button));
+    heartbeat.state = state;
+    heartbeat.cue = buttons.indexOf(button);
+    heartbeat.sampleRate = static_cast<quint32>(qMax(0, button->getMediaInfo().sampleRate));
+    qint64 positionMs = 0;
+    qint64 timeNs = 0;
+    if (!button->getPositionReport(positionMs, timeNs))
+    {
+        positionMs = button->getPlayhead();
+        timeNs = Clock::system()->nowNs();
+    }
+    heartbeat.samplePosition = heartbeat.sampleRate > 0 ? positionMs * heartbeat.sampleRate / 1000 : positionMs;
+    heartbeat.positionNs = timeNs;
+    heartbeat.frame = sentFrames[heartbeat.deck];
+    redundancy->publish(heartbeat);
+}
+
+// Backup on standby: every deck plays the cue of the primary, muted and locked to its playhead
+void MainWindow::onRedundancyHeartbeats()
+{
+    heartbeat_t heartbeat;
+    while (redundancy->takeHeartbeat(heartbeat))
+    {
+        if (!redundancy->isStandby() || heartbeat.deck >= decks.size()) continue;
+        CueButton *current = playingButtons[heartbeat.deck];
+        CueButton *button = (heartbeat.cue >= 0 && heartbeat.cue < buttons.size()) ? buttons[heartbeat.cue] : nullptr;
+        switch (heartbeat.state) {
+        case HEARTBEAT_PLAYING:
+            if (!button || button->getFilePath().isEmpty()) break;
+            if (current == button && button->isPlaying())
+            {
+                followPrimary(button, heartbeat);
+                break;
+            }
+            button->setStandby(true);
+            redundancySeekNs[heartbeat.deck] = 0;
+            if (current == button && button->playbackState() == QMediaPlayer::PausedState)
+                button->startPlayback();
+            else
+                button->click(); // GO, the next heartbeat moves it to the primary playhead
+            break;
+        case HEARTBEAT_PAUSED:
+            if (current && current->isPlaying())
+                current->pausePlayback();
+            break;
+        default:
+            if (current && current->playbackState() != QMediaPlayer::StoppedState)
+                current->stopPlayback();
+            break;
+        }
+    }
+}
+
+void MainWindow::followPrimary(CueButton *button, const heartbeat_t &heartbeat)
+{
+    const qint64 nowNs = Clock::system()->nowNs();
+    const double target = RedundancyLink::playheadMs(heartbeat, nowNs);
+    const double errorMs = target - button->getPlayhead();
+    if (qAbs(errorMs) > REDUNDANCY_SEEK_MS)
+    {
+        qint64 &lastSeekNs = redundancySeekNs[heartbeat.deck];
+        if (nowNs - lastSeekNs < REDUNDANCY_SEEK_HOLD_MS * 1000000LL) return;
+        lastSeekNs = nowNs;
+        button->setRateTrim(1.0);
+        button->setPlaybackPosition(qRound64(target));
+        return;
+    }
+    const double trim = qBound(-REDUNDANCY_MAX_TRIM, errorMs / REDUNDANCY_PULL_MS, REDUNDANCY_MAX_TRIM);
+    button->setRateTrim(1.0 + std::round(trim / REDUNDANCY_TRIM_STEP) * REDUNDANCY_TRIM_STEP);
+}
+
+// The backup is locked to the primary, the frame at the playhead goes out at once
+void MainWindow::onPrimaryLost()
+{
+    for (CueButton *button : buttons)
+    {
+        if (button->isStandby())
+            button->setStandby(false);
+    }
+    for (CueButton *button : playingButtons)
+    {
+        if (button && button->isPlaying())
+            button->emitCurrentFrame();
+    }
+}
+
+// The primary sends again, the cues of the backup go on muted and follow its heartbeats
+void MainWindow::onPrimaryBack()
+{
+    for (CueButton *button : playingButtons)
+    {
+        if (!button) continue;
+        button->setStandby(true);
+        redundancySeekNs[deckOf(button)] = 0;
+    }
+}
+
+void MainWindow::onDeckSelected(int index)
+{
+    if (index < 0 || index >= decks.size()) return;
+    selectedDeck = index;
+    this->setUiDefaults();
+    updateStreamStats();
+}
+
+// GOs for a shared time, from this instance or another one
+void MainWindow::onSyncGo()
+{
+    sync_go_t go;
+    while (clockSync->takeGo(go))
+    {
+        if (go.cue < 0 || go.cue >= buttons.size()) continue;
+        const qint64 waitNs = clockSync->toLocal(go.sharedNs) - Clock::system()->nowNs();
+        const int timerMs = static_cast<int>(waitNs / 1000000) - SYNC_SPIN_MS;
+        if (timerMs > 0)
+            QTimer::singleShot(timerMs, Qt::PreciseTimer, this, [this, go]() { fireSyncGo(go.cue, go.sharedNs); });
+        else
+            fireSyncGo(go.cue, go.sharedNs);
+    }
+}
+
+// The timer wakes up a few ms early, the rest is a spin on the monotonic clock
+void MainWindow::fireSyncGo(int cue, qint64 sharedNs)
+{
+    if (cue < 0 || cue >= buttons.size()) return;
+    qint64 targetNs = clockSync->toLocal(sharedNs);
+    qint64 nowNs = Clock::system()->nowNs();
+    while (nowNs < targetNs)
+    {
+        nowNs = Clock::system()->nowNs();
+        if (targetNs - nowNs > 100000) targetNs = clockSync->toLocal(sharedNs); // Follow a new estimate
+    }
+    buttons[cue]->click();
+    const double lateUs = (nowNs - targetNs) / 1000.0;
+    if (lateUs > 1000)
+        msgBuffer.append(QString("WARNING! Synced GO of cue %1 %2 ms late").arg(cue + 1).arg(lateUs / 1000, 0, 'f', 1));
+}
+
+// Timing of every stream, shown in the tooltips of the deck selector and the framerate
+void MainWindow::updateStreamStats()
+{
+    QStringList lines;
+    for (int i = 0; i < decks.size(); ++i)
+    {
+        const stream_stats_t stats = anet->getStreamStats(i);
+        QString line = QString("%1 (stream %2): %3 packets").arg(decks[i].name).arg(decks[i].streamId).arg(stats.packets);
+        if (stats.packets > 1)
+            line += QString(", interval %1 ms (max %2), jitter max %3 ms, send delay max %4 ms")
+                        .arg(stats.meanIntervalMs, 0, 'f', 2)
+                        .arg(stats.maxIntervalMs, 0, 'f', 2)
+                        .arg(stats.maxJitterMs, 0, 'f', 2)
+                        .arg(stats.maxLatencyMs, 0, 'f', 2);
+        lines.append(line);
+    }
+    if (clockSync->getRole() == SYNC_CLIENT)
+    {
+        const sync_stats_t sync = clockSync->getStats();
+        lines.append(QString("Clock sync: %1, offset %2 us, jitter %3 us, path delay %4 us, drift %5 ppm")
+                         .arg(sync.locked ? "locked" : "unlocked")
+                         .arg(sync.offsetUs, 0, 'f', 1).arg(sync.jitterUs, 0, 'f', 1)
+                         .arg(sync.pathDelayUs, 0, 'f', 1).arg(sync.driftPpm, 0, 'f', 2));
+    }
+    ui->comboBox_Deck->setToolTip(lines.join('\n'));
+    ui->label_fps->setToolTip(lines.value(selectedDeck));
+}
+
+void MainWindow::updateDrift()
+{
+    const bool logNow = driftLogTimer.hasExpired(DRIFT_LOG_INTERVAL_MS);
+    if (logNow)
+        driftLogTimer.restart();
+
+    QString text;
+    QString toolTip = "Timecode against the audio clock of the playing cue";
+    for (int deck = 0; deck < playingButtons.size(); ++deck)
+    {
+        CueButton *button = playingButtons[deck];
+        if (button == nullptr) continue;
+        const drift_stats_t stats = button->getDrift().stats();
+        if (stats.edges == 0) continue;
+
+        if (logNow)
+            recorder->recordDrift(buttons.indexOf(button), stats.offsetMs, stats.driftPpm);
+        if (deck != selectedDeck) continue;
+
+        text = QString::asprintf("%+.2f ms  %+.1f ppm", stats.offsetMs, stats.driftPpm);
+        toolTip = QString::asprintf("Offset %+.3f ms, jitter %.3f ms (last %d frames)\n"
+                                    "Range %+.3f .. %+.3f ms over %.0f s\n"
+                                    "Drift %+.2f ppm, audio clock %+.1f ppm against the system clock",
+                                    stats.offsetMs, stats.jitterMs, DRIFT_OFFSET_WINDOW,
+                                    stats.minOffsetMs, stats.maxOffsetMs, stats.elapsedS,
+                                    stats.driftPpm, stats.audioClockPpm);
+    }
+    ui->label_drift->setText(text);
+    ui->label_drift->setToolTip(toolTip);
+}
+
 void MainWindow::on_actionExit_triggered()
 {
     this->close();
@@ -289,10 +1085,34 @@ void MainWindow::on_actionExit_triggered()
 
 void MainWindow::on_actionClear_Cues_triggered()
 {
+    // Start a new show, the edits of the opened playlist are written to its file
+    closePlaylist();
     clearCues();
     loadSettingsFromFile();
 }
 
+// LTC track of every cue into a folder, the cues are rendered in parallel
+void MainWindow::on_actionExport_LTC_triggered()
+{
+    if (ltcExporter->isBusy())
+    {
+        msgBuffer.append("LTC export is already running");
+        return;
+    }
+    const QVector<ltc_export_job_t> jobs = LtcExporter::jobsFor(currentPlaylist().cues, QString(), false);
+    if (jobs.isEmpty())
+    {
+        msgBuffer.append("No cues to export LTC for");
+        return;
+    }
+    const QString dir = QFileDialog::getExistingDirectory(this, "Export LTC To");
+    if (dir.isEmpty()) return;
+    const bool interleave = QMessageBox::question(this, "Export LTC",
+        "Copy the audio of WAV cues into the files, with the LTC as the last channel?") == QMessageBox::Yes;
+    ltcExporter->exportCues(LtcExporter::jobsFor(currentPlaylist().cues, dir, interleave));
+    msgBuffer.append(QString("Exporting LTC of %1 cues...").arg(jobs.size()));
+}
+
 void MainWindow::on_msgReceived(const QString &msg)
 {
     qDebug() << msg;
@@ -309,10 +1129,98 @@ void MainWindow::checkMsgBuffer()
 
 void MainWindow::on_actionTimeCode_Window_triggered()
 {
-    if (tcwindow) {
-        tcwindow->setWindowTitle("Art-Net Timecode Player 2");
-        tcwindow->show();
+    if (!tcwindow) { // Created when it's opened first, not at the start
+        tcwindow = new TCwindow(this);
+        // Send timecode to the tcWindow
+        connect(this, &MainWindow::tcSignal, tcwindow, &TCwindow::onTcReceived);
     }
+    tcwindow->setWindowTitle("Art-Net Timecode Player 2");
+    tcwindow->show();
+}
+
+bool MainWindow::askTimecode(const QString &title, const QString &label, timecode_t &tc)
+{
+    bool ok;
+    const QString input = QInputDialog::getText(this, title, label, QLineEdit::Normal,
+                                                generator->frameText(generator->frame()).left(11), &ok);
+    if (!ok) return false;
+    static QRegularExpression regex("^(\\d{2}):(\\d{2}):(\\d{2}):(\\d{2})$");
+    const QRegularExpressionMatch match = regex.match(input);
+    if (!match.hasMatch() || match.captured(1).toInt() > 23 || match.captured(2).toInt() > 59 || match.captured(3).toInt() > 59)
+    {
+        QMessageBox::warning(this, "Invalid Input", "Please enter a valid time format (hh:mm:ss:ff).");
+        return false;
+    }
+    tc.hh = match.captured(1).toInt();
+    tc.mm = match.captured(2).toInt();
+    tc.ss = match.captured(3).toInt();
+    tc.ff = match.captured(4).toInt();
+    return true;
+}
+
+// The generator takes the selected deck, a cue playing there is stopped
+void MainWindow::on_actionGenerator_Start_triggered()
+{
+    if (generator->isRunning()) return;
+    generatorDeck = selectedDeck;
+    if (playingButtons[generatorDeck])
+        playingButtons[generatorDeck]->stopPlayback();
+    generator->setFrameRate(defaultFrameRate);
+    generator->start();
+    msgBuffer.append(QString("Generator running on %1 at %2 fps").arg(decks[generatorDeck].name, defaultFrameRate));
+}
+
+void MainWindow::on_actionGenerator_Stop_triggered()
+{
+    generator->stop();
+}
+
+void MainWindow::on_actionGenerator_Run_For_triggered()
+{
+    timecode_t duration = {};
+    if (!askTimecode("Run For", "Duration (hh:mm:ss:ff):", duration)) return;
+    if (!generator->isRunning())
+        on_actionGenerator_Start_triggered();
+    duration.fps = static_cast<uint8_t>(generator->getFrameRate());
+    TCconverter converter;
+    generator->runFor(converter.tc2milliseconds(duration));
+}
+
+void MainWindow::on_actionGenerator_Locate_triggered()
+{
+    timecode_t tc = {};
+    if (askTimecode("Locate", "Generator timecode (hh:mm:ss:ff):", tc))
+        generator->locate(tc);
+}
+
+void MainWindow::on_actionGenerator_Start_Timecode_triggered()
+{
+    timecode_t tc = {};
+    if (!askTimecode("Start Timecode", "Generator starts at (hh:mm:ss:ff):", tc)) return;
+    generator->setStartTimecode(tc);
+    if (!generator->isRunning())
+        generator->locate(tc);
+}
+
+void MainWindow::onGeneratorFrame(const QString &tcTime)
+{
+    if (isTC && !redundancy->isStandby() && !anet->sendTime(tcTime, generatorDeck) && !anet->hasDestination(generatorDeck))
+    {
+        msgBuffer.append("Invalid ArtNet initialization parameters.");
+        generator->stop();
+        return;
+    }
+    if (generatorDeck == selectedDeck)
+        showDeckTime(tcTime.left(tcTime.lastIndexOf(':')), tcTime);
+}
+
+// The event loop runs, the window can be used
+void MainWindow::startupFinished()
+{
+    startupMark("first event");
+    const QString report = startupReport();
+    // In the message log with the rest of the show, a slow start as a warning
+    on_msgReceived(startupElapsedMs() > STARTUP_TARGET_MS ? "WARNING! Slow start. " + report : report);
 }
 
 
@@ -326,8 +1234,10 @@ void MainWindow::on_actionAbout_triggered()
 void MainWindow::onClearReceived(CueButton *button)
 {
     if (!button) return;
-    currentPlayingButton = nullptr;
-    this->setUiDefaults();
+    if (button == selectedButton())
+        this->setUiDefaults();
+    releaseButton(button);
+    oscGoPending.remove(button);
 
     // Find the index of the button to be removed in the buttons array
     int index = buttons.indexOf(button);
@@ -336,12 +1246,18 @@ void MainWindow::onClearReceived(CueButton *button)
         return;
     }
 
+    if (journal->isOpen())
+        journal->append(CUE_FIELD_CLEAR, index, cue_t());
+
     buttons[index]->stopPlayback();
+    if (buttons[index] == scrubButton) cancelScrub();
+    if (buttons[index] == ltcButton) stopLtc();
     buttons[index]->deleteLater(); // Remove the old button
     buttons[index] = nullptr; // Clear the pointer for safety
 
     // Create a new empty button and add it in place of the removed one
     auto *newButton = new CueButton(this);
+    newButton->setFrameRate(defaultFrameRate);
     buttons[index] = newButton;
     // Connect all necessary signals for the new button
     connectCues(newButton);
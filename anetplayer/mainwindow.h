@@ -12,6 +12,20 @@
 #include "tcwindow.h"
 #include "about.h"
 #include "filemanager.h"
+#include "mediaprober.h"
+#include "mediacache.h"
+#include "playlistjournal.h"
+#include "mediawatcher.h"
+#include "showrecorder.h"
+#include "oscserver.h"
+#include "displayserver.h"
+#include "redundancylink.h"
+#include "clocksync.h"
+#include "tcgenerator.h"
+#include "scrubengine.h"
+#include "ltcexporter.h"
+#include "ltcoutput.h"
+#include <QUdpSocket>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -24,49 +38,129 @@ class MainWindow : public QMainWindow
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
+    void startupFinished(); // Called from the event loop after show()
 
 private slots:
     void onPlaybackStarted(CueButton *button);
-    void updatePlayingTime(const QString &audioTime, const QString &tcTime, const int &sliderTimeValue);
+    void updatePlayingTime(CueButton *button, const QString &audioTime, const QString &tcTime, const int &sliderTimeValue);
     void onSettingsData(const settings_t &sett);
+    void startOsc(); // With the port, interface and senders of the settings
+    void startClockSync(); // With the role, master, port and interface of the settings
     void on_actionSettings_triggered();
     void onSliderMoved(int position);
+    void onSliderPressed();
+    void onSliderReleased();
+    void onScrubSeek(qint64 positionMs, bool exact);
+    void onScrubLocate(qint64 positionMs);
     void on_pushButton_Play_clicked();
     void on_pushButton_Stop_clicked();
     void on_pushButton_Pause_clicked();
     void on_actionOpen_triggered();
     void on_actionSave_triggered();
+    void on_actionSave_As_triggered();
     void on_actionExit_triggered();
     void on_actionClear_Cues_triggered();
+    void on_actionExport_LTC_triggered();
     void on_msgReceived(const QString &msg);    // Slot for receiving errors and other text from other classes
     void checkMsgBuffer();     // Slot for checking the buffer
     void on_actionTimeCode_Window_triggered();
     void on_actionAbout_triggered();
+    void on_actionGenerator_Start_triggered();
+    void on_actionGenerator_Stop_triggered();
+    void on_actionGenerator_Run_For_triggered();
+    void on_actionGenerator_Locate_triggered();
+    void on_actionGenerator_Start_Timecode_triggered();
+    void onGeneratorFrame(const QString &tcTime);
     void onClearReceived(CueButton *button);
+    void onMediaProbed(const QString &path, const media_info_t &info);
+    void onCueEdited(CueButton *button, cue_field_t field);
+    void onMediaFileChanged(const QString &path);
+    void onCueEventDue(CueButton *button, int index);
+    void onTransportChanged(CueButton *button, transport_action_t action, qint64 positionMs);
+    void onDeckSelected(int index);
+    void onOscCommands();
+    void onCueAudioStarted(CueButton *button);
+    void updateStreamStats();
+    void updateDrift();
+    void onRedundancyHeartbeats();
+    void onPrimaryLost();
+    void onPrimaryBack();
+    void onSyncGo();
 
 private:
     Ui::MainWindow *ui;
     QGridLayout *gridLayout; // Layout for the buttons
     QVector<CueButton*> buttons; // Vector for storing all created buttons
-    CueButton *currentPlayingButton = nullptr;
+    QVector<CueButton*> playingButtons; // Playing cue of every deck
+    QVector<deck_t> decks;
+    QStringList deckNames;
+    int selectedDeck = 0; // Deck shown and controlled by the transport bar
 
-    Settings *settingsForm;  // Settings window
+    Settings *settingsForm = nullptr;  // Settings window, created when opened first
+    settings_t currentSettings; // Config read once at startup, updated by the settings window
     ArtNetSender *anet;     // Sending timecode and network interface settings
+    InterfaceMonitor *interfaceMonitor; // Interfaces and addresses, followed by the sender
 
     QTimer *pollingTimer;     // Timer for polling
     QStringList msgBuffer;    // Buffer for text messages
 
-    TCwindow *tcwindow;  // Timecode output window
+    TCwindow *tcwindow = nullptr;  // Timecode output window, created when opened first
 
     bool isTC = true; // Timecode output to the network
+    QString defaultFrameRate = "30"; // Framerate for the new cues
     FileManager *fileManager; // Load save common settings, playlists
+    MediaProber *mediaProber; // Background check of the cue files
+    MediaCache *mediaCache; // Persistent file metadata, shared by the cues and the prober
+    PlaylistJournal *journal; // Edits of the opened playlist, saved continuously
+    int gridRows = 0;
+    int gridColumns = 0;
+    QHash<QString, QVector<int>> probeIndex; // File path -> indexes of the cues waiting for the probe result
+    MediaWatcher *mediaWatcher; // Re-probes cue files replaced on disk
+    ShowRecorder *recorder; // Log of the sent timecode and the transport actions
+    OscServer *oscServer; // Remote cue control
+    QUdpSocket oscReplySocket;
+    QHash<CueButton*, osc_command_t> oscGoPending; // Cues started by OSC, waiting for the audio
+    DisplayServer *displayServer; // Timecode page for browsers
+    QString displayCue;   // Cue and transport state of the selected deck, shown on the page
+    QString displayState;
+    QElapsedTimer driftLogTimer; // Drift of the playing cues goes to the show log periodically
+    RedundancyLink *redundancy; // Hot standby with a second player
+    QString redundancyConfig; // Role, peer and port the link runs with
+    timecode_t sentFrames[MAX_DECKS] = {}; // Last timecode of every deck, goes with the heartbeats
+    qint64 redundancySeekNs[MAX_DECKS] = {}; // Last seek of a backup cue to the primary
+    ClockSync *clockSync; // Shared time of several players for synced GOs
+    QString clockSyncConfig; // Role, master, port and interface address the sync runs with
+    TimecodeGenerator *generator; // Timecode without audio
+    int generatorDeck = 0; // Deck the generator sends on, the selected one at its start
+    ScrubEngine *scrub; // Coalesced seeks of the position slider
+    CueButton *scrubButton = nullptr; // Cue under the slider while it's dragged
+    LtcExporter *ltcExporter; // LTC tracks of the cues, rendered in background
+    LtcOutput *ltcOutput; // Live LTC of the playing cue on an audio output
+    CueButton *ltcButton = nullptr; // Cue the LTC output follows
 
     void createButtons(const uint8_t &rows, const uint8_t &columns, const QString &framerate); // create Cues
     void adjustButtonCount(const uint8_t &rows, const uint8_t &columns);
     void loadSettingsFromFile();
     void clearCues();
+    void applyPlaylist(const playlist_t &playlist);
+    playlist_t currentPlaylist() const;
+    void closePlaylist();
+    void fireSyncGo(int cue, qint64 sharedNs);
+    void showDeckTime(const QString &audioTime, const QString &tcTime); // Selected deck on the transport bar
+    void followLtc(CueButton *button); // With every frame the cue sends
+    void stopLtc();
+    void cancelScrub();
+    bool askTimecode(const QString &title, const QString &label, timecode_t &tc);
+    void probeCues();
+    void probeCue(CueButton *button);
     void connectCues(CueButton *cueBut);  // Button event tracking
     void setUiDefaults();
+    void applyDecks(const QVector<deck_t> &deckList);
+    int deckOf(const CueButton *button) const;
+    CueButton *selectedButton() const;
+    void releaseButton(const CueButton *button); // Forget a cue that is deleted or replaced
+    void publishHeartbeat(CueButton *button, heartbeat_state_t state);
+    void followPrimary(CueButton *button, const heartbeat_t &heartbeat);
 
 
 signals:
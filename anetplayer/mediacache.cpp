@@ -0,0 +1,184 @@
+#include "mediacache.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QtEndian>
+#include <cstring>
+
+#define CACHE_MAGIC "ANMC"
+#define CACHE_VERSION 1
+#define CACHE_HEADER_SIZE 32
+#define CACHE_RECORD_SIZE 216
+#define CACHE_HASH_SIZE 20
+
+// Header:  magic[4] version:u32 count:u32 recordSize:u32 stringsOffset:u64 stringsSize:u64
+// Record:  fileSize:u64 modified:i64 sampleFrames:i64 durationMs:i64
+//          pathOffset:u32 pathLength:u32 formatOffset:u32 formatLength:u32
+//          sampleRate:u32 channelMask:u32 channels:u16 status:u8 hasLevels:u8
+//          rmsDb:f32 peakDb:f32 hash[20] peaks[128]
+// All values are little-endian, strings are offsets into the string table
+
+MediaCache::MediaCache() {}
+
+bool MediaCache::load(const QString &fileName)
+{
+    QWriteLocker locker(&lock);
+    cacheFileName = fileName;
+    entries.clear();
+    dirty = false;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < CACHE_HEADER_SIZE) return false;
+
+    const uchar *data = file.map(0, file.size());
+    if (!data) return false;
+
+    const qint64 fileSize = file.size();
+    quint32 count = qFromLittleEndian<quint32>(data + 8);
+    quint32 recordSize = qFromLittleEndian<quint32>(data + 12);
+    quint64 stringsOffset = qFromLittleEndian<quint64>(data + 16);
+    quint64 stringsSize = qFromLittleEndian<quint64>(data + 24);
+
+    if (memcmp(data, CACHE_MAGIC, 4) != 0
+        || qFromLittleEndian<quint32>(data + 4) != CACHE_VERSION
+        || recordSize != CACHE_RECORD_SIZE
+        || CACHE_HEADER_SIZE + quint64(count) * recordSize > stringsOffset
+        || stringsOffset + stringsSize > quint64(fileSize))
+    {
+        file.unmap(const_cast<uchar*>(data));
+        return false;
+    }
+
+    const char *strings = reinterpret_cast<const char*>(data + stringsOffset);
+    auto string = [&](quint32 offset, quint32 length) {
+        if (quint64(offset) + length > stringsSize) return QString();
+        return QString::fromUtf8(strings + offset, length);
+    };
+
+    entries.reserve(count);
+    for (quint32 i = 0; i < count; ++i)
+    {
+        const uchar *r = data + CACHE_HEADER_SIZE + quint64(i) * recordSize;
+        media_info_t info;
+        info.fileSize = qFromLittleEndian<quint64>(r);
+        info.modified = qFromLittleEndian<qint64>(r + 8);
+        info.sampleFrames = qFromLittleEndian<qint64>(r + 16);
+        info.durationMs = qFromLittleEndian<qint64>(r + 24);
+        QString path = string(qFromLittleEndian<quint32>(r + 32), qFromLittleEndian<quint32>(r + 36));
+        info.format = string(qFromLittleEndian<quint32>(r + 40), qFromLittleEndian<quint32>(r + 44));
+        info.sampleRate = qFromLittleEndian<quint32>(r + 48);
+        info.channelMask = qFromLittleEndian<quint32>(r + 52);
+        info.channels = qFromLittleEndian<quint16>(r + 56);
+        info.status = static_cast<media_status_t>(r[58]);
+        info.hasLevels = r[59] != 0;
+        info.rmsDb = qFromLittleEndian<float>(r + 60);
+        info.peakDb = qFromLittleEndian<float>(r + 64);
+        info.hash = QByteArray(reinterpret_cast<const char*>(r + 68), CACHE_HASH_SIZE);
+        if (info.hasLevels)
+            info.peaks = QByteArray(reinterpret_cast<const char*>(r + 68 + CACHE_HASH_SIZE), MEDIA_PEAK_BINS);
+        if (!path.isEmpty())
+            entries.insert(path, info);
+    }
+
+    file.unmap(const_cast<uchar*>(data));
+    return true;
+}
+
+bool MediaCache::save()
+{
+    QWriteLocker locker(&lock);
+    if (!dirty || cacheFileName.isEmpty()) return true;
+
+    QByteArray records(entries.size() * CACHE_RECORD_SIZE, 0);
+    QByteArray strings;
+    QHash<QString, quint32> formatOffsets; // Format names are shared by many records
+
+    uchar *r = reinterpret_cast<uchar*>(records.data());
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it, r += CACHE_RECORD_SIZE)
+    {
+        const media_info_t &info = it.value();
+
+        QByteArray path = it.key().toUtf8();
+        quint32 pathOffset = strings.size();
+        strings.append(path);
+
+        QByteArray format = info.format.toUtf8();
+        if (!formatOffsets.contains(info.format))
+        {
+            formatOffsets.insert(info.format, strings.size());
+            strings.append(format);
+        }
+
+        qToLittleEndian<quint64>(info.fileSize, r);
+        qToLittleEndian<qint64>(info.modified, r + 8);
+        qToLittleEndian<qint64>(info.sampleFrames, r + 16);
+        qToLittleEndian<qint64>(info.durationMs, r + 24);
+        qToLittleEndian<quint32>(pathOffset, r + 32);
+        qToLittleEndian<quint32>(path.size(), r + 36);
+        qToLittleEndian<quint32>(formatOffsets.value(info.format), r + 40);
+        qToLittleEndian<quint32>(format.size(), r + 44);
+        qToLittleEndian<quint32>(info.sampleRate, r + 48);
+        qToLittleEndian<quint32>(info.channelMask, r + 52);
+        qToLittleEndian<quint16>(info.channels, r + 56);
+        r[58] = static_cast<uchar>(info.status);
+        r[59] = info.hasLevels ? 1 : 0;
+        qToLittleEndian<float>(info.rmsDb, r + 60);
+        qToLittleEndian<float>(info.peakDb, r + 64);
+        memcpy(r + 68, info.hash.constData(), qMin<int>(info.hash.size(), CACHE_HASH_SIZE));
+        memcpy(r + 68 + CACHE_HASH_SIZE, info.peaks.constData(), qMin<int>(info.peaks.size(), MEDIA_PEAK_BINS));
+    }
+
+    uchar header[CACHE_HEADER_SIZE];
+    memcpy(header, CACHE_MAGIC, 4);
+    qToLittleEndian<quint32>(CACHE_VERSION, header + 4);
+    qToLittleEndian<quint32>(entries.size(), header + 8);
+    qToLittleEndian<quint32>(CACHE_RECORD_SIZE, header + 12);
+    qToLittleEndian<quint64>(CACHE_HEADER_SIZE + records.size(), header + 16);
+    qToLittleEndian<quint64>(strings.size(), header + 24);
+
+    QSaveFile file(cacheFileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(reinterpret_cast<const char*>(header), CACHE_HEADER_SIZE);
+    file.write(records);
+    file.write(strings);
+    if (!file.commit()) return false;
+
+    dirty = false;
+    return true;
+}
+
+bool MediaCache::lookup(const QString &path, media_info_t &info) const
+{
+    QFileInfo fileInfo(path);
+    if (!fileInfo.exists()) return false;
+
+    QReadLocker locker(&lock);
+    auto it = entries.constFind(path);
+    if (it == entries.constEnd()) return false;
+    if (it->fileSize != fileInfo.size() || it->modified != fileInfo.lastModified().toMSecsSinceEpoch())
+        return false;
+
+    info = it.value();
+    return true;
+}
+
+void MediaCache::insert(const QString &path, const media_info_t &info)
+{
+    QWriteLocker locker(&lock);
+    entries.insert(path, info);
+    dirty = true;
+}
+
+void MediaCache::invalidate(const QString &path)
+{
+    QWriteLocker locker(&lock);
+    if (entries.remove(path) > 0)
+        dirty = true;
+}
+
+int MediaCache::size() const
+{
+    QReadLocker locker(&lock);
+    return entries.size();
+}
@@ -0,0 +1,34 @@
+#ifndef MEDIACACHE_H
+#define MEDIACACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QReadWriteLock>
+#include "struct.h"
+
+// Persistent media metadata, keyed by file path and validated by file size and
+// modification time. The file is a header, an array of fixed size records and
+// a UTF-8 string table, so it's read straight from the memory mapping.
+// Thread safe, the probe threads read and fill it.
+class MediaCache
+{
+
+public:
+    MediaCache();
+
+    bool load(const QString &fileName);
+    bool save();
+
+    bool lookup(const QString &path, media_info_t &info) const; // Stats the file, false if the entry is stale
+    void insert(const QString &path, const media_info_t &info);
+    void invalidate(const QString &path);
+    int size() const;
+
+private:
+    mutable QReadWriteLock lock;
+    QHash<QString, media_info_t> entries;
+    QString cacheFileName;
+    bool dirty = false;
+};
+
+#endif // MEDIACACHE_H
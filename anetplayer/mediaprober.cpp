@@ -0,0 +1,497 @@
+#include "mediaprober.h"
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QtEndian>
+#include <cstring>
+#include <cmath>
+#include "trace.h"
+
+#define PROBE_HEADER_SIZE 64
+#define MP3_SYNC_SEARCH_BYTES 65536
+#define OGG_HEAD_BYTES 512
+#define OGG_TAIL_BYTES 65536
+#define PCM_READ_BYTES 1048576
+#define LEVEL_FLOOR_DB -120.0f
+
+typedef struct
+{
+    bool mpeg1;
+    int layer;
+    int bitrate;
+    int sampleRate;
+    int padding;
+    int channels;
+    int samplesPerFrame;
+    int frameSize;
+} mp3_header_t;
+
+// Bitrates in kbit/s
+static const int mp3Bitrates[5][16] = {
+    {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0}, // MPEG1 Layer I
+    {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},    // MPEG1 Layer II
+    {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},     // MPEG1 Layer III
+    {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0},    // MPEG2/2.5 Layer I
+    {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0}          // MPEG2/2.5 Layer II, III
+};
+
+// Index is the version bits of the header: 0 = MPEG2.5, 1 = reserved, 2 = MPEG2, 3 = MPEG1
+static const int mp3SampleRates[4][3] = {
+    {11025, 12000, 8000},
+    {0, 0, 0},
+    {22050, 24000, 16000},
+    {44100, 48000, 32000}
+};
+
+static bool parseMp3Header(const uchar *h, mp3_header_t &hdr)
+{
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) return false;
+
+    int version = (h[1] >> 3) & 0x03;
+    int layerBits = (h[1] >> 1) & 0x03; // 1 = Layer III, 2 = Layer II, 3 = Layer I
+    int bitrateIndex = h[2] >> 4;
+    int rateIndex = (h[2] >> 2) & 0x03;
+    if (version == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3)
+        return false;
+
+    hdr.mpeg1 = (version == 3);
+    hdr.layer = 4 - layerBits;
+    int table = hdr.mpeg1 ? hdr.layer - 1 : (hdr.layer == 1 ? 3 : 4);
+    hdr.bitrate = mp3Bitrates[table][bitrateIndex];
+    hdr.sampleRate = mp3SampleRates[version][rateIndex];
+    hdr.padding = (h[2] >> 1) & 0x01;
+    hdr.channels = ((h[3] >> 6) == 3) ? 1 : 2;
+
+    if (hdr.layer == 1)
+    {
+        hdr.samplesPerFrame = 384;
+        hdr.frameSize = (12 * hdr.bitrate * 1000 / hdr.sampleRate + hdr.padding) * 4;
+    }
+    else
+    {
+        hdr.samplesPerFrame = (hdr.layer == 3 && !hdr.mpeg1) ? 576 : 1152;
+        hdr.frameSize = hdr.samplesPerFrame / 8 * hdr.bitrate * 1000 / hdr.sampleRate + hdr.padding;
+    }
+    return hdr.frameSize > 4;
+}
+
+// Normalized value of one little-endian PCM sample
+// Sample in a container of bytesPerSample, the valid bits are the top ones
+static inline float pcmSample(const uchar *p, int bytesPerSample, int bits, bool isFloat)
+{
+    if (isFloat)
+        return qFromLittleEndian<float>(p);
+    qint32 v;
+    switch (bytesPerSample) {
+    case 1:
+        v = static_cast<qint32>(quint32(p[0] ^ 0x80) << 24); // 8 bit is unsigned
+        break;
+    case 2:
+        v = static_cast<qint32>(quint32(qFromLittleEndian<quint16>(p)) << 16);
+        break;
+    case 3:
+        v = static_cast<qint32>(quint32(p[2]) << 24 | quint32(p[1]) << 16 | quint32(p[0]) << 8);
+        break;
+    default:
+        v = qFromLittleEndian<qint32>(p);
+        break;
+    }
+    return (v >> (32 - bits)) / static_cast<float>(1u << (bits - 1));
+}
+
+static inline float level2db(double level)
+{
+    if (level <= 0) return LEVEL_FLOOR_DB;
+    return qMax(LEVEL_FLOOR_DB, static_cast<float>(20.0 * std::log10(level)));
+}
+
+MediaProber::MediaProber(QObject *parent)
+    : QObject(parent)
+{
+}
+
+MediaProber::~MediaProber()
+{
+    pool.clear();
+    pool.waitForDone();
+}
+
+void MediaProber::probe(const QStringList &paths)
+{
+    const int gen = generation;
+    for (const QString &path : paths)
+    {
+        ++total;
+        ++pending;
+        pool.start([this, gen, path]() {
+            // Known unchanged files are taken from the cache without touching the content
+            media_info_t info;
+            if (!cache || !cache->lookup(path, info))
+            {
+                info = probeFile(path);
+                if (cache && info.status != MEDIA_MISSING)
+                    cache->insert(path, info);
+            }
+            // Deliver the result in the thread of the prober
+            QMetaObject::invokeMethod(this, [this, gen, path, info]() {
+                if (gen != generation) return;
+                if (info.status == MEDIA_MISSING || info.status == MEDIA_BROKEN) ++failed;
+                emit mediaProbed(path, info);
+                if (--pending == 0)
+                {
+                    emit probeFinished(total, failed);
+                    total = 0;
+                    failed = 0;
+                }
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void MediaProber::cancel()
+{
+    ++generation;
+    pool.clear(); // Remove the probes that haven't started yet
+    total = 0;
+    pending = 0;
+    failed = 0;
+}
+
+bool MediaProber::isBusy() const
+{
+    return pending > 0;
+}
+
+void MediaProber::setCache(MediaCache *mediaCache)
+{
+    cache = mediaCache;
+}
+
+media_info_t MediaProber::probeFile(const QString &path)
+{
+    TRACE_SCOPE("media", "MediaProber::probeFile");
+    media_info_t info;
+
+    QFileInfo fileInfo(path);
+    if (!fileInfo.exists())
+    {
+        info.status = MEDIA_MISSING;
+        return info;
+    }
+    info.fileSize = fileInfo.size();
+    info.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        info.status = MEDIA_BROKEN;
+        return info;
+    }
+
+    // Skip ID3v2 tag, it may precede MP3 and FLAC streams
+    qint64 offset = 0;
+    QByteArray head = file.read(PROBE_HEADER_SIZE);
+    if (head.size() >= 10 && head.startsWith("ID3"))
+    {
+        const uchar *h = reinterpret_cast<const uchar*>(head.constData());
+        offset = 10 + ((h[6] & 0x7F) << 21 | (h[7] & 0x7F) << 14 | (h[8] & 0x7F) << 7 | (h[9] & 0x7F));
+        if (h[5] & 0x10) offset += 10; // Footer
+        file.seek(offset);
+        head = file.read(PROBE_HEADER_SIZE);
+    }
+
+    const uchar *h = reinterpret_cast<const uchar*>(head.constData());
+    bool isMp3Sync = head.size() >= 2 && h[0] == 0xFF && (h[1] & 0xE0) == 0xE0;
+    bool ok = false;
+
+    if (head.size() >= 12 && head.startsWith("RIFF") && head.mid(8, 4) == "WAVE")
+        ok = probeWav(file, info);
+    else if (head.startsWith("OggS"))
+        ok = probeOgg(file, info);
+    else if (head.startsWith("fLaC"))
+        ok = probeFlac(file, offset, info);
+    else if (isMp3Sync || fileInfo.suffix().toLower() == "mp3")
+        ok = probeMp3(file, offset, info);
+    else
+    {
+        info.status = MEDIA_UNSUPPORTED;
+        info.format = fileInfo.suffix().toUpper();
+    }
+
+    if (info.status != MEDIA_UNSUPPORTED)
+    {
+        if (ok && info.sampleRate > 0 && info.sampleFrames > 0)
+        {
+            info.status = MEDIA_OK;
+            info.durationMs = info.sampleFrames * 1000 / info.sampleRate;
+        }
+        else
+        {
+            info.status = MEDIA_BROKEN;
+            return info;
+        }
+    }
+
+    // Content hash lets the cache and the playlist tools recognise the same audio
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    file.seek(0);
+    hash.addData(&file);
+    info.hash = hash.result();
+
+    return info;
+}
+
+bool MediaProber::probeWav(QFile &file, media_info_t &info)
+{
+    info.format = "WAV";
+
+    quint16 formatTag = 0;
+    quint16 blockAlign = 0;
+    quint16 bits = 0;
+    qint64 factFrames = 0;
+    bool hasFmt = false;
+
+    file.seek(12);
+    while (!file.atEnd())
+    {
+        QByteArray chunk = file.read(8);
+        if (chunk.size() < 8) break;
+        quint32 size = qFromLittleEndian<quint32>(chunk.constData() + 4);
+        qint64 dataPos = file.pos();
+
+        if (chunk.startsWith("fmt "))
+        {
+            QByteArray fmt = file.read(qMin<quint32>(size, 40));
+            if (fmt.size() < 16) return false;
+            formatTag = qFromLittleEndian<quint16>(fmt.constData());
+            info.channels = qFromLittleEndian<quint16>(fmt.constData() + 2);
+            info.sampleRate = qFromLittleEndian<quint32>(fmt.constData() + 4);
+            blockAlign = qFromLittleEndian<quint16>(fmt.constData() + 12);
+            bits = qFromLittleEndian<quint16>(fmt.constData() + 14);
+            // WAVE_FORMAT_EXTENSIBLE: valid bits, speaker mask and the real format in the sub format GUID
+            if (formatTag == 0xFFFE && fmt.size() >= 26)
+            {
+                const quint16 validBits = qFromLittleEndian<quint16>(fmt.constData() + 18);
+                if (validBits > 0) bits = validBits;
+                info.channelMask = qFromLittleEndian<quint32>(fmt.constData() + 20);
+                formatTag = qFromLittleEndian<quint16>(fmt.constData() + 24);
+            }
+            hasFmt = true;
+        }
+        else if (chunk.startsWith("fact"))
+        {
+            QByteArray fact = file.read(4);
+            if (fact.size() == 4) factFrames = qFromLittleEndian<quint32>(fact.constData());
+        }
+        else if (chunk.startsWith("data"))
+        {
+            if (!hasFmt || blockAlign == 0) return false;
+            // 1 = PCM, 3 = IEEE float, other formats are compressed
+            if (formatTag == 1 || formatTag == 3)
+            {
+                // Truncated file: only the samples that really exist are counted
+                qint64 available = qMin<qint64>(size, file.size() - dataPos);
+                info.sampleFrames = available / blockAlign;
+                measurePcm(file, dataPos, formatTag == 3, blockAlign, bits, info);
+            }
+            else
+            {
+                info.format = "WAV (compressed)";
+                info.sampleFrames = factFrames;
+            }
+            return true;
+        }
+
+        if (!file.seek(dataPos + size + (size & 1))) break;
+    }
+    return false;
+}
+
+// RMS level, sample peak and the waveform overview of the PCM data
+void MediaProber::measurePcm(QFile &file, qint64 dataPos, bool isFloat, int blockAlign, int bits, media_info_t &info)
+{
+    const int channels = info.channels;
+    const qint64 frames = info.sampleFrames;
+    if (frames <= 0 || channels <= 0 || blockAlign % channels != 0)
+        return;
+    // The container of a sample comes from the block, the bit depth can be
+    // less (20 bits in 3 bytes, 24 in 4) and only sets the scale
+    const int bytesPerSample = blockAlign / channels;
+    if (bytesPerSample < 1 || bytesPerSample > 4 || bits < 1 || bits > bytesPerSample * 8 || (isFloat && bytesPerSample != 4))
+        return;
+
+    const qint64 chunkFrames = qMax(1, PCM_READ_BYTES / blockAlign);
+    QVector<float> binPeaks(MEDIA_PEAK_BINS, 0.0f);
+    double sumSquares = 0;
+    qint64 frame = 0;
+
+    file.seek(dataPos);
+    while (frame < frames)
+    {
+        QByteArray buf = file.read(qMin(chunkFrames, frames - frame) * blockAlign);
+        qint64 n = buf.size() / blockAlign;
+        if (n == 0) break;
+
+        const uchar *p = reinterpret_cast<const uchar*>(buf.constData());
+        for (qint64 i = 0; i < n; ++i, ++frame)
+        {
+            float &binPeak = binPeaks[frame * MEDIA_PEAK_BINS / frames];
+            for (int c = 0; c < channels; ++c, p += bytesPerSample)
+            {
+                float v = pcmSample(p, bytesPerSample, bits, isFloat);
+                sumSquares += double(v) * v;
+                binPeak = qMax(binPeak, std::fabs(v));
+            }
+        }
+    }
+    if (frame == 0) return;
+
+    float peak = 0;
+    info.peaks.resize(MEDIA_PEAK_BINS);
+    for (int i = 0; i < MEDIA_PEAK_BINS; ++i)
+    {
+        peak = qMax(peak, binPeaks[i]);
+        info.peaks[i] = static_cast<char>(qBound(0, static_cast<int>(binPeaks[i] * 255.0f + 0.5f), 255));
+    }
+
+    info.rmsDb = level2db(std::sqrt(sumSquares / (double(frame) * channels)));
+    info.peakDb = level2db(peak);
+    info.hasLevels = true;
+}
+
+bool MediaProber::probeMp3(QFile &file, qint64 offset, media_info_t &info)
+{
+    info.format = "MP3";
+
+    file.seek(offset);
+    QByteArray buf = file.read(MP3_SYNC_SEARCH_BYTES);
+    const uchar *data = reinterpret_cast<const uchar*>(buf.constData());
+    const int size = buf.size();
+
+    // Find the first frame, the sync is confirmed by the header of the next frame
+    mp3_header_t hdr;
+    mp3_header_t next;
+    int pos = -1;
+    for (int i = 0; i + 4 <= size; ++i)
+    {
+        if (!parseMp3Header(data + i, hdr)) continue;
+        int n = i + hdr.frameSize;
+        if (n + 4 <= size && !parseMp3Header(data + n, next)) continue;
+        pos = i;
+        break;
+    }
+    if (pos < 0) return false;
+
+    if (hdr.layer != 3) info.format = QString("MP%1").arg(hdr.layer);
+    info.sampleRate = hdr.sampleRate;
+    info.channels = hdr.channels;
+
+    // Xing/Info header of VBR and LAME files holds the frame count and the encoder delay/padding
+    int sideInfo = hdr.mpeg1 ? (hdr.channels == 1 ? 17 : 32) : (hdr.channels == 1 ? 9 : 17);
+    int x = pos + 4 + sideInfo;
+    if (x + 12 <= size && (memcmp(data + x, "Xing", 4) == 0 || memcmp(data + x, "Info", 4) == 0))
+    {
+        quint32 flags = qFromBigEndian<quint32>(data + x + 4);
+        if (flags & 0x01)
+        {
+            int p = x + 8;
+            qint64 frames = qFromBigEndian<quint32>(data + p);
+            p += 4;
+            if (flags & 0x02) p += 4;   // Stream size
+            if (flags & 0x04) p += 100; // TOC
+            if (flags & 0x08) p += 4;   // Quality
+            info.sampleFrames = frames * hdr.samplesPerFrame;
+
+            // LAME tag: 12-bit encoder delay and padding at offset 21
+            if (p + 24 <= size && (memcmp(data + p, "LAME", 4) == 0 || memcmp(data + p, "Lav", 3) == 0))
+            {
+                int delay = (data[p + 21] << 4) | (data[p + 22] >> 4);
+                int padding = ((data[p + 22] & 0x0F) << 8) | data[p + 23];
+                info.sampleFrames = qMax<qint64>(0, info.sampleFrames - delay - padding);
+            }
+            return true;
+        }
+    }
+
+    // VBRI header of Fraunhofer encoders is always 32 bytes after the frame header
+    int v = pos + 4 + 32;
+    if (v + 18 <= size && memcmp(data + v, "VBRI", 4) == 0)
+    {
+        info.sampleFrames = qint64(qFromBigEndian<quint32>(data + v + 14)) * hdr.samplesPerFrame;
+        return true;
+    }
+
+    // No header: walk all frames to count them exactly
+    qint64 framePos = offset + pos;
+    qint64 frames = 0;
+    uchar h[4];
+    while (file.seek(framePos) && file.read(reinterpret_cast<char*>(h), 4) == 4 && parseMp3Header(h, next))
+    {
+        ++frames;
+        framePos += next.frameSize;
+    }
+    info.sampleFrames = frames * hdr.samplesPerFrame;
+    return frames > 0;
+}
+
+bool MediaProber::probeOgg(QFile &file, media_info_t &info)
+{
+    file.seek(0);
+    QByteArray page = file.read(OGG_HEAD_BYTES);
+    if (page.size() < 28) return false;
+    const uchar *d = reinterpret_cast<const uchar*>(page.constData());
+
+    quint32 serial = qFromLittleEndian<quint32>(d + 14);
+    int packet = 27 + d[26]; // Header + segment table
+    if (packet + 19 > page.size()) return false;
+
+    qint64 preSkip = 0;
+    if (memcmp(d + packet, "\x01vorbis", 7) == 0)
+    {
+        info.format = "OGG Vorbis";
+        info.channels = d[packet + 11];
+        info.sampleRate = qFromLittleEndian<quint32>(d + packet + 12);
+    }
+    else if (memcmp(d + packet, "OpusHead", 8) == 0)
+    {
+        info.format = "OGG Opus";
+        info.channels = d[packet + 9];
+        preSkip = qFromLittleEndian<quint16>(d + packet + 10);
+        info.sampleRate = 48000; // Opus granule position always counts 48 kHz samples
+    }
+    else
+    {
+        return false;
+    }
+
+    // The granule position of the last page is the total number of samples
+    file.seek(qMax<qint64>(0, file.size() - OGG_TAIL_BYTES));
+    QByteArray tail = file.read(OGG_TAIL_BYTES);
+    const uchar *t = reinterpret_cast<const uchar*>(tail.constData());
+    for (int i = tail.size() - 27; i >= 0; --i)
+    {
+        if (memcmp(t + i, "OggS", 4) != 0) continue;
+        if (qFromLittleEndian<quint32>(t + i + 14) != serial) continue;
+        qint64 granule = qFromLittleEndian<qint64>(t + i + 6);
+        if (granule < 0) continue; // -1: no packet finishes on this page
+        info.sampleFrames = qMax<qint64>(0, granule - preSkip);
+        return true;
+    }
+    return false;
+}
+
+bool MediaProber::probeFlac(QFile &file, qint64 offset, media_info_t &info)
+{
+    file.seek(offset);
+    QByteArray head = file.read(42); // "fLaC" + block header + STREAMINFO
+    if (head.size() < 42) return false;
+    const uchar *d = reinterpret_cast<const uchar*>(head.constData());
+    if ((d[4] & 0x7F) != 0) return false; // STREAMINFO must be the first block
+
+    const uchar *s = d + 8;
+    info.format = "FLAC";
+    info.sampleRate = (s[10] << 12) | (s[11] << 4) | (s[12] >> 4);
+    info.channels = ((s[12] >> 1) & 0x07) + 1;
+    info.sampleFrames = (qint64(s[13] & 0x0F) << 32) | qFromBigEndian<quint32>(s + 14);
+    return true;
+}
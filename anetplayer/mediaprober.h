@@ -0,0 +1,49 @@
+#ifndef MEDIAPROBER_H
+#define MEDIAPROBER_H
+
+#include <QObject>
+#include <QFile>
+#include <QThreadPool>
+#include <QStringList>
+#include "struct.h"
+#include "mediacache.h"
+
+// Checks audio files in the background thread pool: existence, format,
+// sample rate, channels and exact duration. Headers are parsed directly,
+// so probing never creates a QMediaPlayer and doesn't decode audio.
+// Results are taken from and stored to the metadata cache when it's set.
+class MediaProber : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MediaProber(QObject *parent = nullptr);
+    ~MediaProber();
+
+    void probe(const QStringList &paths); // Start probing, results arrive with mediaProbed()
+    void cancel(); // Drop all pending results
+    bool isBusy() const;
+    void setCache(MediaCache *mediaCache);
+
+    static media_info_t probeFile(const QString &path); // Synchronous probe, called on the pool threads
+
+signals:
+    void mediaProbed(const QString &path, const media_info_t &info);
+    void probeFinished(int total, int failed);
+
+private:
+    QThreadPool pool;
+    MediaCache *cache = nullptr;
+    int generation = 0; // Results of the cancelled probes are ignored
+    int total = 0;
+    int pending = 0;
+    int failed = 0;
+
+    static bool probeWav(QFile &file, media_info_t &info);
+    static bool probeMp3(QFile &file, qint64 offset, media_info_t &info);
+    static bool probeOgg(QFile &file, media_info_t &info);
+    static bool probeFlac(QFile &file, qint64 offset, media_info_t &info);
+    static void measurePcm(QFile &file, qint64 dataPos, bool isFloat, int blockAlign, int bits, media_info_t &info);
+};
+
+#endif // MEDIAPROBER_H
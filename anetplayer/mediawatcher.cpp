@@ -0,0 +1,105 @@
+#include "mediawatcher.h"
+#include <QFileInfo>
+#include <QDateTime>
+
+#define WATCH_COALESCE_MS 500 // Quiet time after the last event before the files are checked
+
+MediaWatcher::MediaWatcher(QObject *parent)
+    : QObject(parent), watcher(new QFileSystemWatcher(this)), coalesceTimer(new QTimer(this))
+{
+    coalesceTimer->setSingleShot(true);
+    coalesceTimer->setInterval(WATCH_COALESCE_MS);
+
+    // Replaced files show up as directory events, files written in place as file events
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &MediaWatcher::onPathChanged);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &MediaWatcher::onPathChanged);
+    connect(coalesceTimer, &QTimer::timeout, this, &MediaWatcher::processChanges);
+}
+
+void MediaWatcher::setFiles(const QStringList &paths)
+{
+    coalesceTimer->stop();
+    dirtyDirs.clear();
+    dirFiles.clear();
+    fileStamps.clear();
+
+    QStringList watched = watcher->files() + watcher->directories();
+    if (!watched.isEmpty())
+        watcher->removePaths(watched);
+
+    QStringList files;
+    for (const QString &path : paths)
+    {
+        if (fileStamps.contains(path)) continue;
+        QString dir = QFileInfo(path).absolutePath();
+        dirFiles[dir].append(path);
+        fileStamps.insert(path, stamp(path));
+        if (QFileInfo::exists(path))
+            files.append(path);
+    }
+
+    // One call for all paths, the watcher adds them in a batch
+    QStringList dirs = dirFiles.keys();
+    if (!dirs.isEmpty())
+        watcher->addPaths(dirs);
+    if (!files.isEmpty())
+        watcher->addPaths(files);
+}
+
+void MediaWatcher::addFile(const QString &path)
+{
+    if (path.isEmpty() || fileStamps.contains(path)) return;
+
+    QString dir = QFileInfo(path).absolutePath();
+    if (!dirFiles.contains(dir))
+        watcher->addPath(dir);
+    dirFiles[dir].append(path);
+    fileStamps.insert(path, stamp(path));
+    if (QFileInfo::exists(path))
+        watcher->addPath(path);
+}
+
+void MediaWatcher::onPathChanged(const QString &path)
+{
+    if (dirFiles.contains(path))
+        dirtyDirs.insert(path);
+    else
+        dirtyDirs.insert(QFileInfo(path).absolutePath());
+    coalesceTimer->start(); // Restart, the burst is handled when it's over
+}
+
+void MediaWatcher::processChanges()
+{
+    const QSet<QString> dirs = dirtyDirs;
+    dirtyDirs.clear();
+
+    const QStringList files = watcher->files();
+    const QSet<QString> watchedFiles(files.begin(), files.end());
+    QStringList rewatch;
+    for (const QString &dir : dirs)
+    {
+        for (const QString &path : dirFiles.value(dir))
+        {
+            file_stamp_t current = stamp(path);
+            file_stamp_t &known = fileStamps[path];
+            if (current.size != known.size || current.modified != known.modified)
+            {
+                known = current;
+                emit fileChanged(path);
+            }
+            // A deleted or renamed file drops its watch, watch the replacement
+            if (current.size >= 0 && !watchedFiles.contains(path))
+                rewatch.append(path);
+        }
+    }
+    if (!rewatch.isEmpty())
+        watcher->addPaths(rewatch);
+}
+
+MediaWatcher::file_stamp_t MediaWatcher::stamp(const QString &path)
+{
+    QFileInfo info(path);
+    if (!info.exists())
+        return {-1, -1};
+    return {info.size(), info.lastModified().toMSecsSinceEpoch()};
+}
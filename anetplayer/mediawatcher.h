@@ -0,0 +1,48 @@
+#ifndef MEDIAWATCHER_H
+#define MEDIAWATCHER_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+// Watches the cue files and their directories. Bursts of change events are
+// coalesced, then only the files whose size or modification time really
+// changed are reported. The watcher is event driven (inotify on Linux),
+// so it costs nothing while the files don't change.
+class MediaWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MediaWatcher(QObject *parent = nullptr);
+
+    void setFiles(const QStringList &paths); // Replace the watched files
+    void addFile(const QString &path);
+
+signals:
+    void fileChanged(const QString &path);
+
+private slots:
+    void onPathChanged(const QString &path);
+    void processChanges();
+
+private:
+    typedef struct
+    {
+        qint64 size;
+        qint64 modified;
+    } file_stamp_t;
+
+    QFileSystemWatcher *watcher;
+    QTimer *coalesceTimer;
+    QHash<QString, QStringList> dirFiles; // Directory -> watched files in it
+    QHash<QString, file_stamp_t> fileStamps;
+    QSet<QString> dirtyDirs;
+
+    static file_stamp_t stamp(const QString &path);
+};
+
+#endif // MEDIAWATCHER_H
@@ -0,0 +1,287 @@
+#include "oscserver.h"
+#include <QUdpSocket>
+#include <QtEndian>
+#include <cstring>
+#include <future>
+#include "showrecorder.h"
+
+#define OSC_MAX_PACKET 8192
+#define OSC_POLL_MS 50      // The server thread checks the stop request this often
+#define OSC_MAX_BUNDLE_DEPTH 4
+
+static inline int oscPadded(int size)
+{
+    return (size + 4) & ~3; // String with its null terminator, padded to 4 bytes
+}
+
+// Length of the null terminated string at pos, -1 if it runs past the end
+static int oscString(const char *data, int size, int pos)
+{
+    if (pos >= size) return -1;
+    const void *end = memchr(data + pos, 0, size - pos);
+    return end ? static_cast<int>(static_cast<const char*>(end) - (data + pos)) : -1;
+}
+
+static bool matches(const char *address, int length, const char *pattern)
+{
+    const int patternLength = static_cast<int>(strlen(pattern));
+    return length == patternLength && memcmp(address, pattern, length) == 0;
+}
+
+// "hh:mm:ss:ff" without building a string
+static bool parseTimecode(const char *s, int length, timecode_t &tc)
+{
+    if (length != 11) return false;
+    int values[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        const char *p = s + i * 3;
+        if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') return false;
+        if (i < 3 && p[2] != ':') return false;
+        values[i] = (p[0] - '0') * 10 + (p[1] - '0');
+    }
+    tc.hh = values[0];
+    tc.mm = values[1];
+    tc.ss = values[2];
+    tc.ff = values[3];
+    tc.fps = 0;
+    return values[1] < 60 && values[2] < 60;
+}
+
+OscServer::OscServer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+OscServer::~OscServer()
+{
+    stop();
+}
+
+bool OscServer::start(quint16 port, const QHostAddress &address, const QList<QHostAddress> &allowedSenders)
+{
+    QVector<quint32> senders;
+    for (const QHostAddress &sender : allowedSenders)
+    {
+        if (sender.protocol() == QAbstractSocket::IPv4Protocol && !senders.contains(sender.toIPv4Address()))
+            senders.append(sender.toIPv4Address());
+    }
+    if (thread && port == listenPort && address == listenAddress && senders == allowed) return true;
+    stop();
+    if (port == 0) return false;
+    if (address.isNull())
+    {
+        emit sendMsg("OSC control is off, the Art-Net interface has no address");
+        return false;
+    }
+    if (senders.isEmpty())
+    {
+        emit sendMsg("OSC control is off, no trusted senders are set");
+        return false;
+    }
+    allowed = senders;
+    listenAddress = address;
+
+    std::promise<bool> bound;
+    std::future<bool> result = bound.get_future();
+    stopRequested = false;
+    listenPort = port;
+    thread = QThread::create([this, &bound]() {
+        QUdpSocket socket;
+        bool ok = socket.bind(listenAddress, listenPort);
+        bound.set_value(ok);
+        if (ok)
+        {
+            // Bigger kernel buffer for bursts from show control systems
+            socket.setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 1 << 18);
+            serverLoop(socket);
+        }
+    });
+    thread->setObjectName("OSC server");
+    thread->start();
+
+    if (!result.get())
+    {
+        thread->wait();
+        delete thread;
+        thread = nullptr;
+        emit sendMsg(QString("Can't open the OSC port %1 on %2").arg(port).arg(address.toString()));
+        return false;
+    }
+    emit sendMsg(QString("OSC control on %1:%2 from %3 senders").arg(address.toString()).arg(port).arg(allowed.size()));
+    return true;
+}
+
+void OscServer::stop()
+{
+    if (!thread) return;
+    stopRequested = true;
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+    listenPort = 0;
+    listenAddress = QHostAddress();
+}
+
+bool OscServer::isRunning() const
+{
+    return thread != nullptr;
+}
+
+bool OscServer::takeCommand(osc_command_t &command)
+{
+    if (queue.pop(command)) return true;
+
+    // Allow the next wake-up, a command pushed meanwhile is taken now
+    wakePending.store(false, std::memory_order_release);
+    return queue.pop(command);
+}
+
+void OscServer::serverLoop(QUdpSocket &socket)
+{
+    char buffer[OSC_MAX_PACKET];
+    while (!stopRequested.load(std::memory_order_relaxed))
+    {
+        if (!socket.waitForReadyRead(OSC_POLL_MS)) continue;
+
+        int pushed = 0;
+        while (socket.hasPendingDatagrams())
+        {
+            QHostAddress sender;
+            quint16 senderPort = 0;
+            const qint64 size = socket.readDatagram(buffer, sizeof(buffer), &sender, &senderPort);
+            const qint64 receivedNs = ShowRecorder::now();
+            if (size <= 0) continue;
+            if (!allowed.contains(sender.toIPv4Address()))
+            {
+                rejected.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            pushed += handlePacket(buffer, static_cast<int>(size), sender.toIPv4Address(), senderPort, receivedNs, 0);
+        }
+
+        if (pushed > 0 && !wakePending.exchange(true, std::memory_order_acq_rel))
+            emit commandsPending();
+
+        const quint32 lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0)
+            emit sendMsg(QString("OSC queue full, %1 commands dropped").arg(lost));
+        const quint32 untrusted = rejected.exchange(0, std::memory_order_relaxed);
+        if (untrusted > 0)
+            emit sendMsg(QString("WARNING! %1 OSC datagrams from untrusted senders ignored").arg(untrusted));
+    }
+}
+
+// Returns the number of queued commands
+int OscServer::handlePacket(const char *data, int size, quint32 senderIp, quint16 senderPort, qint64 receivedNs, int depth)
+{
+    // #bundle, time tag, then elements of size:i32 content
+    if (size >= 16 && memcmp(data, "#bundle", 8) == 0)
+    {
+        if (depth >= OSC_MAX_BUNDLE_DEPTH) return 0;
+        int pushed = 0;
+        int pos = 16;
+        while (pos + 4 <= size)
+        {
+            const qint32 elementSize = qFromBigEndian<qint32>(data + pos);
+            pos += 4;
+            if (elementSize <= 0 || elementSize > size - pos) break;
+            pushed += handlePacket(data + pos, elementSize, senderIp, senderPort, receivedNs, depth + 1);
+            pos += elementSize;
+        }
+        return pushed;
+    }
+
+    osc_command_t command;
+    if (!parseMessage(data, size, command)) return 0;
+    command.receivedNs = receivedNs;
+    command.senderIp = senderIp;
+    command.senderPort = senderPort;
+    if (!queue.push(command))
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    return 1;
+}
+
+bool OscServer::parseMessage(const char *data, int size, osc_command_t &command)
+{
+    memset(&command, 0, sizeof(command));
+    command.cue = -1;
+
+    const int addressLength = oscString(data, size, 0);
+    if (addressLength <= 0 || data[0] != '/') return false;
+
+    // Type tags and the first argument
+    int pos = oscPadded(addressLength);
+    const char *tags = "";
+    int tagCount = 0;
+    if (pos < size && data[pos] == ',')
+    {
+        const int tagsLength = oscString(data, size, pos);
+        if (tagsLength < 0) return false;
+        tags = data + pos + 1;
+        tagCount = tagsLength - 1;
+        pos += oscPadded(tagsLength);
+    }
+
+    // Buttons of control surfaces send 1 on press and 0 on release, the release is ignored
+    if (tagCount > 0 && (tags[0] == 'i' || tags[0] == 'f'))
+    {
+        if (pos + 4 > size) return false;
+        const quint32 raw = qFromBigEndian<quint32>(data + pos);
+        if ((raw & 0x7FFFFFFF) == 0) return false; // Integer 0 or float +-0.0
+    }
+
+    const char *address = data;
+    if (addressLength > 5 && memcmp(address, "/cue/", 5) == 0)
+    {
+        int i = 5;
+        qint64 number = 0;
+        while (i < addressLength && address[i] >= '0' && address[i] <= '9' && number < 100000)
+            number = number * 10 + (address[i++] - '0');
+        if (i == 5 || number < 1) return false;
+
+        const char *action = address + i;
+        const int actionLength = addressLength - i;
+        if (matches(action, actionLength, "/go"))
+            command.type = OSC_CUE_GO;
+        else if (matches(action, actionLength, "/stop"))
+            command.type = OSC_CUE_STOP;
+        else if (matches(action, actionLength, "/syncgo"))
+        {
+            command.type = OSC_CUE_SYNC_GO;
+            if (tagCount > 0 && tags[0] == 'i')
+                command.value = qFromBigEndian<qint32>(data + pos);
+            else if (tagCount > 0 && tags[0] == 'f')
+            {
+                const quint32 raw = qFromBigEndian<quint32>(data + pos);
+                float lead;
+                memcpy(&lead, &raw, sizeof(lead));
+                command.value = static_cast<qint32>(lead);
+            }
+        }
+        else
+            return false;
+        command.cue = static_cast<qint32>(number - 1);
+        return true;
+    }
+
+    if (matches(address, addressLength, "/transport/play"))
+        command.type = OSC_TRANSPORT_PLAY;
+    else if (matches(address, addressLength, "/transport/pause"))
+        command.type = OSC_TRANSPORT_PAUSE;
+    else if (matches(address, addressLength, "/transport/stop"))
+        command.type = OSC_TRANSPORT_STOP;
+    else if (matches(address, addressLength, "/transport/locate"))
+    {
+        if (tagCount < 1 || tags[0] != 's') return false;
+        const int length = oscString(data, size, pos);
+        if (length < 0 || !parseTimecode(data + pos, length, command.tc)) return false;
+        command.type = OSC_TRANSPORT_LOCATE;
+    }
+    else
+        return false;
+    return true;
+}
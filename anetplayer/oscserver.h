@@ -0,0 +1,80 @@
+#ifndef OSCSERVER_H
+#define OSCSERVER_H
+
+#include <QObject>
+#include <QThread>
+#include <QHostAddress>
+#include <atomic>
+#include "struct.h"
+#include "ringbuffer.h"
+
+class QUdpSocket;
+
+#define OSC_DEFAULT_SERVER_PORT 0 // Off until trusted senders are set
+#define OSC_QUEUE_SIZE 256
+
+typedef enum
+{
+    OSC_CUE_GO = 1,         // /cue/N/go
+    OSC_CUE_STOP,           // /cue/N/stop
+    OSC_CUE_SYNC_GO,        // /cue/N/syncgo [lead ms], every synced player at once
+    OSC_TRANSPORT_PLAY,     // /transport/play
+    OSC_TRANSPORT_PAUSE,    // /transport/pause
+    OSC_TRANSPORT_STOP,     // /transport/stop
+    OSC_TRANSPORT_LOCATE    // /transport/locate "hh:mm:ss:ff"
+} osc_command_type_t;
+
+typedef struct
+{
+    qint64 receivedNs;   // Monotonic time the datagram was read
+    quint8 type;         // osc_command_type_t
+    qint32 cue;          // Cue index, N-1
+    timecode_t tc;       // Locate position, fps is not set
+    qint32 value;        // Integer argument, 0 = none
+    quint32 senderIp;    // IPv4, replies go back to the sender
+    quint16 senderPort;
+} osc_command_t;
+
+// OSC control over UDP. The server thread reads datagrams into a fixed
+// buffer, parses them in place and pushes fixed size commands to a
+// lock-free queue. The playback core is woken once per batch by
+// commandsPending() and drains the queue with takeCommand().
+// It listens on the Art-Net interface only and takes commands from the
+// trusted sender addresses, without them it doesn't start.
+class OscServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OscServer(QObject *parent = nullptr);
+    ~OscServer();
+
+    bool start(quint16 port, const QHostAddress &address, const QList<QHostAddress> &allowedSenders);
+    void stop();
+    bool isRunning() const;
+
+    bool takeCommand(osc_command_t &command); // Playback thread only
+
+    // Parse one OSC message, bundles are unpacked by the server
+    static bool parseMessage(const char *data, int size, osc_command_t &command);
+
+signals:
+    void commandsPending();
+    void sendMsg(const QString &msg);
+
+private:
+    RingBuffer<osc_command_t, OSC_QUEUE_SIZE> queue;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> wakePending{false};
+    std::atomic<quint32> dropped{0};
+    std::atomic<quint32> rejected{0}; // Datagrams of untrusted senders
+    QThread *thread = nullptr;
+    quint16 listenPort = 0;
+    QHostAddress listenAddress;
+    QVector<quint32> allowed; // IPv4, set before the thread starts
+
+    void serverLoop(QUdpSocket &socket);
+    int handlePacket(const char *data, int size, quint32 senderIp, quint16 senderPort, qint64 receivedNs, int depth);
+};
+
+#endif // OSCSERVER_H
@@ -0,0 +1,426 @@
+#include "playlistjournal.h"
+#include "eventtrack.h"
+#include "trace.h"
+#include <QJsonDocument>
+#include <QDeadlineTimer>
+#include <QtEndian>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define JOURNAL_SUFFIX ".journal"
+#define JOURNAL_ROTATED_SUFFIX ".old"
+#define JOURNAL_MAGIC "ANJ1"
+#define JOURNAL_MAGIC_SIZE 4
+#define JOURNAL_BATCH_MS 100 // Edits are written and synced at most this late
+#define JOURNAL_FLUSH_TIMEOUT_MS 2000
+#define JOURNAL_RECORD_OVERHEAD 9 // length:u16 op:u8 index:i32 ... crc:u16
+
+// Record: payloadLength:u16 op:u8 index:i32 payload crc:u16
+// CRC-16 covers op, index and payload, a torn record ends the replay
+
+static bool syncFile(QFile &file)
+{
+    if (!file.flush()) return false;
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+static void applyRecord(quint8 op, qint32 index, const QByteArray &payload, playlist_t &playlist)
+{
+    if (op == CUE_FIELD_GRID)
+    {
+        if (payload.size() < 8) return;
+        playlist.rows = qFromLittleEndian<qint32>(payload.constData());
+        playlist.columns = qFromLittleEndian<qint32>(payload.constData() + 4);
+        playlist.cues.resize(qMax(0, playlist.rows * playlist.columns));
+        return;
+    }
+
+    if (index < 0 || index >= playlist.cues.size()) return;
+    cue_t &cue = playlist.cues[index];
+
+    switch (op) {
+    case CUE_FIELD_FILE:
+        cue.filePath = QString::fromUtf8(payload);
+        break;
+    case CUE_FIELD_OFFSET:
+        if (payload.size() == 8)
+            cue.adjustmentTime = qFromLittleEndian<qint64>(payload.constData());
+        break;
+    case CUE_FIELD_COLOR:
+        if (payload.size() == 4)
+            cue.cueColor = QColor::fromRgba(qFromLittleEndian<quint32>(payload.constData()));
+        break;
+    case CUE_FIELD_FRAMERATE:
+        cue.frameRate = QString::fromUtf8(payload);
+        break;
+    case CUE_FIELD_CLEAR:
+        cue = cue_t();
+        break;
+    case CUE_FIELD_EVENTS:
+        cue.events = EventTrack::fromJson(QJsonDocument::fromJson(payload).array());
+        break;
+    case CUE_FIELD_DECK:
+        if (payload.size() == 4)
+            cue.deck = qFromLittleEndian<qint32>(payload.constData());
+        break;
+    case CUE_FIELD_LOOP:
+    {
+        // "in out mode", in and out are empty without a loop
+        const QStringList parts = QString::fromUtf8(payload).split(' ');
+        if (parts.size() != 3) break;
+        cue.loopIn = parts[0];
+        cue.loopOut = parts[1];
+        cue.loopTcMode = static_cast<quint8>(parts[2].toUInt());
+        break;
+    }
+    case CUE_FIELD_LTC:
+        if (payload.size() == 1)
+            cue.ltcOut = payload.at(0) != 0;
+        break;
+    default:
+        break;
+    }
+}
+
+PlaylistJournal::PlaylistJournal(QObject *parent)
+    : QObject(parent)
+{
+}
+
+PlaylistJournal::~PlaylistJournal()
+{
+    close();
+}
+
+bool PlaylistJournal::open(const QString &playlistFileName)
+{
+    close();
+    playlistFile = playlistFileName;
+
+    // Cut off the torn record left by a crash, new records must follow a valid one
+    qint64 validSize = 0;
+    replayFile(journalName(), nullptr, &validSize);
+    if (QFile::exists(journalName()))
+    {
+        if (validSize < JOURNAL_MAGIC_SIZE)
+            QFile::remove(journalName());
+        else
+            QFile::resize(journalName(), validSize);
+    }
+
+    if (!openJournalFile())
+    {
+        emit sendMsg("Can't open playlist journal: " + journalName());
+        return false;
+    }
+
+    thread = QThread::create([this]() { writerLoop(); });
+    thread->setObjectName("Playlist journal");
+    thread->start();
+    return true;
+}
+
+void PlaylistJournal::close()
+{
+    if (!thread) return;
+
+    {
+        QMutexLocker locker(&mutex);
+        stopRequested = true;
+        wakeUp.wakeAll();
+    }
+    // The journal thread writes the rest and finishes the compaction before exit
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+    journalFile.close();
+
+    stopRequested = false;
+    flushRequested = false;
+    compactRequested = false;
+    records = 0;
+}
+
+bool PlaylistJournal::isOpen() const
+{
+    return thread != nullptr;
+}
+
+QString PlaylistJournal::playlistFileName() const
+{
+    return playlistFile;
+}
+
+QString PlaylistJournal::journalName() const
+{
+    return playlistFile + JOURNAL_SUFFIX;
+}
+
+void PlaylistJournal::append(cue_field_t field, int index, const cue_t &cue)
+{
+    QByteArray payload;
+    switch (field) {
+    case CUE_FIELD_FILE:
+        payload = cue.filePath.toUtf8();
+        break;
+    case CUE_FIELD_OFFSET:
+        payload.resize(8);
+        qToLittleEndian<qint64>(cue.adjustmentTime, payload.data());
+        break;
+    case CUE_FIELD_COLOR:
+        payload.resize(4);
+        qToLittleEndian<quint32>(cue.cueColor.rgba(), payload.data());
+        break;
+    case CUE_FIELD_FRAMERATE:
+        payload = cue.frameRate.toUtf8();
+        break;
+    case CUE_FIELD_EVENTS:
+        payload = QJsonDocument(EventTrack::toJson(cue.events)).toJson(QJsonDocument::Compact);
+        break;
+    case CUE_FIELD_DECK:
+        payload.resize(4);
+        qToLittleEndian<qint32>(cue.deck, payload.data());
+        break;
+    case CUE_FIELD_LOOP:
+        payload = QString("%1 %2 %3").arg(cue.loopIn, cue.loopOut).arg(cue.loopTcMode).toUtf8();
+        break;
+    case CUE_FIELD_LTC:
+        payload = QByteArray(1, cue.ltcOut ? 1 : 0);
+        break;
+    default:
+        break;
+    }
+    appendRecord(field, index, payload);
+}
+
+void PlaylistJournal::appendGrid(int rows, int columns)
+{
+    QByteArray payload(8, 0);
+    qToLittleEndian<qint32>(rows, payload.data());
+    qToLittleEndian<qint32>(columns, payload.data() + 4);
+    appendRecord(CUE_FIELD_GRID, -1, payload);
+}
+
+void PlaylistJournal::appendRecord(quint8 op, qint32 index, const QByteArray &payload)
+{
+    if (payload.size() > 0xFFFF) return;
+
+    QByteArray record(JOURNAL_RECORD_OVERHEAD + payload.size(), 0);
+    char *r = record.data();
+    qToLittleEndian<quint16>(payload.size(), r);
+    r[2] = static_cast<char>(op);
+    qToLittleEndian<qint32>(index, r + 3);
+    memcpy(r + 7, payload.constData(), payload.size());
+    quint16 crc = qChecksum(QByteArrayView(r + 2, 5 + payload.size()));
+    qToLittleEndian<quint16>(crc, r + 7 + payload.size());
+
+    QMutexLocker locker(&mutex);
+    if (!thread) return;
+    pending.append(record);
+    ++appendedSeq;
+    ++records;
+    wakeUp.wakeAll();
+}
+
+bool PlaylistJournal::flush()
+{
+    QMutexLocker locker(&mutex);
+    if (!thread) return false;
+
+    const quint64 target = appendedSeq;
+    flushRequested = true;
+    wakeUp.wakeAll();
+
+    QDeadlineTimer deadline(JOURNAL_FLUSH_TIMEOUT_MS);
+    while (syncedSeq < target && !deadline.hasExpired())
+        written.wait(&mutex, deadline);
+    return syncedSeq >= target && lastWriteOk;
+}
+
+void PlaylistJournal::compact(const playlist_t &snapshot)
+{
+    QMutexLocker locker(&mutex);
+    if (!thread) return;
+
+    // Records appended up to now are part of the snapshot, they go to the rotated journal
+    compactPending.append(pending);
+    pending.clear();
+    compactSnapshot = snapshot;
+    compactRequested = true;
+    records = 0;
+    wakeUp.wakeAll();
+}
+
+int PlaylistJournal::recordCount() const
+{
+    QMutexLocker locker(&mutex);
+    return records;
+}
+
+void PlaylistJournal::setPlaylistWriter(const std::function<bool(const QString&, const playlist_t&)> &writer)
+{
+    playlistWriter = writer;
+}
+
+void PlaylistJournal::writerLoop()
+{
+    QMutexLocker locker(&mutex);
+    for (;;)
+    {
+        while (!stopRequested && !compactRequested && pending.isEmpty())
+            wakeUp.wait(&mutex);
+
+        // Collect the edits of one batch window
+        QDeadlineTimer deadline(JOURNAL_BATCH_MS);
+        while (!stopRequested && !flushRequested && !compactRequested && !deadline.hasExpired())
+            wakeUp.wait(&mutex, deadline);
+
+        QByteArray batch;
+        batch.swap(pending);
+        QByteArray beforeSnapshot;
+        beforeSnapshot.swap(compactPending);
+        const quint64 batchSeq = appendedSeq;
+        const bool compact = compactRequested;
+        playlist_t snapshot;
+        if (compact)
+        {
+            snapshot = compactSnapshot;
+            compactSnapshot = playlist_t();
+            compactRequested = false;
+        }
+        flushRequested = false;
+        locker.unlock();
+
+        bool ok = true;
+        if (compact)
+        {
+            // Old records stay on disk until the full playlist is written
+            ok = beforeSnapshot.isEmpty() || writeBatch(beforeSnapshot);
+            bool done = rotate() && playlistWriter && playlistWriter(playlistFile, snapshot);
+            if (done)
+                QFile::remove(journalName() + JOURNAL_ROTATED_SUFFIX);
+            emit compacted(done);
+        }
+        if (!batch.isEmpty())
+            ok = writeBatch(batch) && ok;
+        if (!ok)
+            emit sendMsg("ERROR! Playlist journal write failed");
+
+        locker.relock();
+        syncedSeq = batchSeq;
+        lastWriteOk = ok;
+        written.wakeAll();
+        if (stopRequested && pending.isEmpty() && !compactRequested)
+            break;
+    }
+}
+
+bool PlaylistJournal::openJournalFile()
+{
+    journalFile.setFileName(journalName());
+    if (!journalFile.open(QIODevice::WriteOnly | QIODevice::Append)) return false;
+    if (journalFile.size() == 0)
+    {
+        journalFile.write(JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE);
+        return syncFile(journalFile);
+    }
+    return true;
+}
+
+bool PlaylistJournal::writeBatch(const QByteArray &batch)
+{
+    TRACE_SCOPE("io", "PlaylistJournal::writeBatch");
+    if (!journalFile.isOpen()) return false;
+    if (journalFile.write(batch) != batch.size()) return false;
+    return syncFile(journalFile);
+}
+
+bool PlaylistJournal::rotate()
+{
+    TRACE_SCOPE("io", "PlaylistJournal::rotate");
+    const QString name = journalName();
+    const QString oldName = name + JOURNAL_ROTATED_SUFFIX;
+    journalFile.close();
+
+    bool ok = true;
+    if (QFile::exists(oldName))
+    {
+        // The previous compaction failed, its records stay in front of the new ones
+        QFile oldFile(oldName);
+        QFile current(name);
+        ok = oldFile.open(QIODevice::WriteOnly | QIODevice::Append) && current.open(QIODevice::ReadOnly);
+        if (ok)
+        {
+            current.seek(JOURNAL_MAGIC_SIZE);
+            oldFile.write(current.readAll());
+            ok = syncFile(oldFile);
+            current.close();
+            if (ok) QFile::remove(name);
+        }
+    }
+    else
+    {
+        ok = QFile::rename(name, oldName);
+    }
+
+    return openJournalFile() && ok;
+}
+
+int PlaylistJournal::replay(const QString &playlistFileName, playlist_t &playlist)
+{
+    TRACE_SCOPE("io", "PlaylistJournal::replay");
+    const QString name = playlistFileName + JOURNAL_SUFFIX;
+    int count = replayFile(name + JOURNAL_ROTATED_SUFFIX, &playlist);
+    count += replayFile(name, &playlist);
+    return count;
+}
+
+void PlaylistJournal::removeFiles(const QString &playlistFileName)
+{
+    const QString name = playlistFileName + JOURNAL_SUFFIX;
+    QFile::remove(name + JOURNAL_ROTATED_SUFFIX);
+    QFile::remove(name);
+}
+
+int PlaylistJournal::replayFile(const QString &name, playlist_t *playlist, qint64 *validSize)
+{
+    if (validSize) *validSize = 0;
+
+    QFile file(name);
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+    const QByteArray data = file.readAll();
+    if (!data.startsWith(JOURNAL_MAGIC)) return 0;
+
+    int count = 0;
+    qint64 pos = JOURNAL_MAGIC_SIZE;
+    const char *d = data.constData();
+    while (pos + JOURNAL_RECORD_OVERHEAD <= data.size())
+    {
+        const int length = qFromLittleEndian<quint16>(d + pos);
+        if (pos + JOURNAL_RECORD_OVERHEAD + length > data.size()) break;
+
+        const quint16 crc = qFromLittleEndian<quint16>(d + pos + 7 + length);
+        if (crc != qChecksum(QByteArrayView(d + pos + 2, 5 + length))) break;
+
+        if (playlist)
+        {
+            const quint8 op = static_cast<quint8>(d[pos + 2]);
+            const qint32 index = qFromLittleEndian<qint32>(d + pos + 3);
+            applyRecord(op, index, QByteArray(d + pos + 7, length), *playlist);
+        }
+        pos += JOURNAL_RECORD_OVERHEAD + length;
+        ++count;
+    }
+
+    if (validSize) *validSize = pos;
+    return count;
+}
@@ -0,0 +1,77 @@
+#ifndef PLAYLISTJOURNAL_H
+#define PLAYLISTJOURNAL_H
+
+#include <QObject>
+#include <QFile>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <functional>
+#include "struct.h"
+
+// Write-ahead journal of the playlist edits. Every edit is appended as a small
+// record to <playlist>.journal, the records are written and fsync'ed in batches
+// by the journal thread, so a crash loses at most the last batch.
+// Compaction writes the whole playlist in the journal thread: the journal is
+// rotated to <playlist>.journal.old first and removed when the playlist is written.
+class PlaylistJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PlaylistJournal(QObject *parent = nullptr);
+    ~PlaylistJournal();
+
+    bool open(const QString &playlistFileName);
+    void close();
+    bool isOpen() const;
+    QString playlistFileName() const;
+
+    void append(cue_field_t field, int index, const cue_t &cue);
+    void appendGrid(int rows, int columns);
+    bool flush(); // Wait until all appended records are on disk
+    void compact(const playlist_t &snapshot); // Rewrite the playlist in background
+    int recordCount() const; // Records since the last compaction
+
+    // Function that writes the full playlist file, called in the journal thread
+    void setPlaylistWriter(const std::function<bool(const QString&, const playlist_t&)> &writer);
+
+    // Apply the journals left by a crash to the loaded playlist, returns the number of records
+    static int replay(const QString &playlistFileName, playlist_t &playlist);
+    // Delete the journals of the playlist, stale once the playlist file holds everything
+    static void removeFiles(const QString &playlistFileName);
+
+signals:
+    void compacted(bool ok);
+    void sendMsg(const QString &msg);
+
+private:
+    QThread *thread = nullptr;
+    mutable QMutex mutex;
+    QWaitCondition wakeUp;  // Writer: new records or a job
+    QWaitCondition written; // Waiters of flush()
+
+    QFile journalFile;  // Used by the journal thread only
+    QString playlistFile;
+    QByteArray pending; // Encoded records waiting for the next batch
+    QByteArray compactPending; // Records older than the compaction snapshot
+    quint64 appendedSeq = 0;
+    quint64 syncedSeq = 0;
+    int records = 0;
+    bool lastWriteOk = true;
+    bool stopRequested = false;
+    bool flushRequested = false;
+    bool compactRequested = false;
+    playlist_t compactSnapshot;
+    std::function<bool(const QString&, const playlist_t&)> playlistWriter;
+
+    QString journalName() const;
+    void writerLoop();
+    bool openJournalFile();
+    bool writeBatch(const QByteArray &batch);
+    bool rotate();
+    void appendRecord(quint8 op, qint32 index, const QByteArray &payload);
+    static int replayFile(const QString &name, playlist_t *playlist, qint64 *validSize = nullptr);
+};
+
+#endif // PLAYLISTJOURNAL_H
@@ -0,0 +1,328 @@
+#include "redundancylink.h"
+#include <QUdpSocket>
+#include <QtEndian>
+#include <QRandomGenerator>
+#include <cstring>
+#include <future>
+#include <chrono>
+#include <thread>
+#include "clock.h"
+#include "framerate.h"
+
+#define HEARTBEAT_MAGIC "ANHB"
+#define HEARTBEAT_VERSION 2
+#define REDUNDANCY_POLL_MS 1
+#define REDUNDANCY_OFFSET_WINDOW 256 // Heartbeats of the delay filter, about 1.3 s
+
+RedundancyLink::RedundancyLink(QObject *parent)
+    : QObject(parent)
+{
+}
+
+RedundancyLink::~RedundancyLink()
+{
+    stop();
+}
+
+bool RedundancyLink::start(redundancy_role_t newRole, const QString &peer, quint16 port)
+{
+    stop();
+    if (newRole == REDUNDANCY_OFF) return true;
+    if (port == 0 || QHostAddress(peer).isNull())
+    {
+        emit sendMsg("Redundancy needs the peer address and port");
+        return false;
+    }
+
+    role = newRole;
+    peerAddress = QHostAddress(peer);
+    linkPort = port;
+    stopRequested = false;
+    takenOver = false;
+    wakePending = false;
+    for (int i = 0; i < MAX_DECKS; ++i)
+    {
+        decks[i] = heartbeat_t();
+        decks[i].deck = static_cast<quint8>(i);
+    }
+    deckMask = (role == REDUNDANCY_PRIMARY) ? 1 : 0; // The primary is heard even when nothing plays
+
+    std::promise<bool> bound;
+    std::future<bool> result = bound.get_future();
+    thread = QThread::create([this, &bound]() {
+        QUdpSocket socket;
+        const bool ok = (role == REDUNDANCY_BACKUP) ? socket.bind(QHostAddress::AnyIPv4, linkPort)
+                                                    : socket.bind(QHostAddress::AnyIPv4, 0);
+        bound.set_value(ok);
+        if (!ok) return;
+        if (role == REDUNDANCY_BACKUP)
+            backupLoop(socket);
+        else
+            primaryLoop(socket);
+    });
+    thread->setObjectName("Redundancy link");
+    thread->start();
+
+    if (!result.get())
+    {
+        thread->wait();
+        delete thread;
+        thread = nullptr;
+        role = REDUNDANCY_OFF;
+        emit sendMsg(QString("Can't open the redundancy port %1").arg(port));
+        return false;
+    }
+    if (role == REDUNDANCY_PRIMARY)
+        emit sendMsg(QString("Primary, heartbeats to %1:%2").arg(peer).arg(port));
+    else
+        emit sendMsg(QString("Backup on standby, heartbeats from %1 on port %2").arg(peer).arg(port));
+    return true;
+}
+
+void RedundancyLink::stop()
+{
+    if (!thread) return;
+    stopRequested = true;
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+    role = REDUNDANCY_OFF;
+}
+
+redundancy_role_t RedundancyLink::getRole() const
+{
+    return role;
+}
+
+bool RedundancyLink::isStandby() const
+{
+    return role == REDUNDANCY_BACKUP && !takenOver.load(std::memory_order_acquire);
+}
+
+void RedundancyLink::publish(const heartbeat_t &heartbeat)
+{
+    if (role != REDUNDANCY_PRIMARY || heartbeat.deck >= MAX_DECKS) return;
+    QMutexLocker locker(&mutex);
+    decks[heartbeat.deck] = heartbeat;
+    deckMask |= 1u << heartbeat.deck;
+}
+
+bool RedundancyLink::takeHeartbeat(heartbeat_t &heartbeat)
+{
+    QMutexLocker locker(&mutex);
+    if (deckMask == 0)
+    {
+        // Allow the next wake-up, a heartbeat received meanwhile is taken now
+        wakePending.store(false, std::memory_order_release);
+        return false;
+    }
+    for (int i = 0; i < MAX_DECKS; ++i)
+    {
+        if (!(deckMask & (1u << i))) continue;
+        deckMask &= ~(1u << i);
+        heartbeat = decks[i];
+        return true;
+    }
+    return false;
+}
+
+double RedundancyLink::playheadMs(const heartbeat_t &heartbeat, qint64 nowNs)
+{
+    double position = (heartbeat.sampleRate > 0) ? heartbeat.samplePosition * 1000.0 / heartbeat.sampleRate
+                                                 : static_cast<double>(heartbeat.samplePosition);
+    if (heartbeat.state == HEARTBEAT_PLAYING)
+        position += (nowNs - heartbeat.offsetNs - heartbeat.positionNs) / 1e6;
+    return position;
+}
+
+QByteArray RedundancyLink::encode(const heartbeat_t &heartbeat, qint64 sentNs)
+{
+    QByteArray packet(REDUNDANCY_PACKET_SIZE, '\0');
+    uchar *d = reinterpret_cast<uchar*>(packet.data());
+    memcpy(d, HEARTBEAT_MAGIC, 4);
+    d[4] = HEARTBEAT_VERSION;
+    d[5] = heartbeat.deck;
+    d[6] = heartbeat.state;
+    d[7] = heartbeat.frame.fps;
+    qToLittleEndian<quint32>(heartbeat.sequence, d + 8);
+    qToLittleEndian<qint32>(heartbeat.cue, d + 12);
+    qToLittleEndian<quint32>(heartbeat.sampleRate, d + 16);
+    qToLittleEndian<qint64>(heartbeat.samplePosition, d + 20);
+    qToLittleEndian<qint64>(heartbeat.positionNs, d + 28);
+    qToLittleEndian<qint64>(sentNs, d + 36);
+    d[44] = heartbeat.frame.ff; // Order of the ArtTimeCode packet
+    d[45] = heartbeat.frame.ss;
+    d[46] = heartbeat.frame.mm;
+    d[47] = heartbeat.frame.hh;
+    qToLittleEndian<quint32>(heartbeat.session, d + 48);
+    return packet;
+}
+
+bool RedundancyLink::decode(const char *data, int size, heartbeat_t &heartbeat, qint64 &sentNs)
+{
+    const uchar *d = reinterpret_cast<const uchar*>(data);
+    if (size < REDUNDANCY_PACKET_SIZE || memcmp(d, HEARTBEAT_MAGIC, 4) != 0 || d[4] != HEARTBEAT_VERSION)
+        return false;
+    if (d[5] >= MAX_DECKS || d[6] > HEARTBEAT_PAUSED) return false;
+    heartbeat.deck = d[5];
+    heartbeat.state = d[6];
+    heartbeat.frame.fps = d[7];
+    heartbeat.sequence = qFromLittleEndian<quint32>(d + 8);
+    heartbeat.cue = qFromLittleEndian<qint32>(d + 12);
+    heartbeat.sampleRate = qFromLittleEndian<quint32>(d + 16);
+    heartbeat.samplePosition = qFromLittleEndian<qint64>(d + 20);
+    heartbeat.positionNs = qFromLittleEndian<qint64>(d + 28);
+    sentNs = qFromLittleEndian<qint64>(d + 36);
+    heartbeat.frame.ff = d[44];
+    heartbeat.frame.ss = d[45];
+    heartbeat.frame.mm = d[46];
+    heartbeat.frame.hh = d[47];
+    heartbeat.session = qFromLittleEndian<quint32>(d + 48);
+    return true;
+}
+
+void RedundancyLink::primaryLoop(QUdpSocket &socket)
+{
+    heartbeat_t states[MAX_DECKS];
+    quint32 sequence = 0;
+    const quint32 session = QRandomGenerator::global()->generate() | 1; // Never 0, the backup's "none"
+    auto next = std::chrono::steady_clock::now();
+    while (!stopRequested.load(std::memory_order_relaxed))
+    {
+        quint32 mask;
+        {
+            QMutexLocker locker(&mutex);
+            mask = deckMask;
+            for (int i = 0; i < MAX_DECKS; ++i)
+                if (mask & (1u << i)) states[i] = decks[i];
+        }
+        for (int i = 0; i < MAX_DECKS; ++i)
+        {
+            if (!(mask & (1u << i))) continue;
+            states[i].sequence = ++sequence;
+            states[i].session = session;
+            const QByteArray packet = encode(states[i], Clock::system()->nowNs());
+            socket.writeDatagram(packet, peerAddress, linkPort);
+        }
+
+        // Fixed rate, a late wake-up doesn't cause a burst
+        next += std::chrono::milliseconds(REDUNDANCY_HEARTBEAT_MS);
+        const auto now = std::chrono::steady_clock::now();
+        if (next < now) next = now;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+double RedundancyLink::silenceLimitMs(quint8 artnetType)
+{
+    for (const framerate_t &rate : frameRates())
+    {
+        if (rate.artnetType == artnetType)
+            return 1000.0 * rate.rateDen / rate.rateNum + REDUNDANCY_JITTER_MS;
+    }
+    return REDUNDANCY_IDLE_FRAME_MS + REDUNDANCY_JITTER_MS;
+}
+
+void RedundancyLink::backupLoop(QUdpSocket &socket)
+{
+    qint64 offsets[REDUNDANCY_OFFSET_WINDOW];
+    int offsetCount = 0;
+    int offsetNext = 0;
+    quint32 lastSequence[MAX_DECKS] = {};
+    quint32 lastSession = 0;
+    qint64 lastHeardNs = 0;
+    double deckLimitMs[MAX_DECKS] = {}; // Silence limit of every playing deck, 0 = not playing
+    qint64 limitNs = static_cast<qint64>((REDUNDANCY_IDLE_FRAME_MS + REDUNDANCY_JITTER_MS) * 1e6);
+    int heardAgain = 0;      // Heartbeats since the takeover
+    bool playingAgain = false;
+    char buffer[REDUNDANCY_PACKET_SIZE * 2];
+    const quint32 primaryIp = peerAddress.toIPv4Address();
+
+    while (!stopRequested.load(std::memory_order_relaxed))
+    {
+        socket.waitForReadyRead(REDUNDANCY_POLL_MS);
+        bool received = false;
+        while (socket.hasPendingDatagrams())
+        {
+            QHostAddress sender;
+            const qint64 size = socket.readDatagram(buffer, sizeof(buffer), &sender);
+            const qint64 receivedNs = Clock::system()->nowNs();
+            heartbeat_t heartbeat;
+            qint64 sentNs = 0;
+            if (size <= 0 || sender.toIPv4Address() != primaryIp) continue;
+            if (!decode(buffer, static_cast<int>(size), heartbeat, sentNs)) continue;
+            if (heartbeat.session != lastSession)
+            {
+                // Restarted primary, its sequence and clock start again
+                if (lastSession != 0)
+                    emit sendMsg("The primary restarted");
+                lastSession = heartbeat.session;
+                memset(lastSequence, 0, sizeof(lastSequence));
+                offsetCount = 0;
+                offsetNext = 0;
+            }
+            if (lastSequence[heartbeat.deck] != 0 && static_cast<qint32>(heartbeat.sequence - lastSequence[heartbeat.deck]) <= 0)
+                continue; // Reordered
+            lastSequence[heartbeat.deck] = heartbeat.sequence;
+
+            // Clock offset plus the smallest path delay of the window
+            offsets[offsetNext] = receivedNs - sentNs;
+            offsetNext = (offsetNext + 1) % REDUNDANCY_OFFSET_WINDOW;
+            if (offsetCount < REDUNDANCY_OFFSET_WINDOW) ++offsetCount;
+            heartbeat.offsetNs = offsets[0];
+            for (int i = 1; i < offsetCount; ++i)
+                heartbeat.offsetNs = qMin(heartbeat.offsetNs, offsets[i]);
+
+            {
+                QMutexLocker locker(&mutex);
+                decks[heartbeat.deck] = heartbeat;
+                deckMask |= 1u << heartbeat.deck;
+            }
+            // Within a frame of the fastest deck that plays
+            deckLimitMs[heartbeat.deck] = (heartbeat.state == HEARTBEAT_PLAYING) ? silenceLimitMs(heartbeat.frame.fps) : 0;
+            double limitMs = REDUNDANCY_IDLE_FRAME_MS + REDUNDANCY_JITTER_MS;
+            for (double deckLimit : deckLimitMs)
+            {
+                if (deckLimit > 0) limitMs = qMin(limitMs, deckLimit);
+            }
+            limitNs = static_cast<qint64>(limitMs * 1e6);
+
+            received = true;
+            lastHeardNs = receivedNs;
+            if (takenOver.load(std::memory_order_relaxed))
+            {
+                ++heardAgain;
+                playingAgain = playingAgain || heartbeat.state == HEARTBEAT_PLAYING;
+            }
+        }
+
+        if (received && !wakePending.exchange(true, std::memory_order_acq_rel))
+            emit heartbeatsPending();
+
+        const qint64 nowNs = Clock::system()->nowNs();
+        if (!takenOver.load(std::memory_order_relaxed))
+        {
+            if (lastHeardNs > 0 && nowNs - lastHeardNs > limitNs)
+            {
+                takenOver.store(true, std::memory_order_release);
+                heardAgain = 0;
+                playingAgain = false;
+                emit primaryLost();
+                emit sendMsg(QString("Primary lost after %1 ms of silence (limit %2 ms), the backup takes over")
+                                 .arg((nowNs - lastHeardNs) / 1e6, 0, 'f', 1).arg(limitNs / 1e6, 0, 'f', 1));
+            }
+        }
+        else if (lastHeardNs > 0 && nowNs - lastHeardNs > limitNs)
+        {
+            heardAgain = 0; // A few heartbeats of a flapping link aren't enough
+            playingAgain = false;
+        }
+        else if (heardAgain >= REDUNDANCY_HANDBACK_HEARTBEATS && playingAgain)
+        {
+            // A stopped primary that came back sends no timecode, the backup keeps the show until it plays
+            takenOver.store(false, std::memory_order_release);
+            emit primaryBack();
+            emit sendMsg("The primary plays again, the backup is back on standby");
+        }
+    }
+}
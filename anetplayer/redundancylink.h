@@ -0,0 +1,104 @@
+#ifndef REDUNDANCYLINK_H
+#define REDUNDANCYLINK_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QHostAddress>
+#include <atomic>
+#include "struct.h"
+
+class QUdpSocket;
+
+#define REDUNDANCY_DEFAULT_PORT 7010
+#define REDUNDANCY_HEARTBEAT_MS 5   // Primary send period
+#define REDUNDANCY_JITTER_MS 10     // Late heartbeats allowed on top of one frame before the takeover
+#define REDUNDANCY_IDLE_FRAME_MS (1000.0 / 24) // Frame of the silence limit while no deck plays, the longest
+#define REDUNDANCY_HANDBACK_HEARTBEATS 20 // Heard again this long, 100 ms, and playing: the backup mutes
+#define REDUNDANCY_PACKET_SIZE 52
+
+typedef enum
+{
+    REDUNDANCY_OFF = 0,
+    REDUNDANCY_PRIMARY,
+    REDUNDANCY_BACKUP
+} redundancy_role_t;
+
+typedef enum
+{
+    HEARTBEAT_STOPPED = 0,
+    HEARTBEAT_PLAYING,
+    HEARTBEAT_PAUSED
+} heartbeat_state_t;
+
+// State of one deck of the primary
+typedef struct
+{
+    quint8 deck = 0;
+    quint8 state = HEARTBEAT_STOPPED;  // heartbeat_state_t
+    qint32 cue = -1;                   // Cue index, -1 = none
+    quint32 sampleRate = 0;            // 0 = the position is in ms
+    qint64 samplePosition = 0;         // Playhead reported by the player
+    qint64 positionNs = 0;             // Primary monotonic time of that position
+    timecode_t frame = {};             // Last sent timecode, fps = ArtTimeCode type
+    quint32 sequence = 0;
+    quint32 session = 0;               // Run of the primary, a restart counts the sequence from 1 again
+    qint64 offsetNs = 0;               // Backup only: local time minus primary time, least delay seen
+} heartbeat_t;
+
+// Hot standby of two players. The primary thread sends the state of every
+// deck at a high rate, the backup thread receives it from the primary's
+// address only and declares the primary lost after one frame of the
+// fastest playing deck plus REDUNDANCY_JITTER_MS of silence. The playback
+// core of the backup follows the heartbeats muted, takes them with
+// takeHeartbeat() after heartbeatsPending(), and takes over
+// on primaryLost(). When the primary plays again the backup hands the show
+// back with primaryBack(), two players never send at once for long.
+class RedundancyLink : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RedundancyLink(QObject *parent = nullptr);
+    ~RedundancyLink();
+
+    bool start(redundancy_role_t role, const QString &peer, quint16 port); // Peer: the backup, or the primary heard by the backup
+    void stop();
+    redundancy_role_t getRole() const;
+    bool isStandby() const; // Backup that hasn't taken over
+
+    void publish(const heartbeat_t &heartbeat); // Primary, latest state of the deck
+
+    bool takeHeartbeat(heartbeat_t &heartbeat); // Backup, newest heartbeat of every deck that changed
+    // Primary playhead in ms at the local monotonic time
+    static double playheadMs(const heartbeat_t &heartbeat, qint64 nowNs);
+    // Silence before the takeover while a deck plays at this ArtTimeCode type
+    static double silenceLimitMs(quint8 artnetType);
+
+    static QByteArray encode(const heartbeat_t &heartbeat, qint64 sentNs);
+    static bool decode(const char *data, int size, heartbeat_t &heartbeat, qint64 &sentNs);
+
+signals:
+    void heartbeatsPending();
+    void primaryLost(); // Backup, queued to the playback core
+    void primaryBack(); // Backup on standby again
+    void sendMsg(const QString &msg);
+
+private:
+    redundancy_role_t role = REDUNDANCY_OFF;
+    QHostAddress peerAddress;
+    quint16 linkPort = 0;
+    QThread *thread = nullptr;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> wakePending{false};
+    std::atomic<bool> takenOver{false};
+
+    QMutex mutex; // Guards the deck states, held only to copy them
+    heartbeat_t decks[MAX_DECKS];
+    quint32 deckMask = 0;     // Primary: decks published, backup: decks with a new heartbeat
+
+    void primaryLoop(QUdpSocket &socket);
+    void backupLoop(QUdpSocket &socket);
+};
+
+#endif // REDUNDANCYLINK_H
@@ -0,0 +1,56 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free single producer, single consumer queue of fixed capacity.
+// Capacity must be a power of two. push() and pop() never block or allocate,
+// push() returns false when the queue is full.
+template<typename T, size_t Capacity>
+class RingBuffer
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(const T &item)
+    {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head - tailCache == Capacity)
+        {
+            tailCache = tailIndex.load(std::memory_order_acquire);
+            if (head - tailCache == Capacity) return false;
+        }
+        slots[head & (Capacity - 1)] = item;
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        const size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail == headCache)
+        {
+            headCache = headIndex.load(std::memory_order_acquire);
+            if (tail == headCache) return false;
+        }
+        item = slots[tail & (Capacity - 1)];
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return headIndex.load(std::memory_order_acquire) == tailIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    // Producer and consumer indexes on separate cache lines
+    alignas(64) std::atomic<size_t> headIndex{0};
+    size_t tailCache = 0; // Producer's copy of the tail
+    alignas(64) std::atomic<size_t> tailIndex{0};
+    size_t headCache = 0; // Consumer's copy of the head
+    alignas(64) T slots[Capacity];
+};
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,123 @@
+#include "scrubengine.h"
+
+#define NS_PER_MS 1000000LL
+
+ScrubEngine::ScrubEngine(QObject *parent, Clock *clock)
+    : QObject(parent), clock(clock), seekTimer(clock->createTimer(this)), locateTimer(clock->createTimer(this))
+{
+    seekTimer->setSingleShot(true);
+    locateTimer->setSingleShot(true);
+    connect(seekTimer, &ClockTimer::timeout, this, &ScrubEngine::flushSeek);
+    connect(locateTimer, &ClockTimer::timeout, this, &ScrubEngine::flushLocate);
+}
+
+void ScrubEngine::press(qint64 positionMs)
+{
+    if (scrubbing) return;
+    scrubbing = true;
+    pressPosition = positionMs;
+    lastSeek = -1;
+    lastLocate = -1;
+    // The first move goes out at once
+    lastSeekNs = clock->nowNs() - SCRUB_SEEK_INTERVAL_MS * NS_PER_MS;
+    lastLocateNs = clock->nowNs() - SCRUB_LOCATE_INTERVAL_MS * NS_PER_MS;
+    moves = seeks = locates = 0;
+    emit scrubbingChanged(true);
+}
+
+void ScrubEngine::move(qint64 positionMs)
+{
+    if (!scrubbing) press(positionMs);
+    target = positionMs; // Latest wins, a pending target is replaced
+    ++moves;
+    flushSeek();
+    flushLocate();
+}
+
+void ScrubEngine::release(qint64 positionMs)
+{
+    if (!scrubbing) return;
+    seekTimer->stop();
+    locateTimer->stop();
+    target = positionMs;
+    // A click without a drag leaves the cue where it is
+    if (moves > 0 || target != pressPosition)
+    {
+        emit seekRequested(target, true);
+        emit locateRequested(target);
+        ++seeks;
+        ++locates;
+    }
+    scrubbing = false;
+    emit scrubbingChanged(false);
+}
+
+// The cue went away under the slider, nothing is sought
+void ScrubEngine::cancel()
+{
+    if (!scrubbing) return;
+    seekTimer->stop();
+    locateTimer->stop();
+    scrubbing = false;
+    emit scrubbingChanged(false);
+}
+
+bool ScrubEngine::isScrubbing() const
+{
+    return scrubbing;
+}
+
+// The player has no keyframe seek, every seek is exact. A drag seeks on a
+// grid instead, so small moves of the mouse cost no seek at all.
+qint64 ScrubEngine::coarsePosition(qint64 positionMs)
+{
+    return qMax<qint64>(positionMs, 0) / SCRUB_COARSE_STEP_MS * SCRUB_COARSE_STEP_MS;
+}
+
+qint64 ScrubEngine::moveCount() const
+{
+    return moves;
+}
+
+qint64 ScrubEngine::seekCount() const
+{
+    return seeks;
+}
+
+qint64 ScrubEngine::locateCount() const
+{
+    return locates;
+}
+
+// Seek to the target now if the interval passed, else once it has
+void ScrubEngine::flushSeek()
+{
+    if (!scrubbing || coarsePosition(target) == lastSeek) return;
+    const qint64 waitNs = lastSeekNs + SCRUB_SEEK_INTERVAL_MS * NS_PER_MS - clock->nowNs();
+    if (waitNs > 0)
+    {
+        if (!seekTimer->isActive())
+            seekTimer->start(static_cast<int>((waitNs + NS_PER_MS - 1) / NS_PER_MS));
+        return;
+    }
+    lastSeek = coarsePosition(target);
+    lastSeekNs = clock->nowNs();
+    ++seeks;
+    emit seekRequested(lastSeek, false);
+}
+
+void ScrubEngine::flushLocate()
+{
+    if (!scrubbing || target == lastLocate) return;
+    const qint64 waitNs = lastLocateNs + SCRUB_LOCATE_INTERVAL_MS * NS_PER_MS - clock->nowNs();
+    if (waitNs > 0)
+    {
+        if (!locateTimer->isActive())
+            locateTimer->start(static_cast<int>((waitNs + NS_PER_MS - 1) / NS_PER_MS));
+        return;
+    }
+    lastLocate = target;
+    lastLocateNs = clock->nowNs();
+    ++locates;
+    emit locateRequested(target);
+}
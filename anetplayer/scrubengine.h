@@ -0,0 +1,61 @@
+#ifndef SCRUBENGINE_H
+#define SCRUBENGINE_H
+
+#include <QObject>
+#include "clock.h"
+
+#define SCRUB_SEEK_INTERVAL_MS 40     // Coarse seeks while dragging, at most 25 per second
+#define SCRUB_LOCATE_INTERVAL_MS 100  // Locate timecode while dragging, 10 per second
+#define SCRUB_COARSE_STEP_MS 100      // Grid of the seeks while dragging, the release is exact
+#define SCRUB_GRAIN_MS 60             // Audio heard after a seek of a paused cue
+
+// Drag of the position slider. Every move only replaces the target, the
+// latest one wins: seeks go out at a bounded rate, snapped to a coarse grid
+// and only when the target moved to another step of it, locate timecode
+// follows the exact target at a lower rate. The release seeks exactly to
+// where the slider was let go, whatever was still pending is dropped. A
+// press and release without a move in between seeks nothing.
+class ScrubEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ScrubEngine(QObject *parent = nullptr, Clock *clock = Clock::system());
+
+    void press(qint64 positionMs);
+    void move(qint64 positionMs);
+    void release(qint64 positionMs);
+    void cancel();
+    bool isScrubbing() const;
+    static qint64 coarsePosition(qint64 positionMs); // Seek of a drag to this position
+
+    // Counters of the last drag
+    qint64 moveCount() const;
+    qint64 seekCount() const;
+    qint64 locateCount() const;
+
+signals:
+    void scrubbingChanged(bool scrubbing);
+    void seekRequested(qint64 positionMs, bool exact); // Coarse while dragging
+    void locateRequested(qint64 positionMs); // Timecode of the target
+
+private:
+    Clock *clock;
+    ClockTimer *seekTimer;
+    ClockTimer *locateTimer;
+    bool scrubbing = false;
+    qint64 target = 0;
+    qint64 pressPosition = 0;
+    qint64 lastSeek = -1;
+    qint64 lastLocate = -1;
+    qint64 lastSeekNs = 0;
+    qint64 lastLocateNs = 0;
+    qint64 moves = 0;
+    qint64 seeks = 0;
+    qint64 locates = 0;
+
+    void flushSeek();
+    void flushLocate();
+};
+
+#endif // SCRUBENGINE_H
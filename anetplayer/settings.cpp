@@ -1,6 +1,8 @@
 #include "settings.h"
 #include "ui_settings.h"
 #include <QFile>
+#include <QMediaDevices>
+#include <QAudioDevice>
 
 Settings::Settings(QWidget *parent)
     : QDialog(parent)
@@ -9,9 +11,6 @@ Settings::Settings(QWidget *parent)
     ui->setupUi(this);
     setdat = new settings_t;
 
-    QStringList interfaces = ArtNetSender::getAvailableInterfaces();
-    ui->comboBox_nwInterfaces->addItems(interfaces);
-
     // Set list of artnet framerate
     QStringList fps = {
         "24",
@@ -20,17 +19,47 @@ Settings::Settings(QWidget *parent)
         "30"
     };
     ui->comboBox_fps->addItems(fps);
+    // Index is redundancy_role_t
+    ui->comboBox_redundancy->addItems({"Off", "Primary", "Backup"});
+    // Index is sync_role_t
+    ui->comboBox_sync->addItems({"Off", "Master", "Client"});
+    // Item data is the device id, the names may repeat
+    ui->comboBox_ltcDevice->addItem("Off", QString());
+    for (const QAudioDevice &device : QMediaDevices::audioOutputs())
+        ui->comboBox_ltcDevice->addItem(device.description(), QString::fromUtf8(device.id()));
 
     fileManager= new FileManager(this);
-    // Read parameters from the file if they exist, otherwise use default values
-    settings_t loadedSettings;
-    fileManager->loadSettings("config.ini", loadedSettings);
-    // Display the parameters in the settings window
+}
+
+// Interfaces of the monitor table, the current selection is kept
+void Settings::setInterfaces(const QStringList &interfaces)
+{
+    const QString selected = ui->comboBox_nwInterfaces->currentText();
+    ui->comboBox_nwInterfaces->clear();
+    ui->comboBox_nwInterfaces->addItems(interfaces);
+    ui->comboBox_nwInterfaces->setCurrentText(selected);
+}
+
+// Display the parameters in the settings window, they come from the config read at startup
+void Settings::setSettings(const settings_t &loadedSettings)
+{
     ui->checkBox_isTC->setChecked(loadedSettings.tcOut);
     ui->comboBox_fps->setCurrentText(loadedSettings.fps);
     ui->comboBox_nwInterfaces->setCurrentText(loadedSettings.slectedInterfaceName);
     ui->lineEdit_ip->setText(loadedSettings.ip);
     ui->lineEdit_port->setText(QString::number(loadedSettings.port));
+    ui->lineEdit_oscPort->setText(QString::number(loadedSettings.oscPort));
+    ui->lineEdit_oscSenders->setText(loadedSettings.oscSenders);
+    ui->lineEdit_displayPort->setText(QString::number(loadedSettings.displayPort));
+    ui->lineEdit_displayAddress->setText(loadedSettings.displayAddress);
+    ui->comboBox_redundancy->setCurrentIndex(loadedSettings.redundancyRole);
+    ui->lineEdit_redundancyPeer->setText(loadedSettings.redundancyPeer);
+    ui->lineEdit_redundancyPort->setText(QString::number(loadedSettings.redundancyPort));
+    ui->comboBox_sync->setCurrentIndex(loadedSettings.syncRole);
+    ui->lineEdit_syncMaster->setText(loadedSettings.syncMaster);
+    ui->lineEdit_syncPort->setText(QString::number(loadedSettings.syncPort));
+    ui->comboBox_ltcDevice->setCurrentIndex(qMax(0, ui->comboBox_ltcDevice->findData(loadedSettings.ltcDevice)));
+    ui->spinBox_ltcChannel->setValue(loadedSettings.ltcChannel + 1);
     ui->spinBox_columns->setValue(loadedSettings.columns);
     ui->spinBox_rows->setValue(loadedSettings.rows);
 }
@@ -55,6 +84,18 @@ void Settings::on_pushButton_Ok_clicked()
     setdat->slectedInterfaceName = ui->comboBox_nwInterfaces->currentText();
     setdat->fps = ui->comboBox_fps->currentText();
     setdat->tcOut = ui->checkBox_isTC->checkState();
+    setdat->oscPort = ui->lineEdit_oscPort->text().toUShort();
+    setdat->oscSenders = ui->lineEdit_oscSenders->text().trimmed();
+    setdat->displayPort = ui->lineEdit_displayPort->text().toUShort();
+    setdat->displayAddress = ui->lineEdit_displayAddress->text().trimmed();
+    setdat->redundancyRole = static_cast<uint8_t>(ui->comboBox_redundancy->currentIndex());
+    setdat->redundancyPeer = ui->lineEdit_redundancyPeer->text();
+    setdat->redundancyPort = ui->lineEdit_redundancyPort->text().toUShort();
+    setdat->syncRole = static_cast<uint8_t>(ui->comboBox_sync->currentIndex());
+    setdat->syncMaster = ui->lineEdit_syncMaster->text();
+    setdat->syncPort = ui->lineEdit_syncPort->text().toUShort();
+    setdat->ltcDevice = ui->comboBox_ltcDevice->currentData().toString();
+    setdat->ltcChannel = static_cast<uint8_t>(ui->spinBox_ltcChannel->value() - 1);
     emit settingsData(*setdat);
 
     // Save settings to file
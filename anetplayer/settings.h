@@ -18,6 +18,8 @@ class Settings : public QDialog
 public:
     explicit Settings(QWidget *parent = nullptr);
     ~Settings();
+    void setSettings(const settings_t &loadedSettings);
+    void setInterfaces(const QStringList &interfaces);
 
 private slots:
     void on_pushButton_Cancel_clicked();
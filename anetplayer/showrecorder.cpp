@@ -0,0 +1,325 @@
+#include "showrecorder.h"
+#include <QDir>
+#include <QDateTime>
+#include <QtEndian>
+#include <algorithm>
+
+#define SHOW_LOG_MAGIC "ANSR"
+#define SHOW_LOG_VERSION 1
+#define SHOW_LOG_HEADER_SIZE 32
+#define SHOW_LOG_WRITE_MS 50 // The log thread drains the ring this often
+
+// Header: magic[4] version:u32 startEpochMs:i64 startNs:i64 reserved[8]
+// Entry:  type:u8 timeDelta:varint payload
+//   TIMECODE:  streamId:u8 rateType:u8 frameDelta:varint (frames since the previous timecode of the stream)
+//   TRANSPORT: action:u8 cue:varint positionMs:varint
+//   DROPPED:   count:varint
+//   DRIFT:     cue:varint offsetUs:varint driftPpb:varint
+// Signed values are zigzag encoded, so a normal frame advance takes one byte
+
+static void putVarint(QByteArray &out, qint64 value)
+{
+    quint64 v = (quint64(value) << 1) ^ quint64(value >> 63); // Zigzag
+    while (v >= 0x80)
+    {
+        out.append(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.append(static_cast<char>(v));
+}
+
+static bool getVarint(const QByteArray &data, qint64 &pos, qint64 &value)
+{
+    quint64 v = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos >= data.size()) return false;
+        const quint8 byte = static_cast<quint8>(data[pos++]);
+        v |= quint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            value = qint64(v >> 1) ^ -qint64(v & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static int nominalFps(quint8 rateType)
+{
+    switch (rateType) {
+    case 0: return 24;
+    case 1: return 25;
+    default: return 30; // 29.97 drop-frame labels count like 30
+    }
+}
+
+// Label count at the nominal rate, the labels are restored from it exactly
+static qint64 frameNumber(const quint8 *tc)
+{
+    return ((qint64(tc[3]) * 60 + tc[2]) * 60 + tc[1]) * nominalFps(tc[4]) + tc[0];
+}
+
+static void frameLabels(qint64 frame, quint8 rateType, quint8 *tc)
+{
+    const int fps = nominalFps(rateType);
+    if (frame < 0) frame = 0;
+    tc[0] = static_cast<quint8>(frame % fps);
+    frame /= fps;
+    tc[1] = static_cast<quint8>(frame % 60);
+    frame /= 60;
+    tc[2] = static_cast<quint8>(frame % 60);
+    tc[3] = static_cast<quint8>(frame / 60);
+    tc[4] = rateType;
+}
+
+ShowRecorder::ShowRecorder(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ShowRecorder::~ShowRecorder()
+{
+    stop();
+}
+
+bool ShowRecorder::start(const QString &directory)
+{
+    stop();
+
+    QDir dir(directory);
+    if (!dir.mkpath("."))
+    {
+        emit sendMsg("Can't create the show log directory: " + directory);
+        return false;
+    }
+
+    const QDateTime startTime = QDateTime::currentDateTime();
+    logFile.setFileName(dir.filePath("show-" + startTime.toString("yyyyMMdd-HHmmss") + "." SHOW_LOG_SUFFIX));
+    if (!logFile.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        emit sendMsg("Can't open the show log: " + logFile.fileName());
+        return false;
+    }
+
+    lastTimeNs = now();
+    std::fill(std::begin(lastFrame), std::end(lastFrame), 0);
+
+    if (logFile.size() == 0)
+    {
+        uchar header[SHOW_LOG_HEADER_SIZE] = {};
+        memcpy(header, SHOW_LOG_MAGIC, 4);
+        qToLittleEndian<quint32>(SHOW_LOG_VERSION, header + 4);
+        qToLittleEndian<qint64>(startTime.toMSecsSinceEpoch(), header + 8);
+        qToLittleEndian<qint64>(lastTimeNs, header + 16);
+        logFile.write(reinterpret_cast<const char*>(header), SHOW_LOG_HEADER_SIZE);
+        logFile.flush();
+    }
+
+    stopRequested = false;
+    dropped.store(0, std::memory_order_relaxed);
+    thread = QThread::create([this]() { writerLoop(); });
+    thread->setObjectName("Show recorder");
+    thread->start();
+    recording.store(true, std::memory_order_release);
+    return true;
+}
+
+void ShowRecorder::stop()
+{
+    if (!thread) return;
+
+    recording.store(false, std::memory_order_release);
+    {
+        QMutexLocker locker(&mutex);
+        stopRequested = true;
+        wakeUp.wakeAll();
+    }
+    // The log thread writes the rest of the ring before exit
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+    logFile.close();
+}
+
+bool ShowRecorder::isRecording() const
+{
+    return recording.load(std::memory_order_acquire);
+}
+
+QString ShowRecorder::fileName() const
+{
+    return logFile.fileName();
+}
+
+void ShowRecorder::recordTransport(transport_action_t action, int cue, qint64 positionMs)
+{
+    show_record_t record;
+    record.timeNs = now();
+    record.type = SHOW_REC_TRANSPORT;
+    record.streamId = 0;
+    record.action = static_cast<quint8>(action);
+    memset(record.tc, 0, sizeof(record.tc));
+    record.cue = cue;
+    record.value = positionMs;
+    record.value2 = 0;
+    push(record);
+}
+
+void ShowRecorder::recordDrift(int cue, double offsetMs, double driftPpm)
+{
+    show_record_t record;
+    record.timeNs = now();
+    record.type = SHOW_REC_DRIFT;
+    record.streamId = 0;
+    record.action = 0;
+    memset(record.tc, 0, sizeof(record.tc));
+    record.cue = cue;
+    record.value = qRound64(offsetMs * 1000.0);
+    record.value2 = qRound64(driftPpm * 1000.0);
+    push(record);
+}
+
+void ShowRecorder::writerLoop()
+{
+    QByteArray out;
+    bool writeOk = true;
+    for (;;)
+    {
+        bool stopping;
+        {
+            QMutexLocker locker(&mutex);
+            if (!stopRequested)
+                wakeUp.wait(&mutex, SHOW_LOG_WRITE_MS);
+            stopping = stopRequested;
+        }
+
+        show_record_t record;
+        while (ring.pop(record))
+            encode(record, out);
+
+        const quint32 lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0)
+        {
+            show_record_t marker = {};
+            marker.type = SHOW_REC_DROPPED;
+            marker.timeNs = now();
+            marker.cue = -1;
+            marker.value = lost;
+            encode(marker, out);
+        }
+
+        if (!out.isEmpty())
+        {
+            bool ok = logFile.write(out) == out.size() && logFile.flush();
+            if (!ok && writeOk)
+                emit sendMsg("ERROR! Show log write failed: " + logFile.fileName());
+            writeOk = ok;
+            out.clear();
+        }
+
+        if (stopping) break;
+    }
+}
+
+void ShowRecorder::encode(const show_record_t &record, QByteArray &out)
+{
+    out.append(static_cast<char>(record.type));
+    putVarint(out, record.timeNs - lastTimeNs);
+    lastTimeNs = record.timeNs;
+
+    switch (record.type) {
+    case SHOW_REC_TIMECODE:
+    {
+        const qint64 frame = frameNumber(record.tc);
+        out.append(static_cast<char>(record.streamId));
+        out.append(static_cast<char>(record.tc[4]));
+        putVarint(out, frame - lastFrame[record.streamId]);
+        lastFrame[record.streamId] = frame;
+        break;
+    }
+    case SHOW_REC_TRANSPORT:
+        out.append(static_cast<char>(record.action));
+        putVarint(out, record.cue);
+        putVarint(out, record.value);
+        break;
+    case SHOW_REC_DRIFT:
+        putVarint(out, record.cue);
+        putVarint(out, record.value);
+        putVarint(out, record.value2);
+        break;
+    default:
+        putVarint(out, record.value);
+        break;
+    }
+}
+
+bool ShowRecorder::readLog(const QString &fileName, show_log_t &log, QString *error)
+{
+    log = show_log_t();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (error) *error = "Can't open " + fileName;
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    if (data.size() < SHOW_LOG_HEADER_SIZE || !data.startsWith(SHOW_LOG_MAGIC)
+        || qFromLittleEndian<quint32>(data.constData() + 4) != SHOW_LOG_VERSION)
+    {
+        if (error) *error = "Not a show log: " + fileName;
+        return false;
+    }
+
+    log.startEpochMs = qFromLittleEndian<qint64>(data.constData() + 8);
+    log.startNs = qFromLittleEndian<qint64>(data.constData() + 16);
+
+    qint64 timeNs = log.startNs;
+    qint64 frames[256] = {};
+    qint64 pos = SHOW_LOG_HEADER_SIZE;
+    while (pos < data.size())
+    {
+        show_record_t record = {};
+        record.cue = -1;
+        record.type = static_cast<quint8>(data[pos++]);
+
+        qint64 delta;
+        if (!getVarint(data, pos, delta)) break; // Entry torn by a crash
+        timeNs += delta;
+        record.timeNs = timeNs;
+
+        bool ok = true;
+        qint64 value = 0;
+        qint64 cue = 0;
+        switch (record.type) {
+        case SHOW_REC_TIMECODE:
+            if (pos + 2 > data.size()) { ok = false; break; }
+            record.streamId = static_cast<quint8>(data[pos++]);
+            record.tc[4] = static_cast<quint8>(data[pos++]);
+            ok = getVarint(data, pos, value);
+            frames[record.streamId] += value;
+            frameLabels(frames[record.streamId], record.tc[4], record.tc);
+            break;
+        case SHOW_REC_TRANSPORT:
+            if (pos + 1 > data.size()) { ok = false; break; }
+            record.action = static_cast<quint8>(data[pos++]);
+            ok = getVarint(data, pos, cue) && getVarint(data, pos, record.value);
+            record.cue = static_cast<qint32>(cue);
+            break;
+        case SHOW_REC_DROPPED:
+            ok = getVarint(data, pos, record.value);
+            break;
+        case SHOW_REC_DRIFT:
+            ok = getVarint(data, pos, cue) && getVarint(data, pos, record.value) && getVarint(data, pos, record.value2);
+            record.cue = static_cast<qint32>(cue);
+            break;
+        default:
+            if (error) *error = QString("Unknown entry type %1 at offset %2").arg(record.type).arg(pos - 1);
+            return false;
+        }
+        if (!ok) break;
+        log.records.append(record);
+    }
+    return true;
+}
@@ -0,0 +1,117 @@
+#ifndef SHOWRECORDER_H
+#define SHOWRECORDER_H
+
+#include <QObject>
+#include <QFile>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include "struct.h"
+#include "ringbuffer.h"
+
+#define SHOW_LOG_SUFFIX "ansr"
+#define SHOW_RING_SIZE 8192 // Records buffered between the send path and the log thread
+
+typedef enum
+{
+    SHOW_REC_TIMECODE = 1,
+    SHOW_REC_TRANSPORT,
+    SHOW_REC_DROPPED,    // Records lost because the ring was full
+    SHOW_REC_DRIFT       // Timecode against the audio clock of a playing cue
+} show_record_type_t;
+
+// One log entry. Timecode is the ArtTimeCode payload: frames, seconds, minutes, hours, type
+typedef struct
+{
+    qint64 timeNs;      // Monotonic clock
+    quint8 type;        // show_record_type_t
+    quint8 streamId;
+    quint8 action;      // transport_action_t
+    quint8 tc[5];
+    qint32 cue;         // Cue index, -1 if unknown
+    qint64 value;       // Position in ms, the number of dropped records, or the drift offset in us
+    qint64 value2;      // Drift in ppb
+} show_record_t;
+
+typedef struct
+{
+    qint64 startEpochMs = 0; // Wall clock when the log was started
+    qint64 startNs = 0;      // Monotonic clock at the same moment
+    QVector<show_record_t> records;
+} show_log_t;
+
+// Always-on recorder of the emitted timecode and the transport actions.
+// The send path only takes a timestamp and pushes a fixed size record to a
+// lock-free ring, the log thread drains it and appends delta-encoded entries
+// to the log file. Records are pushed from one thread (the GUI thread).
+class ShowRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ShowRecorder(QObject *parent = nullptr);
+    ~ShowRecorder();
+
+    bool start(const QString &directory); // New log file named by the start time
+    void stop();
+    bool isRecording() const;
+    QString fileName() const;
+
+    void recordTimecode(quint8 streamId, const char *tc)
+    {
+        show_record_t record;
+        record.timeNs = now();
+        record.type = SHOW_REC_TIMECODE;
+        record.streamId = streamId;
+        record.action = 0;
+        memcpy(record.tc, tc, sizeof(record.tc));
+        record.cue = -1;
+        record.value = 0;
+        record.value2 = 0;
+        push(record);
+    }
+
+    void recordTransport(transport_action_t action, int cue, qint64 positionMs);
+    void recordDrift(int cue, double offsetMs, double driftPpm);
+
+    static qint64 now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static bool readLog(const QString &fileName, show_log_t &log, QString *error = nullptr);
+
+signals:
+    void sendMsg(const QString &msg);
+
+private:
+    RingBuffer<show_record_t, SHOW_RING_SIZE> ring;
+    std::atomic<bool> recording{false};
+    std::atomic<quint32> dropped{0};
+
+    QThread *thread = nullptr;
+    QMutex mutex;
+    QWaitCondition wakeUp;
+    bool stopRequested = false;
+
+    QFile logFile; // Used by the log thread only
+    qint64 lastTimeNs = 0;
+    qint64 lastFrame[256]; // Previous frame number of every stream
+
+    void push(const show_record_t &record)
+    {
+        if (!recording.load(std::memory_order_relaxed)) return;
+        if (!ring.push(record))
+            dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void writerLoop();
+    void encode(const show_record_t &record, QByteArray &out);
+};
+
+#endif // SHOWRECORDER_H
@@ -0,0 +1,278 @@
+#include "soaktest.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QThread>
+#include <QUdpSocket>
+#include <QRandomGenerator>
+#include <cmath>
+#include "clock.h"
+#include "frameclock.h"
+#include "artnetsender.h"
+
+#define SOAK_TIMER_MS 1              // Cue timer period, as CueButton
+#define SOAK_REPORT_MS 10            // Position reports of the player
+#define SOAK_PAST_MIDNIGHT_MS 60000  // Day runs go one minute past the rollover
+#define SOAK_SENDER_MS 3600000       // The loopback scenario sends one hour
+#define SOAK_MAX_ERRORS 5            // Reported errors per scenario
+#define SOAK_TC_OFFSET 14            // Timecode bytes in the ArtTimeCode packet
+#define DROP_FRAMES_PER_DAY 2589408  // 29.97 drop frame
+
+typedef struct
+{
+    QString name;
+    double fps;
+    qint64 durationMs;
+    qint64 adjustmentMs;
+    int reportMs;
+    int reportJitterMs;   // Reported position off by up to this, both ways
+    double audioPpm;      // Audio clock against the system clock
+    bool useSender;
+} soak_scenario_t;
+
+typedef struct
+{
+    qint64 frames = 0;
+    qint64 repeats = 0;   // Frame sent again after a report moved the playhead back
+    qint64 rollovers = 0;
+    qint64 received = 0;
+    qint64 errorCount = 0;
+    QStringList errors;
+    stream_stats_t stats;
+    qint64 elapsedMs = 0;
+} soak_result_t;
+
+static bool sameTimecode(const timecode_t &a, const timecode_t &b)
+{
+    return a.hh == b.hh && a.mm == b.mm && a.ss == b.ss && a.ff == b.ff;
+}
+
+// Counted independently of TCconverter
+static timecode_t nextTimecode(timecode_t tc, int base, bool dropFrame)
+{
+    if (++tc.ff >= base) { tc.ff = 0; ++tc.ss; }
+    if (tc.ss >= 60) { tc.ss = 0; ++tc.mm; }
+    if (tc.mm >= 60) { tc.mm = 0; ++tc.hh; }
+    if (tc.hh >= 24) tc.hh = 0;
+    // Frames 0 and 1 are dropped at every minute except each tenth
+    if (dropFrame && tc.ss == 0 && tc.ff < 2 && tc.mm % 10 != 0) tc.ff = 2;
+    return tc;
+}
+
+static QString timecodeText(const timecode_t &tc)
+{
+    return QString("%1:%2:%3:%4").arg(tc.hh, 2, 10, QChar('0')).arg(tc.mm, 2, 10, QChar('0'))
+        .arg(tc.ss, 2, 10, QChar('0')).arg(tc.ff, 2, 10, QChar('0'));
+}
+
+static soak_result_t runScenario(const soak_scenario_t &scenario, ArtNetSender *sender, QUdpSocket *receiver)
+{
+    soak_result_t result;
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    SimulatedClock clock;
+    FrameClock frameClock(&clock);
+    frameClock.setFramerate(scenario.fps);
+    if (sender) sender->setClock(&clock);
+    TCconverter converter;
+    QRandomGenerator random(1); // Same jitter on every run
+
+    const bool dropFrame = static_cast<int>(scenario.fps) == 29;
+    const int base = qRound(scenario.fps);
+    const qint64 framesPerDay = dropFrame ? DROP_FRAMES_PER_DAY : qint64(base) * 86400;
+    const quint8 type = (base == 24) ? 0 : (base == 25) ? 1 : dropFrame ? 2 : 3;
+
+    auto fail = [&result](const QString &msg) {
+        if (result.errors.size() < SOAK_MAX_ERRORS) result.errors.append(msg);
+        ++result.errorCount;
+    };
+
+    // Player: the audio clock, reported with some error
+    ClockTimer *reportTimer = clock.createTimer();
+    QObject::connect(reportTimer, &ClockTimer::timeout, [&]() {
+        qint64 position = static_cast<qint64>(clock.nowNs() * (1.0 + scenario.audioPpm * 1e-6) / 1e6);
+        if (scenario.reportJitterMs > 0)
+            position += random.bounded(2 * scenario.reportJitterMs + 1) - scenario.reportJitterMs;
+        frameClock.setAudioPosition(qMax<qint64>(position, 0));
+    });
+
+    timecode_t last = {};
+    bool haveLast = false;
+    ClockTimer *cueTimer = clock.createTimer();
+    QObject::connect(cueTimer, &ClockTimer::timeout, [&]() {
+        // As CueButton::updateTime
+        const qint64 position = frameClock.position();
+        timecode_t tc;
+        if (!frameClock.nextFrame(position, tc)) return;
+        const QString anetTime = converter.anetTime(position, scenario.adjustmentMs, scenario.fps);
+        const QByteArray packet = ArtNetSender::timecodePacket(0, anetTime);
+        ++result.frames;
+
+        const quint8 *data = reinterpret_cast<const quint8*>(packet.constData()) + SOAK_TC_OFFSET;
+        timecode_t sent;
+        sent.ff = data[0];
+        sent.ss = data[1];
+        sent.mm = data[2];
+        sent.hh = data[3];
+        sent.fps = base;
+        if (data[4] != type)
+            fail(QString("%1: rate type %2, expected %3").arg(anetTime).arg(data[4]).arg(type));
+
+        // Continuity
+        if (haveLast)
+        {
+            const timecode_t expected = nextTimecode(last, base, dropFrame);
+            if (sameTimecode(sent, expected))
+            {
+                if (sent.hh == 0 && last.hh == 23) ++result.rollovers;
+            }
+            else if (sameTimecode(sent, last) || sameTimecode(nextTimecode(sent, base, dropFrame), last))
+                ++result.repeats;
+            else
+                fail(QString("%1 after %2, expected %3").arg(timecodeText(sent), timecodeText(last), timecodeText(expected)));
+        }
+        last = sent;
+        haveLast = true;
+
+        // Content: frame number of the shifted position, counted back from the timecode
+        const double exact = std::floor((position + scenario.adjustmentMs) * scenario.fps / 1000);
+        const qint64 frame = ((static_cast<qint64>(exact) % framesPerDay) + framesPerDay) % framesPerDay;
+        const qint64 counted = dropFrame ? converter.dftc2frames(sent) : converter.ndftc2frames(sent);
+        if (counted != frame)
+            fail(QString("%1 at %2 ms is frame %3, expected %4").arg(anetTime).arg(position).arg(counted).arg(frame));
+
+        if (sender)
+        {
+            sender->sendTime(anetTime);
+            QCoreApplication::sendPostedEvents(sender, QEvent::MetaCall); // The queued service pass
+            while (receiver->hasPendingDatagrams())
+            {
+                QByteArray datagram(static_cast<int>(receiver->pendingDatagramSize()), Qt::Uninitialized);
+                receiver->readDatagram(datagram.data(), datagram.size());
+                if (datagram.mid(SOAK_TC_OFFSET) != packet.mid(SOAK_TC_OFFSET))
+                    fail(QString("Received packet differs from %1").arg(anetTime));
+                ++result.received;
+            }
+        }
+    });
+
+    frameClock.setAudioPosition(0); // GO
+    reportTimer->start(scenario.reportMs);
+    cueTimer->start(SOAK_TIMER_MS);
+    clock.advanceTo((scenario.durationMs - 1) * 1000000);
+    delete cueTimer;
+    delete reportTimer;
+
+    // Totals of an exact audio clock
+    const bool ideal = scenario.reportJitterMs == 0 && scenario.audioPpm == 0;
+    if (ideal)
+    {
+        const qint64 expectedFrames = static_cast<qint64>((scenario.durationMs - 1) * scenario.fps / 1000);
+        if (result.frames != expectedFrames)
+            fail(QString("%1 frames, expected %2").arg(result.frames).arg(expectedFrames));
+        if (result.repeats > 0)
+            fail(QString("%1 repeated frames").arg(result.repeats));
+    }
+    const double dayMs = 86400000.0;
+    const bool crossesMidnight = std::floor(scenario.adjustmentMs / dayMs)
+                                 != std::floor((scenario.adjustmentMs + scenario.durationMs - 1) / dayMs);
+    if (crossesMidnight && result.rollovers == 0)
+        fail("No rollover at midnight");
+
+    if (sender)
+    {
+        result.stats = sender->getStreamStats(0);
+        if (result.received != result.frames)
+            fail(QString("%1 packets received, %2 sent").arg(result.received).arg(result.frames));
+        // On the simulated clock the only jitter is the timer period
+        if (result.stats.maxJitterMs > SOAK_TIMER_MS + 1e-6)
+            fail(QString("Sender jitter %1 ms").arg(result.stats.maxJitterMs));
+        sender->setClock(Clock::system());
+    }
+    result.elapsedMs = elapsed.elapsed();
+    return result;
+}
+
+int runSoak(double hours)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    const qint64 dayMs = static_cast<qint64>(hours * 3600000) + SOAK_PAST_MIDNIGHT_MS;
+
+    QVector<soak_scenario_t> scenarios = {
+        {"24 fps day", 24, dayMs, 0, SOAK_REPORT_MS, 0, 0, false},
+        {"25 fps day", 25, dayMs, 0, SOAK_REPORT_MS, 0, 0, false},
+        {"29.97df day", 29.97, dayMs, 0, SOAK_REPORT_MS, 0, 0, false},
+        {"30 fps day", 30, dayMs, 0, SOAK_REPORT_MS, 0, 0, false},
+        {"29.97df from -10 s", 29.97, 3600000, -10000, SOAK_REPORT_MS, 0, 0, false},
+        {"30 fps from -10 s", 30, 3600000, -10000, SOAK_REPORT_MS, 0, 0, false},
+        {"25 fps jittery player", 25, dayMs, 0, 40, 3, 30, false},
+        {"25 fps sender", 25, SOAK_SENDER_MS, 0, SOAK_REPORT_MS, 0, 0, true},
+    };
+    QVector<soak_result_t> results(scenarios.size());
+
+    QElapsedTimer total;
+    total.start();
+
+    // Simulated scenarios on their own threads, the sender on this one
+    QVector<QThread*> threads;
+    for (int i = 0; i < scenarios.size(); ++i)
+    {
+        if (scenarios[i].useSender) continue;
+        QThread *thread = QThread::create([&scenarios, &results, i]() {
+            results[i] = runScenario(scenarios[i], nullptr, nullptr);
+        });
+        thread->setObjectName("Soak " + scenarios[i].name);
+        thread->start();
+        threads.append(thread);
+    }
+
+    for (int i = 0; i < scenarios.size(); ++i)
+    {
+        if (!scenarios[i].useSender) continue;
+        QUdpSocket receiver;
+        if (!receiver.bind(QHostAddress::LocalHost, 0))
+        {
+            err << "Can't open the loopback timecode socket" << Qt::endl;
+            results[i].errors.append("No loopback socket");
+            ++results[i].errorCount;
+            continue;
+        }
+        receiver.setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 1 << 18);
+        ArtNetSender sender;
+        sender.setTargetIP("127.0.0.1");
+        sender.setTargetPort(receiver.localPort());
+        results[i] = runScenario(scenarios[i], &sender, &receiver);
+    }
+
+    for (QThread *thread : threads)
+    {
+        thread->wait();
+        delete thread;
+    }
+
+    int failed = 0;
+    for (int i = 0; i < scenarios.size(); ++i)
+    {
+        const soak_scenario_t &scenario = scenarios[i];
+        const soak_result_t &result = results[i];
+        const bool ok = result.errorCount == 0;
+        if (!ok) ++failed;
+        out << QString("%1  %2  %3 h simulated in %4 s, %5 frames, %6 repeats, %7 rollovers")
+                   .arg(ok ? "PASS" : "FAIL").arg(scenario.name, -22)
+                   .arg(scenario.durationMs / 3600000.0, 0, 'f', 2).arg(result.elapsedMs / 1000.0, 0, 'f', 2)
+                   .arg(result.frames).arg(result.repeats).arg(result.rollovers) << Qt::endl;
+        if (scenario.useSender)
+            out << QString("      sender: %1 packets, mean interval %2 ms, max jitter %3 ms")
+                       .arg(result.stats.packets).arg(result.stats.meanIntervalMs, 0, 'f', 3)
+                       .arg(result.stats.maxJitterMs, 0, 'f', 3) << Qt::endl;
+        for (const QString &error : result.errors)
+            out << "      " << error << Qt::endl;
+        if (result.errorCount > result.errors.size())
+            out << QString("      ... %1 errors").arg(result.errorCount) << Qt::endl;
+    }
+    out << QString("%1 of %2 scenarios passed in %3 s").arg(scenarios.size() - failed).arg(scenarios.size())
+               .arg(total.elapsed() / 1000.0, 0, 'f', 2) << Qt::endl;
+    return failed > 0 ? 1 : 0;
+}
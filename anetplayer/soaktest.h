@@ -0,0 +1,13 @@
+#ifndef SOAKTEST_H
+#define SOAKTEST_H
+
+// Long runs of the timecode path on a simulated clock. Every scenario drives
+// a FrameClock with the 1 ms cue timer and simulated position reports of
+// the player, the sent timecode is checked frame by frame: each frame must
+// follow the previous one, 29.97 must drop the right frame numbers and
+// 23:59:59 must roll over to 00:00:00. One scenario also sends through an
+// ArtNetSender on loopback. The scenarios run in parallel, a full day of
+// playback takes seconds. Returns 0 when every scenario passed.
+int runSoak(double hours);
+
+#endif // SOAKTEST_H
@@ -0,0 +1,38 @@
+#include "startup.h"
+#include <QElapsedTimer>
+#include <QVector>
+#include <QPair>
+#include "trace.h"
+
+static QElapsedTimer startupTimer;
+static QVector<QPair<const char*, qint64>> phases; // Name, end in ns
+
+void startupBegin()
+{
+    startupTimer.start();
+    phases.clear();
+}
+
+void startupMark(const char *phase)
+{
+    if (!startupTimer.isValid()) return;
+    phases.append(qMakePair(phase, startupTimer.nsecsElapsed()));
+    TRACE_INSTANT("startup", phase);
+}
+
+qint64 startupElapsedMs()
+{
+    return startupTimer.isValid() ? startupTimer.elapsed() : 0;
+}
+
+QString startupReport()
+{
+    QStringList parts;
+    qint64 previousNs = 0;
+    for (const auto &phase : phases)
+    {
+        parts.append(QString("%1 %2 ms").arg(phase.first).arg((phase.second - previousNs) / 1e6, 0, 'f', 1));
+        previousNs = phase.second;
+    }
+    return QString("Started in %1 ms: %2").arg(previousNs / 1e6, 0, 'f', 1).arg(parts.join(", "));
+}
@@ -0,0 +1,15 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <QString>
+
+#define STARTUP_TARGET_MS 200 // From main() to the first usable window
+
+// Phase timings of the cold start, GUI thread only. startupBegin() is the
+// first line of main(), every startupMark() ends a phase.
+void startupBegin();
+void startupMark(const char *phase);
+qint64 startupElapsedMs();
+QString startupReport(); // "Started in N ms: phase N ms, ..."
+
+#endif // STARTUP_H
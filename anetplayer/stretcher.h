@@ -6,6 +6,7 @@
 #include <QFont>
 #include <QTimer>
 #include <QLabel>
+#include "trace.h"
 
 class LabelStretcher : public QObject {
     Q_OBJECT
@@ -33,6 +34,7 @@ private:
 
     void resizeAll() {
         if (widgets.isEmpty()) return;
+        TRACE_SCOPE("ui", "LabelStretcher::resizeAll");
 
         qreal minFontSize = std::numeric_limits<qreal>::max();
         for (auto widget : widgets) {
@@ -1,6 +1,8 @@
 #ifndef STRUCT_H
 #define STRUCT_H
 #include <QMainWindow>
+#include <QColor>
+#include <QVector>
 
 typedef struct
 {
@@ -11,6 +13,18 @@ typedef struct
     QString ip;
     uint16_t port;
     bool tcOut;
+    uint16_t oscPort;  // OSC control server, 0 = off
+    QString oscSenders; // Trusted OSC sender addresses, comma separated
+    uint16_t displayPort; // Timecode display web server, 0 = off
+    QString displayAddress; // Local address it listens on
+    uint8_t redundancyRole; // redundancy_role_t
+    QString redundancyPeer; // Backup address of the primary
+    uint16_t redundancyPort; // Heartbeat port
+    uint8_t syncRole; // sync_role_t
+    QString syncMaster; // Master address of the clients
+    uint16_t syncPort; // Clock sync port
+    QString ltcDevice; // Audio output id of the live LTC, empty = off
+    uint8_t ltcChannel; // Channel of the LTC on it, from 0
 } settings_t;
 
 typedef struct
@@ -22,5 +36,122 @@ typedef struct
     uint8_t fps;
 } timecode_t;
 
+typedef enum
+{
+    CUE_EVENT_MARKER = 0, // UI marker, shown in the play status
+    CUE_EVENT_OSC,        // OSC message with one int argument
+    CUE_EVENT_TRIGGER     // Art-Net ArtTrigger packet
+} cue_event_type_t;
+
+typedef struct
+{
+    qint64 timeMs = 0;     // Position in the cue
+    qint64 durationMs = 0; // Length of the marker region, 0 = until the next marker
+    cue_event_type_t type = CUE_EVENT_MARKER;
+    QString text;          // Marker text or OSC address
+    qint32 value = 0;      // OSC argument or ArtTrigger Key
+    qint32 subValue = 0;   // ArtTrigger SubKey
+    QString host;          // Destination, empty = Art-Net target IP
+    quint16 port = 0;      // Destination port, 0 = default port of the event type
+} cue_event_t;
+
+// Timecode of a looping cue at the loop point
+typedef enum
+{
+    LOOP_TC_JUMP = 0,   // Jumps back to the in point with the audio
+    LOOP_TC_CONTINUE    // Counts on from the loop start, free running
+} loop_tc_mode_t;
+
+typedef struct
+{
+    QString filePath;
+    qint64 adjustmentTime;
+    QString frameRate;
+    QColor cueColor;
+    QVector<cue_event_t> events;
+    int deck = 0;          // Deck that plays the cue
+    QString loopIn;        // Loop region "hh:mm:ss:ff" at the cue framerate, empty = no loop
+    QString loopOut;
+    quint8 loopTcMode = LOOP_TC_JUMP; // loop_tc_mode_t
+    bool ltcOut = false;   // Also sends its timecode as live LTC
+} cue_t;
+
+typedef struct
+{
+    int rows;
+    int columns;
+    QVector<cue_t> cues;
+} playlist_t;
+
+// Edited part of the playlist, also the record type of the playlist journal
+typedef enum
+{
+    CUE_FIELD_FILE = 1,
+    CUE_FIELD_OFFSET,
+    CUE_FIELD_COLOR,
+    CUE_FIELD_FRAMERATE,
+    CUE_FIELD_CLEAR,
+    CUE_FIELD_GRID,
+    CUE_FIELD_EVENTS,
+    CUE_FIELD_DECK,
+    CUE_FIELD_LOOP,
+    CUE_FIELD_LTC
+} cue_field_t;
+
+typedef struct
+{
+    QString ip;
+    quint16 port;
+} destination_t;
+
+// Independent player with its own transport and ArtTimeCode stream
+typedef struct
+{
+    QString name;
+    quint8 streamId = 0;
+    QVector<destination_t> destinations; // Empty: the target IP and port of the settings
+} deck_t;
+
+#define MAX_DECKS 16
+
+// Transport actions of a cue, recorded in the show log
+typedef enum
+{
+    TRANSPORT_GO = 1,   // Cue started from the beginning
+    TRANSPORT_PLAY,     // Resumed
+    TRANSPORT_PAUSE,
+    TRANSPORT_STOP,
+    TRANSPORT_LOCATE,   // Playhead moved
+    TRANSPORT_END       // End of media
+} transport_action_t;
+
+typedef enum
+{
+    MEDIA_UNKNOWN = 0,  // Not probed yet
+    MEDIA_OK,
+    MEDIA_UNSUPPORTED,  // File exists, but its format can't be analysed (the player still may decode it)
+    MEDIA_MISSING,
+    MEDIA_BROKEN
+} media_status_t;
+
+#define MEDIA_PEAK_BINS 128 // Size of the waveform overview
+
+typedef struct
+{
+    media_status_t status = MEDIA_UNKNOWN;
+    QString format;
+    int sampleRate = 0;
+    int channels = 0;
+    quint32 channelMask = 0; // Speaker layout of WAVE_FORMAT_EXTENSIBLE, 0 = default layout for the channel count
+    qint64 sampleFrames = 0; // Exact length in samples per channel
+    qint64 durationMs = 0;
+    qint64 fileSize = 0;
+    qint64 modified = 0; // Last modification time of the file, ms since epoch
+    QByteArray hash; // SHA-1 of the file content
+    bool hasLevels = false; // Levels are measured for PCM files only
+    float rmsDb = 0; // RMS level, dBFS
+    float peakDb = 0; // Sample peak, dBFS
+    QByteArray peaks; // Waveform overview, MEDIA_PEAK_BINS values 0..255
+} media_info_t;
 
 #endif // STRUCT_H
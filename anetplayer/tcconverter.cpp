@@ -1,4 +1,5 @@
 #include "tcconverter.h"
+#include <cmath>
 
 TCconverter::TCconverter() {}
 
@@ -10,14 +11,12 @@ timecode_t TCconverter::frames2dftc(const qint64 &frames)
     constexpr int framesPerHour = static_cast<int>(framerate * 60 * 60 + 0.5);
     constexpr int framesPer24Hours = framesPerHour * 24;
     constexpr int framesPer10Minutes = static_cast<int>(framerate * 600 + 0.5);
-    constexpr int framesPerMinute = static_cast<int>(framerate * 60 + 0.5) - dropFrames; // Количество кадров в минуте с учётом дроп-фреймов
+    constexpr int framesPerMinute = static_cast<int>(framerate + 0.5) * 60 - dropFrames; // Количество кадров в минуте с учётом дроп-фреймов
 
     qint64 frameNumber = frames;
 
-    // Adjust for negative frame numbers by adding a full 24-hour frame count
-    frameNumber = (frameNumber < 0) ? frameNumber + framesPer24Hours : frameNumber;
-    // If frame number exceeds 24 hours, wrap it around (timecode rollover)
-    frameNumber %= framesPer24Hours;
+    // Wrap around 24 hours both ways (timecode rollover)
+    frameNumber = ((frameNumber % framesPer24Hours) + framesPer24Hours) % framesPer24Hours;
 
     int full10MinBlocks = frameNumber / framesPer10Minutes;
     int remainingFrames = frameNumber % framesPer10Minutes;
@@ -48,11 +47,8 @@ timecode_t TCconverter::frames2ndftc(const qint64 &frames, const int &framerate)
     const int framesPerHour = framerate * 60 * 60;
     const int framesPer24Hours = framesPerHour * 24;
 
-    // Adjust for negative frame numbers by adding a full 24-hour frame count
-    qint64 frameNumber = (frames < 0) ? frames + framesPer24Hours : frames;
-
-    // If frame number exceeds 24 hours, wrap it around (timecode rollover)
-    frameNumber %= framesPer24Hours;
+    // Wrap around 24 hours both ways (timecode rollover)
+    qint64 frameNumber = ((frames % framesPer24Hours) + framesPer24Hours) % framesPer24Hours;
 
     timecode_t tc;
     const int fps = framerate;
@@ -71,7 +67,8 @@ timecode_t TCconverter::frames2ndftc(const qint64 &frames, const int &framerate)
 timecode_t TCconverter::milliseconds2tc(const qint64 &ms, const double &framerate)
 {
     timecode_t tc;
-    quint64 frames = ms * framerate / 1000;
+    // Frames before the start count down from 24 hours
+    qint64 frames = static_cast<qint64>(std::floor(ms * framerate / 1000));
     int fps = static_cast<int>(framerate);
     if (fps == 29)
     {
@@ -110,7 +107,7 @@ qint64 TCconverter::tc2milliseconds(const timecode_t &tc)
 {
     quint64 totalMilliseconds = 0;
     int fps = static_cast<int>(tc.fps);
-    if (fps == 29.97)
+    if (fps == 29) // 29.97 drop frame
     {
         totalMilliseconds = (dftc2frames(tc) * 1000) / 29.97;
     }
@@ -121,6 +118,12 @@ qint64 TCconverter::tc2milliseconds(const timecode_t &tc)
     return totalMilliseconds;
 }
 
+QString TCconverter::anetTime(qint64 positionMs, qint64 adjustmentMs, double framerate)
+{
+    timecode_t tc = milliseconds2tc(positionMs + adjustmentMs, framerate);
+    return tc2string(tc) + QString(":%1").arg(static_cast<int>(framerate));
+}
+
 QString TCconverter::tc2string(const timecode_t &tc)
 {
     QString strTime = QString("%1:%2:%3:%4")
@@ -19,6 +19,8 @@ public:
     qint64 tc2milliseconds(const timecode_t &tc);
 
     QString tc2string(const timecode_t &tc);
+    // "hh:mm:ss:ff:fps" of the cue position shifted by the signed adjustment, as sent to Art-Net
+    QString anetTime(qint64 positionMs, qint64 adjustmentMs, double framerate);
 
 };
 
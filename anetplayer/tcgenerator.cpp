@@ -0,0 +1,167 @@
+#include "tcgenerator.h"
+
+#define NS_PER_S 1000000000LL
+
+// Integer division rounded down and up, for frames on both sides of the anchor
+static qint64 floorDiv(qint64 a, qint64 b)
+{
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+static qint64 ceilDiv(qint64 a, qint64 b)
+{
+    return -floorDiv(-a, b);
+}
+
+TimecodeGenerator::TimecodeGenerator(QObject *parent, Clock *clock)
+    : QObject(parent), clock(clock), timer(clock->createTimer(this))
+{
+    timer->setSingleShot(true); // Set to the next frame edge every time
+    connect(timer, &ClockTimer::timeout, this, &TimecodeGenerator::tick);
+}
+
+void TimecodeGenerator::setFrameRate(const QString &framerate)
+{
+    const timecode_t current = timecode();
+    const timecode_t start = getStartTimecode();
+    const framerate_t &rate = frameRateOf(framerate);
+    fps = rate.fps;
+    rateNum = rate.rateNum;
+    rateDen = rate.rateDen;
+
+    // The same timecodes at the new rate, a running generator continues from now
+    startFrame = tcToFrame(start);
+    currentFrame = tcToFrame(current);
+    anchorFrame = currentFrame;
+    anchorNs = clock->nowNs();
+    if (running) scheduleNextFrame();
+}
+
+double TimecodeGenerator::getFrameRate() const
+{
+    return fps;
+}
+
+void TimecodeGenerator::setStartTimecode(const timecode_t &tc)
+{
+    startFrame = tcToFrame(tc);
+    if (!running)
+        currentFrame = startFrame;
+}
+
+timecode_t TimecodeGenerator::getStartTimecode() const
+{
+    return (static_cast<int>(fps) == 29) ? converter.frames2dftc(startFrame)
+                                         : converter.frames2ndftc(startFrame, static_cast<int>(fps));
+}
+
+void TimecodeGenerator::start()
+{
+    endFrame = -1;
+    if (running) return;
+    running = true;
+    anchorFrame = currentFrame;
+    anchorNs = clock->nowNs();
+    emit runningChanged(true);
+    emit frameChanged(frameText(currentFrame));
+    scheduleNextFrame();
+}
+
+void TimecodeGenerator::runFor(qint64 durationMs)
+{
+    start();
+    // Whole frames of the duration from the frame that is out now
+    endFrame = currentFrame + qMax<qint64>(1, floorDiv(durationMs * rateNum, rateDen * 1000));
+}
+
+void TimecodeGenerator::stop()
+{
+    if (!running) return;
+    timer->stop();
+    running = false;
+    endFrame = -1;
+    emit runningChanged(false);
+}
+
+void TimecodeGenerator::locate(const timecode_t &tc)
+{
+    currentFrame = tcToFrame(tc);
+    anchorFrame = currentFrame;
+    anchorNs = clock->nowNs();
+    if (endFrame >= 0) endFrame = -1; // The duration was counted from the old position
+    emit frameChanged(frameText(currentFrame));
+    if (running) scheduleNextFrame();
+}
+
+bool TimecodeGenerator::isRunning() const
+{
+    return running;
+}
+
+qint64 TimecodeGenerator::frame() const
+{
+    return currentFrame;
+}
+
+timecode_t TimecodeGenerator::timecode() const
+{
+    return (static_cast<int>(fps) == 29) ? converter.frames2dftc(currentFrame)
+                                         : converter.frames2ndftc(currentFrame, static_cast<int>(fps));
+}
+
+QString TimecodeGenerator::frameText(qint64 frame)
+{
+    const timecode_t tc = (static_cast<int>(fps) == 29) ? converter.frames2dftc(frame)
+                                                        : converter.frames2ndftc(frame, static_cast<int>(fps));
+    return converter.tc2string(tc) + QString(":%1").arg(static_cast<int>(fps));
+}
+
+qint64 TimecodeGenerator::frameEdgeNs(qint64 frame) const
+{
+    return anchorNs + ceilDiv((frame - anchorFrame) * rateDen * NS_PER_S, rateNum);
+}
+
+qint64 TimecodeGenerator::framesAt(qint64 nowNs)
+{
+    // rateNum frames take exactly rateDen seconds, moving the anchor by that keeps the products small
+    const qint64 periodNs = rateDen * NS_PER_S;
+    const qint64 periods = floorDiv(nowNs - anchorNs, periodNs);
+    if (periods > 0)
+    {
+        anchorNs += periods * periodNs;
+        anchorFrame += periods * rateNum;
+    }
+    return anchorFrame + floorDiv((nowNs - anchorNs) * rateNum, periodNs);
+}
+
+qint64 TimecodeGenerator::tcToFrame(timecode_t tc)
+{
+    tc.fps = static_cast<uint8_t>(fps);
+    return (tc.fps == 29) ? converter.dftc2frames(tc) : converter.ndftc2frames(tc);
+}
+
+void TimecodeGenerator::tick()
+{
+    if (!running) return;
+    const qint64 frame = framesAt(clock->nowNs());
+    if (frame > currentFrame)
+    {
+        if (endFrame >= 0 && frame >= endFrame)
+        {
+            currentFrame = endFrame;
+            stop();
+            emit finished();
+            return;
+        }
+        currentFrame = frame; // Frames missed by a late timer are skipped, as a cue does
+        emit frameChanged(frameText(currentFrame));
+    }
+    scheduleNextFrame();
+}
+
+// Timers never fire early on the clock, rounding up puts the tick just after the edge
+void TimecodeGenerator::scheduleNextFrame()
+{
+    const qint64 waitNs = frameEdgeNs(currentFrame + 1) - clock->nowNs();
+    timer->start(static_cast<int>(qMax<qint64>(0, ceilDiv(waitNs, 1000000))));
+}
@@ -0,0 +1,62 @@
+#ifndef TCGENERATOR_H
+#define TCGENERATOR_H
+
+#include <QObject>
+#include "clock.h"
+#include "tcconverter.h"
+#include "framerate.h"
+
+// Free-running timecode without audio, for rehearsals, countdowns and cues
+// that are only an offset. The frame count is exact: frame n starts
+// n * den / num seconds after the anchor on the clock, 29.97 runs at
+// 30000/1001 and is labelled drop frame. Every frame goes out as
+// "hh:mm:ss:ff:fps" with frameChanged(), the same string a playing cue sends.
+class TimecodeGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TimecodeGenerator(QObject *parent = nullptr, Clock *clock = Clock::system());
+
+    void setFrameRate(const QString &framerate); // "24", "25", "29.97", "30"
+    double getFrameRate() const;
+    void setStartTimecode(const timecode_t &tc); // Located there when stopped
+    timecode_t getStartTimecode() const;
+
+    void start(); // From the current frame, which is sent at once
+    void runFor(qint64 durationMs); // Start, stop after the duration
+    void stop(); // Holds the current frame
+    void locate(const timecode_t &tc);
+    bool isRunning() const;
+
+    qint64 frame() const; // Current frame, counted from 00:00:00:00
+    timecode_t timecode() const;
+    QString frameText(qint64 frame); // "hh:mm:ss:ff:fps", wrapped at 24 h
+    qint64 frameEdgeNs(qint64 frame) const; // Clock time the frame starts, while running
+
+signals:
+    void frameChanged(const QString &time);
+    void runningChanged(bool running);
+    void finished(); // End of runFor()
+
+private:
+    mutable TCconverter converter;
+    Clock *clock;
+    ClockTimer *timer;
+    double fps = 30;
+    qint64 rateNum = 30;    // Frames per rateDen seconds
+    qint64 rateDen = 1;
+    qint64 startFrame = 0;
+    qint64 currentFrame = 0;
+    qint64 anchorFrame = 0; // Frame that started at anchorNs
+    qint64 anchorNs = 0;
+    qint64 endFrame = -1;   // First frame not sent by runFor(), -1 = free running
+    bool running = false;
+
+    qint64 framesAt(qint64 nowNs);
+    qint64 tcToFrame(timecode_t tc);
+    void tick();
+    void scheduleNextFrame();
+};
+
+#endif // TCGENERATOR_H
@@ -0,0 +1,184 @@
+#include "tcrenderer.h"
+#include <QFile>
+#include <QHostAddress>
+#include <QtEndian>
+#include <cstring>
+#include "frameclock.h"
+#include "artnetsender.h"
+#include "framerate.h"
+
+#define PCAP_MAGIC 0xA1B2C3D4 // Microsecond timestamps
+#define PCAP_SNAPLEN 65535
+#define PCAP_LINKTYPE_ETHERNET 1
+#define PCAP_HEADER_SIZE 24
+#define PCAP_RECORD_HEADER_SIZE 16
+#define ETH_HEADER_SIZE 14
+#define IPV4_HEADER_SIZE 20
+#define UDP_HEADER_SIZE 8
+#define PCAP_WRITE_CHUNK (1 << 20)
+
+QVector<render_packet_t> TimecodeRenderer::render(const render_options_t &options)
+{
+    QVector<render_packet_t> packets;
+    if (options.durationMs <= 0 || options.timerMs <= 0) return packets;
+    packets.reserve(static_cast<int>(options.durationMs * options.fps / 1000) + 1);
+
+    SimulatedClock clock;
+    FrameClock frameClock(&clock);
+    frameClock.setFramerate(options.fps);
+    frameClock.setAudioPosition(0); // The audio starts with the GO
+
+    TCconverter converter;
+    ClockTimer *timer = clock.createTimer();
+    QObject::connect(timer, &ClockTimer::timeout, [&]() {
+        const qint64 position = frameClock.position();
+        timecode_t tc;
+        if (!frameClock.nextFrame(position, tc)) return;
+
+        render_packet_t packet;
+        packet.timeUs = clock.nowNs() / 1000;
+        packet.data = ArtNetSender::timecodePacket(options.streamId,
+                                                   converter.anetTime(position, options.adjustmentMs, options.fps));
+        packets.append(packet);
+    });
+    timer->start(options.timerMs);
+    clock.advanceTo((options.durationMs - 1) * 1000000); // Last tick before the end of the file
+    delete timer;
+    return packets;
+}
+
+static quint32 checksumAdd(quint32 sum, const uchar *data, int size)
+{
+    for (int i = 0; i + 1 < size; i += 2)
+        sum += (quint32(data[i]) << 8) | data[i + 1];
+    if (size & 1)
+        sum += quint32(data[size - 1]) << 8;
+    return sum;
+}
+
+static quint16 checksumFold(quint32 sum)
+{
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<quint16>(~sum);
+}
+
+bool TimecodeRenderer::writePcap(const QString &fileName, const QVector<render_packet_t> &packets,
+                                 const QString &srcIp, const QString &dstIp, quint16 port, qint64 startEpochUs)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    const quint32 src = QHostAddress(srcIp).toIPv4Address();
+    const quint32 dst = QHostAddress(dstIp).toIPv4Address();
+    const bool broadcast = (dst & 0xFF) == 0xFF;
+
+    QByteArray out;
+    out.reserve(PCAP_WRITE_CHUNK + 256);
+    uchar header[PCAP_HEADER_SIZE];
+    qToLittleEndian<quint32>(PCAP_MAGIC, header);
+    qToLittleEndian<quint16>(2, header + 4);
+    qToLittleEndian<quint16>(4, header + 6);
+    qToLittleEndian<qint32>(0, header + 8);
+    qToLittleEndian<quint32>(0, header + 12);
+    qToLittleEndian<quint32>(PCAP_SNAPLEN, header + 16);
+    qToLittleEndian<quint32>(PCAP_LINKTYPE_ETHERNET, header + 20);
+    out.append(reinterpret_cast<const char*>(header), sizeof(header));
+
+    quint16 ipId = 0;
+    for (const render_packet_t &packet : packets)
+    {
+        const int udpSize = UDP_HEADER_SIZE + packet.data.size();
+        const int frameSize = ETH_HEADER_SIZE + IPV4_HEADER_SIZE + udpSize;
+        const qint64 timeUs = startEpochUs + packet.timeUs;
+
+        uchar record[PCAP_RECORD_HEADER_SIZE];
+        qToLittleEndian<quint32>(static_cast<quint32>(timeUs / 1000000), record);
+        qToLittleEndian<quint32>(static_cast<quint32>(timeUs % 1000000), record + 4);
+        qToLittleEndian<quint32>(frameSize, record + 8);
+        qToLittleEndian<quint32>(frameSize, record + 12);
+        out.append(reinterpret_cast<const char*>(record), sizeof(record));
+
+        // Ethernet, locally administered source address
+        uchar eth[ETH_HEADER_SIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x02, 0x00, 0x02, 0x00, 0x00, 0x01, 0x08, 0x00};
+        if (!broadcast)
+        {
+            const uchar unicast[6] = {0x02, 0x00, 0x02, 0x00, 0x00, 0x02};
+            memcpy(eth, unicast, 6);
+        }
+        out.append(reinterpret_cast<const char*>(eth), sizeof(eth));
+
+        uchar ip[IPV4_HEADER_SIZE] = {};
+        ip[0] = 0x45;
+        qToBigEndian<quint16>(IPV4_HEADER_SIZE + udpSize, ip + 2);
+        qToBigEndian<quint16>(ipId++, ip + 4);
+        ip[8] = 64;  // TTL
+        ip[9] = 17;  // UDP
+        qToBigEndian<quint32>(src, ip + 12);
+        qToBigEndian<quint32>(dst, ip + 16);
+        qToBigEndian<quint16>(checksumFold(checksumAdd(0, ip, sizeof(ip))), ip + 10);
+        out.append(reinterpret_cast<const char*>(ip), sizeof(ip));
+
+        uchar udp[UDP_HEADER_SIZE] = {};
+        qToBigEndian<quint16>(port, udp);
+        qToBigEndian<quint16>(port, udp + 2);
+        qToBigEndian<quint16>(udpSize, udp + 4);
+        // Checksum over the pseudo header, the UDP header and the payload
+        quint32 sum = (src >> 16) + (src & 0xFFFF) + (dst >> 16) + (dst & 0xFFFF) + 17 + udpSize;
+        sum = checksumAdd(sum, udp, sizeof(udp));
+        sum = checksumAdd(sum, reinterpret_cast<const uchar*>(packet.data.constData()), packet.data.size());
+        quint16 checksum = checksumFold(sum);
+        qToBigEndian<quint16>(checksum == 0 ? 0xFFFF : checksum, udp + 6);
+        out.append(reinterpret_cast<const char*>(udp), sizeof(udp));
+        out.append(packet.data);
+
+        if (out.size() >= PCAP_WRITE_CHUNK)
+        {
+            if (file.write(out) != out.size()) return false;
+            out.clear();
+        }
+    }
+    return file.write(out) == out.size();
+}
+
+bool TimecodeRenderer::readPcap(const QString &fileName, QVector<render_packet_t> &packets, QString *error)
+{
+    packets.clear();
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (error) *error = "Can't open " + fileName;
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    const uchar *d = reinterpret_cast<const uchar*>(data.constData());
+    if (data.size() < PCAP_HEADER_SIZE || qFromLittleEndian<quint32>(d) != PCAP_MAGIC
+        || qFromLittleEndian<quint32>(d + 20) != PCAP_LINKTYPE_ETHERNET)
+    {
+        if (error) *error = "Not an Ethernet pcap file with microsecond timestamps: " + fileName;
+        return false;
+    }
+
+    const int headersSize = ETH_HEADER_SIZE + IPV4_HEADER_SIZE + UDP_HEADER_SIZE;
+    qint64 pos = PCAP_HEADER_SIZE;
+    while (pos + PCAP_RECORD_HEADER_SIZE <= data.size())
+    {
+        const qint64 timeUs = qint64(qFromLittleEndian<quint32>(d + pos)) * 1000000 + qFromLittleEndian<quint32>(d + pos + 4);
+        const quint32 size = qFromLittleEndian<quint32>(d + pos + 8);
+        pos += PCAP_RECORD_HEADER_SIZE;
+        if (pos + qint64(size) > data.size())
+        {
+            if (error) *error = QString("Truncated record at offset %1").arg(pos);
+            return false;
+        }
+        if (size >= quint32(headersSize))
+            packets.append({timeUs, data.mid(pos + headersSize, size - headersSize)});
+        pos += size;
+    }
+    return true;
+}
+
+double TimecodeRenderer::frameRateValue(const QString &frameRate)
+{
+    return frameRateOf(frameRate).fps; // Same table as CueButton::setFrameRate
+}
@@ -0,0 +1,47 @@
+#ifndef TCRENDERER_H
+#define TCRENDERER_H
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+#define RENDER_DEFAULT_SRC_IP "2.0.0.1"       // Art-Net primary network
+#define RENDER_DEFAULT_DST_IP "2.255.255.255"
+#define RENDER_ARTNET_PORT 6454
+
+typedef struct
+{
+    qint64 durationMs = 0;
+    double fps = 30;           // 24, 25, 29.97 (drop-frame) or 30
+    qint64 adjustmentMs = 0;   // Signed, as cue_t::adjustmentTime
+    quint8 streamId = 0;
+    int timerMs = 1;           // Period of the cue timer
+} render_options_t;
+
+typedef struct
+{
+    qint64 timeUs;     // From the GO
+    QByteArray data;   // ArtTimeCode packet
+} render_packet_t;
+
+// Offline render of the ArtTimeCode stream of a cue. The cue timer and the
+// FrameClock of CueButton run on a simulated clock that follows the audio
+// exactly, so the output depends only on the options and is the same on
+// every run and every build.
+class TimecodeRenderer
+{
+public:
+    static QVector<render_packet_t> render(const render_options_t &options);
+
+    // Ethernet/IPv4/UDP capture, timestamps from startEpochUs
+    static bool writePcap(const QString &fileName, const QVector<render_packet_t> &packets,
+                          const QString &srcIp = RENDER_DEFAULT_SRC_IP, const QString &dstIp = RENDER_DEFAULT_DST_IP,
+                          quint16 port = RENDER_ARTNET_PORT, qint64 startEpochUs = 0);
+
+    // UDP payloads and timestamps of a capture written by writePcap()
+    static bool readPcap(const QString &fileName, QVector<render_packet_t> &packets, QString *error = nullptr);
+
+    static double frameRateValue(const QString &frameRate); // Framerate of cue_t::frameRate
+};
+
+#endif // TCRENDERER_H
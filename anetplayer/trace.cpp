@@ -0,0 +1,126 @@
+#include "trace.h"
+
+#ifdef ANET_TRACE
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <algorithm>
+
+QMutex Trace::registryMutex;
+QVector<Trace::buffer_t*> Trace::registry;
+const qint64 Trace::originTicks = Trace::ticks();
+const qint64 Trace::originNs = Trace::steadyNs();
+
+Trace::buffer_t *Trace::registerThread()
+{
+    buffer_t *buffer = new buffer_t();
+    QThread *thread = QThread::currentThread();
+    QMutexLocker locker(&registryMutex);
+    buffer->tid = registry.size() + 1;
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread())
+        buffer->threadName = "GUI";
+    else if (!thread->objectName().isEmpty())
+        buffer->threadName = thread->objectName();
+    else
+        buffer->threadName = QString("Thread %1").arg(buffer->tid);
+    registry.append(buffer);
+    threadBuffer = buffer;
+    return buffer;
+}
+
+// JSON string body: quotes, backslashes and control characters escaped
+static QByteArray jsonEscape(const QByteArray &text)
+{
+    QByteArray escaped;
+    escaped.reserve(text.size());
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped.append('\\').append(c);
+        else if (static_cast<uchar>(c) < 0x20)
+            escaped.append("\\u00").append(QByteArray::number(static_cast<uchar>(c), 16).rightJustified(2, '0'));
+        else
+            escaped.append(c);
+    }
+    return escaped;
+}
+
+bool Trace::writeChromeJson(const QString &fileName)
+{
+    typedef struct
+    {
+        int tid;
+        trace_event_t event;
+    } flushed_t;
+
+    QVector<flushed_t> events;
+    QVector<QPair<int, QString>> threads;
+    {
+        QMutexLocker locker(&registryMutex);
+        for (buffer_t *buffer : registry)
+        {
+            threads.append(qMakePair(buffer->tid, buffer->threadName));
+            const quint64 written = buffer->written.load(std::memory_order_acquire);
+            const quint64 first = (written > TRACE_BUFFER_SIZE) ? written - TRACE_BUFFER_SIZE : 0;
+            for (quint64 index = first; index < written; ++index)
+            {
+                const slot_t &slot = buffer->entries[index & (TRACE_BUFFER_SIZE - 1)];
+                const quint64 before = slot.sequence.load(std::memory_order_acquire);
+                const trace_event_t event = slot.event;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                const quint64 after = slot.sequence.load(std::memory_order_relaxed);
+                if (before != 2 * index + 2 || after != before) continue; // Overwritten meanwhile
+                events.append({buffer->tid, event});
+            }
+        }
+    }
+    std::sort(events.begin(), events.end(), [](const flushed_t &a, const flushed_t &b) {
+        return a.event.start < b.event.start;
+    });
+
+    // ns per tick from the clock pair taken at startup and now
+    if (steadyNs() - originNs < 10000000)
+        QThread::msleep(10);
+    const double nsPerTick = double(steadyNs() - originNs) / double(ticks() - originTicks);
+
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    // Times in microseconds from the first event
+    const qint64 firstTicks = events.isEmpty() ? 0 : events.first().event.start;
+    QByteArray out;
+    out.reserve(events.size() * 96 + 4096);
+    out.append("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto &thread : threads)
+    {
+        if (!first) out.append(",\n");
+        first = false;
+        out.append("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + QByteArray::number(thread.first)
+                   + ",\"args\":{\"name\":\"" + jsonEscape(thread.second.toUtf8()) + "\"}}");
+    }
+    for (const flushed_t &flushed : events)
+    {
+        const trace_event_t &event = flushed.event;
+        if (!first) out.append(",\n");
+        first = false;
+        out.append("{\"cat\":\"").append(jsonEscape(event.category))
+           .append("\",\"name\":\"").append(jsonEscape(event.name))
+           .append("\",\"pid\":1,\"tid\":").append(QByteArray::number(flushed.tid))
+           .append(",\"ts\":").append(QByteArray::number((event.start - firstTicks) * nsPerTick / 1000.0, 'f', 3));
+        if (event.duration < 0)
+            out.append(",\"ph\":\"i\",\"s\":\"t\"}");
+        else
+            out.append(",\"ph\":\"X\",\"dur\":").append(QByteArray::number(event.duration * nsPerTick / 1000.0, 'f', 3)).append("}");
+    }
+    out.append("\n]}\n");
+
+    if (file.write(out) != out.size()) return false;
+    return file.commit();
+}
+
+#endif // ANET_TRACE
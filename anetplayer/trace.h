@@ -0,0 +1,127 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Scoped trace events of the hot paths, saved as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev). Built only with "qmake CONFIG+=trace",
+// which defines ANET_TRACE, otherwise the macros expand to nothing.
+//   TRACE_SCOPE("net", "ArtNetSender::sendTime");
+// Category and name must be string literals, only the pointers are stored.
+
+#ifdef ANET_TRACE
+
+#include <QString>
+#include <QMutex>
+#include <QVector>
+#include <atomic>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRACE_TSC
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define TRACE_TSC
+#endif
+
+#define TRACE_BUFFER_SIZE 16384 // Events kept per thread, the oldest are overwritten
+
+typedef struct
+{
+    const char *category;
+    const char *name;
+    qint64 start;      // Trace::ticks()
+    qint64 duration;   // Ticks, -1 for an instant event
+} trace_event_t;
+
+// Every thread writes to its own ring, so recording takes no lock. A slot
+// carries a sequence number, the writer makes it odd while the event is
+// written, so a flush from another thread skips the slots being overwritten.
+// Time is read from the CPU time stamp counter where there is one, it is
+// cheaper than the system clock and is converted to ns when saved.
+class Trace
+{
+public:
+    static qint64 ticks()
+    {
+#ifdef TRACE_TSC
+        return static_cast<qint64>(__rdtsc());
+#else
+        return steadyNs();
+#endif
+    }
+
+    static qint64 steadyNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void record(const char *category, const char *name, qint64 start, qint64 duration)
+    {
+        buffer_t *buffer = threadBuffer ? threadBuffer : registerThread();
+        const quint64 index = buffer->written.load(std::memory_order_relaxed);
+        slot_t &slot = buffer->entries[index & (TRACE_BUFFER_SIZE - 1)];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.event.category = category;
+        slot.event.name = name;
+        slot.event.start = start;
+        slot.event.duration = duration;
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+        buffer->written.store(index + 1, std::memory_order_release);
+    }
+
+    static bool writeChromeJson(const QString &fileName); // Events of all threads
+
+private:
+    typedef struct
+    {
+        std::atomic<quint64> sequence{0};
+        trace_event_t event;
+    } slot_t;
+
+    typedef struct
+    {
+        alignas(64) std::atomic<quint64> written{0};
+        int tid = 0;
+        QString threadName;
+        slot_t entries[TRACE_BUFFER_SIZE]; // Not "slots", Qt defines it as a macro
+    } buffer_t;
+
+    static inline thread_local buffer_t *threadBuffer = nullptr;
+    static QMutex registryMutex;
+    static QVector<buffer_t*> registry; // Buffers live until the process exits
+    static const qint64 originTicks;    // Clock pair for the tick conversion
+    static const qint64 originNs;
+
+    static buffer_t *registerThread();
+};
+
+class TraceScope
+{
+public:
+    TraceScope(const char *category, const char *name)
+        : category(category), name(name), start(Trace::ticks()) {}
+    ~TraceScope() { Trace::record(category, name, start, Trace::ticks() - start); }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *category;
+    const char *name;
+    qint64 start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(category, name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(category, name)
+#define TRACE_INSTANT(category, name) Trace::record(category, name, Trace::ticks(), -1)
+
+#else
+
+#define TRACE_SCOPE(category, name)
+#define TRACE_INSTANT(category, name)
+
+#endif // ANET_TRACE
+
+#endif // TRACE_H